@@ -420,6 +420,40 @@ rasqal_new_distinct_algebra_node(rasqal_query* query,
 }
 
 
+/*
+ * rasqal_new_reduced_algebra_node:
+ * @query: #rasqal_query query object
+ * @node1: inner algebra node
+ *
+ * INTERNAL - Create a new REDUCED algebra node for an inner node
+ * 
+ * The input @node becomes owned by the new node
+ *
+ * Return value: a new #rasqal_algebra_node object or NULL on failure
+ **/
+rasqal_algebra_node*
+rasqal_new_reduced_algebra_node(rasqal_query* query,
+                                rasqal_algebra_node* node1)
+{
+  rasqal_algebra_node* node;
+
+  if(!query || !node1)
+    goto fail;
+
+  node = rasqal_new_algebra_node(query, RASQAL_ALGEBRA_OPERATOR_REDUCED);
+  if(node) {
+    node->node1 = node1;
+    return node;
+  }
+
+  fail:
+  if(node1)
+    rasqal_free_algebra_node(node1);
+
+  return NULL;
+}
+
+
 /*
  * rasqal_new_graph_algebra_node:
  * @query: #rasqal_query query object
@@ -915,7 +949,10 @@ rasqal_algebra_algebra_node_write_internal(rasqal_algebra_node *node,
     arg_count++;
   }
 
-  if(node->seq && node->op == RASQAL_ALGEBRA_OPERATOR_ORDERBY) {
+  if(node->seq && (node->op == RASQAL_ALGEBRA_OPERATOR_ORDERBY ||
+                    node->op == RASQAL_ALGEBRA_OPERATOR_GROUP ||
+                    node->op == RASQAL_ALGEBRA_OPERATOR_AGGREGATION ||
+                    node->op == RASQAL_ALGEBRA_OPERATOR_HAVING)) {
     int order_size = raptor_sequence_size(node->seq);
     if(order_size) {
       int i;
@@ -924,7 +961,10 @@ rasqal_algebra_algebra_node_write_internal(rasqal_algebra_node *node,
         raptor_iostream_counted_string_write(" ,\n", 3, iostr);
         rasqal_algebra_write_indent(iostr, indent);
       }
-      raptor_iostream_counted_string_write("Conditions([ ", 13, iostr);
+      if(node->op == RASQAL_ALGEBRA_OPERATOR_AGGREGATION)
+        raptor_iostream_counted_string_write("Expressions([ ", 14, iostr);
+      else
+        raptor_iostream_counted_string_write("Conditions([ ", 13, iostr);
       for(i = 0; i < order_size; i++) {
         rasqal_expression* e;
         e = (rasqal_expression*)raptor_sequence_get_at(node->seq, i);
@@ -937,7 +977,17 @@ rasqal_algebra_algebra_node_write_internal(rasqal_algebra_node *node,
     }
   }
 
-  if(node->vars_seq && node->op == RASQAL_ALGEBRA_OPERATOR_PROJECT) {
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_ORDERBY && node->distinct) {
+    if(arg_count) {
+      raptor_iostream_counted_string_write(" ,\n", 3, iostr);
+      rasqal_algebra_write_indent(iostr, indent);
+    }
+    raptor_iostream_counted_string_write("distinct", 8, iostr);
+    arg_count++;
+  }
+
+  if(node->vars_seq && (node->op == RASQAL_ALGEBRA_OPERATOR_PROJECT ||
+                        node->op == RASQAL_ALGEBRA_OPERATOR_AGGREGATION)) {
     if(arg_count) {
       raptor_iostream_counted_string_write(" ,\n", 3, iostr);
       rasqal_algebra_write_indent(iostr, indent);
@@ -948,6 +998,49 @@ rasqal_algebra_algebra_node_write_internal(rasqal_algebra_node *node,
     raptor_iostream_counted_string_write(" ])", 3, iostr);
   }
 
+  if(node->bindings && node->op == RASQAL_ALGEBRA_OPERATOR_VALUES) {
+    rasqal_bindings* bindings = node->bindings;
+    int i;
+
+    if(arg_count) {
+      raptor_iostream_counted_string_write(" ,\n", 3, iostr);
+      rasqal_algebra_write_indent(iostr, indent);
+    }
+    raptor_iostream_counted_string_write("Variables([ ", 12, iostr);
+    rasqal_variables_write(bindings->variables, iostr);
+    raptor_iostream_counted_string_write(" ]) ,\n", 6, iostr);
+    rasqal_algebra_write_indent(iostr, indent);
+    raptor_iostream_counted_string_write("Rows([ ", 7, iostr);
+    if(bindings->rows) {
+      rasqal_row* row;
+
+      for(i = 0;
+          (row = (rasqal_row*)raptor_sequence_get_at(bindings->rows, i));
+          i++) {
+        if(i > 0)
+          raptor_iostream_counted_string_write(", ", 2, iostr);
+        rasqal_row_write(row, iostr);
+      }
+    }
+    raptor_iostream_counted_string_write(" ])", 3, iostr);
+    arg_count++;
+  }
+
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_SERVICE && node->service_uri) {
+    if(arg_count) {
+      raptor_iostream_counted_string_write(" ,\n", 3, iostr);
+      rasqal_algebra_write_indent(iostr, indent);
+    }
+    raptor_iostream_string_write("service <", iostr);
+    raptor_iostream_string_write(raptor_uri_as_string(node->service_uri),
+                                 iostr);
+    raptor_iostream_counted_string_write("> ", 2, iostr);
+    if(node->query_string)
+      raptor_iostream_string_write(node->query_string, iostr);
+    raptor_iostream_write_byte('\n', iostr);
+    arg_count++;
+  }
+
   if(node->op == RASQAL_ALGEBRA_OPERATOR_SLICE) {
     if(arg_count) {
       raptor_iostream_counted_string_write(" ,\n", 3, iostr);
@@ -1307,6 +1400,27 @@ rasqal_algebra_group_graph_pattern_to_algebra(rasqal_query* query,
           true_expr = NULL; /* now owned by gnode */
         }
       } /* end for all optional */
+    } else if(egp->op == RASQAL_GRAPH_PATTERN_OPERATOR_MINUS) {
+      /* If E is of the form MINUS{P} */
+      rasqal_graph_pattern* sgp;
+      rasqal_algebra_node* anode;
+
+      sgp = rasqal_graph_pattern_get_sub_graph_pattern(egp, 0);
+
+      /* Let A := Transform(P) */
+      anode = sgp ? rasqal_algebra_graph_pattern_to_algebra(query, sgp) : NULL;
+      if(!anode) {
+        RASQAL_DEBUG1("rasqal_algebra_graph_pattern_to_algebra() failed\n");
+        goto fail;
+      }
+
+      /* G := Minus(G, A) */
+      gnode = rasqal_new_2op_algebra_node(query, RASQAL_ALGEBRA_OPERATOR_DIFF,
+                                          gnode, anode);
+      if(!gnode) {
+        RASQAL_DEBUG1("rasqal_new_2op_algebra_node() failed\n");
+        goto fail;
+      }
     } else {
       /* If E is any other form:*/
       rasqal_algebra_node* anode;
@@ -1622,6 +1736,259 @@ rasqal_algebra_node_is_empty(rasqal_algebra_node* node)
 }
 
 
+static int
+rasqal_algebra_expression_is_volatile(void *user_data, rasqal_expression *e)
+{
+  switch(e->op) {
+    case RASQAL_EXPR_BNODE:
+    case RASQAL_EXPR_CURRENT_DATETIME:
+    case RASQAL_EXPR_NOW:
+    case RASQAL_EXPR_RAND:
+    case RASQAL_EXPR_UUID:
+    case RASQAL_EXPR_STRUUID:
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+
+/* visit each expression of a node; non-0 if @fn returns non-0 */
+static int
+rasqal_algebra_node_expressions_visit(rasqal_algebra_node* node,
+                                      rasqal_expression_visit_fn fn,
+                                      void *user_data)
+{
+  if(node->expr && rasqal_expression_visit(node->expr, fn, user_data))
+    return 1;
+
+  if(node->seq && (node->op == RASQAL_ALGEBRA_OPERATOR_ORDERBY ||
+                   node->op == RASQAL_ALGEBRA_OPERATOR_GROUP ||
+                   node->op == RASQAL_ALGEBRA_OPERATOR_AGGREGATION ||
+                   node->op == RASQAL_ALGEBRA_OPERATOR_HAVING)) {
+    rasqal_expression* e;
+    int i;
+
+    for(i = 0;
+        (e = (rasqal_expression*)raptor_sequence_get_at(node->seq, i));
+        i++) {
+      if(rasqal_expression_visit(e, fn, user_data))
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_algebra_visitor_is_volatile(rasqal_query* query,
+                                   rasqal_algebra_node* node,
+                                   void* user_data)
+{
+  /* remote data may change between executions */
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_SERVICE)
+    return 1;
+
+  return rasqal_algebra_node_expressions_visit(node,
+                                               rasqal_algebra_expression_is_volatile,
+                                               NULL);
+}
+
+
+/*
+ * rasqal_algebra_node_is_volatile:
+ * @query: #rasqal_query query
+ * @node: #rasqal_algebra_node node
+ *
+ * INTERNAL - Check if an algebra node may give different results from the same data
+ *
+ * True if the tree contains a SERVICE or a function such as RAND(),
+ * NOW() or BNODE() that returns a new value each execution.
+ *
+ * Return value: non-0 if volatile
+ **/
+int
+rasqal_algebra_node_is_volatile(rasqal_query* query, rasqal_algebra_node* node)
+{
+  return rasqal_algebra_node_visit(query, node,
+                                   rasqal_algebra_visitor_is_volatile, NULL);
+}
+
+
+typedef struct {
+  /* variables bound inside the tree indexed by offset */
+  char* bound;
+  int width;
+} rasqal_algebra_correlation_state;
+
+
+static void
+rasqal_algebra_mark_bound(rasqal_algebra_correlation_state* state,
+                          rasqal_variable* v)
+{
+  if(v && v->offset >= 0 && v->offset < state->width)
+    state->bound[v->offset] = 1;
+}
+
+
+static int
+rasqal_algebra_visitor_mark_bound(rasqal_query* query,
+                                  rasqal_algebra_node* node,
+                                  void* user_data)
+{
+  rasqal_algebra_correlation_state* state;
+  rasqal_variable* v;
+  int i;
+
+  state = (rasqal_algebra_correlation_state*)user_data;
+
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_BGP && node->triples) {
+    for(i = node->start_column; i <= node->end_column; i++) {
+      rasqal_triple* t;
+
+      t = (rasqal_triple*)raptor_sequence_get_at(node->triples, i);
+      /* only variables this triple binds rather than reads */
+      if((v = rasqal_literal_as_variable(t->subject)) &&
+         rasqal_query_variable_bound_in_triple(query, v, i))
+        rasqal_algebra_mark_bound(state, v);
+      if((v = rasqal_literal_as_variable(t->predicate)) &&
+         rasqal_query_variable_bound_in_triple(query, v, i))
+        rasqal_algebra_mark_bound(state, v);
+      if((v = rasqal_literal_as_variable(t->object)) &&
+         rasqal_query_variable_bound_in_triple(query, v, i))
+        rasqal_algebra_mark_bound(state, v);
+      if(t->origin && (v = rasqal_literal_as_variable(t->origin)) &&
+         rasqal_query_variable_bound_in_triple(query, v, i))
+        rasqal_algebra_mark_bound(state, v);
+    }
+  }
+
+  if(node->var)
+    rasqal_algebra_mark_bound(state, node->var);
+
+  if(node->graph)
+    rasqal_algebra_mark_bound(state, rasqal_literal_as_variable(node->graph));
+
+  if(node->bindings && node->bindings->variables) {
+    for(i = 0;
+        (v = (rasqal_variable*)raptor_sequence_get_at(node->bindings->variables, i));
+        i++)
+      rasqal_algebra_mark_bound(state, v);
+  }
+
+  if(node->vars_seq && node->op == RASQAL_ALGEBRA_OPERATOR_AGGREGATION) {
+    for(i = 0;
+        (v = (rasqal_variable*)raptor_sequence_get_at(node->vars_seq, i));
+        i++)
+      rasqal_algebra_mark_bound(state, v);
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_algebra_literal_is_outer(rasqal_algebra_correlation_state* state,
+                                rasqal_literal* l)
+{
+  rasqal_variable* v = rasqal_literal_as_variable(l);
+
+  if(!v)
+    return 0;
+
+  return (v->offset < 0 || v->offset >= state->width || !state->bound[v->offset]);
+}
+
+
+static int
+rasqal_algebra_expression_uses_outer(void *user_data, rasqal_expression *e)
+{
+  rasqal_algebra_correlation_state* state;
+
+  state = (rasqal_algebra_correlation_state*)user_data;
+
+  if(e->literal)
+    return rasqal_algebra_literal_is_outer(state, e->literal);
+
+  return 0;
+}
+
+
+static int
+rasqal_algebra_visitor_uses_outer(rasqal_query* query,
+                                  rasqal_algebra_node* node,
+                                  void* user_data)
+{
+  rasqal_algebra_correlation_state* state;
+  int i;
+
+  state = (rasqal_algebra_correlation_state*)user_data;
+
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_BGP && node->triples) {
+    for(i = node->start_column; i <= node->end_column; i++) {
+      rasqal_triple* t;
+
+      t = (rasqal_triple*)raptor_sequence_get_at(node->triples, i);
+      if(rasqal_algebra_literal_is_outer(state, t->subject) ||
+         rasqal_algebra_literal_is_outer(state, t->predicate) ||
+         rasqal_algebra_literal_is_outer(state, t->object) ||
+         (t->origin && rasqal_algebra_literal_is_outer(state, t->origin)))
+        return 1;
+    }
+  }
+
+  return rasqal_algebra_node_expressions_visit(node,
+                                               rasqal_algebra_expression_uses_outer,
+                                               state);
+}
+
+
+/*
+ * rasqal_algebra_node_is_correlated:
+ * @query: #rasqal_query query
+ * @node: #rasqal_algebra_node node
+ *
+ * INTERNAL - Check if an algebra node reads variables bound outside it
+ *
+ * Triple patterns match against the current value of a variable
+ * bound by an earlier pattern and expressions evaluate with the
+ * current variable values, so a tree that mentions a variable it
+ * does not bind itself may return different rows depending on where
+ * it is executed.
+ *
+ * Return value: non-0 if correlated or on failure
+ **/
+int
+rasqal_algebra_node_is_correlated(rasqal_query* query,
+                                  rasqal_algebra_node* node)
+{
+  rasqal_algebra_correlation_state state;
+  int rc;
+
+  if(!query->triples_use_map)
+    return 1;
+
+  state.width = rasqal_variables_table_get_total_variables_count(query->vars_table);
+  if(state.width <= 0)
+    return 0;
+
+  state.bound = RASQAL_CALLOC(char*, RASQAL_GOOD_CAST(size_t, state.width), 1);
+  if(!state.bound)
+    return 1;
+
+  rasqal_algebra_node_visit(query, node, rasqal_algebra_visitor_mark_bound,
+                            &state);
+  rc = rasqal_algebra_node_visit(query, node, rasqal_algebra_visitor_uses_outer,
+                                 &state);
+
+  RASQAL_FREE(char*, state.bound);
+
+  return rc;
+}
+
+
 static int
 rasqal_algebra_remove_znodes(rasqal_query* query, rasqal_algebra_node* node,
                              void* data)
@@ -2470,7 +2837,10 @@ rasqal_algebra_query_add_distinct(rasqal_query* query,
   if(!projection)
     return node;
 
-  if(projection->distinct) {
+  if(projection->distinct == 2) {
+    /* REDUCED */
+    node = rasqal_new_reduced_algebra_node(query, node);
+  } else if(projection->distinct) {
     node = rasqal_new_distinct_algebra_node(query, node);
 
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
@@ -56,6 +56,7 @@
 /* Local definitions */
  
 static int rasqal_xsd_datetime_parse(const char *datetime_string, rasqal_xsd_datetime *result, int is_dateTime);
+static int rasqal_xsd_datetime_parse_general(const char *datetime_string, rasqal_xsd_datetime *result, int is_dateTime);
 static unsigned int days_per_month(int month, int year);
 
 
@@ -155,8 +156,138 @@ rasqal_xsd_datetime_normalize(rasqal_xsd_datetime *datetime)
 }
 
 
-/**
+/* Fixed layout of the common xsd:dateTime lexical form: 0 is a digit */
+static const char rasqal_xsd_datetime_fast_layout[] = "0000-00-00T00:00:00";
+#define RASQAL_XSD_DATETIME_FAST_LAYOUT_LEN 19
+
+#define DIGITS2(p) (((p)[0] - '0') * 10 + ((p)[1] - '0'))
+
+/*
+ * rasqal_xsd_datetime_parse_fast:
+ * @datetime_string: xsd:dateTime as lexical form string
+ * @result: target struct for holding dateTime components
+ *
+ * INTERNAL - Parse the common xsd:dateTime lexical form
+ * 'yyyy-mm-ddThh:mm:ss' ('.' s+)? ('Z' | ('+'|'-') hh ':' mm)?
+ * at fixed offsets.
+ *
+ * Any other form or an out of range value is left to
+ * rasqal_xsd_datetime_parse_general() which also reports errors.
+ * The @result is the same as that function would give.
+ *
+ * Return value: zero on success, non zero if the string was not handled
+ */
+static int
+rasqal_xsd_datetime_parse_fast(const char *datetime_string,
+                               rasqal_xsd_datetime *result)
+{
+  const char *p = datetime_string;
+  int i;
+  int year, month, day, hour, minute, second;
+  int microseconds = 0;
+
+  for(i = 0; i < RASQAL_XSD_DATETIME_FAST_LAYOUT_LEN; i++) {
+    if(rasqal_xsd_datetime_fast_layout[i] == '0') {
+      if(!ISNUM(p[i]))
+        return 1;
+    } else if(p[i] != rasqal_xsd_datetime_fast_layout[i])
+      return 1;
+  }
+
+  year = DIGITS2(p) * 100 + DIGITS2(p + 2);
+  month = DIGITS2(p + 5);
+  day = DIGITS2(p + 8);
+  hour = DIGITS2(p + 11);
+  minute = DIGITS2(p + 14);
+  second = DIGITS2(p + 17);
+
+  if(!year || month < 1 || month > 12 ||
+     day < 1 || day > RASQAL_GOOD_CAST(int, days_per_month(month, year)) ||
+     hour > 24 || minute > 59 || second > 59 ||
+     (hour == 24 && (minute || second)))
+    return 1;
+
+  p += RASQAL_XSD_DATETIME_FAST_LAYOUT_LEN;
+
+  if(*p == '.') {
+    const char *q = ++p;
+
+    for(; ISNUM(*p); p++) {
+      /* truncate to microseconds */
+      if(p - q < 6)
+        microseconds = microseconds * 10 + (*p - '0');
+    }
+    if(p == q)
+      return 1;
+
+    for(i = RASQAL_GOOD_CAST(int, p - q); i < 6; i++)
+      microseconds *= 10;
+  }
+
+  if(!*p) {
+    result->timezone_minutes = RASQAL_XSD_DATETIME_NO_TZ;
+    result->have_tz = 'N';
+  } else if(*p == 'Z' && !p[1]) {
+    result->timezone_minutes = 0;
+    result->have_tz = 'Z';
+  } else if((*p == '+' || *p == '-') &&
+            ISNUM(p[1]) && ISNUM(p[2]) && p[3] == ':' &&
+            ISNUM(p[4]) && ISNUM(p[5]) && !p[6]) {
+    int tz_hours = DIGITS2(p + 1);
+    int tz_minutes = DIGITS2(p + 4);
+
+    if(tz_hours > 14 || tz_minutes > 59 || (tz_hours == 14 && tz_minutes))
+      return 1;
+
+    tz_minutes += tz_hours * 60;
+    result->timezone_minutes = RASQAL_GOOD_CAST(short int, (*p == '-') ? -tz_minutes : tz_minutes);
+    result->have_tz = 'Y';
+  } else
+    return 1;
+
+  result->year = year;
+  result->month = RASQAL_GOOD_CAST(unsigned char, month);
+  result->day = RASQAL_GOOD_CAST(unsigned char, day);
+  result->hour = RASQAL_GOOD_CAST(signed char, hour);
+  result->minute = RASQAL_GOOD_CAST(signed char, minute);
+  result->second = RASQAL_GOOD_CAST(signed char, second);
+  result->microseconds = microseconds;
+  result->time_on_timeline = 0;
+
+  return 0;
+}
+
+
+/*
  * rasqal_xsd_datetime_parse:
+ * @datetime_string: xsd:dateTime or xsd:date as lexical form string
+ * @result: target struct for holding dateTime components
+ * @is_dateTime: is xsd:dateTime
+ *
+ * INTERNAL - Parse a xsd:dateTime or xsd:date string into a
+ * #rasqal_xsd_datetime struct, trying the fixed layout first.
+ *
+ * Return value: zero on success, non zero on failure.
+ */
+static int
+rasqal_xsd_datetime_parse(const char *datetime_string,
+                          rasqal_xsd_datetime *result,
+                          int is_dateTime)
+{
+  if(!datetime_string || !result)
+    return -1;
+
+  if(is_dateTime &&
+     !rasqal_xsd_datetime_parse_fast(datetime_string, result))
+    return 0;
+
+  return rasqal_xsd_datetime_parse_general(datetime_string, result,
+                                           is_dateTime);
+}
+
+
+/**
+ * rasqal_xsd_datetime_parse_general:
  * @datetime_string: xsd:dateTime as lexical form string
  * @result: target struct for holding dateTime components
  * @is_dateTime: is xsd:dateTime and should look for time (hour, mins, secs)
@@ -200,9 +331,9 @@ rasqal_xsd_datetime_normalize(rasqal_xsd_datetime *datetime)
  * Return value: zero on success, non zero on failure.
  */
 static int
-rasqal_xsd_datetime_parse(const char *datetime_string,
-                          rasqal_xsd_datetime *result,
-                          int is_dateTime)
+rasqal_xsd_datetime_parse_general(const char *datetime_string,
+                                  rasqal_xsd_datetime *result,
+                                  int is_dateTime)
 {
   const char *p, *q; 
 #define B_SIZE 16
@@ -1363,6 +1494,36 @@ rasqal_xsd_datetime_set_from_unixtime(rasqal_xsd_datetime* dt,
 }
 
 
+/*
+ * rasqal_xsd_days_from_civil:
+ * @year: year
+ * @month: month 1-12
+ * @day: day 1-31
+ *
+ * INTERNAL - Get the number of days from 1970-01-01 to a proleptic
+ * Gregorian calendar date
+ *
+ * Return value: days, negative before 1970-01-01
+ */
+static time_t
+rasqal_xsd_days_from_civil(signed int year, unsigned int month,
+                           unsigned int day)
+{
+  time_t y = RASQAL_GOOD_CAST(time_t, year) - (month <= 2);
+  time_t era;
+  time_t year_of_era;
+  time_t day_of_year;
+
+  /* 400 year eras of 146097 days, with March as the first month */
+  era = (y >= 0 ? y : y - 399) / 400;
+  year_of_era = y - era * 400;
+  day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+
+  return era * 146097 + year_of_era * 365 + year_of_era / 4 -
+    year_of_era / 100 + day_of_year - 719468;
+}
+
+
 /**
  * rasqal_xsd_datetime_get_as_unixtime:
  * @dt: datetime
@@ -1374,31 +1535,18 @@ rasqal_xsd_datetime_set_from_unixtime(rasqal_xsd_datetime* dt,
 time_t
 rasqal_xsd_datetime_get_as_unixtime(rasqal_xsd_datetime* dt)
 {
-  struct tm time_buf;
+  time_t days;
 
   if(!dt)
     return 0;
-  
-  memset(&time_buf, '\0', sizeof(time_buf));
 
-  time_buf.tm_year = dt->year - TM_YEAR_ORIGIN;
-  time_buf.tm_mon  = dt->month - TM_MONTH_ORIGIN;
-  time_buf.tm_mday = dt->day;
-  time_buf.tm_hour = dt->hour;
-  time_buf.tm_min  = dt->minute;
-  time_buf.tm_sec  = dt->second;
-  time_buf.tm_wday = 0;
-  time_buf.tm_yday = 0;
-  time_buf.tm_isdst = -1;
-
-#ifdef HAVE_TM_GMTOFF
-  if(dt->timezone_minutes == RASQAL_XSD_DATETIME_NO_TZ)
-    time_buf.tm_gmtoff = 0;
-  else
-    time_buf.tm_gmtoff = dt->timezone_minutes * 60;
-#endif
+  /* Same result as timegm() with the fields in a struct tm (any
+   * timezone offset is ignored) but computed directly rather than by
+   * a call that may switch the process timezone.
+   */
+  days = rasqal_xsd_days_from_civil(dt->year, dt->month, dt->day);
 
-  return rasqal_timegm(&time_buf);
+  return ((days * 24 + dt->hour) * 60 + dt->minute) * 60 + dt->second;
 }
 
 
@@ -1922,6 +2070,176 @@ test_datetime_compare(rasqal_world* world, const char *value1, const char *value
 }
 
 
+static const char* const datetime_fast_tests[] = {
+  "2004-12-31T19:01:00Z",
+  "2004-12-31T19:01:00",
+  "2004-12-31T19:01:00.5Z",
+  "2004-12-31T19:01:00.1234567+05:30",
+  "2004-12-31T19:01:00.000",
+  "2004-12-31T19:01:00.0001-00:00",
+  "2004-12-31T24:00:00-14:00",
+  "0001-01-01T00:00:00Z",
+  /* not handled by the fast parser */
+  "2004-12-31T24:00:01Z",
+  "2004-02-30T00:00:00Z",
+  "0000-01-01T00:00:00Z",
+  "2004-12-31T19:01:00.Z",
+  "2004-12-31T19:01:00+14:30",
+  "2004-12-31T19:01:00+5:30",
+  "2004-12-31T19:01:00ZZ",
+  "12004-12-31T19:01:00Z",
+  "-2004-12-31T19:01:00Z",
+  "2004-12-31 19:01:00",
+  "2004-12-31T19:01",
+  NULL
+};
+
+
+/* check the fast parser agrees with the general one */
+static int
+test_datetime_parse_fast(const char* program)
+{
+  int failures = 0;
+  int i;
+
+  for(i = 0; datetime_fast_tests[i]; i++) {
+    const char* str = datetime_fast_tests[i];
+    rasqal_xsd_datetime fast_dt;
+    rasqal_xsd_datetime general_dt;
+    int fast_rc;
+    int general_rc;
+
+    memset(&fast_dt, '\0', sizeof(fast_dt));
+    memset(&general_dt, '\0', sizeof(general_dt));
+    fast_rc = rasqal_xsd_datetime_parse_fast(str, &fast_dt);
+    general_rc = rasqal_xsd_datetime_parse_general(str, &general_dt, 1);
+
+    if(!fast_rc &&
+       (general_rc || memcmp(&fast_dt, &general_dt, sizeof(fast_dt)))) {
+      fprintf(stderr, "%s: fast parse of dateTime \"%s\" differs\n",
+              program, str);
+      failures++;
+    }
+
+    if(!rasqal_xsd_datetime_parse(str, &fast_dt, 1) != !general_rc) {
+      fprintf(stderr, "%s: parse of dateTime \"%s\" returned %s\n",
+              program, str, general_rc ? "success" : "failure");
+      failures++;
+    }
+  }
+
+  return failures;
+}
+
+
+/* check the timeline agrees with timegm() */
+static int
+test_datetime_timeline(const char* program)
+{
+  int failures = 0;
+  int year;
+
+  for(year = 1901; year < 2100; year += 7) {
+    unsigned char month;
+
+    for(month = 1; month <= 12; month++) {
+      rasqal_xsd_datetime dt;
+      struct tm time_buf;
+      time_t expected;
+
+      memset(&dt, '\0', sizeof(dt));
+      dt.year = year;
+      dt.month = month;
+      dt.day = RASQAL_GOOD_CAST(unsigned char, days_per_month(month, year));
+      dt.hour = 23;
+      dt.minute = 59;
+      dt.second = 58;
+
+      memset(&time_buf, '\0', sizeof(time_buf));
+      time_buf.tm_year = dt.year - TM_YEAR_ORIGIN;
+      time_buf.tm_mon = dt.month - TM_MONTH_ORIGIN;
+      time_buf.tm_mday = dt.day;
+      time_buf.tm_hour = dt.hour;
+      time_buf.tm_min = dt.minute;
+      time_buf.tm_sec = dt.second;
+      expected = rasqal_timegm(&time_buf);
+
+      if(rasqal_xsd_datetime_get_as_unixtime(&dt) != expected) {
+        fprintf(stderr, "%s: timeline of %d-%02d differs from timegm\n",
+                program, year, month);
+        failures++;
+      }
+    }
+  }
+
+  return failures;
+}
+
+
+#define DATETIME_SORT_COUNT 1000
+
+static int
+datetime_sort_compare(const void *a, const void *b)
+{
+  rasqal_xsd_datetime* dt1 = *(rasqal_xsd_datetime* const*)a;
+  rasqal_xsd_datetime* dt2 = *(rasqal_xsd_datetime* const*)b;
+
+  return rasqal_xsd_datetime_compare2(dt1, dt2, NULL);
+}
+
+
+/* parse and sort timestamps as ORDER BY over event data would */
+static int
+test_datetime_sort(rasqal_world* world, const char* program)
+{
+  rasqal_xsd_datetime** dts;
+  unsigned long seed = 1;
+  int failures = 0;
+  int i;
+
+  dts = RASQAL_CALLOC(rasqal_xsd_datetime**, DATETIME_SORT_COUNT,
+                      sizeof(rasqal_xsd_datetime*));
+  if(!dts)
+    return 1;
+
+  for(i = 0; i < DATETIME_SORT_COUNT; i++) {
+    char buffer[40];
+
+    seed = seed * 1103515245UL + 12345UL;
+    sprintf(buffer, "%04lu-%02lu-%02luT%02lu:%02lu:%02lu.%03luZ",
+            1970 + (seed >> 8) % 60, 1 + (seed >> 4) % 12,
+            1 + (seed >> 12) % 28, (seed >> 16) % 24, (seed >> 20) % 60,
+            (seed >> 3) % 60, (seed >> 6) % 1000);
+    dts[i] = rasqal_new_xsd_datetime(world, buffer);
+    if(!dts[i]) {
+      fprintf(stderr, "%s: failed to parse dateTime %s\n", program, buffer);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  qsort(dts, DATETIME_SORT_COUNT, sizeof(rasqal_xsd_datetime*),
+        datetime_sort_compare);
+
+  for(i = 1; i < DATETIME_SORT_COUNT; i++) {
+    if(datetime_sort_compare(&dts[i - 1], &dts[i]) > 0) {
+      fprintf(stderr, "%s: dateTimes not sorted at %d\n", program, i);
+      failures++;
+      break;
+    }
+  }
+
+  tidy:
+  for(i = 0; i < DATETIME_SORT_COUNT; i++) {
+    if(dts[i])
+      rasqal_free_xsd_datetime(dts[i]);
+  }
+  RASQAL_FREE(rasqal_xsd_datetime**, dts);
+
+  return failures;
+}
+
+
 int
 main(int argc, char *argv[])
 {
@@ -2251,6 +2569,10 @@ main(int argc, char *argv[])
     MYASSERT((new_secs = rasqal_xsd_datetime_get_as_unixtime(&dt)));
     MYASSERT(new_secs == secs);
   }
+
+  MYASSERT(test_datetime_parse_fast(program) == 0);
+  MYASSERT(test_datetime_timeline(program) == 0);
+  MYASSERT(test_datetime_sort(world, program) == 0);
   
   rasqal_free_world(world);
 
@@ -44,6 +44,9 @@
 #ifdef HAVE_FLOAT_H
 #include <float.h>
 #endif
+#ifdef HAVE_LIMITS_H
+#include <limits.h>
+#endif
 
 #include "rasqal.h"
 #include "rasqal_internal.h"
@@ -96,6 +99,29 @@ static void rasqal_xsd_decimal_clear(rasqal_xsd_decimal* dec);
 #endif
 #endif
 
+#ifdef HAVE___INT128
+/* Fixed point fast path
+ *
+ * Most decimals seen in data (prices, measurements) have few digits.
+ * These are held exactly as a 128 bit integer scaled by a power of 10
+ * and added, subtracted, multiplied and compared with integer
+ * arithmetic.  The implementation above is only used when a value
+ * does not fit in 38 digits or needs more than
+ * RASQAL_DECIMAL_FIXED_MAX_SCALE fractional digits, or for division.
+ */
+#define RASQAL_DECIMAL_FIXED 1
+typedef __int128 rasqal_decimal_fixed;
+
+/* largest fixed magnitude: 10^38 - 1 */
+#define RASQAL_DECIMAL_FIXED_MAX_DIGITS 38
+#define RASQAL_DECIMAL_FIXED_MAX \
+  ((rasqal_decimal_fixed)10000000000000000000ULL * \
+   (rasqal_decimal_fixed)10000000000000000000ULL - 1)
+
+/* most fractional digits kept: the 18 digits output by as_string */
+#define RASQAL_DECIMAL_FIXED_MAX_SCALE 18
+#endif
+
 struct rasqal_xsd_decimal_s {
   unsigned int precision_digits;
   unsigned int precision_bits;
@@ -103,6 +129,14 @@ struct rasqal_xsd_decimal_s {
   RASQAL_DECIMAL_ROUNDING rounding;
   char* string;
   size_t string_len;
+#ifdef RASQAL_DECIMAL_FIXED
+  /* non-0 if the value is @fixed / 10^@scale */
+  int is_fixed;
+  /* non-0 if @raw holds the value too */
+  int raw_valid;
+  rasqal_decimal_fixed fixed;
+  unsigned int scale;
+#endif
 };
 
 
@@ -179,6 +213,13 @@ rasqal_xsd_decimal_init(rasqal_xsd_decimal* dec)
 
   dec->string = NULL;
   dec->string_len = 0;
+
+#ifdef RASQAL_DECIMAL_FIXED
+  dec->is_fixed = 1;
+  dec->raw_valid = 1;
+  dec->fixed = 0;
+  dec->scale = 0;
+#endif
 }
 
 
@@ -208,7 +249,296 @@ rasqal_xsd_decimal_clear(rasqal_xsd_decimal* dec)
 #ifdef RASQAL_DECIMAL_NONE
   dec->raw= 0e0;
 #endif
-}  
+}
+
+
+#ifdef RASQAL_DECIMAL_FIXED
+/* big enough for a sign, 38 digits, a point and a trailing 0 */
+#define RASQAL_DECIMAL_FIXED_BUFFER_SIZE 48
+
+static rasqal_decimal_fixed
+rasqal_decimal_fixed_pow10(unsigned int n)
+{
+  rasqal_decimal_fixed p = 1;
+
+  while(n--)
+    p *= 10;
+
+  return p;
+}
+
+
+/* *r = a + b where |a|, |b| are in range; non-0 if result is not */
+static int
+rasqal_decimal_fixed_add(rasqal_decimal_fixed a, rasqal_decimal_fixed b,
+                         rasqal_decimal_fixed* r)
+{
+  if(b > 0 ? (a > RASQAL_DECIMAL_FIXED_MAX - b) :
+             (a < -RASQAL_DECIMAL_FIXED_MAX - b))
+    return 1;
+
+  *r = a + b;
+  return 0;
+}
+
+
+/* *r = a * b where |a|, |b| are in range; non-0 if result is not */
+static int
+rasqal_decimal_fixed_multiply(rasqal_decimal_fixed a, rasqal_decimal_fixed b,
+                              rasqal_decimal_fixed* r)
+{
+  rasqal_decimal_fixed abs_a = (a < 0) ? -a : a;
+  rasqal_decimal_fixed abs_b = (b < 0) ? -b : b;
+
+  if(abs_b && abs_a > RASQAL_DECIMAL_FIXED_MAX / abs_b)
+    return 1;
+
+  *r = a * b;
+  return 0;
+}
+
+
+/*
+ * Parse a plain xsd:decimal lexical form "[+-]digits[.digits]" into
+ * @v_p / 10^@scale_p with trailing fractional zeros dropped.
+ *
+ * Return value: non-0 if the form is not recognised or does not fit
+ */
+static int
+rasqal_decimal_fixed_parse(const char* string, rasqal_decimal_fixed* v_p,
+                           unsigned int* scale_p)
+{
+  const char* p = string;
+  rasqal_decimal_fixed v = 0;
+  unsigned int ndigits = 0;
+  unsigned int scale = 0;
+  unsigned int zeros = 0;
+  int negative = 0;
+  int seen_digit = 0;
+  int seen_point = 0;
+
+  if(*p == '-') {
+    negative = 1;
+    p++;
+  } else if(*p == '+')
+    p++;
+
+  for(; *p; p++) {
+    unsigned int count = 1;
+    int digit;
+
+    if(*p == '.') {
+      if(seen_point)
+        return 1;
+      seen_point = 1;
+      continue;
+    }
+
+    if(*p < '0' || *p > '9')
+      return 1;
+
+    seen_digit = 1;
+    digit = *p - '0';
+
+    if(seen_point) {
+      /* hold back fractional zeros until a later non-0 digit */
+      if(!digit) {
+        zeros++;
+        continue;
+      }
+      count += zeros;
+      zeros = 0;
+      scale += count;
+      if(scale > RASQAL_DECIMAL_FIXED_MAX_SCALE)
+        return 1;
+    }
+
+    /* leading zeros are not significant */
+    if(v || digit) {
+      ndigits = v ? ndigits + count : 1;
+      if(ndigits > RASQAL_DECIMAL_FIXED_MAX_DIGITS)
+        return 1;
+
+      while(--count)
+        v *= 10;
+      v = v * 10 + digit;
+    }
+  }
+
+  if(!seen_digit)
+    return 1;
+
+  *v_p = negative ? -v : v;
+  *scale_p = scale;
+
+  return 0;
+}
+
+
+/*
+ * Format @v / 10^@scale in canonical form into @buffer of at least
+ * RASQAL_DECIMAL_FIXED_BUFFER_SIZE bytes.  @v must have no trailing
+ * fractional zeros.
+ *
+ * Return value: length of formatted string
+ */
+static size_t
+rasqal_decimal_fixed_format(rasqal_decimal_fixed v, unsigned int scale,
+                            char* buffer)
+{
+  char digits[RASQAL_DECIMAL_FIXED_MAX_DIGITS];
+  unsigned int ndigits = 0;
+  unsigned int i;
+  char* p = buffer;
+
+  if(v < 0) {
+    *p++ = '-';
+    v = -v;
+  }
+
+  /* least significant digit first */
+  do {
+    digits[ndigits++] = RASQAL_GOOD_CAST(char, '0' + (int)(v % 10));
+    v /= 10;
+  } while(v);
+
+  if(ndigits > scale) {
+    for(i = ndigits; i > scale; i--)
+      *p++ = digits[i - 1];
+  } else
+    *p++ = '0';
+
+  *p++ = '.';
+
+  if(scale) {
+    for(i = scale; i > 0; i--)
+      *p++ = (i <= ndigits) ? digits[i - 1] : '0';
+  } else
+    *p++ = '0';
+
+  *p = '\0';
+
+  return RASQAL_GOOD_CAST(size_t, p - buffer);
+}
+
+
+static void
+rasqal_xsd_decimal_set_fixed(rasqal_xsd_decimal* dec, rasqal_decimal_fixed v,
+                             unsigned int scale)
+{
+  while(scale && !(v % 10)) {
+    v /= 10;
+    scale--;
+  }
+
+  dec->is_fixed = 1;
+  dec->raw_valid = 0;
+  dec->fixed = v;
+  dec->scale = scale;
+}
+
+
+/* Bring fixed decimals @a and @b to a common scale: non-0 on overflow */
+static int
+rasqal_xsd_decimal_fixed_align(rasqal_xsd_decimal* a, rasqal_xsd_decimal* b,
+                               rasqal_decimal_fixed* a_p,
+                               rasqal_decimal_fixed* b_p,
+                               unsigned int* scale_p)
+{
+  *a_p = a->fixed;
+  *b_p = b->fixed;
+
+  if(a->scale < b->scale) {
+    *scale_p = b->scale;
+    return rasqal_decimal_fixed_multiply(a->fixed,
+                                         rasqal_decimal_fixed_pow10(b->scale - a->scale),
+                                         a_p);
+  }
+
+  *scale_p = a->scale;
+  if(b->scale < a->scale)
+    return rasqal_decimal_fixed_multiply(b->fixed,
+                                         rasqal_decimal_fixed_pow10(a->scale - b->scale),
+                                         b_p);
+
+  return 0;
+}
+
+
+/* Make @dec->raw hold the value of a fixed decimal: non-0 on failure */
+static int
+rasqal_xsd_decimal_ensure_raw(rasqal_xsd_decimal* dec)
+{
+  char buffer[RASQAL_DECIMAL_FIXED_BUFFER_SIZE];
+  int rc = 0;
+
+  if(!dec->is_fixed || dec->raw_valid)
+    return 0;
+
+  rasqal_decimal_fixed_format(dec->fixed, dec->scale, buffer);
+
+#if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
+  dec->raw = strtod(buffer, NULL);
+#endif
+#ifdef RASQAL_DECIMAL_MPFR
+  rc = mpfr_set_str(dec->raw, buffer, 10, dec->rounding);
+#endif
+#ifdef RASQAL_DECIMAL_GMP
+  rc = mpf_set_str(dec->raw, buffer, 10);
+#endif
+
+  dec->raw_valid = 1;
+
+  return rc;
+}
+
+
+/*
+ * Round fixed decimal @a to an integer into @result: to -infinity if
+ * @mode is < 0, to +infinity if > 0 otherwise to nearest the same way
+ * as the implementation round.
+ */
+static void
+rasqal_xsd_decimal_fixed_integer(rasqal_xsd_decimal* result,
+                                 rasqal_xsd_decimal* a, int mode)
+{
+  rasqal_decimal_fixed p = rasqal_decimal_fixed_pow10(a->scale);
+  rasqal_decimal_fixed q = a->fixed / p;
+  rasqal_decimal_fixed r = a->fixed % p;
+
+  if(mode < 0) {
+    if(r < 0)
+      q--;
+  } else if(mode > 0) {
+    if(r > 0)
+      q++;
+  } else {
+#ifdef RASQAL_DECIMAL_GMP
+    /* floor(a + 0.5) */
+    if(r > 0 && 2 * r >= p)
+      q++;
+    else if(r < 0 && -2 * r > p)
+      q--;
+#else
+    /* halfway cases away from zero */
+    if(r > 0 && 2 * r >= p)
+      q++;
+    else if(r < 0 && -2 * r >= p)
+      q--;
+#endif
+  }
+
+  rasqal_xsd_decimal_set_fixed(result, q, 0);
+}
+
+#define RASQAL_DECIMAL_ENSURE_RAW(dec) rasqal_xsd_decimal_ensure_raw(dec)
+/* mark @dec as set by the implementation */
+#define RASQAL_DECIMAL_RAW_RESULT(dec) \
+  do { (dec)->is_fixed = 0; (dec)->raw_valid = 1; } while(0)
+#else
+#define RASQAL_DECIMAL_ENSURE_RAW(dec) 0
+#define RASQAL_DECIMAL_RAW_RESULT(dec) do { } while(0)
+#endif
 
 
 /**
@@ -238,7 +568,17 @@ rasqal_xsd_decimal_set_string(rasqal_xsd_decimal* dec, const char* string)
 
   memcpy(dec->string, string, len + 1);
   dec->string_len = len;
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(!rasqal_decimal_fixed_parse(string, &dec->fixed, &dec->scale)) {
+    dec->is_fixed = 1;
+    dec->raw_valid = 0;
+    return 0;
+  }
+#endif
+
+  RASQAL_DECIMAL_RAW_RESULT(dec);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   dec->raw = strtod(string, NULL);
 #endif
@@ -273,6 +613,11 @@ rasqal_xsd_decimal_set_long(rasqal_xsd_decimal* dec, long l)
   
   rasqal_xsd_decimal_clear_string(dec);
 
+#ifdef RASQAL_DECIMAL_FIXED
+  rasqal_xsd_decimal_set_fixed(dec, l, 0);
+  return 0;
+#endif
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   dec->raw=l;
 #endif
@@ -302,6 +647,8 @@ rasqal_xsd_decimal_set_double(rasqal_xsd_decimal* dec, double d)
   
   rasqal_xsd_decimal_clear_string(dec);
 
+  RASQAL_DECIMAL_RAW_RESULT(dec);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   dec->raw=d;
 #endif
@@ -328,6 +675,21 @@ rasqal_xsd_decimal_get_double(rasqal_xsd_decimal* dec)
 {
   double result=0e0;
 
+#ifdef RASQAL_DECIMAL_FIXED
+  /* exact when both integer and power of 10 are exact doubles */
+  static const double powers_of_10[RASQAL_DECIMAL_FIXED_MAX_SCALE + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+  };
+  const rasqal_decimal_fixed max_exact = (rasqal_decimal_fixed)1 << 53;
+
+  if(dec->is_fixed && dec->fixed <= max_exact && dec->fixed >= -max_exact)
+    return (double)dec->fixed / powers_of_10[dec->scale];
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(dec))
+    return result;
+#endif
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result=(double)dec->raw;
 #endif
@@ -355,6 +717,32 @@ rasqal_xsd_decimal_get_long(rasqal_xsd_decimal* dec, int* error_p)
 {
   long result = 0;
 
+#ifdef RASQAL_DECIMAL_FIXED
+#ifdef RASQAL_DECIMAL_MPFR
+  /* MPFR rounds fractions by the rounding mode so leave those to it */
+  if(dec->is_fixed && !dec->scale) {
+#else
+  if(dec->is_fixed) {
+#endif
+    /* truncate */
+    rasqal_decimal_fixed q;
+
+    q = dec->fixed / rasqal_decimal_fixed_pow10(dec->scale);
+    if(q > LONG_MAX || q < LONG_MIN) {
+      if(error_p)
+        *error_p = 1;
+      return 0;
+    }
+    return (long)q;
+  }
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(dec)) {
+    if(error_p)
+      *error_p = 1;
+    return 0;
+  }
+#endif
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result=(long)dec->raw;
 #endif
@@ -419,7 +807,19 @@ rasqal_xsd_decimal_as_string(rasqal_xsd_decimal* dec)
   
   if(dec->string)
     return dec->string;
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(dec->is_fixed) {
+    s = RASQAL_MALLOC(char*, RASQAL_DECIMAL_FIXED_BUFFER_SIZE);
+    if(!s)
+      return NULL;
+
+    dec->string_len = rasqal_decimal_fixed_format(dec->fixed, dec->scale, s);
+    dec->string = s;
+    return s;
+  }
+#endif
+
 #ifdef RASQAL_DECIMAL_C99
   len = dec->precision_digits;
   s = RASQAL_MALLOC(cstring, len + 1);
@@ -537,7 +937,25 @@ rasqal_xsd_decimal_add(rasqal_xsd_decimal* result,
   int rc=0;
 
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed && b->is_fixed) {
+    rasqal_decimal_fixed x;
+    rasqal_decimal_fixed y;
+    unsigned int scale;
+
+    if(!rasqal_xsd_decimal_fixed_align(a, b, &x, &y, &scale) &&
+       !rasqal_decimal_fixed_add(x, y, &x)) {
+      rasqal_xsd_decimal_set_fixed(result, x, scale);
+      return 0;
+    }
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = a->raw + b->raw;
 #endif
@@ -569,7 +987,25 @@ rasqal_xsd_decimal_subtract(rasqal_xsd_decimal* result,
   int rc=0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed && b->is_fixed) {
+    rasqal_decimal_fixed x;
+    rasqal_decimal_fixed y;
+    unsigned int scale;
+
+    if(!rasqal_xsd_decimal_fixed_align(a, b, &x, &y, &scale) &&
+       !rasqal_decimal_fixed_add(x, -y, &x)) {
+      rasqal_xsd_decimal_set_fixed(result, x, scale);
+      return 0;
+    }
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = a->raw - b->raw;
 #endif
@@ -601,7 +1037,23 @@ rasqal_xsd_decimal_multiply(rasqal_xsd_decimal* result,
   int rc=0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed && b->is_fixed &&
+     a->scale + b->scale <= RASQAL_DECIMAL_FIXED_MAX_SCALE) {
+    rasqal_decimal_fixed x;
+
+    if(!rasqal_decimal_fixed_multiply(a->fixed, b->fixed, &x)) {
+      rasqal_xsd_decimal_set_fixed(result, x, a->scale + b->scale);
+      return 0;
+    }
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = a->raw * b->raw;
 #endif
@@ -629,6 +1081,11 @@ rasqal_xsd_decimal_is_zero(rasqal_xsd_decimal* d)
 {
   int rc = 0;
 
+#ifdef RASQAL_DECIMAL_FIXED
+  if(d->is_fixed)
+    return !d->fixed;
+#endif
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   rc = fabs(d->raw) < RASQAL_DOUBLE_EPSILON;
 #endif
@@ -665,7 +1122,11 @@ rasqal_xsd_decimal_divide(rasqal_xsd_decimal* result,
 
   if(rasqal_xsd_decimal_is_zero(b))
     return 1;
-  
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = a->raw / b->raw;
 #endif
@@ -695,7 +1156,18 @@ rasqal_xsd_decimal_negate(rasqal_xsd_decimal* result, rasqal_xsd_decimal* a)
   int rc=0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed) {
+    rasqal_xsd_decimal_set_fixed(result, -a->fixed, a->scale);
+    return 0;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = -a->raw;
 #endif
@@ -725,7 +1197,18 @@ rasqal_xsd_decimal_abs(rasqal_xsd_decimal* result, rasqal_xsd_decimal* a)
   int rc = 0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed) {
+    rasqal_xsd_decimal_set_fixed(result, (a->fixed < 0) ? -a->fixed : a->fixed, a->scale);
+    return 0;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = fabs(a->raw);
 #endif
@@ -759,7 +1242,18 @@ rasqal_xsd_decimal_round(rasqal_xsd_decimal* result, rasqal_xsd_decimal* a)
 #endif
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed) {
+    rasqal_xsd_decimal_fixed_integer(result, a, 0);
+    return 0;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = round(a->raw);
 #endif
@@ -798,7 +1292,18 @@ rasqal_xsd_decimal_ceil(rasqal_xsd_decimal* result, rasqal_xsd_decimal* a)
   int rc = 0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed) {
+    rasqal_xsd_decimal_fixed_integer(result, a, 1);
+    return 0;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = ceil(a->raw);
 #endif
@@ -828,7 +1333,18 @@ rasqal_xsd_decimal_floor(rasqal_xsd_decimal* result, rasqal_xsd_decimal* a)
   int rc = 0;
   
   rasqal_xsd_decimal_clear_string(result);
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed) {
+    rasqal_xsd_decimal_fixed_integer(result, a, -1);
+    return 0;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a))
+    return 1;
+  RASQAL_DECIMAL_RAW_RESULT(result);
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   result->raw = floor(a->raw);
 #endif
@@ -856,7 +1372,21 @@ int
 rasqal_xsd_decimal_compare(rasqal_xsd_decimal* a, rasqal_xsd_decimal* b)
 {
   int rc = 0;
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed && b->is_fixed) {
+    rasqal_decimal_fixed x;
+    rasqal_decimal_fixed y;
+    unsigned int scale;
+
+    if(!rasqal_xsd_decimal_fixed_align(a, b, &x, &y, &scale))
+      return (x > y) - (x < y);
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 0;
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   rc = rasqal_double_approximately_compare(a->raw, b->raw);
 #endif
@@ -884,7 +1414,17 @@ int
 rasqal_xsd_decimal_equals(rasqal_xsd_decimal* a, rasqal_xsd_decimal* b)
 {
   int rc;
-  
+
+#ifdef RASQAL_DECIMAL_FIXED
+  if(a->is_fixed && b->is_fixed) {
+    /* both have no trailing fractional zeros so equal values match */
+    return a->scale == b->scale && a->fixed == b->fixed;
+  }
+#endif
+
+  if(RASQAL_DECIMAL_ENSURE_RAW(a) || RASQAL_DECIMAL_ENSURE_RAW(b))
+    return 0;
+
 #if defined(RASQAL_DECIMAL_C99) || defined(RASQAL_DECIMAL_NONE)
   rc = rasqal_double_approximately_equal(b->raw, a->raw);
 #elif defined(RASQAL_DECIMAL_MPFR)
@@ -906,6 +1446,156 @@ rasqal_xsd_decimal_equals(rasqal_xsd_decimal* a, rasqal_xsd_decimal* b)
 
 int main(int argc, char *argv[]);
 
+
+typedef struct {
+  const char* a;
+  char op;
+  const char* b;
+  const char* expected;
+} decimal_op_test;
+
+static const decimal_op_test decimal_op_tests[] = {
+  { "0.1",    '+', "0.2",    "0.3" },
+  { "12.50",  '+', "7.25",   "19.75" },
+  { "+3",     '-', "3.000",  "0.0" },
+  { "-0.005", '-', "0.995",  "-1.0" },
+  { "1.5",    '*', "1.5",    "2.25" },
+  { "-0.25",  '*', "400",    "-100.0" },
+  { "1",      '/', "4",      "0.25" },
+  { "-1.5",   'f', NULL,     "-2.0" },
+  { "-1.5",   'c', NULL,     "-1.0" },
+  { "2.5",    'r', NULL,     "3.0" },
+  { "0.75",   'r', NULL,     "1.0" },
+  { "007.10", 'a', NULL,     "7.1" },
+  { "-.5",    'a', NULL,     "0.5" },
+  { NULL,     0,   NULL,     NULL }
+};
+
+
+static int
+decimal_test_ops(const char* program, rasqal_world* world)
+{
+  rasqal_xsd_decimal* a = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* b = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* result = rasqal_new_xsd_decimal(world);
+  int failures = 0;
+  int i;
+
+  for(i = 0; decimal_op_tests[i].a; i++) {
+    const decimal_op_test* t = &decimal_op_tests[i];
+    char* result_s;
+    int rc = 0;
+
+    rasqal_xsd_decimal_set_string(a, t->a);
+    if(t->b)
+      rasqal_xsd_decimal_set_string(b, t->b);
+
+    switch(t->op) {
+      case '+': rc = rasqal_xsd_decimal_add(result, a, b); break;
+      case '-': rc = rasqal_xsd_decimal_subtract(result, a, b); break;
+      case '*': rc = rasqal_xsd_decimal_multiply(result, a, b); break;
+      case '/': rc = rasqal_xsd_decimal_divide(result, a, b); break;
+      case 'f': rc = rasqal_xsd_decimal_floor(result, a); break;
+      case 'c': rc = rasqal_xsd_decimal_ceil(result, a); break;
+      case 'r': rc = rasqal_xsd_decimal_round(result, a); break;
+      case 'a': rc = rasqal_xsd_decimal_abs(result, a); break;
+      default: rc = 1; break;
+    }
+
+    result_s = rc ? NULL : rasqal_xsd_decimal_as_string(result);
+    if(!result_s || strcmp(result_s, t->expected)) {
+      fprintf(stderr, "%s: FAILED: %s %c %s = %s expected %s\n", program,
+              t->a, t->op, t->b ? t->b : "", result_s ? result_s : "(error)",
+              t->expected);
+      failures++;
+    }
+  }
+
+  /* 38 digits times 4 no longer fits and must give the same value
+   * as that number parsed by the general implementation */
+  rasqal_xsd_decimal_set_string(a, "98765432109876543210987654321098765432");
+  rasqal_xsd_decimal_set_long(b, 4);
+  rasqal_xsd_decimal_multiply(result, a, b);
+  rasqal_xsd_decimal_set_string(b, "395061728439506172843950617284395061728");
+  if(rasqal_xsd_decimal_compare(result, b) || rasqal_xsd_decimal_compare(b, result)) {
+    fprintf(stderr, "%s: FAILED: overflowed multiply %s expected %s\n",
+            program, rasqal_xsd_decimal_as_string(result),
+            rasqal_xsd_decimal_as_string(b));
+    failures++;
+  }
+
+  /* mixed scales compare by value */
+  rasqal_xsd_decimal_set_string(a, "2.50");
+  rasqal_xsd_decimal_set_string(b, "2.5000");
+  if(rasqal_xsd_decimal_compare(a, b) || !rasqal_xsd_decimal_equals(a, b)) {
+    fprintf(stderr, "%s: FAILED: 2.50 not equal to 2.5000\n", program);
+    failures++;
+  }
+  rasqal_xsd_decimal_set_string(b, "2.49");
+  if(rasqal_xsd_decimal_compare(a, b) <= 0) {
+    fprintf(stderr, "%s: FAILED: 2.50 not greater than 2.49\n", program);
+    failures++;
+  }
+
+  rasqal_free_xsd_decimal(a);
+  rasqal_free_xsd_decimal(b);
+  rasqal_free_xsd_decimal(result);
+
+  return failures;
+}
+
+
+#define DECIMAL_SUM_COUNT 10000
+
+/* SUM and AVG of prices 0.00, 1.01, ... 99.99 repeating */
+static int
+decimal_test_sum(const char* program, rasqal_world* world)
+{
+  rasqal_xsd_decimal* sum = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* price = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* count = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* avg = rasqal_new_xsd_decimal(world);
+  const char* expected_sum = "499950.0";
+  const char* expected_avg = "49.995";
+  char prices[100][8];
+  char* result_s;
+  int failures = 0;
+  int i;
+
+  for(i = 0; i < 100; i++)
+    snprintf(prices[i], sizeof(prices[i]), "%d.%02d", i, i);
+
+  rasqal_xsd_decimal_set_long(sum, 0);
+  for(i = 0; i < DECIMAL_SUM_COUNT; i++) {
+    rasqal_xsd_decimal_set_string(price, prices[i % 100]);
+    rasqal_xsd_decimal_add(sum, sum, price);
+  }
+  rasqal_xsd_decimal_set_long(count, DECIMAL_SUM_COUNT);
+  rasqal_xsd_decimal_divide(avg, sum, count);
+
+  result_s = rasqal_xsd_decimal_as_string(sum);
+  if(strcmp(result_s, expected_sum)) {
+    fprintf(stderr, "%s: FAILED: SUM %s expected %s\n", program, result_s,
+            expected_sum);
+    failures++;
+  }
+
+  result_s = rasqal_xsd_decimal_as_string(avg);
+  if(strcmp(result_s, expected_avg)) {
+    fprintf(stderr, "%s: FAILED: AVG %s expected %s\n", program, result_s,
+            expected_avg);
+    failures++;
+  }
+
+  rasqal_free_xsd_decimal(sum);
+  rasqal_free_xsd_decimal(price);
+  rasqal_free_xsd_decimal(count);
+  rasqal_free_xsd_decimal(avg);
+
+  return failures;
+}
+
+
 int
 main(int argc, char *argv[]) {
   char const *program=rasqal_basename(*argv);
@@ -1034,6 +1724,13 @@ main(int argc, char *argv[]) {
     FAIL;
   }
 
+  if(decimal_test_ops(program, world)) {
+    FAIL;
+  }
+
+  if(decimal_test_sum(program, world)) {
+    FAIL;
+  }
 
   FAIL_LABEL
   if(a)
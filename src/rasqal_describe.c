@@ -0,0 +1,523 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_describe.c - Rasqal DESCRIBE concise bounded descriptions
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#ifndef STANDALONE
+
+/*
+ * The concise bounded description (CBD) of a resource is every triple
+ * with the resource as subject plus, recursively, the CBD of every
+ * blank node object of those triples.
+ *
+ * Resources are added as the DESCRIBE result rows are read.  Each
+ * resource is queued once per describe: a visited set of every
+ * resource ever queued stops shared or cyclic blank nodes being
+ * expanded again and stops a resource bound in several rows being
+ * described twice.  Triples are streamed one at a time from a triples
+ * match with the subject bound, which the triples source can answer
+ * from a subject index.
+ */
+
+/* initial size of visited set: power of 2 */
+#define RASQAL_DESCRIBE_VISITED_INITIAL_SIZE 64
+
+typedef struct rasqal_describe_entry_s {
+  struct rasqal_describe_entry_s* next;
+  unsigned int hash;
+  rasqal_literal* resource;
+} rasqal_describe_entry;
+
+
+struct rasqal_describe_s {
+  rasqal_query* query;
+
+  /* shared */
+  rasqal_triples_source* triples_source;
+
+  /* visited set: hash buckets of resources ever queued.  The
+   * resource literals are owned here
+   */
+  rasqal_describe_entry** visited;
+  unsigned int visited_size;
+  unsigned int visited_count;
+
+  /* queue of resources to describe: shared with @visited */
+  raptor_sequence* pending;
+
+  /* variables for the predicate and object of the current match */
+  rasqal_variables_table* vars_table;
+  rasqal_literal* predicate;
+  rasqal_literal* object;
+
+  /* match pattern (resource ?p ?o) and state */
+  rasqal_triple pattern;
+  rasqal_triple_meta meta;
+
+  /* non-0 if the current match has returned a triple */
+  int started;
+};
+
+
+/*
+ * rasqal_new_describe:
+ * @query: query
+ * @triples_source: triples source to describe from (shared)
+ *
+ * INTERNAL - Constructor - create a DESCRIBE concise bounded description generator
+ *
+ * Return value: new describe or NULL on failure
+ */
+rasqal_describe*
+rasqal_new_describe(rasqal_query* query,
+                    rasqal_triples_source* triples_source)
+{
+  rasqal_describe* describe;
+  rasqal_variable* v;
+
+  describe = RASQAL_CALLOC(rasqal_describe*, 1, sizeof(*describe));
+  if(!describe)
+    return NULL;
+
+  describe->query = query;
+  describe->triples_source = triples_source;
+
+  describe->pending = raptor_new_sequence(NULL, NULL);
+  if(!describe->pending)
+    goto fail;
+
+  describe->vars_table = rasqal_new_variables_table(query->world);
+  if(!describe->vars_table)
+    goto fail;
+
+  v = rasqal_variables_table_add2(describe->vars_table,
+                                  RASQAL_VARIABLE_TYPE_NORMAL,
+                                  RASQAL_GOOD_CAST(const unsigned char*, "p"),
+                                  1, NULL);
+  if(!v)
+    goto fail;
+  describe->predicate = rasqal_new_variable_literal(query->world, v);
+  if(!describe->predicate)
+    goto fail;
+
+  v = rasqal_variables_table_add2(describe->vars_table,
+                                  RASQAL_VARIABLE_TYPE_NORMAL,
+                                  RASQAL_GOOD_CAST(const unsigned char*, "o"),
+                                  1, NULL);
+  if(!v)
+    goto fail;
+  describe->object = rasqal_new_variable_literal(query->world, v);
+  if(!describe->object)
+    goto fail;
+
+  describe->pattern.predicate = describe->predicate;
+  describe->pattern.object = describe->object;
+
+  return describe;
+
+  fail:
+  rasqal_free_describe(describe);
+  return NULL;
+}
+
+
+/*
+ * rasqal_free_describe:
+ * @describe: describe object
+ *
+ * INTERNAL - Destructor - destroy a DESCRIBE generator
+ *
+ * This must be called before the triples source is freed.
+ */
+void
+rasqal_free_describe(rasqal_describe* describe)
+{
+  unsigned int i;
+
+  if(!describe)
+    return;
+
+  rasqal_reset_triple_meta(&describe->meta);
+
+  if(describe->predicate)
+    rasqal_free_literal(describe->predicate);
+  if(describe->object)
+    rasqal_free_literal(describe->object);
+  if(describe->vars_table)
+    rasqal_free_variables_table(describe->vars_table);
+
+  if(describe->pending)
+    raptor_free_sequence(describe->pending);
+
+  for(i = 0; i < describe->visited_size; i++) {
+    rasqal_describe_entry* entry = describe->visited[i];
+
+    while(entry) {
+      rasqal_describe_entry* next = entry->next;
+
+      rasqal_free_literal(entry->resource);
+      RASQAL_FREE(rasqal_describe_entry, entry);
+      entry = next;
+    }
+  }
+  if(describe->visited)
+    RASQAL_FREE(rasqal_describe_entry**, describe->visited);
+
+  RASQAL_FREE(rasqal_describe, describe);
+}
+
+
+static int
+rasqal_describe_grow_visited(rasqal_describe* describe)
+{
+  unsigned int new_size;
+  rasqal_describe_entry** new_visited;
+  unsigned int i;
+
+  new_size = describe->visited_size ? describe->visited_size << 1 : RASQAL_DESCRIBE_VISITED_INITIAL_SIZE;
+  new_visited = RASQAL_CALLOC(rasqal_describe_entry**, new_size,
+                              sizeof(rasqal_describe_entry*));
+  if(!new_visited)
+    return 1;
+
+  for(i = 0; i < describe->visited_size; i++) {
+    rasqal_describe_entry* entry;
+    rasqal_describe_entry* next;
+
+    for(entry = describe->visited[i]; entry; entry = next) {
+      unsigned int b = entry->hash & (new_size - 1);
+
+      next = entry->next;
+      entry->next = new_visited[b];
+      new_visited[b] = entry;
+    }
+  }
+
+  if(describe->visited)
+    RASQAL_FREE(rasqal_describe_entry**, describe->visited);
+  describe->visited = new_visited;
+  describe->visited_size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_describe_add_resource:
+ * @describe: describe object
+ * @resource: resource to describe (shared)
+ *
+ * INTERNAL - Queue a resource to be described if it has not been seen before
+ *
+ * Values that are not URIs or blank nodes have no description and
+ * are ignored.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_describe_add_resource(rasqal_describe* describe,
+                             rasqal_literal* resource)
+{
+  rasqal_describe_entry* entry;
+  unsigned int hash;
+  unsigned int b;
+
+  if(!resource ||
+     (resource->type != RASQAL_LITERAL_URI &&
+      resource->type != RASQAL_LITERAL_BLANK))
+    return 0;
+
+  hash = rasqal_literal_hash(resource, RASQAL_LITERAL_HASH_INIT);
+
+  if(describe->visited_size) {
+    b = hash & (describe->visited_size - 1);
+    for(entry = describe->visited[b]; entry; entry = entry->next) {
+      if(entry->hash == hash &&
+         rasqal_literal_equals_flags(entry->resource, resource,
+                                     RASQAL_COMPARE_RDF, NULL))
+        return 0;
+    }
+  }
+
+  if(describe->visited_count >= describe->visited_size &&
+     rasqal_describe_grow_visited(describe))
+    return 1;
+
+  entry = RASQAL_MALLOC(rasqal_describe_entry*, sizeof(*entry));
+  if(!entry)
+    return 1;
+
+  entry->hash = hash;
+  entry->resource = rasqal_new_literal_from_literal(resource);
+
+  b = hash & (describe->visited_size - 1);
+  entry->next = describe->visited[b];
+  describe->visited[b] = entry;
+  describe->visited_count++;
+
+  return raptor_sequence_push(describe->pending, entry->resource);
+}
+
+
+/*
+ * rasqal_describe_next_triple:
+ * @describe: describe object
+ * @triple: triple to fill with the next description triple
+ *
+ * INTERNAL - Get the next triple of the descriptions of the queued resources
+ *
+ * The parts of @triple are shared and valid until the next call.
+ *
+ * Return value: 0 if a triple was returned, >0 if all queued resources are described, <0 on failure
+ */
+int
+rasqal_describe_next_triple(rasqal_describe* describe, rasqal_triple* triple)
+{
+  while(1) {
+    rasqal_variable* pv = describe->predicate->value.variable;
+    rasqal_variable* ov = describe->object->value.variable;
+    rasqal_triples_match* rtm = describe->meta.triples_match;
+
+    if(!rtm) {
+      rasqal_literal* resource;
+
+      resource = (rasqal_literal*)raptor_sequence_unshift(describe->pending);
+      if(!resource)
+        return 1;
+
+      describe->pattern.subject = resource;
+
+      describe->meta.parts = (rasqal_triple_parts)(RASQAL_TRIPLE_PREDICATE | RASQAL_TRIPLE_OBJECT);
+      describe->meta.bindings[0] = NULL;
+      describe->meta.bindings[1] = pv;
+      describe->meta.bindings[2] = ov;
+      describe->meta.bindings[3] = NULL;
+
+      rtm = rasqal_new_triples_match(describe->query,
+                                     describe->triples_source,
+                                     &describe->meta, &describe->pattern);
+      /* no match object means nothing to describe */
+      if(!rtm)
+        continue;
+
+      describe->meta.triples_match = rtm;
+      describe->started = 0;
+    } else if(describe->started)
+      rasqal_triples_match_next_match(rtm);
+
+    describe->started = 1;
+
+    if(rasqal_triples_match_is_end(rtm)) {
+      /* frees the match and unbinds the variables */
+      rasqal_reset_triple_meta(&describe->meta);
+      continue;
+    }
+
+    if(!rasqal_triples_match_bind_match(rtm, describe->meta.bindings,
+                                        describe->meta.parts))
+      continue;
+
+    /* blank node objects are part of the description */
+    if(ov->value && ov->value->type == RASQAL_LITERAL_BLANK &&
+       rasqal_describe_add_resource(describe, ov->value))
+      return -1;
+
+    triple->subject = describe->pattern.subject;
+    triple->predicate = pv->value;
+    triple->object = ov->value;
+    triple->origin = NULL;
+
+    return 0;
+  }
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+/*
+ * Each resource ex:rN has a name, a link to the next resource, a
+ * two level chain of blank nodes and a tag pointing to one blank
+ * node shared by all resources that also points to itself.  The CBD
+ * of one resource is 4 + 2 + 1 triples plus the 2 of the shared node.
+ */
+#define DESCRIBE_RESOURCES 200
+
+#define DESCRIBE_ONE_QUERY "\
+PREFIX ex: <http://example.org/>\n\
+DESCRIBE ex:r0\
+"
+
+#define DESCRIBE_ALL_QUERY "\
+PREFIX ex: <http://example.org/>\n\
+DESCRIBE ?r WHERE { ?r ex:next ?n }\
+"
+
+
+static raptor_stringbuffer*
+make_describe_graph(int resources)
+{
+  raptor_stringbuffer* sb;
+  int i;
+
+  sb = raptor_new_stringbuffer();
+  if(!sb)
+    return NULL;
+
+  for(i = 0; i < resources; i++) {
+    char lines[640];
+
+    sprintf(lines,
+            "<http://example.org/r%d> <http://example.org/name> \"r%d\" .\n"
+            "<http://example.org/r%d> <http://example.org/next> <http://example.org/r%d> .\n"
+            "<http://example.org/r%d> <http://example.org/addr> _:a%d .\n"
+            "<http://example.org/r%d> <http://example.org/tag> _:shared .\n"
+            "_:a%d <http://example.org/city> \"c%d\" .\n"
+            "_:a%d <http://example.org/geo> _:g%d .\n"
+            "_:g%d <http://example.org/lat> \"%d\" .\n",
+            i, i, i, (i + 1) % resources, i, i, i, i, i, i, i, i, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, lines), 1);
+  }
+
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*,
+    "_:shared <http://example.org/label> \"shared\" .\n"
+    "_:shared <http://example.org/self> _:shared .\n"), 1);
+
+  return sb;
+}
+
+
+/* returns number of triples or -1 on failure */
+static int
+describe_count(rasqal_world* world, const char* query_string,
+               int resources)
+{
+  raptor_stringbuffer* sb;
+  raptor_iostream* iostr;
+  raptor_uri* base_uri;
+  rasqal_data_graph* dg;
+  rasqal_query* query = NULL;
+  rasqal_query_results* results = NULL;
+  int count = -1;
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+  sb = make_describe_graph(resources);
+  iostr = rasqal_new_iostream_from_stringbuffer(world->raptor_world_ptr, sb);
+  dg = rasqal_new_data_graph_from_iostream(world, iostr, base_uri, NULL,
+                                           RASQAL_DATA_GRAPH_BACKGROUND,
+                                           NULL, "ntriples", NULL);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+  if(!query || !dg || rasqal_query_add_data_graph(query, dg))
+    goto tidy;
+
+  if(rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          base_uri))
+    goto tidy;
+
+  results = rasqal_query_execute(query);
+  if(results) {
+    count = 0;
+    while(rasqal_query_results_get_triple(results)) {
+      count++;
+      if(rasqal_query_results_next_triple(results))
+        break;
+    }
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+  raptor_free_uri(base_uri);
+
+  return count;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world *world;
+  int resources = DESCRIBE_RESOURCES;
+  int failures = 0;
+  int count;
+  int expected;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+
+  expected = 4 + 2 + 1 + 2;
+  count = describe_count(world, DESCRIBE_ONE_QUERY, resources);
+  if(count != expected) {
+    fprintf(stderr, "%s: DESCRIBE of one resource returned %d triples, expected %d\n",
+            program, count, expected);
+    failures++;
+  }
+
+  expected = (4 + 2 + 1) * resources + 2;
+  count = describe_count(world, DESCRIBE_ALL_QUERY, resources);
+  if(count != expected) {
+    fprintf(stderr, "%s: DESCRIBE of %d resources returned %d triples, expected %d\n",
+            program, resources, count, expected);
+    failures++;
+  }
+
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
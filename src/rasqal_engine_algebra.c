@@ -57,9 +57,44 @@ typedef struct {
   rasqal_rowsource* rowsource;
 
   rasqal_triples_source* triples_source;
+
+  /* sequence of #rasqal_engine_algebra_subtree found in #algebra_node */
+  raptor_sequence* subtrees;
+
+  /* sequence of #rasqal_engine_algebra_subtree_use */
+  raptor_sequence* subtree_uses;
 } rasqal_engine_algebra_data;
 
 
+/*
+ * An uncorrelated algebra subtree that may be materialized once and
+ * replayed: identical subtrees share one entry.
+ */
+typedef struct {
+  /* written algebra of the subtree */
+  unsigned char* key;
+  size_t key_len;
+
+  /* number of occurrences that are executed */
+  int count;
+
+  /* non-0 if an occurrence is the right side of a join and is reset
+   * for every left row */
+  int reset;
+
+  /* non-0 once the first executed occurrence has been seen */
+  int seen;
+
+  rasqal_materialization* materialization;
+} rasqal_engine_algebra_subtree;
+
+
+typedef struct {
+  rasqal_algebra_node* node;
+  rasqal_engine_algebra_subtree* subtree;
+} rasqal_engine_algebra_subtree_use;
+
+
 static rasqal_rowsource* rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data, rasqal_algebra_node* node, rasqal_engine_error *error_p);
 
 
@@ -450,6 +485,53 @@ rasqal_algebra_values_algebra_node_to_rowsource(rasqal_engine_algebra_data* exec
 }
 
 
+static rasqal_rowsource*
+rasqal_algebra_reduced_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                                 rasqal_algebra_node* node,
+                                                 rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_rowsource *rs;
+  int size;
+
+  rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1, error_p);
+  if((error_p && *error_p) || !rs)
+    return NULL;
+
+  size = rasqal_query_get_feature(query, RASQAL_FEATURE_REDUCED_SIZE);
+  return rasqal_new_reduced_rowsource(query->world, query, rs, size);
+}
+
+
+static rasqal_rowsource*
+rasqal_algebra_diff_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                              rasqal_algebra_node* node,
+                                              rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_rowsource *left_rs;
+  rasqal_rowsource *right_rs;
+
+  left_rs = rasqal_algebra_node_to_rowsource(execution_data, node->node1,
+                                             error_p);
+  if((error_p && *error_p) || !left_rs)
+    return NULL;
+
+  right_rs = rasqal_algebra_node_to_rowsource(execution_data, node->node2,
+                                              error_p);
+  if((error_p && *error_p) || !right_rs) {
+    rasqal_free_rowsource(left_rs);
+    return NULL;
+  }
+
+  /* the right rows are only kept across a reset if they do not
+   * depend on variables bound outside the right side */
+  return rasqal_new_diff_rowsource(query->world, query, left_rs, right_rs,
+                                   !rasqal_algebra_node_is_correlated(query,
+                                                                      node->node2));
+}
+
+
 static rasqal_rowsource*
 rasqal_algebra_service_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                  rasqal_algebra_node* node,
@@ -467,9 +549,9 @@ rasqal_algebra_service_algebra_node_to_rowsource(rasqal_engine_algebra_data* exe
 
 
 static rasqal_rowsource*
-rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
-                                 rasqal_algebra_node* node,
-                                 rasqal_engine_error *error_p)
+rasqal_algebra_node_to_rowsource_internal(rasqal_engine_algebra_data* execution_data,
+                                          rasqal_algebra_node* node,
+                                          rasqal_engine_error *error_p)
 {
   rasqal_rowsource* rs = NULL;
   
@@ -554,10 +636,18 @@ rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
                                                             node, error_p);
       break;
 
-    case RASQAL_ALGEBRA_OPERATOR_UNKNOWN:
     case RASQAL_ALGEBRA_OPERATOR_DIFF:
-    case RASQAL_ALGEBRA_OPERATOR_TOLIST:
+      rs = rasqal_algebra_diff_algebra_node_to_rowsource(execution_data,
+                                                         node, error_p);
+      break;
+
     case RASQAL_ALGEBRA_OPERATOR_REDUCED:
+      rs = rasqal_algebra_reduced_algebra_node_to_rowsource(execution_data,
+                                                            node, error_p);
+      break;
+
+    case RASQAL_ALGEBRA_OPERATOR_UNKNOWN:
+    case RASQAL_ALGEBRA_OPERATOR_TOLIST:
     default:
       RASQAL_DEBUG2("Unsupported algebra node operator %s\n",
                     rasqal_algebra_node_operator_as_counted_string(node->op,
@@ -572,6 +662,308 @@ rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
 }
 
 
+static void
+rasqal_free_engine_algebra_subtree(rasqal_engine_algebra_subtree* subtree)
+{
+  if(subtree->materialization)
+    rasqal_free_materialization(subtree->materialization);
+
+  if(subtree->key)
+    RASQAL_FREE(char*, subtree->key);
+
+  RASQAL_FREE(rasqal_engine_algebra_subtree, subtree);
+}
+
+
+static void
+rasqal_free_engine_algebra_subtree_use(rasqal_engine_algebra_subtree_use* use)
+{
+  RASQAL_FREE(rasqal_engine_algebra_subtree_use, use);
+}
+
+
+static rasqal_engine_algebra_subtree*
+rasqal_engine_algebra_get_subtree(rasqal_engine_algebra_data* execution_data,
+                                  rasqal_algebra_node* node)
+{
+  rasqal_engine_algebra_subtree_use* use;
+  int i;
+
+  if(!execution_data->subtree_uses)
+    return NULL;
+
+  for(i = 0;
+      (use = (rasqal_engine_algebra_subtree_use*)raptor_sequence_get_at(execution_data->subtree_uses, i));
+      i++) {
+    if(use->node == node)
+      return use->subtree;
+  }
+
+  return NULL;
+}
+
+
+/* non-0 if materializing @node could save executing it again */
+static int
+rasqal_engine_algebra_node_can_materialize(rasqal_query* query,
+                                           rasqal_algebra_node* node)
+{
+  switch(node->op) {
+    case RASQAL_ALGEBRA_OPERATOR_BGP:
+      if(rasqal_algebra_node_is_empty(node))
+        return 0;
+      break;
+
+    case RASQAL_ALGEBRA_OPERATOR_FILTER:
+    case RASQAL_ALGEBRA_OPERATOR_JOIN:
+    case RASQAL_ALGEBRA_OPERATOR_LEFTJOIN:
+    case RASQAL_ALGEBRA_OPERATOR_UNION:
+    case RASQAL_ALGEBRA_OPERATOR_DIFF:
+    case RASQAL_ALGEBRA_OPERATOR_PROJECT:
+    case RASQAL_ALGEBRA_OPERATOR_DISTINCT:
+    case RASQAL_ALGEBRA_OPERATOR_REDUCED:
+    case RASQAL_ALGEBRA_OPERATOR_SLICE:
+    case RASQAL_ALGEBRA_OPERATOR_ORDERBY:
+    case RASQAL_ALGEBRA_OPERATOR_GRAPH:
+      break;
+
+    /* GROUP returns rows for the AGGREGATION above it; ASSIGN and
+     * VALUES are cheaper to evaluate than to replay */
+    case RASQAL_ALGEBRA_OPERATOR_GROUP:
+    case RASQAL_ALGEBRA_OPERATOR_AGGREGATION:
+    case RASQAL_ALGEBRA_OPERATOR_HAVING:
+    case RASQAL_ALGEBRA_OPERATOR_ASSIGN:
+    case RASQAL_ALGEBRA_OPERATOR_VALUES:
+    case RASQAL_ALGEBRA_OPERATOR_SERVICE:
+    case RASQAL_ALGEBRA_OPERATOR_UNKNOWN:
+    case RASQAL_ALGEBRA_OPERATOR_TOLIST:
+    default:
+      return 0;
+  }
+
+  return (!rasqal_algebra_node_is_volatile(query, node) &&
+          !rasqal_algebra_node_is_correlated(query, node));
+}
+
+
+/*
+ * Find the subtrees of @node that can be materialized, grouping
+ * identical ones by their written algebra.  @reset is non-0 if @node
+ * is the right side of a join.
+ */
+static int
+rasqal_engine_algebra_find_subtrees(rasqal_engine_algebra_data* execution_data,
+                                    rasqal_algebra_node* node,
+                                    int reset)
+{
+  rasqal_query* query = execution_data->query;
+
+  if(rasqal_engine_algebra_node_can_materialize(query, node)) {
+    rasqal_engine_algebra_subtree* subtree = NULL;
+    rasqal_engine_algebra_subtree_use* use;
+    raptor_iostream* iostr;
+    unsigned char* key = NULL;
+    size_t key_len = 0;
+    int i;
+
+    iostr = raptor_new_iostream_to_string(query->world->raptor_world_ptr,
+                                          (void**)&key, &key_len,
+                                          rasqal_alloc_memory);
+    if(!iostr)
+      return 1;
+    rasqal_algebra_algebra_node_write(node, iostr);
+    raptor_free_iostream(iostr);
+    if(!key)
+      return 1;
+
+    for(i = 0;
+        (subtree = (rasqal_engine_algebra_subtree*)raptor_sequence_get_at(execution_data->subtrees, i));
+        i++) {
+      if(subtree->key_len == key_len && !memcmp(subtree->key, key, key_len))
+        break;
+    }
+
+    if(subtree) {
+      RASQAL_FREE(char*, key);
+    } else {
+      subtree = RASQAL_CALLOC(rasqal_engine_algebra_subtree*, 1,
+                              sizeof(*subtree));
+      if(!subtree) {
+        RASQAL_FREE(char*, key);
+        return 1;
+      }
+      subtree->key = key;
+      subtree->key_len = key_len;
+      if(raptor_sequence_push(execution_data->subtrees, subtree))
+        return 1;
+    }
+
+    subtree->count++;
+    if(reset)
+      subtree->reset = 1;
+
+    use = RASQAL_CALLOC(rasqal_engine_algebra_subtree_use*, 1, sizeof(*use));
+    if(!use)
+      return 1;
+    use->node = node;
+    use->subtree = subtree;
+    if(raptor_sequence_push(execution_data->subtree_uses, use))
+      return 1;
+  }
+
+  /* GRAPH sets the origin of the triples below it when executed */
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_GRAPH)
+    return 0;
+
+  if(node->node1 &&
+     rasqal_engine_algebra_find_subtrees(execution_data, node->node1, 0))
+    return 1;
+
+  if(node->node2 &&
+     rasqal_engine_algebra_find_subtrees(execution_data, node->node2,
+                                         (node->op == RASQAL_ALGEBRA_OPERATOR_JOIN ||
+                                          node->op == RASQAL_ALGEBRA_OPERATOR_LEFTJOIN)))
+    return 1;
+
+  return 0;
+}
+
+
+/* subtrees below a replayed occurrence are never executed */
+static void
+rasqal_engine_algebra_forget_subtrees(rasqal_engine_algebra_data* execution_data,
+                                      rasqal_algebra_node* node)
+{
+  rasqal_engine_algebra_subtree* subtree;
+
+  subtree = rasqal_engine_algebra_get_subtree(execution_data, node);
+  if(subtree)
+    subtree->count--;
+
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_GRAPH)
+    return;
+
+  if(node->node1)
+    rasqal_engine_algebra_forget_subtrees(execution_data, node->node1);
+  if(node->node2)
+    rasqal_engine_algebra_forget_subtrees(execution_data, node->node2);
+}
+
+
+static int
+rasqal_engine_algebra_subtree_is_shared(rasqal_engine_algebra_subtree* subtree)
+{
+  return (subtree && (subtree->count > 1 || subtree->reset));
+}
+
+
+static void
+rasqal_engine_algebra_select_subtrees(rasqal_engine_algebra_data* execution_data,
+                                      rasqal_algebra_node* node)
+{
+  rasqal_engine_algebra_subtree* subtree;
+
+  subtree = rasqal_engine_algebra_get_subtree(execution_data, node);
+  if(rasqal_engine_algebra_subtree_is_shared(subtree)) {
+    if(subtree->seen) {
+      if(node->op != RASQAL_ALGEBRA_OPERATOR_GRAPH) {
+        if(node->node1)
+          rasqal_engine_algebra_forget_subtrees(execution_data, node->node1);
+        if(node->node2)
+          rasqal_engine_algebra_forget_subtrees(execution_data, node->node2);
+      }
+      return;
+    }
+    subtree->seen = 1;
+  }
+
+  if(node->op == RASQAL_ALGEBRA_OPERATOR_GRAPH)
+    return;
+
+  if(node->node1)
+    rasqal_engine_algebra_select_subtrees(execution_data, node->node1);
+  if(node->node2)
+    rasqal_engine_algebra_select_subtrees(execution_data, node->node2);
+}
+
+
+/*
+ * rasqal_engine_algebra_share_subtrees:
+ * @execution_data: execution data
+ * @node: algebra node
+ *
+ * INTERNAL - Find the subtrees of @node to execute once and replay
+ *
+ * These are uncorrelated subtrees that occur more than once, such as
+ * the same sub-SELECT or OPTIONAL in several UNION branches, and
+ * uncorrelated right sides of joins which are otherwise executed
+ * again for every left row.  Each becomes one materialization read
+ * by a materialize rowsource at every occurrence.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_engine_algebra_share_subtrees(rasqal_engine_algebra_data* execution_data,
+                                     rasqal_algebra_node* node)
+{
+  execution_data->subtrees = raptor_new_sequence((raptor_data_free_handler)rasqal_free_engine_algebra_subtree, NULL);
+  execution_data->subtree_uses = raptor_new_sequence((raptor_data_free_handler)rasqal_free_engine_algebra_subtree_use, NULL);
+  if(!execution_data->subtrees || !execution_data->subtree_uses)
+    return 1;
+
+  if(rasqal_engine_algebra_find_subtrees(execution_data, node, 0))
+    return 1;
+
+  rasqal_engine_algebra_select_subtrees(execution_data, node);
+
+  return 0;
+}
+
+
+static rasqal_rowsource*
+rasqal_algebra_node_to_rowsource(rasqal_engine_algebra_data* execution_data,
+                                 rasqal_algebra_node* node,
+                                 rasqal_engine_error *error_p)
+{
+  rasqal_query *query = execution_data->query;
+  rasqal_engine_algebra_subtree* subtree;
+  rasqal_rowsource* rs;
+
+  subtree = rasqal_engine_algebra_get_subtree(execution_data, node);
+  if(!rasqal_engine_algebra_subtree_is_shared(subtree))
+    return rasqal_algebra_node_to_rowsource_internal(execution_data, node,
+                                                     error_p);
+
+  if(!subtree->materialization) {
+    rs = rasqal_algebra_node_to_rowsource_internal(execution_data, node,
+                                                   error_p);
+    if((error_p && *error_p) && rs) {
+      rasqal_free_rowsource(rs);
+      rs = NULL;
+    }
+    if(!rs)
+      return NULL;
+
+    RASQAL_DEBUG3("materializing %s subtree used %d times\n",
+                  rasqal_algebra_node_operator_as_counted_string(node->op,
+                                                                 NULL),
+                  subtree->count);
+    subtree->materialization = rasqal_new_materialization(rs);
+    if(!subtree->materialization) {
+      *error_p = RASQAL_ENGINE_FAILED;
+      return NULL;
+    }
+  }
+
+  rs = rasqal_new_materialize_rowsource(query->world, query,
+                                        subtree->materialization);
+  if(!rs)
+    *error_p = RASQAL_ENGINE_FAILED;
+
+  return rs;
+}
+
+
 
 static int
 rasqal_query_engine_algebra_execute_init(void* ex_data,
@@ -587,6 +979,9 @@ rasqal_query_engine_algebra_execute_init(void* ex_data,
   rasqal_solution_modifier* modifier;
   rasqal_algebra_node* node;
   rasqal_algebra_aggregate* ae;
+  rasqal_result_cache* cache;
+  unsigned char* cache_key = NULL;
+  size_t cache_key_len = 0;
   
   execution_data = (rasqal_engine_algebra_data*)ex_data;
 
@@ -594,18 +989,15 @@ rasqal_query_engine_algebra_execute_init(void* ex_data,
   execution_data->query = query;
   execution_data->query_results = query_results;
 
-  if(!execution_data->triples_source) {
-    execution_data->triples_source = rasqal_new_triples_source(execution_data->query);
-    if(!execution_data->triples_source) {
-      *error_p = RASQAL_ENGINE_FAILED;
-      return 1;
-    }
-  }
-
   projection = rasqal_query_get_projection(query);
   modifier = query->modifier;
 
-  node = rasqal_algebra_query_to_algebra(query);
+  if(query->verb == RASQAL_QUERY_VERB_DESCRIBE &&
+     !rasqal_query_get_query_graph_pattern(query))
+    /* 'DESCRIBE <uri>' has no pattern: one empty row to describe from */
+    node = rasqal_new_empty_algebra_node(query);
+  else
+    node = rasqal_algebra_query_to_algebra(query);
   if(!node)
     return 1;
 
@@ -665,10 +1057,54 @@ rasqal_query_engine_algebra_execute_init(void* ex_data,
 #endif
   RASQAL_DEBUG2("algebra nodes: %d\n", execution_data->nodes_count);
 
+  cache = query->world->result_cache;
+  if(cache) {
+    cache_key = rasqal_result_cache_new_key(query, node, &cache_key_len);
+    if(cache_key) {
+      /* replaying cached rows needs no data */
+      execution_data->rowsource = rasqal_result_cache_lookup(cache, query,
+                                                             cache_key,
+                                                             cache_key_len);
+      if(execution_data->rowsource) {
+        RASQAL_FREE(char*, cache_key);
+        return 0;
+      }
+    }
+  }
+
+  if(!execution_data->triples_source) {
+    execution_data->triples_source = rasqal_new_triples_source(execution_data->query);
+    if(!execution_data->triples_source) {
+      if(cache_key)
+        RASQAL_FREE(char*, cache_key);
+      *error_p = RASQAL_ENGINE_FAILED;
+      return 1;
+    }
+  }
+
+  if(rasqal_engine_algebra_share_subtrees(execution_data, node)) {
+    if(cache_key)
+      RASQAL_FREE(char*, cache_key);
+    *error_p = RASQAL_ENGINE_FAILED;
+    return 1;
+  }
+
   error = RASQAL_ENGINE_OK;
   execution_data->rowsource = rasqal_algebra_node_to_rowsource(execution_data,
                                                                node,
                                                                &error);
+  if(cache_key) {
+    if(execution_data->rowsource && error == RASQAL_ENGINE_OK)
+      execution_data->rowsource = rasqal_new_result_cache_rowsource(cache,
+                                                                    query,
+                                                                    execution_data->rowsource,
+                                                                    cache_key,
+                                                                    cache_key_len);
+    else
+      RASQAL_FREE(char*, cache_key);
+    if(!execution_data->rowsource)
+      error = RASQAL_ENGINE_FAILED;
+  }
 #ifdef RASQAL_DEBUG
   RASQAL_DEBUG1("rowsource (query plan) result: \n");
   if(execution_data->rowsource)
@@ -684,6 +1120,57 @@ rasqal_query_engine_algebra_execute_init(void* ex_data,
 }
 
 
+/**
+ * rasqal_algebra_query_to_rowsource:
+ * @query: query with a prepared query graph pattern
+ * @triples_source: triples source to match against
+ * @node_p: pointer to store the algebra node
+ *
+ * INTERNAL - Build a rowsource for the query graph pattern over a triples source
+ *
+ * Only the graph pattern is executed; there is no projection,
+ * grouping, ordering or distinct.  The algebra node returned in
+ * @node_p must be freed by the caller after the rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_algebra_query_to_rowsource(rasqal_query* query,
+                                  rasqal_triples_source* triples_source,
+                                  rasqal_algebra_node** node_p)
+{
+  rasqal_engine_algebra_data execution_data;
+  rasqal_engine_error error = RASQAL_ENGINE_OK;
+  rasqal_algebra_node* node;
+  rasqal_rowsource* rowsource;
+
+  *node_p = NULL;
+
+  node = rasqal_algebra_query_to_algebra(query);
+  if(!node)
+    return NULL;
+
+  memset(&execution_data, '\0', sizeof(execution_data));
+  execution_data.query = query;
+  execution_data.algebra_node = node;
+  execution_data.triples_source = triples_source;
+
+  rowsource = rasqal_algebra_node_to_rowsource(&execution_data, node, &error);
+  if(rowsource && error != RASQAL_ENGINE_OK) {
+    rasqal_free_rowsource(rowsource);
+    rowsource = NULL;
+  }
+
+  if(!rowsource) {
+    rasqal_free_algebra_node(node);
+    return NULL;
+  }
+
+  *node_p = node;
+  return rowsource;
+}
+
+
 static raptor_sequence*
 rasqal_query_engine_algebra_get_all_rows(void* ex_data,
                                          rasqal_engine_error *error_p)
@@ -743,6 +1230,12 @@ rasqal_query_engine_algebra_execute_finish(void* ex_data,
 
     if(execution_data->rowsource)
       rasqal_free_rowsource(execution_data->rowsource);
+
+    if(execution_data->subtree_uses)
+      raptor_free_sequence(execution_data->subtree_uses);
+
+    if(execution_data->subtrees)
+      raptor_free_sequence(execution_data->subtrees);
   }
 
   return 0;
@@ -756,6 +1249,17 @@ rasqal_query_engine_algebra_finish_factory(rasqal_query_execution_factory* facto
 }
 
 
+static rasqal_triples_source*
+rasqal_query_engine_algebra_get_triples_source(void* ex_data)
+{
+  rasqal_engine_algebra_data* execution_data;
+
+  execution_data = (rasqal_engine_algebra_data*)ex_data;
+
+  return execution_data->triples_source;
+}
+
+
 const rasqal_query_execution_factory rasqal_query_engine_algebra =
 {
   /* .name=                */ "rasqal query algebra query engine",
@@ -764,5 +1268,6 @@ const rasqal_query_execution_factory rasqal_query_engine_algebra =
   /* .get_all_rows=        */ rasqal_query_engine_algebra_get_all_rows,
   /* .get_row=             */ rasqal_query_engine_algebra_get_row,
   /* .execute_finish=      */ rasqal_query_engine_algebra_execute_finish,
-  /* .finish_factory=      */ rasqal_query_engine_algebra_finish_factory
+  /* .finish_factory=      */ rasqal_query_engine_algebra_finish_factory,
+  /* .get_triples_source=  */ rasqal_query_engine_algebra_get_triples_source
 };
@@ -0,0 +1,728 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_escape.c - Rasqal escaped string writing for result formats
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RASQAL_ESCAPE_AVX2 1
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RASQAL_ESCAPE_SSE2 1
+#endif
+
+
+/*
+ * Result values are almost always mostly plain text that needs no
+ * escaping at all.  Each writer here scans for the next byte that
+ * needs escaping, 32 or 16 bytes at a time when AVX2 or SSE2 is
+ * available at compile time, writes the clean run before it with one
+ * counted write and only hands the short runs of special bytes to the
+ * byte at a time raptor escaping functions.  The output is identical
+ * to escaping the whole value with raptor.
+ */
+
+/* bytes 0x00-0x1F need escaping */
+#define RASQAL_ESCAPE_CONTROL 1
+/* bytes 0x80-0xFF need escaping */
+#define RASQAL_ESCAPE_HIGH    2
+
+typedef struct
+{
+  /* 4 bytes that need escaping; repeat one to use fewer */
+  unsigned char specials[4];
+
+  /* bit flags RASQAL_ESCAPE_CONTROL and RASQAL_ESCAPE_HIGH */
+  unsigned int flags;
+} rasqal_escape_class;
+
+
+/* CSV: whether a value needs quoting at all */
+static const rasqal_escape_class rasqal_escape_csv_class = {
+  { '"', ',', '\r', '\n' }, 0
+};
+
+/* CSV: inside a quoted value only the quote is doubled */
+static const rasqal_escape_class rasqal_escape_csv_quoted_class = {
+  { '"', '"', '"', '"' }, 0
+};
+
+/* XML cdata; non-ASCII is passed to raptor for UTF-8 checking */
+static const rasqal_escape_class rasqal_escape_xml_class = {
+  { '&', '<', '>', '>' }, RASQAL_ESCAPE_CONTROL | RASQAL_ESCAPE_HIGH
+};
+
+
+static RASQAL_INLINE int
+rasqal_escape_is_special(const rasqal_escape_class* cls, unsigned char c)
+{
+  if(c == cls->specials[0] || c == cls->specials[1] ||
+     c == cls->specials[2] || c == cls->specials[3])
+    return 1;
+
+  if((cls->flags & RASQAL_ESCAPE_CONTROL) && c < 0x20)
+    return 1;
+
+  if((cls->flags & RASQAL_ESCAPE_HIGH) && c >= 0x80)
+    return 1;
+
+  return 0;
+}
+
+
+#if defined(RASQAL_ESCAPE_SSE2) || defined(RASQAL_ESCAPE_AVX2)
+static RASQAL_INLINE unsigned int
+rasqal_escape_first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+  return RASQAL_GOOD_CAST(unsigned int, __builtin_ctz(mask));
+#else
+  unsigned int i = 0;
+
+  while(!(mask & 1)) {
+    mask >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+#endif
+
+
+/*
+ * rasqal_escape_clean_span:
+ * @cls: escape class
+ * @string: string
+ * @len: length of @string
+ *
+ * INTERNAL - Get the length of the prefix of @string that needs no escaping
+ *
+ * Return value: number of bytes before the first special byte or @len
+ */
+static size_t
+rasqal_escape_clean_span(const rasqal_escape_class* cls,
+                         const unsigned char* string, size_t len)
+{
+  size_t i = 0;
+
+#ifdef RASQAL_ESCAPE_AVX2
+  if(len - i >= 32) {
+    const __m256i s0 = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[0]));
+    const __m256i s1 = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[1]));
+    const __m256i s2 = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[2]));
+    const __m256i s3 = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[3]));
+    const __m256i control = _mm256_set1_epi8(0x1F);
+
+    for(; len - i >= 32; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(string + i));
+      __m256i m;
+      unsigned int mask;
+
+      m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, s0),
+                                          _mm256_cmpeq_epi8(v, s1)),
+                          _mm256_or_si256(_mm256_cmpeq_epi8(v, s2),
+                                          _mm256_cmpeq_epi8(v, s3)));
+      if(cls->flags & RASQAL_ESCAPE_CONTROL)
+        /* unsigned v <= 0x1F */
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(v, control),
+                                                 v));
+      mask = RASQAL_GOOD_CAST(unsigned int, _mm256_movemask_epi8(m));
+      if(cls->flags & RASQAL_ESCAPE_HIGH)
+        mask |= RASQAL_GOOD_CAST(unsigned int, _mm256_movemask_epi8(v));
+
+      if(mask)
+        return i + rasqal_escape_first_bit(mask);
+    }
+  }
+#endif
+
+#ifdef RASQAL_ESCAPE_SSE2
+  if(len - i >= 16) {
+    const __m128i s0 = _mm_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[0]));
+    const __m128i s1 = _mm_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[1]));
+    const __m128i s2 = _mm_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[2]));
+    const __m128i s3 = _mm_set1_epi8(RASQAL_GOOD_CAST(char, cls->specials[3]));
+    const __m128i control = _mm_set1_epi8(0x1F);
+
+    for(; len - i >= 16; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(string + i));
+      __m128i m;
+      unsigned int mask;
+
+      m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, s0),
+                                    _mm_cmpeq_epi8(v, s1)),
+                       _mm_or_si128(_mm_cmpeq_epi8(v, s2),
+                                    _mm_cmpeq_epi8(v, s3)));
+      if(cls->flags & RASQAL_ESCAPE_CONTROL)
+        /* unsigned v <= 0x1F */
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+      mask = RASQAL_GOOD_CAST(unsigned int, _mm_movemask_epi8(m));
+      if(cls->flags & RASQAL_ESCAPE_HIGH)
+        mask |= RASQAL_GOOD_CAST(unsigned int, _mm_movemask_epi8(v));
+
+      if(mask)
+        return i + rasqal_escape_first_bit(mask);
+    }
+  }
+#endif
+
+  for(; i < len; i++) {
+    if(rasqal_escape_is_special(cls, string[i]))
+      break;
+  }
+
+  return i;
+}
+
+
+/*
+ * rasqal_escape_special_span:
+ * @cls: escape class
+ * @string: string
+ * @len: length of @string
+ *
+ * INTERNAL - Get the length of the prefix of @string that all needs escaping
+ *
+ * Special bytes are rare so this is a simple loop.  When
+ * #RASQAL_ESCAPE_HIGH is set the span always ends on a UTF-8
+ * character boundary.
+ *
+ * Return value: number of special bytes at the start of @string
+ */
+static size_t
+rasqal_escape_special_span(const rasqal_escape_class* cls,
+                           const unsigned char* string, size_t len)
+{
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    if(!rasqal_escape_is_special(cls, string[i]))
+      break;
+  }
+
+  return i;
+}
+
+
+/**
+ * rasqal_iostream_write_csv_string:
+ * @string: string
+ * @len: length of @string
+ * @iostr: iostream to write to
+ *
+ * INTERNAL - Write a string to an iostream in CSV style
+ *
+ * The value is quoted if it contains a double quote, comma,
+ * linefeed or return and any double quotes are doubled.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_iostream_write_csv_string(const unsigned char *string, size_t len,
+                                 raptor_iostream *iostr)
+{
+  const char delim = '\x22';
+  size_t i;
+
+  if(rasqal_escape_clean_span(&rasqal_escape_csv_class, string, len) == len)
+    return raptor_iostream_counted_string_write(string, len, iostr);
+
+  raptor_iostream_write_byte(delim, iostr);
+  for(i = 0; i < len; ) {
+    size_t n;
+
+    n = rasqal_escape_clean_span(&rasqal_escape_csv_quoted_class,
+                                 string + i, len - i);
+    if(n) {
+      raptor_iostream_counted_string_write(string + i, n, iostr);
+      i += n;
+    }
+
+    if(i < len) {
+      /* double the quote */
+      raptor_iostream_write_byte(delim, iostr);
+      raptor_iostream_write_byte(delim, iostr);
+      i++;
+    }
+  }
+  raptor_iostream_write_byte(delim, iostr);
+
+  return 0;
+}
+
+
+/**
+ * rasqal_iostream_write_ntriples_string:
+ * @string: UTF-8 string
+ * @len: length of @string
+ * @delim: terminating delimiter character for string (such as " or >) or \0 for no escaping
+ * @iostr: iostream to write to
+ *
+ * INTERNAL - Write a string to an iostream with N-Triples escaping
+ *
+ * Same output as raptor_string_ntriples_write() but printable ASCII
+ * runs are written without being escaped byte by byte.  Like raptor,
+ * writing stops at the first NUL byte.
+ *
+ * Return value: non-0 on failure such as bad UTF-8 encoding
+ */
+int
+rasqal_iostream_write_ntriples_string(const unsigned char *string, size_t len,
+                                      const char delim,
+                                      raptor_iostream *iostr)
+{
+  rasqal_escape_class cls;
+  const unsigned char* nul;
+  size_t i;
+
+  nul = RASQAL_GOOD_CAST(const unsigned char*, memchr(string, '\0', len));
+  if(nul)
+    len = RASQAL_GOOD_CAST(size_t, nul - string);
+
+  cls.specials[0] = '"';
+  cls.specials[1] = '\\';
+  cls.specials[2] = 0x7F;
+  cls.specials[3] = delim ? RASQAL_GOOD_CAST(unsigned char, delim) : '"';
+  cls.flags = RASQAL_ESCAPE_CONTROL | RASQAL_ESCAPE_HIGH;
+
+  for(i = 0; i < len; ) {
+    size_t n;
+
+    n = rasqal_escape_clean_span(&cls, string + i, len - i);
+    if(n) {
+      raptor_iostream_counted_string_write(string + i, n, iostr);
+      i += n;
+    }
+
+    if(i < len) {
+      n = rasqal_escape_special_span(&cls, string + i, len - i);
+      if(raptor_string_ntriples_write(string + i, n, delim, iostr))
+        return 1;
+      i += n;
+    }
+  }
+
+  return 0;
+}
+
+
+/**
+ * rasqal_xml_writer_write_cdata:
+ * @xml_writer: XML writer
+ * @string: UTF-8 string
+ * @len: length of @string
+ *
+ * INTERNAL - Write XML character data with escaping
+ *
+ * Same output as raptor_xml_writer_cdata_counted() but runs of
+ * printable ASCII without &, < or > are written directly.
+ *
+ * The first byte, or the first run of special bytes, always goes
+ * through raptor_xml_writer_cdata_counted() so the writer closes any
+ * pending start tag and records the element content as cdata just
+ * as for a single raptor call; the clean runs after it are then
+ * plain bytes.  From a control character other than tab, linefeed or
+ * return, which raptor may refuse to write, the rest of the value is
+ * left to raptor.
+ */
+void
+rasqal_xml_writer_write_cdata(raptor_xml_writer* xml_writer,
+                              const unsigned char *string, size_t len)
+{
+  const rasqal_escape_class* cls = &rasqal_escape_xml_class;
+  size_t i = 0;
+  size_t n;
+
+  if(len && !rasqal_escape_is_special(cls, string[0]))
+    n = 1;
+  else
+    n = rasqal_escape_special_span(cls, string, len);
+
+  while(1) {
+    size_t j;
+
+    /* n special bytes, or 1 clean byte first, at i */
+    for(j = i; j < i + n; j++) {
+      if(string[j] < 0x20 &&
+         string[j] != '\t' && string[j] != '\n' && string[j] != '\r') {
+        n = len - i;
+        break;
+      }
+    }
+    raptor_xml_writer_cdata_counted(xml_writer, string + i,
+                                    RASQAL_GOOD_CAST(unsigned int, n));
+    i += n;
+
+    if(i >= len)
+      break;
+
+    n = rasqal_escape_clean_span(cls, string + i, len - i);
+    if(n) {
+      raptor_xml_writer_raw_counted(xml_writer, string + i,
+                                    RASQAL_GOOD_CAST(unsigned int, n));
+      i += n;
+    }
+
+    if(i >= len)
+      break;
+
+    n = rasqal_escape_special_span(cls, string + i, len - i);
+  }
+}
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+#define ESCAPE_TEST_SEED 12345U
+#define ESCAPE_TEST_VALUES_COUNT 20000
+#define ESCAPE_TEST_VALUE_MAX_LEN 200
+
+/* mostly plain words with some bytes every format has to escape */
+static const char* const escape_test_pieces[] = {
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+  "http://example.org/resource/", "1234567890", " ", " ", " ",
+  "\"", ",", "\n", "\r", "\t", "<", ">", "&", "\\",
+  "\xc3\xa9", "\xe2\x82\xac", "\x7f"
+};
+#define ESCAPE_TEST_PIECES_COUNT \
+  (sizeof(escape_test_pieces) / sizeof(escape_test_pieces[0]))
+/* pieces from this index need escaping in some format */
+#define ESCAPE_TEST_FIRST_SPECIAL 13
+
+/* values with an embedded NUL; raptor stops writing at the NUL */
+static const struct {
+  const char* string;
+  size_t len;
+} escape_test_nul_values[] = {
+  { "abc\0def", 7 },
+  { "\0", 1 },
+  { "x\"\0\"y", 5 },
+  { "\xc3\xa9\0\xc3\xa9", 5 },
+  { "the quick brown fox jumps over the lazy dog\0 and more", 53 }
+};
+#define ESCAPE_TEST_NUL_VALUES_COUNT \
+  (sizeof(escape_test_nul_values) / sizeof(escape_test_nul_values[0]))
+
+
+/* reference: the byte at a time CSV writer */
+static int
+escape_test_csv_reference(const unsigned char *string, size_t len,
+                          raptor_iostream *iostr)
+{
+  const char delim = '\x22';
+  int quoting_needed = 0;
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    char c = RASQAL_GOOD_CAST(char, string[i]);
+    if(c == delim   || c == ',' || c == '\r' || c == '\n') {
+      quoting_needed++;
+      break;
+    }
+  }
+  if(!quoting_needed)
+    return raptor_iostream_counted_string_write(string, len, iostr);
+
+  raptor_iostream_write_byte(delim, iostr);
+  for(i = 0; i < len; i++) {
+    char c = RASQAL_GOOD_CAST(char, string[i]);
+    if(c == delim)
+      raptor_iostream_write_byte(delim, iostr);
+    raptor_iostream_write_byte(c, iostr);
+  }
+  raptor_iostream_write_byte(delim, iostr);
+
+  return 0;
+}
+
+
+typedef enum {
+  ESCAPE_FORMAT_CSV,
+  ESCAPE_FORMAT_NTRIPLES,
+  ESCAPE_FORMAT_XML,
+  ESCAPE_FORMAT_LAST = ESCAPE_FORMAT_XML
+} escape_test_format;
+
+static const char* const escape_test_format_labels[ESCAPE_FORMAT_LAST + 1] = {
+  "CSV", "TSV/JSON", "XML"
+};
+
+
+/*
+ * Write all values to @iostr in @format with the fast writers or, if
+ * @reference is set, the original raptor / byte at a time writers.
+ */
+static int
+escape_test_write(raptor_world* raptor_world_ptr, raptor_iostream* iostr,
+                  escape_test_format format, int reference,
+                  unsigned char** values, size_t* lens, int count)
+{
+  raptor_namespace_stack* nstack = NULL;
+  raptor_xml_writer* xml_writer = NULL;
+  raptor_namespace* ns = NULL;
+  raptor_xml_element* element = NULL;
+  int rc = 0;
+  int i;
+
+  if(format == ESCAPE_FORMAT_XML) {
+    nstack = raptor_new_namespaces(raptor_world_ptr, 1);
+    xml_writer = raptor_new_xml_writer(raptor_world_ptr, nstack, iostr);
+    if(xml_writer)
+      ns = raptor_new_namespace(nstack, NULL,
+                                RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/ns#"),
+                                0);
+    if(ns)
+      element = raptor_new_xml_element_from_namespace_local_name(ns,
+                                                                 RASQAL_GOOD_CAST(const unsigned char*, "v"),
+                                                                 NULL, NULL);
+    if(!element) {
+      rc = 1;
+      goto tidy;
+    }
+    /* end tags are indented unless the element content was cdata */
+    raptor_xml_writer_set_option(xml_writer, RAPTOR_OPTION_WRITER_AUTO_INDENT,
+                                 NULL, 1);
+  }
+
+  for(i = 0; i < count; i++) {
+    switch(format) {
+      case ESCAPE_FORMAT_CSV:
+        if(reference)
+          escape_test_csv_reference(values[i], lens[i], iostr);
+        else
+          rasqal_iostream_write_csv_string(values[i], lens[i], iostr);
+        break;
+
+      case ESCAPE_FORMAT_NTRIPLES:
+        if(reference)
+          raptor_string_ntriples_write(values[i], lens[i], '"', iostr);
+        else
+          rasqal_iostream_write_ntriples_string(values[i], lens[i], '"',
+                                                iostr);
+        break;
+
+      case ESCAPE_FORMAT_XML:
+        raptor_xml_writer_start_element(xml_writer, element);
+        if(reference)
+          raptor_xml_writer_cdata_counted(xml_writer, values[i],
+                                          RASQAL_GOOD_CAST(unsigned int, lens[i]));
+        else
+          rasqal_xml_writer_write_cdata(xml_writer, values[i], lens[i]);
+        raptor_xml_writer_end_element(xml_writer, element);
+        break;
+    }
+    raptor_iostream_write_byte('\n', iostr);
+  }
+
+  tidy:
+  if(element)
+    raptor_free_xml_element(element);
+  if(ns)
+    raptor_free_namespace(ns);
+  if(xml_writer)
+    raptor_free_xml_writer(xml_writer);
+  if(nstack)
+    raptor_free_namespaces(nstack);
+
+  return rc;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  raptor_world* raptor_world_ptr;
+  rasqal_random* r = NULL;
+  unsigned char** values = NULL;
+  size_t* lens = NULL;
+  int failures = 0;
+  int i;
+  int f;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+  raptor_world_ptr = rasqal_world_get_raptor(world);
+
+  r = rasqal_new_random(world);
+  rasqal_random_seed(r, ESCAPE_TEST_SEED);
+
+  values = RASQAL_CALLOC(unsigned char**, ESCAPE_TEST_VALUES_COUNT,
+                         sizeof(unsigned char*));
+  lens = RASQAL_CALLOC(size_t*, ESCAPE_TEST_VALUES_COUNT, sizeof(size_t));
+  if(!values || !lens) {
+    failures++;
+    goto tidy;
+  }
+
+  /* Every 4th value is plain text; the rest have a few special bytes
+   * at random positions so the SIMD and scalar paths are both used.
+   */
+  for(i = 0; i < ESCAPE_TEST_VALUES_COUNT; i++) {
+    size_t len = 0;
+    int plain = !(i % 4);
+
+    values[i] = RASQAL_MALLOC(unsigned char*, ESCAPE_TEST_VALUE_MAX_LEN + 1);
+    if(!values[i]) {
+      failures++;
+      goto tidy;
+    }
+
+    while(1) {
+      const char* piece;
+      size_t piece_len;
+      unsigned int n;
+
+      n = RASQAL_GOOD_CAST(unsigned int, rasqal_random_irand(r));
+      if(plain || (n % 16))
+        n %= ESCAPE_TEST_FIRST_SPECIAL;
+      else
+        n %= ESCAPE_TEST_PIECES_COUNT;
+      piece = escape_test_pieces[n];
+      piece_len = strlen(piece);
+      if(len + piece_len > ESCAPE_TEST_VALUE_MAX_LEN)
+        break;
+      memcpy(values[i] + len, piece, piece_len);
+      len += piece_len;
+    }
+    values[i][len] = '\0';
+    lens[i] = len;
+  }
+
+  for(i = 0; i < RASQAL_GOOD_CAST(int, ESCAPE_TEST_NUL_VALUES_COUNT); i++) {
+    const unsigned char* value;
+    size_t len = escape_test_nul_values[i].len;
+    void *ref_string = NULL;
+    void *fast_string = NULL;
+    size_t ref_len = 0;
+    size_t fast_len = 0;
+    raptor_iostream* iostr;
+
+    value = RASQAL_GOOD_CAST(const unsigned char*,
+                             escape_test_nul_values[i].string);
+
+    iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                          &ref_string, &ref_len, malloc);
+    raptor_string_ntriples_write(value, len, '"', iostr);
+    raptor_free_iostream(iostr);
+
+    iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                          &fast_string, &fast_len, malloc);
+    rasqal_iostream_write_ntriples_string(value, len, '"', iostr);
+    raptor_free_iostream(iostr);
+
+    if(!ref_string || !fast_string || ref_len != fast_len ||
+       memcmp(ref_string, fast_string, ref_len)) {
+      fprintf(stderr, "%s: TSV/JSON escaped NUL value %d differs from raptor (%d vs %d bytes)\n",
+              program, i, RASQAL_GOOD_CAST(int, ref_len),
+              RASQAL_GOOD_CAST(int, fast_len));
+      failures++;
+    }
+    if(ref_string)
+      free(ref_string);
+    if(fast_string)
+      free(fast_string);
+  }
+
+  for(f = 0; f <= ESCAPE_FORMAT_LAST; f++) {
+    escape_test_format format = (escape_test_format)f;
+    const char* label = escape_test_format_labels[f];
+    void *ref_string = NULL;
+    void *fast_string = NULL;
+    size_t ref_len = 0;
+    size_t fast_len = 0;
+    raptor_iostream* iostr;
+
+    /* Check the fast writer output is identical */
+    iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                          &ref_string, &ref_len, malloc);
+    escape_test_write(raptor_world_ptr, iostr, format, 1, values, lens,
+                      ESCAPE_TEST_VALUES_COUNT);
+    raptor_free_iostream(iostr);
+
+    iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                          &fast_string, &fast_len, malloc);
+    escape_test_write(raptor_world_ptr, iostr, format, 0, values, lens,
+                      ESCAPE_TEST_VALUES_COUNT);
+    raptor_free_iostream(iostr);
+
+    if(!ref_string || !fast_string || ref_len != fast_len ||
+       memcmp(ref_string, fast_string, ref_len)) {
+      fprintf(stderr, "%s: %s escaped output differs from raptor (%d vs %d bytes)\n",
+              program, label, RASQAL_GOOD_CAST(int, ref_len),
+              RASQAL_GOOD_CAST(int, fast_len));
+      failures++;
+    }
+    if(ref_string)
+      free(ref_string);
+    if(fast_string)
+      free(fast_string);
+  }
+
+  tidy:
+  if(values) {
+    for(i = 0; i < ESCAPE_TEST_VALUES_COUNT; i++) {
+      if(values[i])
+        RASQAL_FREE(unsigned char*, values[i]);
+    }
+    RASQAL_FREE(unsigned char**, values);
+  }
+  if(lens)
+    RASQAL_FREE(size_t*, lens);
+  if(r)
+    rasqal_free_random(r);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -102,7 +102,8 @@ rasqal_expression_evaluate_to_unixtime(rasqal_expression *e,
   if((error_p && *error_p) || !l)
     goto failed;
 
-  if(l->type != RASQAL_LITERAL_DATETIME)
+  if(l->type != RASQAL_LITERAL_DATETIME ||
+     rasqal_literal_ensure_native(l))
     goto failed;
 
   unixtime = rasqal_xsd_datetime_get_as_unixtime(l->value.datetime);
@@ -193,7 +194,8 @@ rasqal_expression_evaluate_datetime_part(rasqal_expression *e,
   if((error_p && *error_p) || !l)
     goto failed;
   
-  if(l->type != RASQAL_LITERAL_DATETIME)
+  if(l->type != RASQAL_LITERAL_DATETIME ||
+     rasqal_literal_ensure_native(l))
     goto failed;
   
   /* SECONDS accessor has decimal results and includes microseconds */
@@ -268,7 +270,8 @@ rasqal_expression_evaluate_datetime_timezone(rasqal_expression *e,
   if((error_p && *error_p) || !l)
     goto failed;
   
-  if(l->type != RASQAL_LITERAL_DATETIME)
+  if(l->type != RASQAL_LITERAL_DATETIME ||
+     rasqal_literal_ensure_native(l))
     goto failed;
   
   s = RASQAL_GOOD_CAST(const unsigned char*, rasqal_xsd_datetime_get_timezone_as_counted_string(l->value.datetime, NULL));
@@ -322,7 +325,8 @@ rasqal_expression_evaluate_datetime_tz(rasqal_expression *e,
   if((error_p && *error_p) || !l)
     goto failed;
   
-  if(l->type != RASQAL_LITERAL_DATETIME)
+  if(l->type != RASQAL_LITERAL_DATETIME ||
+     rasqal_literal_ensure_native(l))
     goto failed;
   
 #define TIMEZONE_STRING_LEN 7
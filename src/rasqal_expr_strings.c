@@ -62,20 +62,22 @@ rasqal_expression_evaluate_strlen(rasqal_expression *e,
   rasqal_literal* l1;
   rasqal_literal* result = NULL;
   const unsigned char *s;
+  size_t s_len = 0;
   int len = 0;
   
   l1 = rasqal_expression_evaluate2(e->arg1, eval_context, error_p);
   if((error_p && *error_p) || !l1)
     goto failed;
   
-  s = rasqal_literal_as_string_flags(l1, eval_context->flags, error_p);
+  s = rasqal_literal_as_counted_string(l1, &s_len, eval_context->flags,
+                                       error_p);
   if(error_p && *error_p)
     goto failed;
 
   if(!s)
     len = 0;
   else
-    len = raptor_unicode_utf8_strlen(s, strlen(RASQAL_GOOD_CAST(const char*, s)));
+    len = rasqal_utf8_strlen(s, s_len);
   
 
   result = rasqal_new_numeric_literal_from_long(world, RASQAL_LITERAL_INTEGER,
@@ -113,10 +115,12 @@ rasqal_expression_evaluate_substr(rasqal_expression *e,
   rasqal_literal* l2 = NULL;
   rasqal_literal* l3 = NULL;
   const unsigned char *s;
+  const unsigned char *view;
   unsigned char* new_s = NULL;
   char* new_lang = NULL;
   raptor_uri* dt_uri = NULL;
   size_t len = 0;
+  size_t view_len = 0;
   int startingLoc = 0;
   int length = -1;
   
@@ -150,14 +154,25 @@ rasqal_expression_evaluate_substr(rasqal_expression *e,
 
   }
   
-  new_s = RASQAL_MALLOC(unsigned char*, len + 1);
-  if(!new_s)
-    goto failed;
-
   /* adjust starting index to xsd fn:substring initial offset 1 */
-  if(!raptor_unicode_utf8_substr(new_s, /* dest_length_p */ NULL,
-                                 s, len, startingLoc - 1, length))
-    goto failed;
+  view = rasqal_utf8_substr(s, len, startingLoc - 1, length, &view_len);
+  if(view) {
+    /* common case: copy just the substring found in place */
+    new_s = RASQAL_MALLOC(unsigned char*, view_len + 1);
+    if(!new_s)
+      goto failed;
+
+    memcpy(new_s, view, view_len);
+    new_s[view_len] = '\0';
+  } else {
+    new_s = RASQAL_MALLOC(unsigned char*, len + 1);
+    if(!new_s)
+      goto failed;
+
+    if(!raptor_unicode_utf8_substr(new_s, /* dest_length_p */ NULL,
+                                   s, len, startingLoc - 1, length))
+      goto failed;
+  }
 
   if(l1->language) {
     len = strlen(RASQAL_GOOD_CAST(const char*, l1->language));
@@ -233,25 +248,8 @@ rasqal_expression_evaluate_set_case(rasqal_expression *e,
   if(!new_s)
     goto failed;
 
-  if(e->op == RASQAL_EXPR_UCASE) {
-    unsigned int i;
-    
-    for(i = 0; i < len; i++) {
-      unsigned char c = s[i];
-      if(islower(RASQAL_GOOD_CAST(int, c)))
-        c = RASQAL_GOOD_CAST(unsigned char, toupper(RASQAL_GOOD_CAST(int, c)));
-      new_s[i] = c;
-    }
-  } else { /* RASQAL_EXPR_LCASE */
-    unsigned int i;
-
-    for(i = 0; i < len; i++) {
-      unsigned char c = s[i];
-      if(isupper(RASQAL_GOOD_CAST(int, c)))
-        c = RASQAL_GOOD_CAST(unsigned char, tolower(RASQAL_GOOD_CAST(int, c)));
-      new_s[i] = c;
-    }
-  }
+  /* only ASCII letters change case */
+  rasqal_utf8_set_case(new_s, s, len, (e->op == RASQAL_EXPR_UCASE));
   new_s[len] = '\0';
 
   if(l1->language) {
@@ -405,9 +403,7 @@ rasqal_expression_evaluate_str_prefix_suffix(rasqal_expression *e,
     } else if(e->op == RASQAL_EXPR_STRENDS) {
       b = !memcmp(s1 + len1 - len2, s2, len2);
     } else { /* RASQAL_EXPR_CONTAINS */
-      /* b = (strnstr(RASQAL_GOOD_CAST(const char*, s1), RASQAL_GOOD_CAST(const char*, s2), len2) != NULL); */
-      b = (strstr(RASQAL_GOOD_CAST(const char*, s1),
-                  RASQAL_GOOD_CAST(const char*, s2)) != NULL);
+      b = (rasqal_utf8_find(s1, len1, s2, len2) != NULL);
     }
   }
   
@@ -452,8 +448,6 @@ rasqal_expression_evaluate_encode_for_uri(rasqal_expression *e,
   unsigned char* new_s = NULL;
   raptor_uri* dt_uri = NULL;
   size_t len = 0;
-  unsigned int i;
-  unsigned char* p;
 
   l1 = rasqal_expression_evaluate2(e->arg1, eval_context, error_p);
   if((error_p && *error_p) || !l1)
@@ -476,31 +470,12 @@ rasqal_expression_evaluate_encode_for_uri(rasqal_expression *e,
   if(!new_s)
     goto failed;
 
-  p = new_s;
-  for(i = 0; i < len; i++) {
-    unsigned char c = s[i];
-
-    /* All characters are escaped except those identified as
-     * "unreserved" by [RFC 3986], that is the upper- and lower-case
-     * letters A-Z, the digits 0-9, HYPHEN-MINUS ("-"), LOW LINE
-     * ("_"), FULL STOP ".", and TILDE "~".
-     */
-    if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
-       (c >= '0' && c <= '9') || 
-       c == '-' || c == '_' || c == '.' || c == '~') {
-      *p++ = c;
-    } else {
-      unsigned short hex;
-
-      *p++ = '%';
-      hex = (c & 0xf0) >> 4;
-      *p++ = RASQAL_GOOD_CAST(unsigned char, (hex < 10) ? ('0' + hex) : ('A' + hex - 10));
-      hex = (c & 0x0f);
-      *p++ = RASQAL_GOOD_CAST(unsigned char, (hex < 10) ? ('0' + hex) : ('A' + hex - 10));
-    }
-  }
-
-  *p = '\0';
+  /* All characters are escaped except those identified as
+   * "unreserved" by [RFC 3986], that is the upper- and lower-case
+   * letters A-Z, the digits 0-9, HYPHEN-MINUS ("-"), LOW LINE
+   * ("_"), FULL STOP ".", and TILDE "~".
+   */
+  rasqal_utf8_encode_for_uri(new_s, s, len);
 
   rasqal_free_literal(l1);
 
@@ -881,7 +856,7 @@ rasqal_expression_evaluate_strbefore(rasqal_expression *e,
   const unsigned char *needle;
   size_t haystack_len;
   size_t needle_len;
-  const char *ptr;
+  const unsigned char *ptr;
   unsigned char* result;
   size_t result_len;
   char* new_lang = NULL;
@@ -929,10 +904,9 @@ rasqal_expression_evaluate_strbefore(rasqal_expression *e,
   if((error_p && *error_p) || !needle)
     goto failed;
 
-  ptr = strstr(RASQAL_GOOD_CAST(const char*, haystack), 
-               RASQAL_GOOD_CAST(const char*, needle));
+  ptr = rasqal_utf8_find(haystack, haystack_len, needle, needle_len);
   if(ptr) {
-    result_len = RASQAL_GOOD_CAST(size_t, ptr - RASQAL_GOOD_CAST(const char*, haystack));
+    result_len = RASQAL_GOOD_CAST(size_t, ptr - haystack);
 
     if(l1->language) {
       size_t len = strlen(RASQAL_GOOD_CAST(const char*, l1->language));
@@ -947,17 +921,18 @@ rasqal_expression_evaluate_strbefore(rasqal_expression *e,
     haystack = RASQAL_GOOD_CAST(const unsigned char *, "");
   }
 
-  rasqal_free_literal(l1); l1 = NULL;
-  rasqal_free_literal(l2); l2 = NULL;
-
   result = RASQAL_MALLOC(unsigned char*, result_len + 1);
   if(!result)
     goto failed;
 
+  /* copy before freeing l1 which may own the string */
   if(result_len)
     memcpy(result, haystack, result_len);
   result[result_len] = '\0';
 
+  rasqal_free_literal(l1); l1 = NULL;
+  rasqal_free_literal(l2); l2 = NULL;
+
   return rasqal_new_string_literal(world, result, 
                                    new_lang,
                                    /* datatype */ NULL,
@@ -1001,7 +976,7 @@ rasqal_expression_evaluate_strafter(rasqal_expression *e,
   const unsigned char *needle;
   size_t haystack_len;
   size_t needle_len;
-  const char *ptr;
+  const unsigned char *ptr;
   unsigned char* result;
   size_t result_len;
   char* new_lang = NULL;
@@ -1050,11 +1025,10 @@ rasqal_expression_evaluate_strafter(rasqal_expression *e,
   if((error_p && *error_p) || !needle)
     goto failed;
 
-  ptr = strstr(RASQAL_GOOD_CAST(const char*, haystack),
-               RASQAL_GOOD_CAST(const char*, needle));
+  ptr = rasqal_utf8_find(haystack, haystack_len, needle, needle_len);
   if(ptr) {
     ptr += needle_len;
-    result_len = haystack_len - RASQAL_GOOD_CAST(size_t, (ptr - RASQAL_GOOD_CAST(const char*, haystack)));
+    result_len = haystack_len - RASQAL_GOOD_CAST(size_t, (ptr - haystack));
 
     if(l1->language) {
       size_t len = strlen(RASQAL_GOOD_CAST(const char*, l1->language));
@@ -1065,21 +1039,22 @@ rasqal_expression_evaluate_strafter(rasqal_expression *e,
       memcpy(new_lang, l1->language, len + 1);
     }
   } else {
-    ptr = (const char *)"";
+    ptr = RASQAL_GOOD_CAST(const unsigned char *, "");
     result_len = 0;
   }
 
-  rasqal_free_literal(l1); l1 = NULL;
-  rasqal_free_literal(l2); l2 = NULL;
-
   result = RASQAL_MALLOC(unsigned char*, result_len + 1);
   if(!result)
     goto failed;
 
+  /* copy before freeing l1 which may own the string */
   if(result_len)
     memcpy(result, ptr, result_len);
   result[result_len] = '\0';
 
+  rasqal_free_literal(l1); l1 = NULL;
+  rasqal_free_literal(l2); l2 = NULL;
+
   return rasqal_new_string_literal(world, result, 
                                    new_lang,
                                    /* datatype */ NULL,
@@ -57,7 +57,9 @@ static const struct
   const char *label;
 } rasqal_features_list [RASQAL_FEATURE_LAST + 1]= {
   { RASQAL_FEATURE_NO_NET,    1,  "noNet",    "Deny network requests." } ,
-  { RASQAL_FEATURE_RAND_SEED, 1,  "randSeed", "Set rand() seed." }
+  { RASQAL_FEATURE_RAND_SEED, 1,  "randSeed", "Set rand() seed." },
+  { RASQAL_FEATURE_REDUCED_SIZE, 1, "reducedSize", "Set SELECT REDUCED duplicate cache size." },
+  { RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE, 1, "constructDedupSize", "Set CONSTRUCT duplicate triple cache size." }
 };
 
 
@@ -0,0 +1,1681 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_format_arrow.c - Format results as an Apache Arrow IPC stream
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#include <stdarg.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+/*
+ * Apache Arrow IPC streaming format writer
+ *
+ * Results are written as a Schema message followed by record
+ * batches of up to RASQAL_ARROW_BATCH_SIZE rows and the end of
+ * stream marker, so they can be loaded by dataframe tools without
+ * parsing text.
+ *
+ * Arrow needs column types up front in the schema, so the first
+ * batch of rows is read before anything is written and the types are
+ * chosen from every value of a column in that batch:
+ *   only integers                         int64
+ *   only numbers                          float64
+ *   only booleans                         bool
+ *   only xsd:dateTime with a timezone     timestamp[us, UTC]
+ *   only xsd:dateTime with no timezone    timestamp[us]
+ *   only URIs                             utf8 dictionary with int32 indices
+ *   anything else or no values            utf8
+ *
+ * so every value of the first batch fits its column.  Each later
+ * batch is written as soon as it fills, so only one batch of rows is
+ * held in memory.  A later value that does not fit the column type
+ * is written as null and a warning is logged.  Values in utf8 and
+ * dictionary columns are written as in SPARQL CSV: URIs, _:label for
+ * blank nodes and the lexical form of literals.  Each batch sends new
+ * dictionary entries as a delta before the batch.
+ *
+ * Boolean results are written as one row with a bool column named
+ * "boolean".
+ *
+ * Message metadata is Arrow's flatbuffers schema, built with the
+ * small back-to-front flatbuffer builder below.
+ */
+
+#define RASQAL_ARROW_BATCH_SIZE 8192
+
+/* Arrow format flatbuffer enumerations */
+#define RASQAL_ARROW_METADATA_V5 4
+
+#define RASQAL_ARROW_HEADER_SCHEMA 1
+#define RASQAL_ARROW_HEADER_DICTIONARY_BATCH 2
+#define RASQAL_ARROW_HEADER_RECORD_BATCH 3
+
+#define RASQAL_ARROW_TYPE_INT 2
+#define RASQAL_ARROW_TYPE_FLOATING_POINT 3
+#define RASQAL_ARROW_TYPE_UTF8 5
+#define RASQAL_ARROW_TYPE_BOOL 6
+#define RASQAL_ARROW_TYPE_TIMESTAMP 10
+
+#define RASQAL_ARROW_PRECISION_DOUBLE 2
+#define RASQAL_ARROW_TIME_UNIT_MICROSECOND 2
+
+
+typedef enum {
+  RASQAL_ARROW_COLUMN_UTF8,
+  RASQAL_ARROW_COLUMN_INT64,
+  RASQAL_ARROW_COLUMN_DOUBLE,
+  RASQAL_ARROW_COLUMN_BOOL,
+  RASQAL_ARROW_COLUMN_TIMESTAMP,
+  RASQAL_ARROW_COLUMN_DICTIONARY
+} rasqal_arrow_column_type;
+
+
+/* Growable byte buffer */
+typedef struct {
+  unsigned char* data;
+  size_t length;
+  size_t size;
+} rasqal_arrow_buffer;
+
+
+static int
+rasqal_arrow_buffer_append(rasqal_arrow_buffer* b, const void* data,
+                           size_t len)
+{
+  if(b->length + len > b->size) {
+    size_t new_size = b->size ? (b->size << 1) : 256;
+    unsigned char* new_data;
+
+    while(new_size < b->length + len)
+      new_size <<= 1;
+
+    new_data = RASQAL_MALLOC(unsigned char*, new_size);
+    if(!new_data)
+      return 1;
+
+    if(b->data) {
+      memcpy(new_data, b->data, b->length);
+      RASQAL_FREE(unsigned char*, b->data);
+    }
+    b->data = new_data;
+    b->size = new_size;
+  }
+
+  if(len) {
+    if(data)
+      memcpy(b->data + b->length, data, len);
+    else
+      memset(b->data + b->length, '\0', len);
+  }
+  b->length += len;
+
+  return 0;
+}
+
+
+static void
+rasqal_arrow_buffer_clear(rasqal_arrow_buffer* b)
+{
+  if(b->data)
+    RASQAL_FREE(unsigned char*, b->data);
+  b->data = NULL;
+  b->length = b->size = 0;
+}
+
+
+/* store @n bytes of @value little-endian */
+static void
+rasqal_arrow_put_le(unsigned char* p, int64_t value, int n)
+{
+  uint64_t u = RASQAL_GOOD_CAST(uint64_t, value);
+  int i;
+
+  for(i = 0; i < n; i++) {
+    p[i] = RASQAL_GOOD_CAST(unsigned char, u & 0xff);
+    u >>= 8;
+  }
+}
+
+
+static int
+rasqal_arrow_buffer_append_le(rasqal_arrow_buffer* b, int64_t value, int n)
+{
+  unsigned char bytes[8];
+
+  rasqal_arrow_put_le(bytes, value, n);
+  return rasqal_arrow_buffer_append(b, bytes, n);
+}
+
+
+
+/* Flatbuffer builder: data is built from the end of @buf down to @head */
+
+#define RASQAL_ARROW_FB_MAX_FIELDS 8
+
+typedef struct {
+  unsigned char* buf;
+  size_t size;
+  size_t head;
+  size_t minalign;
+  int failed;
+
+  /* fields of table being built: offsets from end of buffer or 0 */
+  size_t fields[RASQAL_ARROW_FB_MAX_FIELDS];
+  int fields_count;
+  size_t table_start;
+} rasqal_arrow_fb;
+
+
+#define RASQAL_ARROW_FB_OFFSET(fb) ((fb)->size - (fb)->head)
+
+
+/* make sure there are @need bytes free before @head */
+static int
+rasqal_arrow_fb_grow(rasqal_arrow_fb* fb, size_t need)
+{
+  size_t used;
+  size_t new_size;
+  unsigned char* new_buf;
+
+  if(fb->failed)
+    return 1;
+
+  if(fb->head >= need)
+    return 0;
+
+  used = RASQAL_ARROW_FB_OFFSET(fb);
+  new_size = fb->size ? (fb->size << 1) : 1024;
+  while(new_size < used + need)
+    new_size <<= 1;
+
+  new_buf = RASQAL_MALLOC(unsigned char*, new_size);
+  if(!new_buf) {
+    fb->failed = 1;
+    return 1;
+  }
+
+  if(fb->buf) {
+    memcpy(new_buf + new_size - used, fb->buf + fb->head, used);
+    RASQAL_FREE(unsigned char*, fb->buf);
+  }
+  fb->buf = new_buf;
+  fb->size = new_size;
+  fb->head = new_size - used;
+
+  return 0;
+}
+
+
+/* align so that after @additional bytes an @align sized value fits */
+static int
+rasqal_arrow_fb_prep(rasqal_arrow_fb* fb, size_t align, size_t additional)
+{
+  size_t pad;
+
+  if(align > fb->minalign)
+    fb->minalign = align;
+
+  pad = (~(RASQAL_ARROW_FB_OFFSET(fb) + additional) + 1) & (align - 1);
+  if(rasqal_arrow_fb_grow(fb, pad + align + additional))
+    return 1;
+
+  fb->head -= pad;
+  memset(fb->buf + fb->head, '\0', pad);
+
+  return 0;
+}
+
+
+/* push @n bytes of @value; space must already have been made */
+static void
+rasqal_arrow_fb_push(rasqal_arrow_fb* fb, int64_t value, int n)
+{
+  fb->head -= n;
+  rasqal_arrow_put_le(fb->buf + fb->head, value, n);
+}
+
+
+static void
+rasqal_arrow_fb_push_uoffset(rasqal_arrow_fb* fb, size_t off)
+{
+  if(rasqal_arrow_fb_prep(fb, 4, 0))
+    return;
+  rasqal_arrow_fb_push(fb, RASQAL_GOOD_CAST(int64_t, RASQAL_ARROW_FB_OFFSET(fb) + 4 - off), 4);
+}
+
+
+static size_t
+rasqal_arrow_fb_string(rasqal_arrow_fb* fb, const char* str)
+{
+  size_t len = strlen(str);
+
+  if(rasqal_arrow_fb_prep(fb, 4, len + 1))
+    return 0;
+
+  /* NUL terminator, bytes, length */
+  fb->head -= len + 1;
+  memcpy(fb->buf + fb->head, str, len);
+  fb->buf[fb->head + len] = '\0';
+  rasqal_arrow_fb_push(fb, RASQAL_GOOD_CAST(int64_t, len), 4);
+
+  return RASQAL_ARROW_FB_OFFSET(fb);
+}
+
+
+static int
+rasqal_arrow_fb_start_vector(rasqal_arrow_fb* fb, size_t elem_size,
+                             size_t count, size_t align)
+{
+  return rasqal_arrow_fb_prep(fb, 4, elem_size * count) ||
+         rasqal_arrow_fb_prep(fb, align, elem_size * count);
+}
+
+
+static size_t
+rasqal_arrow_fb_end_vector(rasqal_arrow_fb* fb, size_t count)
+{
+  if(fb->failed)
+    return 0;
+  rasqal_arrow_fb_push(fb, RASQAL_GOOD_CAST(int64_t, count), 4);
+  return RASQAL_ARROW_FB_OFFSET(fb);
+}
+
+
+/* vector of (int64, int64) structs: FieldNode or Buffer */
+static size_t
+rasqal_arrow_fb_pair_vector(rasqal_arrow_fb* fb, const int64_t* pairs,
+                            size_t count)
+{
+  size_t i;
+
+  if(rasqal_arrow_fb_start_vector(fb, 16, count, 8))
+    return 0;
+
+  for(i = count; i > 0; i--) {
+    rasqal_arrow_fb_push(fb, pairs[(i - 1) * 2 + 1], 8);
+    rasqal_arrow_fb_push(fb, pairs[(i - 1) * 2], 8);
+  }
+
+  return rasqal_arrow_fb_end_vector(fb, count);
+}
+
+
+static void
+rasqal_arrow_fb_start_table(rasqal_arrow_fb* fb, int fields_count)
+{
+  memset(fb->fields, '\0', sizeof(fb->fields));
+  fb->fields_count = fields_count;
+  fb->table_start = RASQAL_ARROW_FB_OFFSET(fb);
+}
+
+
+static void
+rasqal_arrow_fb_add_scalar(rasqal_arrow_fb* fb, int slot, int64_t value,
+                           int n)
+{
+  if(rasqal_arrow_fb_prep(fb, n, 0))
+    return;
+  rasqal_arrow_fb_push(fb, value, n);
+  fb->fields[slot] = RASQAL_ARROW_FB_OFFSET(fb);
+}
+
+
+static void
+rasqal_arrow_fb_add_offset(rasqal_arrow_fb* fb, int slot, size_t off)
+{
+  rasqal_arrow_fb_push_uoffset(fb, off);
+  fb->fields[slot] = RASQAL_ARROW_FB_OFFSET(fb);
+}
+
+
+static size_t
+rasqal_arrow_fb_end_table(rasqal_arrow_fb* fb)
+{
+  size_t object;
+  size_t vtable;
+  int n = fb->fields_count;
+  int i;
+
+  /* placeholder for the offset to the vtable */
+  if(rasqal_arrow_fb_prep(fb, 4, 0))
+    return 0;
+  rasqal_arrow_fb_push(fb, 0, 4);
+  object = RASQAL_ARROW_FB_OFFSET(fb);
+
+  while(n > 0 && !fb->fields[n - 1])
+    n--;
+
+  if(rasqal_arrow_fb_grow(fb, RASQAL_GOOD_CAST(size_t, (n + 2) * 2)))
+    return 0;
+
+  for(i = n - 1; i >= 0; i--)
+    rasqal_arrow_fb_push(fb, fb->fields[i] ?
+                         RASQAL_GOOD_CAST(int64_t, object - fb->fields[i]) : 0,
+                         2);
+  rasqal_arrow_fb_push(fb, RASQAL_GOOD_CAST(int64_t, object - fb->table_start), 2);
+  rasqal_arrow_fb_push(fb, (n + 2) * 2, 2);
+  vtable = RASQAL_ARROW_FB_OFFSET(fb);
+
+  rasqal_arrow_put_le(fb->buf + fb->size - object,
+                      RASQAL_GOOD_CAST(int64_t, vtable - object), 4);
+
+  return object;
+}
+
+
+static void
+rasqal_arrow_fb_finish(rasqal_arrow_fb* fb, size_t root)
+{
+  if(rasqal_arrow_fb_prep(fb, fb->minalign, 4))
+    return;
+  rasqal_arrow_fb_push_uoffset(fb, root);
+}
+
+
+static void
+rasqal_arrow_fb_reset(rasqal_arrow_fb* fb)
+{
+  fb->head = fb->size;
+  fb->minalign = 1;
+  fb->failed = 0;
+}
+
+
+
+/* Writer state */
+
+typedef struct {
+  const unsigned char* name;
+  rasqal_arrow_column_type type;
+
+  /* batch buffers */
+  rasqal_arrow_buffer validity;
+  /* fixed width values, utf8 offsets or dictionary indices */
+  rasqal_arrow_buffer values;
+  /* utf8 bytes */
+  rasqal_arrow_buffer data;
+  int null_count;
+
+  /* dictionary values as utf8 offsets and bytes */
+  rasqal_arrow_buffer dict_offsets;
+  rasqal_arrow_buffer dict_data;
+  int dict_count;
+  /* number of dictionary values already written */
+  int dict_sent;
+  /* open addressing hash table of dictionary indices or -1 */
+  int* dict_table;
+  unsigned int dict_table_size;
+
+  /* timestamp column: non-0 if values have a timezone (UTC) */
+  int utc;
+
+  /* number of values written as null since they did not fit @type */
+  int misfits;
+} rasqal_arrow_column;
+
+
+typedef struct {
+  rasqal_world* world;
+  rasqal_query* query;
+  raptor_iostream* iostr;
+
+  int columns_count;
+  rasqal_arrow_column* columns;
+
+  /* batch of rows as @columns_count literal pointers per row */
+  rasqal_arrow_buffer rows;
+  int rows_count;
+
+  /* non-0 once the schema has been written */
+  int schema_written;
+
+  rasqal_arrow_fb fb;
+  rasqal_arrow_buffer body;
+  rasqal_arrow_buffer scratch;
+
+  /* body buffers as (offset, length) pairs and field nodes as
+   * (length, null count) pairs for the message being written */
+  int64_t* buffers;
+  int buffers_count;
+  int64_t* nodes;
+  int nodes_count;
+} rasqal_arrow_writer;
+
+
+static unsigned int
+rasqal_arrow_hash(const unsigned char* str, size_t len)
+{
+  /* FNV-1a */
+  unsigned int hash = 2166136261U;
+
+  while(len--) {
+    hash ^= *str++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+/* append the SPARQL CSV form of a value */
+static int
+rasqal_arrow_append_term(rasqal_arrow_buffer* b, rasqal_literal* l)
+{
+  const unsigned char* str;
+  size_t len = 0;
+
+  str = rasqal_literal_as_counted_string(l, &len, 0, NULL);
+  if(!str)
+    return 1;
+
+  if(l->type == RASQAL_LITERAL_BLANK &&
+     rasqal_arrow_buffer_append(b, "_:", 2))
+    return 1;
+
+  return rasqal_arrow_buffer_append(b, str, len);
+}
+
+
+static int
+rasqal_arrow_dict_grow(rasqal_arrow_column* c)
+{
+  unsigned int new_size = c->dict_table_size ? (c->dict_table_size << 1) : 1024;
+  int* new_table;
+  unsigned int i;
+  int j;
+
+  new_table = RASQAL_MALLOC(int*, new_size * sizeof(int));
+  if(!new_table)
+    return 1;
+  for(i = 0; i < new_size; i++)
+    new_table[i] = -1;
+
+  for(j = 0; j < c->dict_count; j++) {
+    const unsigned char* ofs = c->dict_offsets.data + j * 4;
+    size_t start = ofs[0] | (ofs[1] << 8) | (ofs[2] << 16) | (RASQAL_GOOD_CAST(size_t, ofs[3]) << 24);
+    size_t end = ofs[4] | (ofs[5] << 8) | (ofs[6] << 16) | (RASQAL_GOOD_CAST(size_t, ofs[7]) << 24);
+    unsigned int slot;
+
+    slot = rasqal_arrow_hash(c->dict_data.data + start, end - start) & (new_size - 1);
+    while(new_table[slot] >= 0)
+      slot = (slot + 1) & (new_size - 1);
+    new_table[slot] = j;
+  }
+
+  if(c->dict_table)
+    RASQAL_FREE(int*, c->dict_table);
+  c->dict_table = new_table;
+  c->dict_table_size = new_size;
+
+  return 0;
+}
+
+
+/* Return value: dictionary index of string or <0 on failure */
+static int
+rasqal_arrow_dict_index(rasqal_arrow_column* c, const unsigned char* str,
+                        size_t len)
+{
+  unsigned int slot;
+
+  /* offset of the first value */
+  if(!c->dict_offsets.length &&
+     rasqal_arrow_buffer_append_le(&c->dict_offsets, 0, 4))
+    return -1;
+
+  if(RASQAL_GOOD_CAST(unsigned int, c->dict_count * 2) >= c->dict_table_size &&
+     rasqal_arrow_dict_grow(c))
+    return -1;
+
+  slot = rasqal_arrow_hash(str, len) & (c->dict_table_size - 1);
+  while(c->dict_table[slot] >= 0) {
+    const unsigned char* ofs = c->dict_offsets.data + c->dict_table[slot] * 4;
+    size_t start = ofs[0] | (ofs[1] << 8) | (ofs[2] << 16) | (RASQAL_GOOD_CAST(size_t, ofs[3]) << 24);
+    size_t end = ofs[4] | (ofs[5] << 8) | (ofs[6] << 16) | (RASQAL_GOOD_CAST(size_t, ofs[7]) << 24);
+
+    if(end - start == len && !memcmp(c->dict_data.data + start, str, len))
+      return c->dict_table[slot];
+
+    slot = (slot + 1) & (c->dict_table_size - 1);
+  }
+
+  if(rasqal_arrow_buffer_append(&c->dict_data, str, len) ||
+     rasqal_arrow_buffer_append_le(&c->dict_offsets,
+                                   RASQAL_GOOD_CAST(int64_t, c->dict_data.length), 4))
+    return -1;
+
+  c->dict_table[slot] = c->dict_count;
+  return c->dict_count++;
+}
+
+
+static int
+rasqal_arrow_literal_is_integer(rasqal_literal* l)
+{
+  return l->type == RASQAL_LITERAL_INTEGER ||
+         l->type == RASQAL_LITERAL_INTEGER_SUBTYPE;
+}
+
+
+static int
+rasqal_arrow_literal_is_number(rasqal_literal* l)
+{
+  return rasqal_arrow_literal_is_integer(l) ||
+         l->type == RASQAL_LITERAL_DOUBLE ||
+         l->type == RASQAL_LITERAL_FLOAT ||
+         l->type == RASQAL_LITERAL_DECIMAL;
+}
+
+
+/* choose column types from the first batch of rows */
+static void
+rasqal_arrow_infer_types(rasqal_arrow_writer* w)
+{
+  rasqal_literal** cells;
+  int i;
+
+  cells = RASQAL_GOOD_CAST(rasqal_literal**, w->rows.data);
+
+  for(i = 0; i < w->columns_count; i++) {
+    rasqal_arrow_column* c = &w->columns[i];
+    int integers = 0, numbers = 0, booleans = 0, uris = 0;
+    int utc_datetimes = 0, local_datetimes = 0;
+    int bound = 0;
+    int r;
+
+    for(r = 0; r < w->rows_count; r++) {
+      rasqal_literal* l = cells[r * w->columns_count + i];
+
+      if(!l)
+        continue;
+
+      bound++;
+      if(rasqal_arrow_literal_is_integer(l))
+        integers++;
+      if(rasqal_arrow_literal_is_number(l)) {
+        /* a decimal with no value is written as a string */
+        if(l->type != RASQAL_LITERAL_DECIMAL ||
+           !rasqal_literal_ensure_native(l))
+          numbers++;
+      } else if(l->type == RASQAL_LITERAL_BOOLEAN)
+        booleans++;
+      else if(l->type == RASQAL_LITERAL_DATETIME) {
+        if(!rasqal_literal_ensure_native(l)) {
+          if(l->value.datetime->have_tz == 'N')
+            local_datetimes++;
+          else
+            utc_datetimes++;
+        }
+      } else if(l->type == RASQAL_LITERAL_URI)
+        uris++;
+    }
+
+    if(!bound)
+      c->type = RASQAL_ARROW_COLUMN_UTF8;
+    else if(integers == bound)
+      c->type = RASQAL_ARROW_COLUMN_INT64;
+    else if(numbers == bound)
+      c->type = RASQAL_ARROW_COLUMN_DOUBLE;
+    else if(booleans == bound)
+      c->type = RASQAL_ARROW_COLUMN_BOOL;
+    else if(utc_datetimes == bound || local_datetimes == bound) {
+      c->type = RASQAL_ARROW_COLUMN_TIMESTAMP;
+      c->utc = (utc_datetimes == bound);
+    } else if(uris == bound)
+      c->type = RASQAL_ARROW_COLUMN_DICTIONARY;
+    else
+      c->type = RASQAL_ARROW_COLUMN_UTF8;
+  }
+}
+
+
+/*
+ * rasqal_arrow_build_column:
+ * @w: writer
+ * @index: column index
+ *
+ * INTERNAL - Build the batch buffers of a column from the batch rows
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_arrow_build_column(rasqal_arrow_writer* w, int index)
+{
+  rasqal_arrow_column* c = &w->columns[index];
+  rasqal_literal** cells;
+  int n = w->rows_count;
+  int rc = 0;
+  int r;
+
+  cells = RASQAL_GOOD_CAST(rasqal_literal**, w->rows.data);
+
+  c->validity.length = 0;
+  c->values.length = 0;
+  c->data.length = 0;
+  c->null_count = 0;
+
+  rc = rasqal_arrow_buffer_append(&c->validity, NULL, RASQAL_GOOD_CAST(size_t, (n + 7) / 8));
+  if(c->type == RASQAL_ARROW_COLUMN_BOOL)
+    rc = rc || rasqal_arrow_buffer_append(&c->values, NULL, RASQAL_GOOD_CAST(size_t, (n + 7) / 8));
+  else if(c->type == RASQAL_ARROW_COLUMN_UTF8)
+    rc = rc || rasqal_arrow_buffer_append_le(&c->values, 0, 4);
+
+  for(r = 0; r < n && !rc; r++) {
+    rasqal_literal* l = cells[r * w->columns_count + index];
+    int valid = (l != NULL);
+    int64_t i64 = 0;
+    double d = 0.0;
+    int idx;
+
+    switch(c->type) {
+      case RASQAL_ARROW_COLUMN_INT64:
+        if(l && rasqal_arrow_literal_is_integer(l))
+          i64 = l->value.integer;
+        else
+          valid = 0;
+        rc = rasqal_arrow_buffer_append_le(&c->values, i64, 8);
+        break;
+
+      case RASQAL_ARROW_COLUMN_DOUBLE:
+        if(l && rasqal_arrow_literal_is_integer(l))
+          d = RASQAL_GOOD_CAST(double, l->value.integer);
+        else if(l && l->type == RASQAL_LITERAL_DECIMAL &&
+                !rasqal_literal_ensure_native(l))
+          d = rasqal_xsd_decimal_get_double(l->value.decimal);
+        else if(l && rasqal_arrow_literal_is_number(l))
+          d = l->value.floating;
+        else
+          valid = 0;
+        memcpy(&i64, &d, sizeof(d));
+        rc = rasqal_arrow_buffer_append_le(&c->values, i64, 8);
+        break;
+
+      case RASQAL_ARROW_COLUMN_BOOL:
+        if(l && l->type == RASQAL_LITERAL_BOOLEAN) {
+          if(l->value.integer)
+            c->values.data[r >> 3] |= RASQAL_GOOD_CAST(unsigned char, 1 << (r & 7));
+        } else
+          valid = 0;
+        break;
+
+      case RASQAL_ARROW_COLUMN_TIMESTAMP:
+        if(l && l->type == RASQAL_LITERAL_DATETIME &&
+           !rasqal_literal_ensure_native(l)) {
+          i64 = RASQAL_GOOD_CAST(int64_t, rasqal_xsd_datetime_get_as_unixtime(l->value.datetime));
+          i64 = i64 * 1000000 + l->value.datetime->microseconds;
+        } else
+          valid = 0;
+        rc = rasqal_arrow_buffer_append_le(&c->values, i64, 8);
+        break;
+
+      case RASQAL_ARROW_COLUMN_DICTIONARY:
+        idx = 0;
+        if(l) {
+          w->scratch.length = 0;
+          rc = rasqal_arrow_append_term(&w->scratch, l);
+          if(!rc) {
+            idx = rasqal_arrow_dict_index(c, w->scratch.data,
+                                          w->scratch.length);
+            rc = (idx < 0);
+          }
+        }
+        rc = rc || rasqal_arrow_buffer_append_le(&c->values, idx, 4);
+        break;
+
+      case RASQAL_ARROW_COLUMN_UTF8:
+      default:
+        if(l)
+          rc = rasqal_arrow_append_term(&c->data, l);
+        rc = rc || rasqal_arrow_buffer_append_le(&c->values,
+                                                 RASQAL_GOOD_CAST(int64_t, c->data.length),
+                                                 4);
+        break;
+    }
+
+    if(valid)
+      c->validity.data[r >> 3] |= RASQAL_GOOD_CAST(unsigned char, 1 << (r & 7));
+    else {
+      /* the type was chosen from the first batch */
+      if(l)
+        c->misfits++;
+      c->null_count++;
+    }
+  }
+
+  return rc;
+}
+
+
+/* append a buffer to the message body, 8 byte aligned */
+static int
+rasqal_arrow_body_add(rasqal_arrow_writer* w, const unsigned char* data,
+                      size_t len)
+{
+  size_t pad = (8 - (len & 7)) & 7;
+
+  w->buffers[w->buffers_count * 2] = RASQAL_GOOD_CAST(int64_t, w->body.length);
+  w->buffers[w->buffers_count * 2 + 1] = RASQAL_GOOD_CAST(int64_t, len);
+  w->buffers_count++;
+
+  return rasqal_arrow_buffer_append(&w->body, data, len) ||
+         rasqal_arrow_buffer_append(&w->body, NULL, pad);
+}
+
+
+static void
+rasqal_arrow_add_node(rasqal_arrow_writer* w, int length, int null_count)
+{
+  w->nodes[w->nodes_count * 2] = length;
+  w->nodes[w->nodes_count * 2 + 1] = null_count;
+  w->nodes_count++;
+}
+
+
+/* write the encapsulated message in @fb with the body */
+static int
+rasqal_arrow_write_message(rasqal_arrow_writer* w, int header_type,
+                           size_t header)
+{
+  rasqal_arrow_fb* fb = &w->fb;
+  size_t message;
+  size_t len;
+  size_t pad;
+  unsigned char prefix[8];
+
+  rasqal_arrow_fb_start_table(fb, 5);
+  rasqal_arrow_fb_add_scalar(fb, 3, RASQAL_GOOD_CAST(int64_t, w->body.length), 8);
+  rasqal_arrow_fb_add_offset(fb, 2, header);
+  rasqal_arrow_fb_add_scalar(fb, 0, RASQAL_ARROW_METADATA_V5, 2);
+  rasqal_arrow_fb_add_scalar(fb, 1, header_type, 1);
+  message = rasqal_arrow_fb_end_table(fb);
+  rasqal_arrow_fb_finish(fb, message);
+
+  if(fb->failed)
+    return 1;
+
+  /* continuation marker and metadata length padded to 8 bytes */
+  len = RASQAL_ARROW_FB_OFFSET(fb);
+  pad = (8 - (len & 7)) & 7;
+  rasqal_arrow_put_le(prefix, -1, 4);
+  rasqal_arrow_put_le(prefix + 4, RASQAL_GOOD_CAST(int64_t, len + pad), 4);
+
+  raptor_iostream_write_bytes(prefix, 1, 8, w->iostr);
+  raptor_iostream_write_bytes(fb->buf + fb->head, 1, len, w->iostr);
+  if(pad) {
+    memset(prefix, '\0', pad);
+    raptor_iostream_write_bytes(prefix, 1, pad, w->iostr);
+  }
+  if(w->body.length)
+    raptor_iostream_write_bytes(w->body.data, 1, w->body.length, w->iostr);
+
+  rasqal_arrow_fb_reset(fb);
+  w->body.length = 0;
+  w->buffers_count = 0;
+  w->nodes_count = 0;
+
+  return 0;
+}
+
+
+static size_t
+rasqal_arrow_fb_int_type(rasqal_arrow_fb* fb, int bit_width)
+{
+  rasqal_arrow_fb_start_table(fb, 2);
+  rasqal_arrow_fb_add_scalar(fb, 0, bit_width, 4);
+  rasqal_arrow_fb_add_scalar(fb, 1, 1, 1);
+  return rasqal_arrow_fb_end_table(fb);
+}
+
+
+static int
+rasqal_arrow_write_schema(rasqal_arrow_writer* w)
+{
+  rasqal_arrow_fb* fb = &w->fb;
+  size_t* fields;
+  size_t fields_vector;
+  size_t schema;
+  int i;
+
+  fields = RASQAL_CALLOC(size_t*, RASQAL_GOOD_CAST(size_t, w->columns_count + 1),
+                         sizeof(size_t));
+  if(!fields)
+    return 1;
+
+  for(i = 0; i < w->columns_count; i++) {
+    rasqal_arrow_column* c = &w->columns[i];
+    size_t name;
+    size_t type;
+    size_t dictionary = 0;
+    size_t children;
+    size_t timezone = 0;
+    int type_type;
+
+    name = rasqal_arrow_fb_string(fb, RASQAL_GOOD_CAST(const char*, c->name));
+
+    switch(c->type) {
+      case RASQAL_ARROW_COLUMN_INT64:
+        type_type = RASQAL_ARROW_TYPE_INT;
+        type = rasqal_arrow_fb_int_type(fb, 64);
+        break;
+
+      case RASQAL_ARROW_COLUMN_DOUBLE:
+        type_type = RASQAL_ARROW_TYPE_FLOATING_POINT;
+        rasqal_arrow_fb_start_table(fb, 1);
+        rasqal_arrow_fb_add_scalar(fb, 0, RASQAL_ARROW_PRECISION_DOUBLE, 2);
+        type = rasqal_arrow_fb_end_table(fb);
+        break;
+
+      case RASQAL_ARROW_COLUMN_BOOL:
+        type_type = RASQAL_ARROW_TYPE_BOOL;
+        rasqal_arrow_fb_start_table(fb, 0);
+        type = rasqal_arrow_fb_end_table(fb);
+        break;
+
+      case RASQAL_ARROW_COLUMN_TIMESTAMP:
+        type_type = RASQAL_ARROW_TYPE_TIMESTAMP;
+        /* no timezone is a local date and time */
+        if(c->utc)
+          timezone = rasqal_arrow_fb_string(fb, "UTC");
+        rasqal_arrow_fb_start_table(fb, 2);
+        if(timezone)
+          rasqal_arrow_fb_add_offset(fb, 1, timezone);
+        rasqal_arrow_fb_add_scalar(fb, 0, RASQAL_ARROW_TIME_UNIT_MICROSECOND, 2);
+        type = rasqal_arrow_fb_end_table(fb);
+        break;
+
+      case RASQAL_ARROW_COLUMN_DICTIONARY:
+      case RASQAL_ARROW_COLUMN_UTF8:
+      default:
+        type_type = RASQAL_ARROW_TYPE_UTF8;
+        rasqal_arrow_fb_start_table(fb, 0);
+        type = rasqal_arrow_fb_end_table(fb);
+        break;
+    }
+
+    if(c->type == RASQAL_ARROW_COLUMN_DICTIONARY) {
+      size_t index_type = rasqal_arrow_fb_int_type(fb, 32);
+
+      /* dictionary id is the column index */
+      rasqal_arrow_fb_start_table(fb, 4);
+      rasqal_arrow_fb_add_scalar(fb, 0, i, 8);
+      rasqal_arrow_fb_add_offset(fb, 1, index_type);
+      rasqal_arrow_fb_add_scalar(fb, 2, 0, 1);
+      dictionary = rasqal_arrow_fb_end_table(fb);
+    }
+
+    rasqal_arrow_fb_start_vector(fb, 4, 0, 4);
+    children = rasqal_arrow_fb_end_vector(fb, 0);
+
+    rasqal_arrow_fb_start_table(fb, 7);
+    rasqal_arrow_fb_add_offset(fb, 0, name);
+    rasqal_arrow_fb_add_offset(fb, 3, type);
+    if(dictionary)
+      rasqal_arrow_fb_add_offset(fb, 4, dictionary);
+    rasqal_arrow_fb_add_offset(fb, 5, children);
+    rasqal_arrow_fb_add_scalar(fb, 1, 1, 1);
+    rasqal_arrow_fb_add_scalar(fb, 2, type_type, 1);
+    fields[i] = rasqal_arrow_fb_end_table(fb);
+  }
+
+  rasqal_arrow_fb_start_vector(fb, 4, RASQAL_GOOD_CAST(size_t, w->columns_count), 4);
+  for(i = w->columns_count - 1; i >= 0; i--)
+    rasqal_arrow_fb_push_uoffset(fb, fields[i]);
+  fields_vector = rasqal_arrow_fb_end_vector(fb, RASQAL_GOOD_CAST(size_t, w->columns_count));
+
+  RASQAL_FREE(size_t*, fields);
+
+  /* little endian */
+  rasqal_arrow_fb_start_table(fb, 4);
+  rasqal_arrow_fb_add_offset(fb, 1, fields_vector);
+  rasqal_arrow_fb_add_scalar(fb, 0, 0, 2);
+  schema = rasqal_arrow_fb_end_table(fb);
+
+  return rasqal_arrow_write_message(w, RASQAL_ARROW_HEADER_SCHEMA, schema);
+}
+
+
+/* RecordBatch table from the nodes and buffers collected */
+static size_t
+rasqal_arrow_fb_record_batch(rasqal_arrow_writer* w, int length)
+{
+  rasqal_arrow_fb* fb = &w->fb;
+  size_t nodes;
+  size_t buffers;
+
+  buffers = rasqal_arrow_fb_pair_vector(fb, w->buffers,
+                                        RASQAL_GOOD_CAST(size_t, w->buffers_count));
+  nodes = rasqal_arrow_fb_pair_vector(fb, w->nodes,
+                                      RASQAL_GOOD_CAST(size_t, w->nodes_count));
+
+  rasqal_arrow_fb_start_table(fb, 5);
+  rasqal_arrow_fb_add_scalar(fb, 0, length, 8);
+  rasqal_arrow_fb_add_offset(fb, 1, nodes);
+  rasqal_arrow_fb_add_offset(fb, 2, buffers);
+  return rasqal_arrow_fb_end_table(fb);
+}
+
+
+/* write new dictionary values of column @index as a dictionary batch */
+static int
+rasqal_arrow_write_dictionary(rasqal_arrow_writer* w, int index)
+{
+  rasqal_arrow_column* c = &w->columns[index];
+  int count = c->dict_count - c->dict_sent;
+  const unsigned char* ofs = c->dict_offsets.data + c->dict_sent * 4;
+  size_t base;
+  size_t end;
+  size_t record_batch;
+  size_t dictionary_batch;
+  int rc = 0;
+  int i;
+
+  base = ofs[0] | (ofs[1] << 8) | (ofs[2] << 16) | (RASQAL_GOOD_CAST(size_t, ofs[3]) << 24);
+  end = c->dict_data.length;
+
+  rasqal_arrow_add_node(w, count, 0);
+  rc = rasqal_arrow_body_add(w, NULL, 0);
+
+  /* offsets relative to the first new value */
+  w->scratch.length = 0;
+  for(i = 0; i <= count && !rc; i++) {
+    const unsigned char* p = ofs + i * 4;
+    size_t o = p[0] | (p[1] << 8) | (p[2] << 16) | (RASQAL_GOOD_CAST(size_t, p[3]) << 24);
+
+    rc = rasqal_arrow_buffer_append_le(&w->scratch, RASQAL_GOOD_CAST(int64_t, o - base), 4);
+  }
+  rc = rc || rasqal_arrow_body_add(w, w->scratch.data, w->scratch.length);
+  rc = rc || rasqal_arrow_body_add(w, c->dict_data.data + base, end - base);
+  if(rc)
+    return 1;
+
+  record_batch = rasqal_arrow_fb_record_batch(w, count);
+
+  rasqal_arrow_fb_start_table(&w->fb, 3);
+  rasqal_arrow_fb_add_scalar(&w->fb, 0, index, 8);
+  rasqal_arrow_fb_add_offset(&w->fb, 1, record_batch);
+  rasqal_arrow_fb_add_scalar(&w->fb, 2, c->dict_sent > 0, 1);
+  dictionary_batch = rasqal_arrow_fb_end_table(&w->fb);
+
+  c->dict_sent = c->dict_count;
+
+  return rasqal_arrow_write_message(w, RASQAL_ARROW_HEADER_DICTIONARY_BATCH,
+                                    dictionary_batch);
+}
+
+
+static int
+rasqal_arrow_write_batch(rasqal_arrow_writer* w)
+{
+  int rc = 0;
+  int i;
+
+  for(i = 0; i < w->columns_count && !rc; i++)
+    rc = rasqal_arrow_build_column(w, i);
+
+  for(i = 0; i < w->columns_count && !rc; i++) {
+    rasqal_arrow_column* c = &w->columns[i];
+
+    if(c->type == RASQAL_ARROW_COLUMN_DICTIONARY &&
+       c->dict_count > c->dict_sent)
+      rc = rasqal_arrow_write_dictionary(w, i);
+  }
+
+  for(i = 0; i < w->columns_count && !rc; i++) {
+    rasqal_arrow_column* c = &w->columns[i];
+
+    rasqal_arrow_add_node(w, w->rows_count, c->null_count);
+    rc = rasqal_arrow_body_add(w, c->validity.data,
+                               c->null_count ? c->validity.length : 0);
+    rc = rc || rasqal_arrow_body_add(w, c->values.data, c->values.length);
+    if(c->type == RASQAL_ARROW_COLUMN_UTF8)
+      rc = rc || rasqal_arrow_body_add(w, c->data.data, c->data.length);
+  }
+
+  if(rc)
+    return 1;
+
+  return rasqal_arrow_write_message(w, RASQAL_ARROW_HEADER_RECORD_BATCH,
+                                    rasqal_arrow_fb_record_batch(w, w->rows_count));
+}
+
+
+static void
+rasqal_arrow_free_rows(rasqal_arrow_writer* w)
+{
+  rasqal_literal** cells;
+  int i;
+
+  cells = RASQAL_GOOD_CAST(rasqal_literal**, w->rows.data);
+  for(i = 0; i < w->rows_count * w->columns_count; i++) {
+    if(cells[i])
+      rasqal_free_literal(cells[i]);
+  }
+  /* keep the allocation for the next batch */
+  w->rows.length = 0;
+  w->rows_count = 0;
+}
+
+
+/*
+ * rasqal_arrow_flush_rows:
+ * @w: writer
+ *
+ * INTERNAL - Write the batch of rows, after the schema if this is the first batch
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_arrow_flush_rows(rasqal_arrow_writer* w)
+{
+  int rc = 0;
+
+  if(!w->schema_written) {
+    rasqal_arrow_infer_types(w);
+    rc = rasqal_arrow_write_schema(w);
+    w->schema_written = 1;
+  }
+
+  if(!rc && w->rows_count)
+    rc = rasqal_arrow_write_batch(w);
+
+  rasqal_arrow_free_rows(w);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_query_results_write_arrow:
+ * @iostr: #raptor_iostream to write the query to
+ * @results: #rasqal_query_results query results format
+ * @base_uri: #raptor_uri base URI of the output format
+ *
+ * Write query results as an Apache Arrow IPC stream to a
+ * #raptor_iostream
+ *
+ * Return value: non-0 on failure
+ **/
+static int
+rasqal_query_results_write_arrow(rasqal_query_results_formatter* formatter,
+                                 raptor_iostream *iostr,
+                                 rasqal_query_results* results,
+                                 raptor_uri *base_uri)
+{
+  rasqal_world* world = rasqal_query_results_get_world(results);
+  rasqal_query* query = rasqal_query_results_get_query(results);
+  rasqal_query_results_type type;
+  rasqal_arrow_writer w;
+  int is_boolean;
+  int rc = 0;
+  int i;
+
+  type = rasqal_query_results_get_type(results);
+
+  if(type != RASQAL_QUERY_RESULTS_BINDINGS &&
+     type != RASQAL_QUERY_RESULTS_BOOLEAN) {
+    rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR,
+                            query ? &query->locator : NULL,
+                            "Cannot write Arrow for %s query result format",
+                            rasqal_query_results_type_label(type));
+    return 1;
+  }
+
+  is_boolean = rasqal_query_results_is_boolean(results);
+
+  memset(&w, '\0', sizeof(w));
+  w.world = world;
+  w.query = query;
+  w.iostr = iostr;
+  rasqal_arrow_fb_reset(&w.fb);
+
+  if(is_boolean)
+    w.columns_count = 1;
+  else {
+    while(rasqal_query_results_get_binding_name(results, w.columns_count))
+      w.columns_count++;
+  }
+
+  w.columns = RASQAL_CALLOC(rasqal_arrow_column*,
+                            RASQAL_GOOD_CAST(size_t, w.columns_count + 1),
+                            sizeof(rasqal_arrow_column));
+  /* up to 3 buffers per column */
+  w.buffers = RASQAL_CALLOC(int64_t*, RASQAL_GOOD_CAST(size_t, w.columns_count * 3 + 3) * 2,
+                            sizeof(int64_t));
+  w.nodes = RASQAL_CALLOC(int64_t*, RASQAL_GOOD_CAST(size_t, w.columns_count + 1) * 2,
+                          sizeof(int64_t));
+  if(!w.columns || !w.buffers || !w.nodes) {
+    rc = 1;
+    goto tidy;
+  }
+
+  for(i = 0; i < w.columns_count; i++)
+    w.columns[i].name = is_boolean ? RASQAL_GOOD_CAST(const unsigned char*, "boolean") :
+                        rasqal_query_results_get_binding_name(results, i);
+
+  /* write each batch of rows as it fills */
+  if(is_boolean) {
+    rasqal_literal* l;
+
+    l = rasqal_new_boolean_literal(world,
+                                   rasqal_query_results_get_boolean(results) > 0);
+    rc = rasqal_arrow_buffer_append(&w.rows, &l, sizeof(l));
+    if(rc)
+      rasqal_free_literal(l);
+    else
+      w.rows_count = 1;
+  } else {
+    while(!rc && !rasqal_query_results_finished(results)) {
+      rasqal_row* row = rasqal_query_results_get_current_row(results);
+      rasqal_literal** cells;
+
+      if(!row)
+        break;
+
+      rc = rasqal_arrow_buffer_append(&w.rows, NULL,
+                                      RASQAL_GOOD_CAST(size_t, w.columns_count) * sizeof(rasqal_literal*));
+      if(rc)
+        break;
+
+      cells = RASQAL_GOOD_CAST(rasqal_literal**, w.rows.data) +
+              w.rows_count * w.columns_count;
+      for(i = 0; i < w.columns_count && i < row->size; i++)
+        cells[i] = row->values[i] ? rasqal_new_literal_from_literal(row->values[i]) : NULL;
+      w.rows_count++;
+
+      rasqal_query_results_next(results);
+
+      if(w.rows_count == RASQAL_ARROW_BATCH_SIZE)
+        rc = rasqal_arrow_flush_rows(&w);
+    }
+  }
+
+  /* last partial batch and the schema if no batch was written */
+  if(!rc && (w.rows_count || !w.schema_written))
+    rc = rasqal_arrow_flush_rows(&w);
+
+  for(i = 0; !rc && i < w.columns_count; i++) {
+    if(w.columns[i].misfits)
+      rasqal_log_warning_simple(world, RASQAL_WARNING_LEVEL_MAYBE_ERROR,
+                                query ? &query->locator : NULL,
+                                "Arrow column %s: %d values did not fit the type chosen from the first batch and were written as null",
+                                RASQAL_GOOD_CAST(const char*, w.columns[i].name),
+                                w.columns[i].misfits);
+  }
+
+  if(!rc) {
+    /* end of stream */
+    unsigned char eos[8];
+
+    rasqal_arrow_put_le(eos, -1, 4);
+    rasqal_arrow_put_le(eos + 4, 0, 4);
+    raptor_iostream_write_bytes(eos, 1, 8, iostr);
+  }
+
+  tidy:
+  rasqal_arrow_free_rows(&w);
+  rasqal_arrow_buffer_clear(&w.rows);
+
+  if(w.columns) {
+    for(i = 0; i < w.columns_count; i++) {
+      rasqal_arrow_column* c = &w.columns[i];
+
+      rasqal_arrow_buffer_clear(&c->validity);
+      rasqal_arrow_buffer_clear(&c->values);
+      rasqal_arrow_buffer_clear(&c->data);
+      rasqal_arrow_buffer_clear(&c->dict_offsets);
+      rasqal_arrow_buffer_clear(&c->dict_data);
+      if(c->dict_table)
+        RASQAL_FREE(int*, c->dict_table);
+    }
+    RASQAL_FREE(rasqal_arrow_column*, w.columns);
+  }
+
+  if(w.buffers)
+    RASQAL_FREE(int64_t*, w.buffers);
+  if(w.nodes)
+    RASQAL_FREE(int64_t*, w.nodes);
+  if(w.fb.buf)
+    RASQAL_FREE(unsigned char*, w.fb.buf);
+  rasqal_arrow_buffer_clear(&w.body);
+  rasqal_arrow_buffer_clear(&w.scratch);
+
+  return rc;
+}
+
+
+static const char* const arrow_names[] = { "arrow", NULL};
+
+static const char* const arrow_uri_strings[] = {
+  "https://arrow.apache.org/docs/format/Columnar.html#ipc-streaming-format",
+  NULL
+};
+
+static const raptor_type_q arrow_types[] = {
+  { "application/vnd.apache.arrow.stream", 35, 10},
+  { NULL, 0, 0}
+};
+
+static int
+rasqal_query_results_arrow_register_factory(rasqal_query_results_format_factory *factory)
+{
+  int rc = 0;
+
+  factory->desc.names = arrow_names;
+  factory->desc.mime_types = arrow_types;
+
+  factory->desc.label = "Apache Arrow IPC Stream";
+  factory->desc.uri_strings = arrow_uri_strings;
+
+  factory->desc.flags = 0;
+
+  factory->write         = rasqal_query_results_write_arrow;
+  factory->get_rowsource = NULL;
+
+  return rc;
+}
+
+
+int
+rasqal_init_result_format_arrow(rasqal_world* world)
+{
+  return !rasqal_world_register_query_results_format_factory(world,
+                                                             &rasqal_query_results_arrow_register_factory);
+}
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+static const char* const arrow_test_results =
+  "{ \"head\": { \"vars\": [ \"s\", \"n\", \"d\", \"b\", \"t\", \"label\" ] },\n"
+  "  \"results\": { \"bindings\": [\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"n\": { \"type\": \"literal\", \"value\": \"-42\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" },\n"
+  "      \"d\": { \"type\": \"literal\", \"value\": \"2.5\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#double\" },\n"
+  "      \"b\": { \"type\": \"literal\", \"value\": \"true\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#boolean\" },\n"
+  "      \"t\": { \"type\": \"literal\", \"value\": \"2014-01-02T03:04:05Z\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#dateTime\" },\n"
+  "      \"label\": { \"type\": \"literal\", \"xml:lang\": \"en\", \"value\": \"A\" } },\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"n\": { \"type\": \"literal\", \"value\": \"7\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" },\n"
+  "      \"d\": { \"type\": \"literal\", \"value\": \"3\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" },\n"
+  "      \"label\": { \"type\": \"bnode\", \"value\": \"b1\" } }\n"
+  "  ] }\n"
+  "}\n";
+
+
+static unsigned long
+arrow_test_get_le(const unsigned char* p, int n)
+{
+  unsigned long v = 0;
+
+  while(n--)
+    v = (v << 8) | p[n];
+
+  return v;
+}
+
+
+/*
+ * Walk the messages of an Arrow stream storing their header types
+ * in @types.  Returns the number of messages or -1 if the framing
+ * is bad.
+ */
+static int
+arrow_test_walk(const unsigned char* p, size_t len, int* types, int max)
+{
+  const unsigned char* end = p + len;
+  int count = 0;
+
+  while(end - p >= 8) {
+    unsigned long meta_len;
+    const unsigned char* meta;
+    const unsigned char* table;
+    const unsigned char* vtable;
+    unsigned long vtable_len;
+    unsigned long body_len = 0;
+    unsigned long field;
+
+    if(arrow_test_get_le(p, 4) != 0xFFFFFFFFUL)
+      return -1;
+    meta_len = arrow_test_get_le(p + 4, 4);
+    p += 8;
+    if(!meta_len)
+      /* end of stream */
+      return (p == end) ? count : -1;
+
+    if((meta_len & 7) || meta_len > RASQAL_GOOD_CAST(unsigned long, end - p) ||
+       count == max)
+      return -1;
+
+    /* Message table: header_type is field 1, bodyLength field 3 */
+    meta = p;
+    table = meta + arrow_test_get_le(meta, 4);
+    vtable = table - RASQAL_GOOD_CAST(long, arrow_test_get_le(table, 4));
+    vtable_len = arrow_test_get_le(vtable, 2);
+
+    types[count] = 0;
+    if(vtable_len > 6 && (field = arrow_test_get_le(vtable + 6, 2)))
+      types[count] = table[field];
+    if(vtable_len > 10 && (field = arrow_test_get_le(vtable + 10, 2)))
+      body_len = arrow_test_get_le(table + field, 8);
+    count++;
+
+    p += meta_len;
+    if((body_len & 7) || body_len > RASQAL_GOOD_CAST(unsigned long, end - p))
+      return -1;
+    p += body_len;
+  }
+
+  return -1;
+}
+
+
+/* Field @slot of the flatbuffer table at @table or NULL if absent */
+static const unsigned char*
+arrow_test_table_field(const unsigned char* table, int slot)
+{
+  const unsigned char* vtable;
+  unsigned long vtable_len;
+  unsigned long field;
+
+  vtable = table - RASQAL_GOOD_CAST(long, arrow_test_get_le(table, 4));
+  vtable_len = arrow_test_get_le(vtable, 2);
+  if(RASQAL_GOOD_CAST(unsigned long, 6 + slot * 2) > vtable_len)
+    return NULL;
+
+  field = arrow_test_get_le(vtable + 4 + slot * 2, 2);
+  return field ? table + field : NULL;
+}
+
+
+/* Target of the flatbuffer offset at @p or NULL */
+static const unsigned char*
+arrow_test_deref(const unsigned char* p)
+{
+  return p ? p + arrow_test_get_le(p, 4) : NULL;
+}
+
+
+/*
+ * Get the Arrow type of field @index in the schema message at the
+ * start of an Arrow stream and whether it has a timezone.  Returns
+ * the type or -1 if not found.
+ */
+static int
+arrow_test_field_type(const unsigned char* stream, int index, int* has_tz)
+{
+  const unsigned char* meta = stream + 8;
+  const unsigned char* schema;
+  const unsigned char* fields;
+  const unsigned char* field;
+  const unsigned char* type_type;
+  const unsigned char* type;
+
+  /* Message header is field 2, Schema fields field 1 */
+  schema = arrow_test_deref(arrow_test_table_field(arrow_test_deref(meta), 2));
+  fields = schema ? arrow_test_deref(arrow_test_table_field(schema, 1)) : NULL;
+  if(!fields || RASQAL_GOOD_CAST(unsigned long, index) >= arrow_test_get_le(fields, 4))
+    return -1;
+
+  /* Field type_type is field 2, type field 3; Timestamp timezone field 1 */
+  field = arrow_test_deref(fields + 4 + index * 4);
+  type_type = arrow_test_table_field(field, 2);
+  type = arrow_test_deref(arrow_test_table_field(field, 3));
+  *has_tz = type && arrow_test_table_field(type, 1) != NULL;
+
+  return type_type ? *type_type : 0;
+}
+
+
+#define ARROW_TEST_MAX_MESSAGES 10
+
+/* more rows than a batch so the mixed value is in the second batch */
+#define ARROW_TEST_MIXED_ROWS (RASQAL_ARROW_BATCH_SIZE + 1)
+
+/* expected types of the arrow_test_results columns */
+static const int arrow_test_types[6] = {
+  RASQAL_ARROW_TYPE_UTF8, RASQAL_ARROW_TYPE_INT,
+  RASQAL_ARROW_TYPE_FLOATING_POINT, RASQAL_ARROW_TYPE_BOOL,
+  RASQAL_ARROW_TYPE_TIMESTAMP, RASQAL_ARROW_TYPE_UTF8
+};
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  raptor_uri* base_uri;
+  rasqal_query_results* results;
+  rasqal_query_results_formatter* formatter;
+  raptor_iostream* iostr;
+  void* string = NULL;
+  size_t string_len = 0;
+  int types[ARROW_TEST_MAX_MESSAGES];
+  int count;
+  int failures = 0;
+  raptor_stringbuffer* sb;
+  int has_tz;
+  int i;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+
+  /* Test 1: schema, one dictionary batch for ?s and one record batch */
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BINDINGS);
+  formatter = rasqal_new_query_results_formatter(world, "json", NULL, NULL);
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, arrow_test_results),
+                                          strlen(arrow_test_results));
+  if(rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                         base_uri)) {
+    fprintf(stderr, "%s: reading test results failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+
+  formatter = rasqal_new_query_results_formatter(world, "arrow", NULL, NULL);
+  iostr = raptor_new_iostream_to_string(world->raptor_world_ptr,
+                                        &string, &string_len, malloc);
+  if(!failures &&
+     rasqal_query_results_formatter_write(iostr, formatter, results,
+                                          base_uri)) {
+    fprintf(stderr, "%s: writing Arrow failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+  rasqal_free_query_results(results);
+
+  if(!failures) {
+    count = arrow_test_walk(RASQAL_GOOD_CAST(const unsigned char*, string),
+                            string_len, types, ARROW_TEST_MAX_MESSAGES);
+    if(count != 3 ||
+       types[0] != RASQAL_ARROW_HEADER_SCHEMA ||
+       types[1] != RASQAL_ARROW_HEADER_DICTIONARY_BATCH ||
+       types[2] != RASQAL_ARROW_HEADER_RECORD_BATCH) {
+      fprintf(stderr, "%s: test 1 Arrow stream of %d bytes has %d messages, expected schema, dictionary and record batch\n",
+              program, RASQAL_GOOD_CAST(int, string_len), count);
+      failures++;
+    }
+
+    for(i = 0; i < 6 && count > 0; i++) {
+      int type = arrow_test_field_type(RASQAL_GOOD_CAST(const unsigned char*, string),
+                                       i, &has_tz);
+      if(type != arrow_test_types[i]) {
+        fprintf(stderr, "%s: test 1 column %d has Arrow type %d, expected %d\n",
+                program, i, type, arrow_test_types[i]);
+        failures++;
+      }
+    }
+  }
+  if(string)
+    free(string);
+  string = NULL;
+
+  /* Test 3: the column types come from the first batch, each batch
+   * is written as it fills, a later value that does not fit the type
+   * is written as null and dateTimes with no timezone are a timestamp
+   * with no timezone */
+  sb = raptor_new_stringbuffer();
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*,
+    "{ \"head\": { \"vars\": [ \"n\", \"t\" ] },\n"
+    "  \"results\": { \"bindings\": [\n"), 1);
+  for(i = 0; i < ARROW_TEST_MIXED_ROWS; i++) {
+    char row[256];
+
+    sprintf(row,
+            "%s    { \"n\": { \"type\": \"literal\", \"value\": \"%s\"%s },\n"
+            "      \"t\": { \"type\": \"literal\", \"value\": \"2014-01-02T03:04:05\",\n"
+            "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#dateTime\" } }",
+            i ? ",\n" : "",
+            (i < ARROW_TEST_MIXED_ROWS - 1) ? "1" : "x",
+            (i < ARROW_TEST_MIXED_ROWS - 1) ?
+              ", \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\"" : "");
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, row), 1);
+  }
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*,
+    "\n  ] }\n}\n"), 1);
+
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BINDINGS);
+  formatter = rasqal_new_query_results_formatter(world, "json", NULL, NULL);
+  iostr = rasqal_new_iostream_from_stringbuffer(world->raptor_world_ptr, sb);
+  if(rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                         base_uri)) {
+    fprintf(stderr, "%s: reading test 3 results failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+
+  formatter = rasqal_new_query_results_formatter(world, "arrow", NULL, NULL);
+  iostr = raptor_new_iostream_to_string(world->raptor_world_ptr,
+                                        &string, &string_len, malloc);
+  if(rasqal_query_results_formatter_write(iostr, formatter, results,
+                                          base_uri)) {
+    fprintf(stderr, "%s: writing test 3 Arrow failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+  rasqal_free_query_results(results);
+
+  count = string ? arrow_test_walk(RASQAL_GOOD_CAST(const unsigned char*, string),
+                                   string_len, types,
+                                   ARROW_TEST_MAX_MESSAGES) : -1;
+  if(count != 3 ||
+     types[0] != RASQAL_ARROW_HEADER_SCHEMA ||
+     types[1] != RASQAL_ARROW_HEADER_RECORD_BATCH ||
+     types[2] != RASQAL_ARROW_HEADER_RECORD_BATCH) {
+    fprintf(stderr, "%s: test 3 Arrow stream has %d messages, expected schema and 2 record batches\n",
+            program, count);
+    failures++;
+  } else {
+    if(arrow_test_field_type(RASQAL_GOOD_CAST(const unsigned char*, string),
+                             0, &has_tz) != RASQAL_ARROW_TYPE_INT) {
+      fprintf(stderr, "%s: test 3 column is not int64 from the first batch\n",
+              program);
+      failures++;
+    }
+    if(arrow_test_field_type(RASQAL_GOOD_CAST(const unsigned char*, string),
+                             1, &has_tz) != RASQAL_ARROW_TYPE_TIMESTAMP ||
+       has_tz) {
+      fprintf(stderr, "%s: test 3 local dateTime column is not a timestamp with no timezone\n",
+              program);
+      failures++;
+    }
+  }
+  if(string)
+    free(string);
+  string = NULL;
+
+  /* Test 2: boolean is a schema and one record batch */
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BOOLEAN);
+  rasqal_query_results_set_boolean(results, 1);
+  formatter = rasqal_new_query_results_formatter(world, "arrow", NULL, NULL);
+  iostr = raptor_new_iostream_to_string(world->raptor_world_ptr,
+                                        &string, &string_len, malloc);
+  if(rasqal_query_results_formatter_write(iostr, formatter, results,
+                                          base_uri)) {
+    fprintf(stderr, "%s: writing boolean Arrow failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+  rasqal_free_query_results(results);
+
+  count = string ? arrow_test_walk(RASQAL_GOOD_CAST(const unsigned char*, string),
+                                   string_len, types,
+                                   ARROW_TEST_MAX_MESSAGES) : -1;
+  if(count != 2 ||
+     types[0] != RASQAL_ARROW_HEADER_SCHEMA ||
+     types[1] != RASQAL_ARROW_HEADER_RECORD_BATCH) {
+    fprintf(stderr, "%s: test 2 boolean Arrow stream has %d messages, expected 2\n",
+            program, count);
+    failures++;
+  }
+  if(string)
+    free(string);
+
+  raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -0,0 +1,1811 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_format_binary.c - Compact binary query results format
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#ifndef FILE_READ_BUF_SIZE
+#ifdef BUFSIZ
+#define FILE_READ_BUF_SIZE BUFSIZ
+#else
+#define FILE_READ_BUF_SIZE 1024
+#endif
+#endif
+
+
+/*
+ * Rasqal binary query results format
+ *
+ * A stream for passing results between rasqal engines, or caching
+ * them, without re-parsing lexical forms.
+ *
+ * The stream starts with the 4 bytes "RSQB" and a version byte,
+ * then a sequence of records.  Each record is a tag byte, the body
+ * length as a varint and the body.  Readers skip records with
+ * unknown tags.
+ *
+ *   'V'  variables: varint count then count strings
+ *   'R'  row: varint count then count cells
+ *   'B'  boolean: one byte 0 or 1
+ *   'E'  end of results: empty body
+ *
+ * A varint is an unsigned integer in little-endian base 128 and a
+ * string is a varint byte length followed by the bytes.
+ *
+ * A cell is a type byte followed by:
+ *   0  unbound: nothing
+ *   1  dictionary reference: varint term id
+ *   2  new dictionary term: a term; it gets the next term id
+ *   3  canonical xsd:integer: zigzag varint
+ *   4  canonical xsd:double: 8 bytes IEEE 754 little-endian
+ *   5  canonical xsd:boolean: one byte 0 or 1
+ *   6  term not added to the dictionary (dictionary full): a term
+ *
+ * A term is a kind byte followed by:
+ *   'u'  URI: string
+ *   'b'  blank node: string
+ *   'l'  plain literal: string
+ *   'L'  language literal: language string then value string
+ *   'T'  typed literal: datatype URI cell then value string; the
+ *        cell is a reference to a URI term or a 'u' term
+ *
+ * Term ids start at 0 in each stream and are given when a term has
+ * been completely read, so a datatype URI defined inside a typed
+ * literal gets its id before the literal.
+ */
+
+#define RASQAL_BINARY_MAGIC "RSQB"
+#define RASQAL_BINARY_MAGIC_LEN 4
+#define RASQAL_BINARY_VERSION 1
+#define RASQAL_BINARY_HEADER_LEN (RASQAL_BINARY_MAGIC_LEN + 1)
+
+/* Maximum number of terms in a stream dictionary */
+#define RASQAL_BINARY_DICTIONARY_MAX (1 << 20)
+
+typedef enum {
+  RASQAL_BINARY_CELL_UNBOUND = 0,
+  RASQAL_BINARY_CELL_REFERENCE = 1,
+  RASQAL_BINARY_CELL_DEFINE = 2,
+  RASQAL_BINARY_CELL_INTEGER = 3,
+  RASQAL_BINARY_CELL_DOUBLE = 4,
+  RASQAL_BINARY_CELL_BOOLEAN = 5,
+  RASQAL_BINARY_CELL_INLINE = 6
+} rasqal_binary_cell_type;
+
+
+/* Growable byte buffer */
+typedef struct {
+  unsigned char* data;
+  size_t length;
+  size_t size;
+} rasqal_binary_buffer;
+
+
+static int
+rasqal_binary_buffer_append(rasqal_binary_buffer* b,
+                            const void* data, size_t len)
+{
+  if(b->length + len > b->size) {
+    size_t new_size = b->size ? (b->size << 1) : 256;
+    unsigned char* new_data;
+
+    while(new_size < b->length + len)
+      new_size <<= 1;
+
+    new_data = RASQAL_MALLOC(unsigned char*, new_size);
+    if(!new_data)
+      return 1;
+
+    if(b->data) {
+      memcpy(new_data, b->data, b->length);
+      RASQAL_FREE(unsigned char*, b->data);
+    }
+    b->data = new_data;
+    b->size = new_size;
+  }
+
+  if(len)
+    memcpy(b->data + b->length, data, len);
+  b->length += len;
+
+  return 0;
+}
+
+
+static int
+rasqal_binary_buffer_append_byte(rasqal_binary_buffer* b, int c)
+{
+  unsigned char byte = RASQAL_GOOD_CAST(unsigned char, c);
+
+  return rasqal_binary_buffer_append(b, &byte, 1);
+}
+
+
+static size_t
+rasqal_binary_encode_varint(unsigned char* buf, unsigned long value)
+{
+  size_t len = 0;
+
+  while(value >= 0x80) {
+    buf[len++] = RASQAL_GOOD_CAST(unsigned char, (value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buf[len++] = RASQAL_GOOD_CAST(unsigned char, value);
+
+  return len;
+}
+
+
+static int
+rasqal_binary_buffer_append_varint(rasqal_binary_buffer* b,
+                                   unsigned long value)
+{
+  unsigned char buf[16];
+
+  return rasqal_binary_buffer_append(b, buf,
+                                     rasqal_binary_encode_varint(buf, value));
+}
+
+
+static int
+rasqal_binary_buffer_append_string(rasqal_binary_buffer* b,
+                                   const unsigned char* str, size_t len)
+{
+  return rasqal_binary_buffer_append_varint(b, RASQAL_GOOD_CAST(unsigned long, len)) ||
+         rasqal_binary_buffer_append(b, str, len);
+}
+
+
+static void
+rasqal_binary_buffer_clear(rasqal_binary_buffer* b)
+{
+  if(b->data)
+    RASQAL_FREE(unsigned char*, b->data);
+  b->data = NULL;
+  b->length = b->size = 0;
+}
+
+
+/* non-0 if the host stores doubles big-endian */
+static int
+rasqal_binary_host_is_big_endian(void)
+{
+  unsigned int one = 1;
+
+  return !*RASQAL_GOOD_CAST(unsigned char*, &one);
+}
+
+
+/* copy a double to or from 8 little-endian bytes */
+static void
+rasqal_binary_copy_double(unsigned char* dest, const unsigned char* src)
+{
+  int i;
+
+  if(rasqal_binary_host_is_big_endian()) {
+    for(i = 0; i < 8; i++)
+      dest[i] = src[7 - i];
+  } else
+    memcpy(dest, src, 8);
+}
+
+
+
+/* Writer */
+
+typedef struct rasqal_binary_dictionary_entry_s {
+  struct rasqal_binary_dictionary_entry_s* next;
+  unsigned int hash;
+  unsigned long id;
+  size_t key_len;
+  /* key bytes follow */
+} rasqal_binary_dictionary_entry;
+
+typedef struct {
+  rasqal_world* world;
+
+  /* record body being built */
+  rasqal_binary_buffer record;
+
+  /* term key being looked up */
+  rasqal_binary_buffer key;
+
+  /* dictionary of terms written: hash table of @buckets_size chains */
+  rasqal_binary_dictionary_entry** buckets;
+  unsigned int buckets_size;
+
+  /* number of terms in dictionary and next term id */
+  unsigned long count;
+} rasqal_binary_writer;
+
+
+#define RASQAL_BINARY_ENTRY_KEY(entry) \
+  (RASQAL_GOOD_CAST(unsigned char*, entry) + sizeof(rasqal_binary_dictionary_entry))
+
+
+static unsigned int
+rasqal_binary_hash(const unsigned char* key, size_t len)
+{
+  /* FNV-1a */
+  unsigned int hash = 2166136261U;
+
+  while(len--) {
+    hash ^= *key++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+static void
+rasqal_binary_writer_clear(rasqal_binary_writer* w)
+{
+  if(w->buckets) {
+    unsigned int i;
+
+    for(i = 0; i < w->buckets_size; i++) {
+      rasqal_binary_dictionary_entry* entry = w->buckets[i];
+
+      while(entry) {
+        rasqal_binary_dictionary_entry* next = entry->next;
+        RASQAL_FREE(rasqal_binary_dictionary_entry*, entry);
+        entry = next;
+      }
+    }
+    RASQAL_FREE(rasqal_binary_dictionary_entry**, w->buckets);
+  }
+
+  rasqal_binary_buffer_clear(&w->record);
+  rasqal_binary_buffer_clear(&w->key);
+}
+
+
+static rasqal_binary_dictionary_entry*
+rasqal_binary_writer_lookup(rasqal_binary_writer* w, unsigned int hash)
+{
+  rasqal_binary_dictionary_entry* entry;
+
+  for(entry = w->buckets[hash & (w->buckets_size - 1)];
+      entry;
+      entry = entry->next) {
+    if(entry->hash == hash && entry->key_len == w->key.length &&
+       !memcmp(RASQAL_BINARY_ENTRY_KEY(entry), w->key.data, w->key.length))
+      return entry;
+  }
+
+  return NULL;
+}
+
+
+static int
+rasqal_binary_writer_add(rasqal_binary_writer* w,
+                         rasqal_binary_dictionary_entry* entry)
+{
+  unsigned int slot;
+
+  /* keep chains short: grow when the load reaches 1 */
+  if(w->count >= w->buckets_size) {
+    unsigned int new_size = w->buckets_size << 1;
+    rasqal_binary_dictionary_entry** new_buckets;
+    unsigned int i;
+
+    new_buckets = RASQAL_CALLOC(rasqal_binary_dictionary_entry**, new_size,
+                                sizeof(rasqal_binary_dictionary_entry*));
+    if(!new_buckets)
+      return 1;
+
+    for(i = 0; i < w->buckets_size; i++) {
+      rasqal_binary_dictionary_entry* e = w->buckets[i];
+
+      while(e) {
+        rasqal_binary_dictionary_entry* next = e->next;
+
+        slot = e->hash & (new_size - 1);
+        e->next = new_buckets[slot];
+        new_buckets[slot] = e;
+        e = next;
+      }
+    }
+
+    RASQAL_FREE(rasqal_binary_dictionary_entry**, w->buckets);
+    w->buckets = new_buckets;
+    w->buckets_size = new_size;
+  }
+
+  entry->id = w->count++;
+  slot = entry->hash & (w->buckets_size - 1);
+  entry->next = w->buckets[slot];
+  w->buckets[slot] = entry;
+
+  return 0;
+}
+
+
+/* canonical xsd:integer lexical form that round trips through an int */
+static int
+rasqal_binary_integer_is_canonical(const unsigned char* str, size_t len)
+{
+  size_t i = 0;
+
+  if(!str || !len)
+    return 0;
+
+  if(str[0] == '-') {
+    i++;
+    /* no "-" or "-0" */
+    if(len == 1 || str[1] == '0')
+      return 0;
+  }
+
+  if(str[i] == '0' && len > i + 1)
+    return 0;
+
+  for(; i < len; i++) {
+    if(str[i] < '0' || str[i] > '9')
+      return 0;
+  }
+
+  return 1;
+}
+
+
+static int
+rasqal_binary_double_is_canonical(rasqal_literal* l)
+{
+  unsigned char* str;
+  size_t len = 0;
+  int rc;
+
+  str = rasqal_xsd_format_double(l->value.floating, &len);
+  if(!str)
+    return 0;
+
+  rc = (len == l->string_len && !memcmp(str, l->string, len));
+  RASQAL_FREE(char*, str);
+
+  return rc;
+}
+
+
+static int rasqal_binary_write_uri_cell(rasqal_binary_writer* w,
+                                        raptor_uri* uri);
+
+/*
+ * rasqal_binary_write_term_cell:
+ * @w: writer
+ * @kind: term kind byte
+ * @value: value string
+ * @value_len: value length
+ * @prefix: language string (kind 'L') or datatype URI string (kind 'T')
+ * @prefix_len: prefix length
+ * @datatype: datatype URI (kind 'T') or NULL
+ *
+ * INTERNAL - Append a dictionary reference, a new dictionary term or
+ * an inline term cell to the record.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_binary_write_term_cell(rasqal_binary_writer* w, int kind,
+                              const unsigned char* value, size_t value_len,
+                              const unsigned char* prefix, size_t prefix_len,
+                              raptor_uri* datatype)
+{
+  rasqal_binary_dictionary_entry* entry = NULL;
+  unsigned int hash;
+  int rc = 0;
+
+  /* key: kind byte, optional prefix string, value string */
+  w->key.length = 0;
+  rc = rasqal_binary_buffer_append_byte(&w->key, kind);
+  if(prefix)
+    rc = rc || rasqal_binary_buffer_append_string(&w->key, prefix, prefix_len);
+  rc = rc || rasqal_binary_buffer_append_string(&w->key, value, value_len);
+  if(rc)
+    return 1;
+
+  hash = rasqal_binary_hash(w->key.data, w->key.length);
+
+  entry = rasqal_binary_writer_lookup(w, hash);
+  if(entry) {
+    RASQAL_DEBUG2("Reusing dictionary term %lu\n", entry->id);
+    return rasqal_binary_buffer_append_byte(&w->record,
+                                            RASQAL_BINARY_CELL_REFERENCE) ||
+           rasqal_binary_buffer_append_varint(&w->record, entry->id);
+  }
+
+  if(w->count < RASQAL_BINARY_DICTIONARY_MAX) {
+    /* save the key now since a datatype cell reuses the key buffer */
+    entry = RASQAL_MALLOC(rasqal_binary_dictionary_entry*,
+                          sizeof(*entry) + w->key.length);
+    if(!entry)
+      return 1;
+    entry->next = NULL;
+    entry->hash = hash;
+    entry->key_len = w->key.length;
+    memcpy(RASQAL_BINARY_ENTRY_KEY(entry), w->key.data, w->key.length);
+  }
+
+  rc = rasqal_binary_buffer_append_byte(&w->record,
+                                        entry ? RASQAL_BINARY_CELL_DEFINE :
+                                                RASQAL_BINARY_CELL_INLINE);
+  rc = rc || rasqal_binary_buffer_append_byte(&w->record, kind);
+  if(kind == 'L')
+    rc = rc || rasqal_binary_buffer_append_string(&w->record, prefix,
+                                                  prefix_len);
+  else if(kind == 'T')
+    rc = rc || rasqal_binary_write_uri_cell(w, datatype);
+  rc = rc || rasqal_binary_buffer_append_string(&w->record, value, value_len);
+
+  if(entry) {
+    /* id is given after any datatype term inside this one */
+    if(rc || rasqal_binary_writer_add(w, entry)) {
+      RASQAL_FREE(rasqal_binary_dictionary_entry*, entry);
+      rc = 1;
+    }
+  }
+
+  return rc;
+}
+
+
+static int
+rasqal_binary_write_uri_cell(rasqal_binary_writer* w, raptor_uri* uri)
+{
+  const unsigned char* str;
+  size_t len;
+
+  str = raptor_uri_as_counted_string(uri, &len);
+  return rasqal_binary_write_term_cell(w, 'u', str, len, NULL, 0, NULL);
+}
+
+
+/*
+ * rasqal_binary_write_literal_cell:
+ * @w: writer
+ * @l: literal or NULL if unbound
+ *
+ * INTERNAL - Append a cell for a row value to the record
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_binary_write_literal_cell(rasqal_binary_writer* w, rasqal_literal* l)
+{
+  rasqal_binary_buffer* b = &w->record;
+  raptor_uri* datatype;
+  const unsigned char* str;
+  size_t len;
+
+  if(!l)
+    return rasqal_binary_buffer_append_byte(b, RASQAL_BINARY_CELL_UNBOUND);
+
+  switch(l->type) {
+    case RASQAL_LITERAL_URI:
+      return rasqal_binary_write_uri_cell(w, l->value.uri);
+
+    case RASQAL_LITERAL_BLANK:
+      return rasqal_binary_write_term_cell(w, 'b', l->string, l->string_len,
+                                           NULL, 0, NULL);
+
+    case RASQAL_LITERAL_INTEGER:
+      if(rasqal_binary_integer_is_canonical(l->string, l->string_len)) {
+        int i = l->value.integer;
+        unsigned long zigzag;
+
+        zigzag = (i < 0) ?
+          ((RASQAL_GOOD_CAST(unsigned long, -(i + 1)) << 1) | 1) :
+          (RASQAL_GOOD_CAST(unsigned long, i) << 1);
+
+        return rasqal_binary_buffer_append_byte(b, RASQAL_BINARY_CELL_INTEGER) ||
+               rasqal_binary_buffer_append_varint(b, zigzag);
+      }
+      break;
+
+    case RASQAL_LITERAL_DOUBLE:
+      if(rasqal_binary_double_is_canonical(l)) {
+        unsigned char bytes[8];
+
+        rasqal_binary_copy_double(bytes,
+                                  RASQAL_GOOD_CAST(const unsigned char*, &l->value.floating));
+        return rasqal_binary_buffer_append_byte(b, RASQAL_BINARY_CELL_DOUBLE) ||
+               rasqal_binary_buffer_append(b, bytes, 8);
+      }
+      break;
+
+    case RASQAL_LITERAL_BOOLEAN:
+      if(l->string_len == RASQAL_XSD_BOOLEAN_TRUE_LEN &&
+         !memcmp(l->string, rasqal_xsd_boolean_true, l->string_len))
+        return rasqal_binary_buffer_append_byte(b, RASQAL_BINARY_CELL_BOOLEAN) ||
+               rasqal_binary_buffer_append_byte(b, 1);
+      if(l->string_len == RASQAL_XSD_BOOLEAN_FALSE_LEN &&
+         !memcmp(l->string, rasqal_xsd_boolean_false, l->string_len))
+        return rasqal_binary_buffer_append_byte(b, RASQAL_BINARY_CELL_BOOLEAN) ||
+               rasqal_binary_buffer_append_byte(b, 0);
+      break;
+
+    case RASQAL_LITERAL_STRING:
+    case RASQAL_LITERAL_XSD_STRING:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DECIMAL:
+    case RASQAL_LITERAL_DATETIME:
+    case RASQAL_LITERAL_DATE:
+    case RASQAL_LITERAL_UDT:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+      break;
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    default:
+      return 1;
+  }
+
+  /* lexical form of a literal */
+  if(l->language)
+    return rasqal_binary_write_term_cell(w, 'L', l->string, l->string_len,
+                                         RASQAL_GOOD_CAST(const unsigned char*, l->language),
+                                         strlen(l->language), NULL);
+
+  datatype = l->datatype;
+  if(!datatype && l->type != RASQAL_LITERAL_STRING)
+    datatype = rasqal_xsd_datatype_type_to_uri(w->world, l->type);
+
+  if(!datatype)
+    return rasqal_binary_write_term_cell(w, 'l', l->string, l->string_len,
+                                         NULL, 0, NULL);
+
+  str = raptor_uri_as_counted_string(datatype, &len);
+  return rasqal_binary_write_term_cell(w, 'T', l->string, l->string_len,
+                                       str, len, datatype);
+}
+
+
+static void
+rasqal_binary_write_record(raptor_iostream* iostr, int tag,
+                           rasqal_binary_buffer* b)
+{
+  unsigned char buf[16];
+
+  raptor_iostream_write_byte(tag, iostr);
+  raptor_iostream_write_bytes(buf, 1,
+                              rasqal_binary_encode_varint(buf, RASQAL_GOOD_CAST(unsigned long, b->length)),
+                              iostr);
+  if(b->length)
+    raptor_iostream_write_bytes(b->data, 1, b->length, iostr);
+
+  b->length = 0;
+}
+
+
+/*
+ * rasqal_query_results_write_binary:
+ * @iostr: #raptor_iostream to write the query to
+ * @results: #rasqal_query_results query results format
+ * @base_uri: #raptor_uri base URI of the output format
+ *
+ * Write the rasqal binary format of query results to a
+ * #raptor_iostream
+ *
+ * Return value: non-0 on failure
+ **/
+static int
+rasqal_query_results_write_binary(rasqal_query_results_formatter* formatter,
+                                  raptor_iostream *iostr,
+                                  rasqal_query_results* results,
+                                  raptor_uri *base_uri)
+{
+  rasqal_world* world = rasqal_query_results_get_world(results);
+  rasqal_query* query = rasqal_query_results_get_query(results);
+  rasqal_query_results_type type;
+  rasqal_binary_writer w;
+  int rc = 0;
+  int i;
+
+  type = rasqal_query_results_get_type(results);
+
+  if(type != RASQAL_QUERY_RESULTS_BINDINGS &&
+     type != RASQAL_QUERY_RESULTS_BOOLEAN) {
+    rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR,
+                            query ? &query->locator : NULL,
+                            "Cannot write binary format for %s query result format",
+                            rasqal_query_results_type_label(type));
+    return 1;
+  }
+
+  memset(&w, '\0', sizeof(w));
+  w.world = world;
+  w.buckets_size = 256;
+  w.buckets = RASQAL_CALLOC(rasqal_binary_dictionary_entry**, w.buckets_size,
+                            sizeof(rasqal_binary_dictionary_entry*));
+  if(!w.buckets)
+    return 1;
+
+  raptor_iostream_counted_string_write(RASQAL_BINARY_MAGIC,
+                                       RASQAL_BINARY_MAGIC_LEN, iostr);
+  raptor_iostream_write_byte(RASQAL_BINARY_VERSION, iostr);
+
+  if(rasqal_query_results_is_boolean(results)) {
+    rc = rasqal_binary_buffer_append_byte(&w.record,
+                                          rasqal_query_results_get_boolean(results) > 0);
+    if(!rc)
+      rasqal_binary_write_record(iostr, 'B', &w.record);
+    goto end;
+  }
+
+  /* Variables */
+  for(i = 0; rasqal_query_results_get_binding_name(results, i); i++)
+    ;
+  rc = rasqal_binary_buffer_append_varint(&w.record,
+                                          RASQAL_GOOD_CAST(unsigned long, i));
+  for(i = 0; !rc; i++) {
+    const unsigned char *name;
+
+    name = rasqal_query_results_get_binding_name(results, i);
+    if(!name)
+      break;
+
+    rc = rasqal_binary_buffer_append_string(&w.record, name,
+                                            strlen(RASQAL_GOOD_CAST(const char*, name)));
+  }
+  if(rc)
+    goto end;
+  rasqal_binary_write_record(iostr, 'V', &w.record);
+
+  /* Rows */
+  while(!rasqal_query_results_finished(results)) {
+    int count = rasqal_query_results_get_bindings_count(results);
+
+    rc = rasqal_binary_buffer_append_varint(&w.record,
+                                            RASQAL_GOOD_CAST(unsigned long, count));
+    for(i = 0; i < count && !rc; i++) {
+      rasqal_literal *l = rasqal_query_results_get_binding_value(results, i);
+
+      rc = rasqal_binary_write_literal_cell(&w, l);
+      if(rc && l)
+        rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR,
+                                query ? &query->locator : NULL,
+                                "Cannot write binary format for %s literal",
+                                rasqal_literal_type_label(l->type));
+    }
+    if(rc)
+      goto end;
+
+    rasqal_binary_write_record(iostr, 'R', &w.record);
+
+    rasqal_query_results_next(results);
+  }
+
+  end:
+  if(!rc)
+    rasqal_binary_write_record(iostr, 'E', &w.record);
+
+  rasqal_binary_writer_clear(&w);
+
+  return rc;
+}
+
+
+
+/* Reader */
+
+typedef struct {
+  rasqal_world* world;
+  rasqal_rowsource* rowsource;
+
+  /* Rowsource flags */
+  unsigned int flags;
+
+  raptor_iostream* iostr;
+
+  /* bytes read: @offset is the start of the next record */
+  rasqal_binary_buffer buffer;
+  size_t offset;
+
+  int header_done;
+  int vars_done;
+  int finished;
+  int failed;
+
+  /* boolean value from a 'B' record or -1 */
+  int boolean_value;
+
+  /* term dictionary: @dictionary_count of @dictionary_size literals */
+  rasqal_literal** dictionary;
+  unsigned long dictionary_count;
+  unsigned long dictionary_size;
+
+  /* Variables table */
+  rasqal_variables_table* vars_table;
+
+  /* offset of next row */
+  int offset_row;
+} rasqal_rowsource_binary_context;
+
+
+/* position in a record body */
+typedef struct {
+  const unsigned char* p;
+  const unsigned char* end;
+} rasqal_binary_cursor;
+
+
+static void
+rasqal_binary_error(rasqal_rowsource_binary_context* con, const char* message)
+{
+  if(con->failed)
+    return;
+
+  con->failed = 1;
+  rasqal_log_error_simple(con->world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                          "Binary results: %s", message);
+}
+
+
+/* Return value: 0 on success, 1 if truncated or too large */
+static int
+rasqal_binary_decode_varint(const unsigned char** p_p,
+                            const unsigned char* end, unsigned long* value_p)
+{
+  const unsigned char* p = *p_p;
+  unsigned long value = 0;
+  unsigned int shift = 0;
+
+  while(p < end) {
+    unsigned char c = *p++;
+
+    if(shift >= sizeof(unsigned long) * 8)
+      return 1;
+    value |= RASQAL_GOOD_CAST(unsigned long, c & 0x7f) << shift;
+    if(!(c & 0x80)) {
+      *p_p = p;
+      *value_p = value;
+      return 0;
+    }
+    shift += 7;
+  }
+
+  return 1;
+}
+
+
+static int
+rasqal_binary_get_string(rasqal_binary_cursor* cur,
+                         const unsigned char** str_p, size_t* len_p)
+{
+  unsigned long len;
+
+  if(rasqal_binary_decode_varint(&cur->p, cur->end, &len) ||
+     len > RASQAL_GOOD_CAST(unsigned long, cur->end - cur->p))
+    return 1;
+
+  *str_p = cur->p;
+  *len_p = RASQAL_GOOD_CAST(size_t, len);
+  cur->p += len;
+
+  return 0;
+}
+
+
+static unsigned char*
+rasqal_binary_strdup(const unsigned char* str, size_t len)
+{
+  unsigned char* s = RASQAL_MALLOC(unsigned char*, len + 1);
+
+  if(s) {
+    memcpy(s, str, len);
+    s[len] = '\0';
+  }
+
+  return s;
+}
+
+
+static int
+rasqal_binary_add_term(rasqal_rowsource_binary_context* con,
+                       rasqal_literal* l)
+{
+  if(con->dictionary_count == con->dictionary_size) {
+    unsigned long new_size = con->dictionary_size ? (con->dictionary_size << 1) : 256;
+    rasqal_literal** new_dictionary;
+
+    if(con->dictionary_size >= RASQAL_BINARY_DICTIONARY_MAX)
+      return 1;
+
+    new_dictionary = RASQAL_MALLOC(rasqal_literal**,
+                                   new_size * sizeof(rasqal_literal*));
+    if(!new_dictionary)
+      return 1;
+
+    if(con->dictionary) {
+      memcpy(new_dictionary, con->dictionary,
+             con->dictionary_count * sizeof(rasqal_literal*));
+      RASQAL_FREE(rasqal_literal**, con->dictionary);
+    }
+    con->dictionary = new_dictionary;
+    con->dictionary_size = new_size;
+  }
+
+  con->dictionary[con->dictionary_count++] = rasqal_new_literal_from_literal(l);
+
+  return 0;
+}
+
+
+static int rasqal_binary_get_cell(rasqal_rowsource_binary_context* con,
+                                  rasqal_binary_cursor* cur,
+                                  rasqal_literal** l_p);
+
+/* read a term after its cell type byte */
+static rasqal_literal*
+rasqal_binary_get_term(rasqal_rowsource_binary_context* con,
+                       rasqal_binary_cursor* cur)
+{
+  rasqal_world* world = con->world;
+  const unsigned char* str;
+  size_t len;
+  int kind;
+  raptor_uri* uri;
+  unsigned char* value;
+  char* language = NULL;
+  raptor_uri* datatype = NULL;
+
+  if(cur->p >= cur->end)
+    return NULL;
+  kind = *cur->p++;
+
+  switch(kind) {
+    case 'u':
+      if(rasqal_binary_get_string(cur, &str, &len))
+        return NULL;
+      uri = raptor_new_uri_from_counted_string(world->raptor_world_ptr,
+                                               str, len);
+      return uri ? rasqal_new_uri_literal(world, uri) : NULL;
+
+    case 'b':
+    case 'l':
+      if(rasqal_binary_get_string(cur, &str, &len))
+        return NULL;
+      value = rasqal_binary_strdup(str, len);
+      if(!value)
+        return NULL;
+      if(kind == 'b')
+        return rasqal_new_simple_literal(world, RASQAL_LITERAL_BLANK, value);
+      return rasqal_new_string_literal_node(world, value, NULL, NULL);
+
+    case 'L':
+      if(rasqal_binary_get_string(cur, &str, &len))
+        return NULL;
+      language = RASQAL_GOOD_CAST(char*, rasqal_binary_strdup(str, len));
+      if(!language)
+        return NULL;
+      break;
+
+    case 'T':
+      {
+        rasqal_literal* dt = NULL;
+
+        /* only a URI term may follow so a typed literal cannot nest */
+        if(cur->end - cur->p < 2)
+          return NULL;
+        if(cur->p[0] != RASQAL_BINARY_CELL_REFERENCE &&
+           !((cur->p[0] == RASQAL_BINARY_CELL_DEFINE ||
+              cur->p[0] == RASQAL_BINARY_CELL_INLINE) && cur->p[1] == 'u'))
+          return NULL;
+
+        if(rasqal_binary_get_cell(con, cur, &dt) || !dt)
+          return NULL;
+        if(dt->type == RASQAL_LITERAL_URI)
+          datatype = raptor_uri_copy(dt->value.uri);
+        rasqal_free_literal(dt);
+        if(!datatype)
+          return NULL;
+      }
+      break;
+
+    default:
+      return NULL;
+  }
+
+  /* value of a language or typed literal */
+  value = NULL;
+  if(!rasqal_binary_get_string(cur, &str, &len))
+    value = rasqal_binary_strdup(str, len);
+  if(!value) {
+    if(language)
+      RASQAL_FREE(char*, language);
+    if(datatype)
+      raptor_free_uri(datatype);
+    return NULL;
+  }
+
+  return rasqal_new_string_literal_node(world, value, language, datatype);
+}
+
+
+/*
+ * rasqal_binary_get_cell:
+ * @con: reader context
+ * @cur: record body cursor
+ * @l_p: pointer to store new literal or NULL if unbound
+ *
+ * INTERNAL - Read a cell
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_binary_get_cell(rasqal_rowsource_binary_context* con,
+                       rasqal_binary_cursor* cur, rasqal_literal** l_p)
+{
+  rasqal_literal* l = NULL;
+  unsigned long v;
+  unsigned char bytes[8];
+  double d;
+  int cell_type;
+
+  *l_p = NULL;
+
+  if(cur->p >= cur->end)
+    return 1;
+  cell_type = *cur->p++;
+
+  switch(cell_type) {
+    case RASQAL_BINARY_CELL_UNBOUND:
+      return 0;
+
+    case RASQAL_BINARY_CELL_REFERENCE:
+      if(rasqal_binary_decode_varint(&cur->p, cur->end, &v) ||
+         v >= con->dictionary_count)
+        return 1;
+      l = rasqal_new_literal_from_literal(con->dictionary[v]);
+      break;
+
+    case RASQAL_BINARY_CELL_DEFINE:
+    case RASQAL_BINARY_CELL_INLINE:
+      l = rasqal_binary_get_term(con, cur);
+      if(l && cell_type == RASQAL_BINARY_CELL_DEFINE &&
+         rasqal_binary_add_term(con, l)) {
+        rasqal_free_literal(l);
+        return 1;
+      }
+      break;
+
+    case RASQAL_BINARY_CELL_INTEGER:
+      if(rasqal_binary_decode_varint(&cur->p, cur->end, &v))
+        return 1;
+      l = rasqal_new_integer_literal(con->world, RASQAL_LITERAL_INTEGER,
+                                     (v & 1) ?
+                                     -RASQAL_GOOD_CAST(int, v >> 1) - 1 :
+                                     RASQAL_GOOD_CAST(int, v >> 1));
+      break;
+
+    case RASQAL_BINARY_CELL_DOUBLE:
+      if(cur->end - cur->p < 8)
+        return 1;
+      rasqal_binary_copy_double(bytes, cur->p);
+      memcpy(&d, bytes, 8);
+      cur->p += 8;
+      l = rasqal_new_double_literal(con->world, d);
+      break;
+
+    case RASQAL_BINARY_CELL_BOOLEAN:
+      if(cur->p >= cur->end)
+        return 1;
+      l = rasqal_new_boolean_literal(con->world, *cur->p++ != 0);
+      break;
+
+    default:
+      return 1;
+  }
+
+  if(!l)
+    return 1;
+
+  *l_p = l;
+  return 0;
+}
+
+
+/*
+ * rasqal_binary_read_more:
+ * @con: reader context
+ *
+ * INTERNAL - Append the next block of input to the buffer
+ *
+ * Return value: non-0 at end of input or on failure
+ */
+static int
+rasqal_binary_read_more(rasqal_rowsource_binary_context* con)
+{
+  rasqal_binary_buffer* b = &con->buffer;
+  int read_len;
+
+  if(raptor_iostream_read_eof(con->iostr))
+    return 1;
+
+  /* drop records already used */
+  if(con->offset) {
+    memmove(b->data, b->data + con->offset, b->length - con->offset);
+    b->length -= con->offset;
+    con->offset = 0;
+  }
+
+  /* make room for a block */
+  if(rasqal_binary_buffer_append(b, NULL, FILE_READ_BUF_SIZE)) {
+    rasqal_binary_error(con, "out of memory");
+    return 1;
+  }
+  b->length -= FILE_READ_BUF_SIZE;
+
+  read_len = raptor_iostream_read_bytes(b->data + b->length, 1,
+                                        FILE_READ_BUF_SIZE, con->iostr);
+  if(read_len <= 0)
+    return 1;
+
+  b->length += RASQAL_GOOD_CAST(size_t, read_len);
+  return 0;
+}
+
+
+/*
+ * rasqal_binary_next_record:
+ * @con: reader context
+ * @tag_p: pointer to store record tag
+ * @cur: cursor to set to the record body
+ *
+ * INTERNAL - Get the next complete record, reading more input as needed
+ *
+ * Return value: non-0 at end of input or on failure
+ */
+static int
+rasqal_binary_next_record(rasqal_rowsource_binary_context* con, int* tag_p,
+                          rasqal_binary_cursor* cur)
+{
+  while(!con->failed && !con->finished) {
+    const unsigned char* start = con->buffer.data + con->offset;
+    const unsigned char* end = con->buffer.data + con->buffer.length;
+
+    if(!con->header_done) {
+      if(end - start >= RASQAL_BINARY_HEADER_LEN) {
+        if(memcmp(start, RASQAL_BINARY_MAGIC, RASQAL_BINARY_MAGIC_LEN)) {
+          rasqal_binary_error(con, "bad magic number");
+          break;
+        }
+        if(start[RASQAL_BINARY_MAGIC_LEN] != RASQAL_BINARY_VERSION) {
+          rasqal_binary_error(con, "unsupported version");
+          break;
+        }
+        con->offset += RASQAL_BINARY_HEADER_LEN;
+        con->header_done = 1;
+        continue;
+      }
+    } else if(end - start >= 2) {
+      const unsigned char* p = start + 1;
+      unsigned long len;
+
+      if(!rasqal_binary_decode_varint(&p, end, &len) &&
+         len <= RASQAL_GOOD_CAST(unsigned long, end - p)) {
+        *tag_p = *start;
+        cur->p = p;
+        cur->end = p + len;
+        con->offset = RASQAL_GOOD_CAST(size_t, cur->end - con->buffer.data);
+        return 0;
+      }
+    }
+
+    if(rasqal_binary_read_more(con)) {
+      if(!con->failed)
+        rasqal_binary_error(con, "unexpected end of input");
+      break;
+    }
+  }
+
+  return 1;
+}
+
+
+static int
+rasqal_binary_read_variables(rasqal_rowsource_binary_context* con,
+                             rasqal_binary_cursor* cur)
+{
+  unsigned long count;
+  unsigned long i;
+
+  if(rasqal_binary_decode_varint(&cur->p, cur->end, &count))
+    return 1;
+
+  for(i = 0; i < count; i++) {
+    const unsigned char* name;
+    size_t name_len;
+    rasqal_variable *v;
+
+    if(rasqal_binary_get_string(cur, &name, &name_len))
+      return 1;
+
+    v = rasqal_variables_table_add2(con->vars_table,
+                                    RASQAL_VARIABLE_TYPE_NORMAL,
+                                    name, name_len, NULL);
+    if(!v)
+      return 1;
+
+    rasqal_rowsource_add_variable(con->rowsource, v);
+    /* above function takes a reference to v */
+    rasqal_free_variable(v);
+  }
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_binary_read_row(rasqal_rowsource_binary_context* con,
+                       rasqal_binary_cursor* cur)
+{
+  rasqal_row* row;
+  unsigned long count;
+  int i;
+
+  if(rasqal_binary_decode_varint(&cur->p, cur->end, &count) ||
+     count > RASQAL_GOOD_CAST(unsigned long, con->rowsource->size))
+    return NULL;
+
+  row = rasqal_new_row(con->rowsource);
+  if(!row)
+    return NULL;
+
+  for(i = 0; i < RASQAL_GOOD_CAST(int, count); i++) {
+    rasqal_literal* l;
+
+    if(rasqal_binary_get_cell(con, cur, &l)) {
+      rasqal_free_row(row);
+      return NULL;
+    }
+    if(l) {
+      rasqal_row_set_value_at(row, i, l);
+      rasqal_free_literal(l);
+    }
+  }
+
+  row->offset = con->offset_row++;
+
+  return row;
+}
+
+
+/*
+ * rasqal_binary_process:
+ * @con: reader context
+ *
+ * INTERNAL - Handle records until a row is read or the stream ends
+ *
+ * Return value: new row or NULL
+ */
+static rasqal_row*
+rasqal_binary_process(rasqal_rowsource_binary_context* con)
+{
+  int tag;
+  rasqal_binary_cursor cur;
+
+  while(!rasqal_binary_next_record(con, &tag, &cur)) {
+    switch(tag) {
+      case 'V':
+        if(!con->rowsource) {
+          /* reading only a boolean */
+          con->vars_done = 1;
+          return NULL;
+        }
+        if(con->vars_done || rasqal_binary_read_variables(con, &cur)) {
+          rasqal_binary_error(con, "bad variables record");
+          return NULL;
+        }
+        con->vars_done = 1;
+        return NULL;
+
+      case 'R':
+        {
+          rasqal_row* row = NULL;
+
+          if(!con->rowsource)
+            break;
+          if(con->vars_done)
+            row = rasqal_binary_read_row(con, &cur);
+          if(!row)
+            rasqal_binary_error(con, "bad row record");
+          return row;
+        }
+
+      case 'B':
+        if(cur.p >= cur.end) {
+          rasqal_binary_error(con, "bad boolean record");
+          return NULL;
+        }
+        con->boolean_value = (*cur.p != 0);
+        return NULL;
+
+      case 'E':
+        con->finished = 1;
+        return NULL;
+
+      default:
+        /* skip unknown records */
+        break;
+    }
+  }
+
+  return NULL;
+}
+
+
+/* Local handlers for turning a binary stream into rows */
+
+static int
+rasqal_rowsource_binary_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_binary_context* con;
+
+  con = (rasqal_rowsource_binary_context*)user_data;
+
+  con->rowsource = rowsource;
+
+  return 0;
+}
+
+
+static void rasqal_binary_free_context(rasqal_rowsource_binary_context* con);
+
+static int
+rasqal_rowsource_binary_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_binary_context* con;
+
+  con = (rasqal_rowsource_binary_context*)user_data;
+
+  rasqal_binary_free_context(con);
+
+  return 0;
+}
+
+
+static int
+rasqal_rowsource_binary_ensure_variables(rasqal_rowsource* rowsource,
+                                         void *user_data)
+{
+  rasqal_rowsource_binary_context* con;
+
+  con = (rasqal_rowsource_binary_context*)user_data;
+
+  /* the variables record comes before any rows */
+  while(!con->vars_done && !con->failed && !con->finished) {
+    rasqal_row* row = rasqal_binary_process(con);
+
+    if(row) {
+      rasqal_free_row(row);
+      rasqal_binary_error(con, "row before variables");
+    }
+  }
+
+  return con->failed;
+}
+
+
+static rasqal_row*
+rasqal_rowsource_binary_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_binary_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_rowsource_binary_context*)user_data;
+
+  while(!row && !con->failed && !con->finished)
+    row = rasqal_binary_process(con);
+
+  return row;
+}
+
+
+/*
+ * rasqal_binary_init_context:
+ * @world: rasqal world object
+ * @iostr: #raptor_iostream to read the query results from
+ * @flags: flags
+ *
+ * INTERNAL - Initialise the binary reader context
+ *
+ * Return value: context or NULL on failure
+ **/
+static rasqal_rowsource_binary_context*
+rasqal_binary_init_context(rasqal_world *world, raptor_iostream *iostr,
+                           unsigned int flags)
+{
+  rasqal_rowsource_binary_context* con;
+
+  con = RASQAL_CALLOC(rasqal_rowsource_binary_context*, 1, sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->world = world;
+  con->iostr = iostr;
+  con->flags = flags;
+  con->boolean_value = -1;
+
+  return con;
+}
+
+
+/*
+ * rasqal_binary_free_context:
+ * @con: binary reader context
+ *
+ * INTERNAL - Free the binary reader context
+ **/
+static void
+rasqal_binary_free_context(rasqal_rowsource_binary_context* con)
+{
+  if(con->dictionary) {
+    unsigned long i;
+
+    for(i = 0; i < con->dictionary_count; i++)
+      rasqal_free_literal(con->dictionary[i]);
+    RASQAL_FREE(rasqal_literal**, con->dictionary);
+  }
+
+  if(con->vars_table)
+    rasqal_free_variables_table(con->vars_table);
+
+  if(con->flags) {
+    if(con->iostr)
+      raptor_free_iostream(con->iostr);
+  }
+
+  rasqal_binary_buffer_clear(&con->buffer);
+
+  RASQAL_FREE(rasqal_rowsource_binary_context, con);
+}
+
+
+static int
+rasqal_rowsource_binary_get_boolean(rasqal_query_results_formatter *formatter,
+                                    rasqal_world* world,
+                                    raptor_iostream *iostr,
+                                    raptor_uri *base_uri, unsigned int flags)
+{
+  rasqal_rowsource_binary_context* con;
+  int bv;
+
+  con = rasqal_binary_init_context(world, iostr, flags);
+  if(!con)
+    return -1;
+
+  while(con->boolean_value < 0 && !con->failed && !con->finished)
+    rasqal_binary_process(con);
+
+  bv = con->failed ? -1 : con->boolean_value;
+
+  rasqal_binary_free_context(con);
+
+  return bv;
+}
+
+
+static const rasqal_rowsource_handler rasqal_rowsource_binary_handler = {
+  /* .version = */ 1,
+  "binary",
+  /* .init = */ rasqal_rowsource_binary_init,
+  /* .finish = */ rasqal_rowsource_binary_finish,
+  /* .ensure_variables = */ rasqal_rowsource_binary_ensure_variables,
+  /* .read_row = */ rasqal_rowsource_binary_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ NULL,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ NULL,
+  /* .set_origin = */ NULL,
+};
+
+
+/*
+ * rasqal_query_results_get_rowsource_binary:
+ * @world: rasqal world object
+ * @iostr: #raptor_iostream to read the query results from
+ * @base_uri: #raptor_uri base URI of the input format
+ *
+ * INTERNAL - Read rasqal binary query results from an iostream
+ * returning a rowsource.
+ *
+ * Return value: a new rasqal_rowsource or NULL on failure
+ **/
+static rasqal_rowsource*
+rasqal_query_results_get_rowsource_binary(rasqal_query_results_formatter* formatter,
+                                          rasqal_world *world,
+                                          rasqal_variables_table* vars_table,
+                                          raptor_iostream *iostr,
+                                          raptor_uri *base_uri,
+                                          unsigned int flags)
+{
+  rasqal_rowsource_binary_context* con;
+
+  con = rasqal_binary_init_context(world, iostr, flags);
+  if(!con)
+    return NULL;
+
+  con->vars_table = rasqal_new_variables_table_from_variables_table(vars_table);
+
+  return rasqal_new_rowsource_from_handler(world, NULL,
+                                           con,
+                                           &rasqal_rowsource_binary_handler,
+                                           con->vars_table,
+                                           0);
+}
+
+
+static int
+rasqal_query_results_binary_recognise_syntax(rasqal_query_results_format_factory* factory,
+                                             const unsigned char *buffer,
+                                             size_t len,
+                                             const unsigned char *identifier,
+                                             const unsigned char *suffix,
+                                             const char *mime_type)
+{
+  if(buffer && len >= RASQAL_BINARY_MAGIC_LEN &&
+     !memcmp(buffer, RASQAL_BINARY_MAGIC, RASQAL_BINARY_MAGIC_LEN))
+    return 10;
+
+  if(suffix && !strcmp(RASQAL_GOOD_CAST(const char*, suffix), "rqb"))
+    return 8;
+
+  return 0;
+}
+
+
+static const char* const binary_names[] = { "binary", NULL};
+
+static const char* const binary_uri_strings[] = {
+  "http://librdf.org/rasqal/formats/binary-results",
+  NULL
+};
+
+static const raptor_type_q binary_types[] = {
+  { "application/x-rasqal-results-binary", 35, 10},
+  { NULL, 0, 0}
+};
+
+static int
+rasqal_query_results_binary_register_factory(rasqal_query_results_format_factory *factory)
+{
+  int rc = 0;
+
+  factory->desc.names = binary_names;
+  factory->desc.mime_types = binary_types;
+
+  factory->desc.label = "Rasqal Binary Query Results";
+  factory->desc.uri_strings = binary_uri_strings;
+
+  factory->desc.flags = 0;
+
+  factory->write         = rasqal_query_results_write_binary;
+  factory->get_rowsource = rasqal_query_results_get_rowsource_binary;
+  factory->recognise_syntax = rasqal_query_results_binary_recognise_syntax;
+  factory->get_boolean      = rasqal_rowsource_binary_get_boolean;
+
+  return rc;
+}
+
+
+int
+rasqal_init_result_format_binary(rasqal_world* world)
+{
+  return !rasqal_world_register_query_results_format_factory(world,
+                                                             &rasqal_query_results_binary_register_factory);
+}
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+static const char* const binary_test_results =
+  "{ \"head\": { \"vars\": [ \"s\", \"o\", \"x\" ] },\n"
+  "  \"results\": { \"bindings\": [\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"xml:lang\": \"fr\", \"value\": \"caf\\u00e9\" },\n"
+  "      \"x\": { \"type\": \"literal\", \"value\": \"-42\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" } },\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"value\": \"007\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" },\n"
+  "      \"x\": { \"type\": \"literal\", \"value\": \"2.5E0\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#double\" } },\n"
+  "    { \"s\": { \"type\": \"bnode\", \"value\": \"b1\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"value\": \"true\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#boolean\" } },\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"value\": \"1.50\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#decimal\" },\n"
+  "      \"x\": { \"type\": \"literal\", \"value\": \"\" } },\n"
+  "    { \"o\": { \"type\": \"literal\", \"value\": \"v\",\n"
+  "               \"datatype\": \"http://example.org/dt\" },\n"
+  "      \"x\": { \"type\": \"literal\", \"value\": \"v\",\n"
+  "               \"datatype\": \"http://example.org/dt\" } }\n"
+  "  ] }\n"
+  "}\n";
+
+
+/* a typed literal whose datatype cell is another typed literal */
+static const char binary_test_nested[] =
+  "RSQB\x01"
+  "V\x03\x01\x01x"
+  "R\x0e\x01\x06T\x06T\x06u\x02" "dt\x01v\x01v"
+  "E\x00";
+
+
+#define BINARY_TEST_ROWS 1000
+
+
+/* Read @string in @format_name and write the results as @out_format_name */
+static int
+binary_test_convert(rasqal_world* world, raptor_uri* base_uri,
+                    const char* format_name, const void* string, size_t len,
+                    const char* out_format_name,
+                    void** out_string_p, size_t* out_len_p)
+{
+  rasqal_query_results* results;
+  rasqal_query_results_formatter* formatter;
+  raptor_iostream* iostr;
+  int rc = 1;
+
+  *out_string_p = NULL;
+
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BINDINGS);
+  formatter = rasqal_new_query_results_formatter(world, format_name, NULL,
+                                                 NULL);
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, string),
+                                          len);
+  if(!results || !formatter || !iostr)
+    goto tidy;
+
+  rc = rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                           base_uri);
+  raptor_free_iostream(iostr);
+  iostr = NULL;
+  rasqal_free_query_results_formatter(formatter);
+  formatter = NULL;
+  if(rc)
+    goto tidy;
+
+  formatter = rasqal_new_query_results_formatter(world, out_format_name,
+                                                 NULL, NULL);
+  iostr = raptor_new_iostream_to_string(world->raptor_world_ptr,
+                                        out_string_p, out_len_p, malloc);
+  if(!formatter || !iostr) {
+    rc = 1;
+    goto tidy;
+  }
+
+  rc = rasqal_query_results_formatter_write(iostr, formatter, results,
+                                            base_uri);
+
+  tidy:
+  if(iostr)
+    raptor_free_iostream(iostr);
+  if(formatter)
+    rasqal_free_query_results_formatter(formatter);
+  if(results)
+    rasqal_free_query_results(results);
+
+  return rc;
+}
+
+
+static int
+binary_test_count_rows(rasqal_world* world, const char* format_name,
+                       raptor_uri* base_uri, const void* string, size_t len)
+{
+  rasqal_query_results_formatter* formatter;
+  rasqal_variables_table* vt;
+  raptor_iostream* iostr;
+  rasqal_rowsource* rowsource = NULL;
+  int count = 0;
+
+  vt = rasqal_new_variables_table(world);
+  formatter = rasqal_new_query_results_formatter(world, format_name, NULL,
+                                                 NULL);
+
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, string),
+                                          len);
+  if(formatter && iostr)
+    rowsource = rasqal_query_results_formatter_get_read_rowsource(world, iostr,
+                                                                  formatter,
+                                                                  vt, base_uri,
+                                                                  1);
+  else if(iostr)
+    raptor_free_iostream(iostr);
+
+  if(rowsource) {
+    rasqal_row* row;
+
+    while((row = rasqal_rowsource_read_row(rowsource))) {
+      count++;
+      rasqal_free_row(row);
+    }
+    rasqal_free_rowsource(rowsource);
+  }
+
+  if(formatter)
+    rasqal_free_query_results_formatter(formatter);
+  rasqal_free_variables_table(vt);
+
+  return count;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  raptor_uri* base_uri;
+  rasqal_query_results* results;
+  rasqal_query_results_formatter* formatter;
+  raptor_iostream* iostr;
+  raptor_stringbuffer* sb;
+  void* expected = NULL;
+  size_t expected_len = 0;
+  void* binary = NULL;
+  size_t binary_len = 0;
+  void* got = NULL;
+  size_t got_len = 0;
+  void* tsv = NULL;
+  size_t tsv_len = 0;
+  int count;
+  int i;
+  int failures = 0;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+
+  /* Test 1: JSON -> binary -> JSON is the same as JSON -> JSON */
+  if(binary_test_convert(world, base_uri, "json", binary_test_results,
+                         strlen(binary_test_results), "json",
+                         &expected, &expected_len) ||
+     binary_test_convert(world, base_uri, "json", binary_test_results,
+                         strlen(binary_test_results), "binary",
+                         &binary, &binary_len) ||
+     binary_test_convert(world, base_uri, "binary", binary, binary_len,
+                         "json", &got, &got_len)) {
+    fprintf(stderr, "%s: test 1 conversion failed\n", program);
+    failures++;
+  } else if(expected_len != got_len || memcmp(expected, got, got_len)) {
+    fprintf(stderr, "%s: test 1 round trip differs.\nExpected:\n%s\nGot:\n%s\n",
+            program, RASQAL_GOOD_CAST(char*, expected),
+            RASQAL_GOOD_CAST(char*, got));
+    failures++;
+  }
+  if(expected)
+    free(expected);
+  if(binary)
+    free(binary);
+  if(got)
+    free(got);
+  expected = binary = got = NULL;
+
+  /* Test 2: boolean */
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BOOLEAN);
+  formatter = rasqal_new_query_results_formatter(world, "binary", NULL, NULL);
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, "RSQB\x01" "B\x01\x01" "E\x00"),
+                                          10);
+  if(rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                         base_uri) ||
+     rasqal_query_results_get_boolean(results) != 1) {
+    fprintf(stderr, "%s: test 2 boolean result failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+  rasqal_free_query_results(results);
+
+  /* Test 3: nested typed literal datatypes are rejected */
+  count = binary_test_count_rows(world, "binary", base_uri, binary_test_nested,
+                                 sizeof(binary_test_nested) - 1);
+  if(count) {
+    fprintf(stderr, "%s: test 3 read %d rows from a nested typed literal\n",
+            program, count);
+    failures++;
+  }
+
+  /* Test 4: many rows converted from TSV read back the same */
+  sb = raptor_new_stringbuffer();
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "?s\t?p\t?o\n"), 1);
+  for(i = 0; i < BINARY_TEST_ROWS; i++) {
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "<http://example.org/resource/"), 1);
+    raptor_stringbuffer_append_decimal(sb, i / 10);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, ">\t<http://example.org/property/"), 1);
+    raptor_stringbuffer_append_decimal(sb, i % 10);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, ">\t"), 1);
+    raptor_stringbuffer_append_decimal(sb, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
+  }
+  tsv_len = raptor_stringbuffer_length(sb);
+  tsv = raptor_stringbuffer_as_string(sb);
+
+  if(binary_test_convert(world, base_uri, "tsv", tsv, tsv_len, "binary",
+                         &binary, &binary_len)) {
+    fprintf(stderr, "%s: TSV to binary conversion failed\n", program);
+    failures++;
+  } else {
+    count = binary_test_count_rows(world, "tsv", base_uri, tsv, tsv_len);
+    if(count != BINARY_TEST_ROWS) {
+      fprintf(stderr, "%s: TSV reader returned %d rows, expected %d\n",
+              program, count, BINARY_TEST_ROWS);
+      failures++;
+    }
+    count = binary_test_count_rows(world, "binary", base_uri, binary,
+                                   binary_len);
+    if(count != BINARY_TEST_ROWS) {
+      fprintf(stderr, "%s: binary reader returned %d rows, expected %d\n",
+              program, count, BINARY_TEST_ROWS);
+      failures++;
+    }
+  }
+  if(binary)
+    free(binary);
+
+  raptor_free_stringbuffer(sb);
+
+  raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
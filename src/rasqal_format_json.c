@@ -41,6 +41,15 @@
 #include "rasqal_internal.h"
 
 
+#ifndef FILE_READ_BUF_SIZE
+#ifdef BUFSIZ
+#define FILE_READ_BUF_SIZE BUFSIZ
+#else
+#define FILE_READ_BUF_SIZE 1024
+#endif
+#endif
+
+
 static void
 rasqal_iostream_write_json_boolean(raptor_iostream* iostr, 
                                    const char* name, int json_bool)
@@ -180,19 +189,19 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
           case RASQAL_LITERAL_URI:
             raptor_iostream_string_write("\"type\": \"uri\", \"value\": \"", iostr);
             str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->value.uri, &len));
-            raptor_string_ntriples_write(str, len, '"', iostr);
+            rasqal_iostream_write_ntriples_string(str, len, '"', iostr);
             raptor_iostream_write_byte('"', iostr);
             break;
 
           case RASQAL_LITERAL_BLANK:
             raptor_iostream_string_write("\"type\": \"bnode\", \"value\": \"", iostr);
-            raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
+            rasqal_iostream_write_ntriples_string(l->string, l->string_len, '"', iostr);
             raptor_iostream_write_byte('"', iostr);
             break;
 
           case RASQAL_LITERAL_STRING:
             raptor_iostream_string_write("\"type\": \"literal\", \"value\": \"", iostr);
-            raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
+            rasqal_iostream_write_ntriples_string(l->string, l->string_len, '"', iostr);
             raptor_iostream_write_byte('"', iostr);
 
             if(l->language) {
@@ -204,7 +213,7 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
             if(l->datatype) {
               raptor_iostream_string_write(",\n      \"datatype\" : \"", iostr);
               str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->datatype, &len));
-              raptor_string_ntriples_write(str, len, '"', iostr);
+              rasqal_iostream_write_ntriples_string(str, len, '"', iostr);
               raptor_iostream_write_byte('"', iostr);
             }
 
@@ -255,6 +264,1133 @@ rasqal_query_results_write_json1(rasqal_query_results_formatter* formatter,
 }
 
 
+/*
+ * SPARQL JSON results reader
+ *
+ * The reader is a push parser: each chunk read from the iostream is
+ * tokenized and fed to a small structural parser that tracks the
+ * enclosing objects and arrays.  A row is queued as soon as its
+ * binding object is closed so rows are returned while the rest of
+ * the document is still unread.
+ *
+ * Only the parts of the document that matter are interpreted:
+ *   { "head": { "vars": [ NAME, ... ] },
+ *     "results": { "bindings": [ { NAME: TERM, ... }, ... ] } }
+ * or
+ *   { "head": { }, "boolean": true|false }
+ * where TERM is an object with "type", "value" and optionally
+ * "xml:lang" or "datatype" members.  Anything else is skipped.
+ *
+ * JSON does not order object members so "results" may come before
+ * "head".  In that case variables are added as they are seen in
+ * bindings and rows are expanded to the final size as they are read.
+ */
+
+#define RASQAL_JSON_MAX_DEPTH 64
+
+typedef enum {
+  RASQAL_JSON_TOKEN_OBJECT_START,
+  RASQAL_JSON_TOKEN_OBJECT_END,
+  RASQAL_JSON_TOKEN_ARRAY_START,
+  RASQAL_JSON_TOKEN_ARRAY_END,
+  RASQAL_JSON_TOKEN_COLON,
+  RASQAL_JSON_TOKEN_COMMA,
+  RASQAL_JSON_TOKEN_STRING,
+  RASQAL_JSON_TOKEN_NUMBER,
+  RASQAL_JSON_TOKEN_TRUE,
+  RASQAL_JSON_TOKEN_FALSE,
+  RASQAL_JSON_TOKEN_NULL
+} rasqal_json_token_type;
+
+
+/* tokenizer state */
+typedef enum {
+  RASQAL_JSON_LEX_TOKEN,
+  RASQAL_JSON_LEX_STRING,
+  RASQAL_JSON_LEX_STRING_ESCAPE,
+  RASQAL_JSON_LEX_STRING_UNICODE,
+  RASQAL_JSON_LEX_WORD
+} rasqal_json_lex_state;
+
+
+/* what an object or array is in the results document */
+typedef enum {
+  RASQAL_JSON_ROLE_OTHER,
+  RASQAL_JSON_ROLE_TOP,
+  RASQAL_JSON_ROLE_HEAD,
+  RASQAL_JSON_ROLE_VARS,
+  RASQAL_JSON_ROLE_RESULTS,
+  RASQAL_JSON_ROLE_BINDINGS,
+  RASQAL_JSON_ROLE_ROW,
+  RASQAL_JSON_ROLE_TERM
+} rasqal_json_role;
+
+
+typedef enum {
+  RASQAL_JSON_KEY_OTHER,
+  /* In same order as rasqal_json_key_names */
+  RASQAL_JSON_KEY_HEAD,
+  RASQAL_JSON_KEY_VARS,
+  RASQAL_JSON_KEY_RESULTS,
+  RASQAL_JSON_KEY_BINDINGS,
+  RASQAL_JSON_KEY_BOOLEAN,
+  RASQAL_JSON_KEY_TYPE,
+  RASQAL_JSON_KEY_VALUE,
+  RASQAL_JSON_KEY_XML_LANG,
+  RASQAL_JSON_KEY_DATATYPE,
+  RASQAL_JSON_KEY_LAST = RASQAL_JSON_KEY_DATATYPE,
+  /* member of a row: key is a variable name */
+  RASQAL_JSON_KEY_VARIABLE
+} rasqal_json_key;
+
+static const char* const rasqal_json_key_names[RASQAL_JSON_KEY_LAST + 1] = {
+  NULL,
+  "head",
+  "vars",
+  "results",
+  "bindings",
+  "boolean",
+  "type",
+  "value",
+  "xml:lang",
+  "datatype"
+};
+
+
+typedef enum {
+  RASQAL_JSON_EXPECT_KEY,
+  RASQAL_JSON_EXPECT_COLON,
+  RASQAL_JSON_EXPECT_VALUE,
+  /* after a value: comma or end of container */
+  RASQAL_JSON_EXPECT_COMMA
+} rasqal_json_expect;
+
+
+typedef struct {
+  rasqal_json_role role;
+  int is_object;
+  rasqal_json_key key;
+  rasqal_json_expect expect;
+} rasqal_json_frame;
+
+
+typedef struct {
+  unsigned char* string;
+  size_t length;
+  size_t size;
+} rasqal_json_buffer;
+
+
+typedef struct
+{
+  rasqal_world* world;
+  rasqal_rowsource* rowsource;
+
+  int failed;
+
+  /* Input fields */
+  raptor_uri* base_uri;
+  raptor_iostream* iostr;
+  raptor_locator locator;
+  unsigned char buffer[FILE_READ_BUF_SIZE]; /* iostream read buffer */
+
+  /* tokenizer */
+  rasqal_json_lex_state lex_state;
+  rasqal_json_buffer token; /* string or word being read */
+  unsigned long unicode_value; /* \uXXXX being read */
+  int unicode_digits;
+  unsigned long high_surrogate; /* pending \uD800-\uDBFF or 0 */
+
+  /* structure */
+  rasqal_json_frame frames[RASQAL_JSON_MAX_DEPTH];
+  int depth;
+  int top_done;
+  int head_done;
+
+  /* current row and binding */
+  rasqal_json_buffer name; /* variable name of current term */
+  rasqal_json_buffer term_type;
+  rasqal_json_buffer term_value;
+  rasqal_json_buffer term_language;
+  rasqal_json_buffer term_datatype;
+  int term_seen; /* bit mask of (1 << RASQAL_JSON_KEY_...) seen in term */
+  rasqal_row* row;
+  int offset; /* current result row number */
+
+  /* Output fields */
+  raptor_sequence* results_sequence; /* saved result rows */
+
+  /* Variables table allocated for variables in the result set */
+  rasqal_variables_table* vars_table;
+
+  unsigned int flags;
+
+  int boolean_value;
+} rasqal_rowsource_json_context;
+
+
+static void
+rasqal_json_error(rasqal_rowsource_json_context* con, const char* message)
+{
+  if(!con->failed)
+    rasqal_log_error_simple(con->world, RAPTOR_LOG_LEVEL_ERROR,
+                            &con->locator,
+                            "SPARQL JSON results: %s", message);
+  con->failed++;
+}
+
+
+static int
+rasqal_json_buffer_append(rasqal_json_buffer* b,
+                          const unsigned char* string, size_t len)
+{
+  if(b->length + len + 1 > b->size) {
+    size_t nsize = b->size ? (b->size << 1) : 64;
+    unsigned char* nstring;
+
+    while(nsize < b->length + len + 1)
+      nsize <<= 1;
+
+    nstring = RASQAL_MALLOC(unsigned char*, nsize);
+    if(!nstring)
+      return 1;
+    if(b->string) {
+      memcpy(nstring, b->string, b->length);
+      RASQAL_FREE(char*, b->string);
+    }
+    b->string = nstring;
+    b->size = nsize;
+  }
+
+  memcpy(b->string + b->length, string, len);
+  b->length += len;
+  b->string[b->length] = '\0';
+
+  return 0;
+}
+
+
+static int
+rasqal_json_buffer_copy(rasqal_json_buffer* dest, rasqal_json_buffer* src)
+{
+  dest->length = 0;
+  return rasqal_json_buffer_append(dest, src->string, src->length);
+}
+
+
+static void
+rasqal_json_buffer_clear(rasqal_json_buffer* b)
+{
+  if(b->string)
+    RASQAL_FREE(char*, b->string);
+  b->string = NULL;
+  b->length = b->size = 0;
+}
+
+
+/* copy of buffer string for handing to a literal constructor */
+static unsigned char*
+rasqal_json_buffer_strdup(rasqal_json_buffer* b)
+{
+  unsigned char* s;
+
+  s = RASQAL_MALLOC(unsigned char*, b->length + 1);
+  if(!s)
+    return NULL;
+  if(b->length)
+    memcpy(s, b->string, b->length);
+  s[b->length] = '\0';
+
+  return s;
+}
+
+
+static int
+rasqal_json_add_variable(rasqal_rowsource_json_context* con,
+                         const unsigned char* name, size_t name_len)
+{
+  rasqal_variable *v;
+  int offset;
+
+  v = rasqal_variables_table_add2(con->vars_table,
+                                  RASQAL_VARIABLE_TYPE_NORMAL,
+                                  name, name_len, NULL);
+  if(!v)
+    return -1;
+
+  offset = rasqal_rowsource_add_variable(con->rowsource, v);
+  /* above function takes a reference to v */
+  rasqal_free_variable(v);
+
+  return offset;
+}
+
+
+/* end of a term object in a row: turn it into a literal */
+static void
+rasqal_json_end_term(rasqal_rowsource_json_context* con)
+{
+  rasqal_literal* l = NULL;
+  const char* type;
+  int offset;
+
+  if(!con->row)
+    return;
+
+  if(!(con->term_seen & (1 << RASQAL_JSON_KEY_TYPE)) ||
+     !(con->term_seen & (1 << RASQAL_JSON_KEY_VALUE))) {
+    rasqal_json_error(con, "binding has no type or value");
+    return;
+  }
+
+  type = RASQAL_GOOD_CAST(const char*, con->term_type.string);
+
+  if(!strcmp(type, "uri")) {
+    raptor_uri* uri;
+
+    uri = raptor_new_uri_from_counted_string(con->world->raptor_world_ptr,
+                                             con->term_value.string,
+                                             con->term_value.length);
+    if(uri)
+      l = rasqal_new_uri_literal(con->world, uri);
+  } else if(!strcmp(type, "bnode")) {
+    unsigned char* lvalue = rasqal_json_buffer_strdup(&con->term_value);
+
+    if(lvalue)
+      l = rasqal_new_simple_literal(con->world, RASQAL_LITERAL_BLANK, lvalue);
+  } else if(!strcmp(type, "literal") || !strcmp(type, "typed-literal")) {
+    unsigned char* lvalue;
+    raptor_uri* datatype_uri = NULL;
+    char* language_str = NULL;
+
+    lvalue = rasqal_json_buffer_strdup(&con->term_value);
+    if(con->term_seen & (1 << RASQAL_JSON_KEY_DATATYPE))
+      datatype_uri = raptor_new_uri_from_counted_string(con->world->raptor_world_ptr,
+                                                        con->term_datatype.string,
+                                                        con->term_datatype.length);
+    if(con->term_seen & (1 << RASQAL_JSON_KEY_XML_LANG))
+      language_str = RASQAL_GOOD_CAST(char*, rasqal_json_buffer_strdup(&con->term_language));
+
+    if(lvalue)
+      l = rasqal_new_string_literal_node(con->world, lvalue, language_str,
+                                         datatype_uri);
+    else {
+      if(datatype_uri)
+        raptor_free_uri(datatype_uri);
+      if(language_str)
+        RASQAL_FREE(char*, language_str);
+    }
+  } else {
+    rasqal_json_error(con, "binding has an unknown type");
+    return;
+  }
+
+  if(!l) {
+    rasqal_json_error(con, "binding value could not be created");
+    return;
+  }
+
+  offset = rasqal_rowsource_get_variable_offset_by_name(con->rowsource,
+                                                        con->name.string);
+  if(offset < 0)
+    offset = rasqal_json_add_variable(con, con->name.string,
+                                      con->name.length);
+  if(offset >= con->row->size)
+    rasqal_row_expand_size(con->row, con->rowsource->size);
+
+  rasqal_row_set_value_at(con->row, offset, l);
+  rasqal_free_literal(l);
+  RASQAL_DEBUG3("Saving row result %d value at offset %d\n",
+                con->offset, offset);
+}
+
+
+static void
+rasqal_json_open(rasqal_rowsource_json_context* con, rasqal_json_role role,
+                 int is_object)
+{
+  rasqal_json_frame* frame;
+
+  if(con->depth == RASQAL_JSON_MAX_DEPTH) {
+    rasqal_json_error(con, "nested too deeply");
+    return;
+  }
+
+  frame = &con->frames[con->depth++];
+  frame->role = role;
+  frame->is_object = is_object;
+  frame->key = RASQAL_JSON_KEY_OTHER;
+  frame->expect = is_object ? RASQAL_JSON_EXPECT_KEY : RASQAL_JSON_EXPECT_VALUE;
+
+  switch(role) {
+    case RASQAL_JSON_ROLE_ROW:
+      if(con->rowsource) {
+        con->row = rasqal_new_row(con->rowsource);
+        RASQAL_DEBUG2("Made new row %d\n", con->offset);
+      }
+      break;
+
+    case RASQAL_JSON_ROLE_TERM:
+      con->term_seen = 0;
+      break;
+
+    case RASQAL_JSON_ROLE_OTHER:
+    case RASQAL_JSON_ROLE_TOP:
+    case RASQAL_JSON_ROLE_HEAD:
+    case RASQAL_JSON_ROLE_VARS:
+    case RASQAL_JSON_ROLE_RESULTS:
+    case RASQAL_JSON_ROLE_BINDINGS:
+    default:
+      break;
+  }
+}
+
+
+static void
+rasqal_json_close(rasqal_rowsource_json_context* con)
+{
+  rasqal_json_role role = con->frames[--con->depth].role;
+
+  switch(role) {
+    case RASQAL_JSON_ROLE_TOP:
+      con->top_done = 1;
+      break;
+
+    case RASQAL_JSON_ROLE_HEAD:
+      con->head_done = 1;
+      break;
+
+    case RASQAL_JSON_ROLE_ROW:
+      if(con->row) {
+        RASQAL_DEBUG2("Saving row result %d\n", con->offset);
+        con->row->offset = con->offset++;
+        raptor_sequence_push(con->results_sequence, con->row);
+      }
+      con->row = NULL;
+      break;
+
+    case RASQAL_JSON_ROLE_TERM:
+      rasqal_json_end_term(con);
+      break;
+
+    case RASQAL_JSON_ROLE_OTHER:
+    case RASQAL_JSON_ROLE_VARS:
+    case RASQAL_JSON_ROLE_RESULTS:
+    case RASQAL_JSON_ROLE_BINDINGS:
+    default:
+      break;
+  }
+
+  if(con->depth > 0)
+    con->frames[con->depth - 1].expect = RASQAL_JSON_EXPECT_COMMA;
+}
+
+
+static void
+rasqal_json_key_token(rasqal_rowsource_json_context* con,
+                      rasqal_json_frame* frame)
+{
+  int i;
+
+  if(frame->role == RASQAL_JSON_ROLE_ROW) {
+    frame->key = RASQAL_JSON_KEY_VARIABLE;
+    if(rasqal_json_buffer_copy(&con->name, &con->token))
+      rasqal_json_error(con, "out of memory");
+    return;
+  }
+
+  frame->key = RASQAL_JSON_KEY_OTHER;
+  for(i = RASQAL_JSON_KEY_HEAD; i <= RASQAL_JSON_KEY_LAST; i++) {
+    if(!strcmp(RASQAL_GOOD_CAST(const char*, con->token.string),
+               rasqal_json_key_names[i])) {
+      frame->key = (rasqal_json_key)i;
+      break;
+    }
+  }
+}
+
+
+static void
+rasqal_json_value_token(rasqal_rowsource_json_context* con,
+                        rasqal_json_frame* frame,
+                        rasqal_json_token_type type)
+{
+  rasqal_json_role role = frame->role;
+  rasqal_json_role child = RASQAL_JSON_ROLE_OTHER;
+  rasqal_json_buffer* field = NULL;
+
+  frame->expect = RASQAL_JSON_EXPECT_COMMA;
+
+  switch(type) {
+    case RASQAL_JSON_TOKEN_OBJECT_START:
+      if(role == RASQAL_JSON_ROLE_TOP && frame->key == RASQAL_JSON_KEY_HEAD)
+        child = RASQAL_JSON_ROLE_HEAD;
+      else if(role == RASQAL_JSON_ROLE_TOP &&
+              frame->key == RASQAL_JSON_KEY_RESULTS)
+        child = RASQAL_JSON_ROLE_RESULTS;
+      else if(role == RASQAL_JSON_ROLE_BINDINGS)
+        child = RASQAL_JSON_ROLE_ROW;
+      else if(role == RASQAL_JSON_ROLE_ROW)
+        child = RASQAL_JSON_ROLE_TERM;
+      rasqal_json_open(con, child, 1);
+      break;
+
+    case RASQAL_JSON_TOKEN_ARRAY_START:
+      if(role == RASQAL_JSON_ROLE_HEAD && frame->key == RASQAL_JSON_KEY_VARS)
+        child = RASQAL_JSON_ROLE_VARS;
+      else if(role == RASQAL_JSON_ROLE_RESULTS &&
+              frame->key == RASQAL_JSON_KEY_BINDINGS)
+        child = RASQAL_JSON_ROLE_BINDINGS;
+      rasqal_json_open(con, child, 0);
+      break;
+
+    case RASQAL_JSON_TOKEN_STRING:
+      if(role == RASQAL_JSON_ROLE_VARS) {
+        if(con->rowsource)
+          rasqal_json_add_variable(con, con->token.string, con->token.length);
+      } else if(role == RASQAL_JSON_ROLE_TERM) {
+        switch(frame->key) {
+          case RASQAL_JSON_KEY_TYPE:     field = &con->term_type; break;
+          case RASQAL_JSON_KEY_VALUE:    field = &con->term_value; break;
+          case RASQAL_JSON_KEY_XML_LANG: field = &con->term_language; break;
+          case RASQAL_JSON_KEY_DATATYPE: field = &con->term_datatype; break;
+          default: break;
+        }
+        if(field) {
+          if(rasqal_json_buffer_copy(field, &con->token))
+            rasqal_json_error(con, "out of memory");
+          con->term_seen |= (1 << frame->key);
+        }
+      }
+      break;
+
+    case RASQAL_JSON_TOKEN_TRUE:
+    case RASQAL_JSON_TOKEN_FALSE:
+      if(role == RASQAL_JSON_ROLE_TOP && frame->key == RASQAL_JSON_KEY_BOOLEAN) {
+        con->boolean_value = (type == RASQAL_JSON_TOKEN_TRUE);
+        RASQAL_DEBUG2("boolean result value %d\n", con->boolean_value);
+      }
+      break;
+
+    case RASQAL_JSON_TOKEN_NUMBER:
+    case RASQAL_JSON_TOKEN_NULL:
+      break;
+
+    case RASQAL_JSON_TOKEN_OBJECT_END:
+    case RASQAL_JSON_TOKEN_ARRAY_END:
+    case RASQAL_JSON_TOKEN_COLON:
+    case RASQAL_JSON_TOKEN_COMMA:
+    default:
+      rasqal_json_error(con, "unexpected token where a value was expected");
+      break;
+  }
+}
+
+
+static void
+rasqal_json_token(rasqal_rowsource_json_context* con,
+                  rasqal_json_token_type type)
+{
+  rasqal_json_frame* frame;
+
+  if(con->top_done) {
+    rasqal_json_error(con, "content after the end of the document");
+    return;
+  }
+
+  if(!con->depth) {
+    if(type == RASQAL_JSON_TOKEN_OBJECT_START)
+      rasqal_json_open(con, RASQAL_JSON_ROLE_TOP, 1);
+    else
+      rasqal_json_error(con, "document does not start with an object");
+    return;
+  }
+
+  frame = &con->frames[con->depth - 1];
+
+  switch(frame->expect) {
+    case RASQAL_JSON_EXPECT_KEY:
+      if(type == RASQAL_JSON_TOKEN_STRING) {
+        rasqal_json_key_token(con, frame);
+        frame->expect = RASQAL_JSON_EXPECT_COLON;
+      } else if(type == RASQAL_JSON_TOKEN_OBJECT_END)
+        rasqal_json_close(con);
+      else
+        rasqal_json_error(con, "unexpected token where a key was expected");
+      break;
+
+    case RASQAL_JSON_EXPECT_COLON:
+      if(type == RASQAL_JSON_TOKEN_COLON)
+        frame->expect = RASQAL_JSON_EXPECT_VALUE;
+      else
+        rasqal_json_error(con, "no : after a key");
+      break;
+
+    case RASQAL_JSON_EXPECT_VALUE:
+      if(type == RASQAL_JSON_TOKEN_ARRAY_END && !frame->is_object)
+        rasqal_json_close(con);
+      else
+        rasqal_json_value_token(con, frame, type);
+      break;
+
+    case RASQAL_JSON_EXPECT_COMMA:
+      if(type == RASQAL_JSON_TOKEN_COMMA)
+        frame->expect = frame->is_object ? RASQAL_JSON_EXPECT_KEY :
+                                           RASQAL_JSON_EXPECT_VALUE;
+      else if((type == RASQAL_JSON_TOKEN_OBJECT_END && frame->is_object) ||
+              (type == RASQAL_JSON_TOKEN_ARRAY_END && !frame->is_object))
+        rasqal_json_close(con);
+      else
+        rasqal_json_error(con, "no , between values");
+      break;
+  }
+}
+
+
+/* end of a number, true, false or null */
+static void
+rasqal_json_word_token(rasqal_rowsource_json_context* con)
+{
+  const char* word = RASQAL_GOOD_CAST(const char*, con->token.string);
+  unsigned char c = con->token.string[0];
+
+  con->lex_state = RASQAL_JSON_LEX_TOKEN;
+
+  if(!strcmp(word, "true"))
+    rasqal_json_token(con, RASQAL_JSON_TOKEN_TRUE);
+  else if(!strcmp(word, "false"))
+    rasqal_json_token(con, RASQAL_JSON_TOKEN_FALSE);
+  else if(!strcmp(word, "null"))
+    rasqal_json_token(con, RASQAL_JSON_TOKEN_NULL);
+  else if(c == '-' || (c >= '0' && c <= '9'))
+    rasqal_json_token(con, RASQAL_JSON_TOKEN_NUMBER);
+  else
+    rasqal_json_error(con, "unknown word");
+}
+
+
+/* append a unicode codepoint to the token as UTF-8 */
+static void
+rasqal_json_unicode_char(rasqal_rowsource_json_context* con, unsigned long c)
+{
+  unsigned char utf8[4];
+  size_t len;
+
+  if(c < 0x80) {
+    utf8[0] = RASQAL_GOOD_CAST(unsigned char, c);
+    len = 1;
+  } else if(c < 0x800) {
+    utf8[0] = RASQAL_GOOD_CAST(unsigned char, 0xC0 | (c >> 6));
+    utf8[1] = RASQAL_GOOD_CAST(unsigned char, 0x80 | (c & 0x3F));
+    len = 2;
+  } else if(c < 0x10000) {
+    utf8[0] = RASQAL_GOOD_CAST(unsigned char, 0xE0 | (c >> 12));
+    utf8[1] = RASQAL_GOOD_CAST(unsigned char, 0x80 | ((c >> 6) & 0x3F));
+    utf8[2] = RASQAL_GOOD_CAST(unsigned char, 0x80 | (c & 0x3F));
+    len = 3;
+  } else {
+    utf8[0] = RASQAL_GOOD_CAST(unsigned char, 0xF0 | (c >> 18));
+    utf8[1] = RASQAL_GOOD_CAST(unsigned char, 0x80 | ((c >> 12) & 0x3F));
+    utf8[2] = RASQAL_GOOD_CAST(unsigned char, 0x80 | ((c >> 6) & 0x3F));
+    utf8[3] = RASQAL_GOOD_CAST(unsigned char, 0x80 | (c & 0x3F));
+    len = 4;
+  }
+
+  if(rasqal_json_buffer_append(&con->token, utf8, len))
+    rasqal_json_error(con, "out of memory");
+}
+
+
+/* end of \uXXXX escape */
+static void
+rasqal_json_unicode_escape(rasqal_rowsource_json_context* con)
+{
+  unsigned long c = con->unicode_value;
+
+  if(con->high_surrogate) {
+    if(c < 0xDC00 || c > 0xDFFF) {
+      rasqal_json_error(con, "bad \\u surrogate pair");
+      return;
+    }
+    c = 0x10000 + ((con->high_surrogate - 0xD800) << 10) + (c - 0xDC00);
+    con->high_surrogate = 0;
+  } else if(c >= 0xD800 && c <= 0xDBFF) {
+    con->high_surrogate = c;
+    return;
+  } else if(c >= 0xDC00 && c <= 0xDFFF) {
+    rasqal_json_error(con, "bad \\u surrogate pair");
+    return;
+  }
+
+  rasqal_json_unicode_char(con, c);
+}
+
+
+/*
+ * rasqal_json_parse_chunk:
+ * @con: JSON context
+ * @p: chunk of bytes
+ * @len: length of @p
+ * @is_end: non-0 if this is the last chunk
+ *
+ * INTERNAL - tokenize a chunk of SPARQL JSON results
+ *
+ * Tokens may be split across chunks; partial strings and words are
+ * kept in the context.
+ */
+static void
+rasqal_json_parse_chunk(rasqal_rowsource_json_context* con,
+                        const unsigned char* p, size_t len, int is_end)
+{
+  const unsigned char* end = p + len;
+
+  while(p < end && !con->failed) {
+    unsigned char c = *p;
+
+    switch(con->lex_state) {
+      case RASQAL_JSON_LEX_TOKEN:
+        p++;
+        switch(c) {
+          case '\n':
+            con->locator.line++;
+            break;
+
+          case ' ':
+          case '\t':
+          case '\r':
+            break;
+
+          case '"':
+            con->token.length = 0;
+            con->lex_state = RASQAL_JSON_LEX_STRING;
+            break;
+
+          case '{':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_OBJECT_START);
+            break;
+
+          case '}':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_OBJECT_END);
+            break;
+
+          case '[':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_ARRAY_START);
+            break;
+
+          case ']':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_ARRAY_END);
+            break;
+
+          case ':':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_COLON);
+            break;
+
+          case ',':
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_COMMA);
+            break;
+
+          default:
+            if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-') {
+              con->token.length = 0;
+              rasqal_json_buffer_append(&con->token, &c, 1);
+              con->lex_state = RASQAL_JSON_LEX_WORD;
+            } else
+              rasqal_json_error(con, "unexpected character");
+            break;
+        }
+        break;
+
+      case RASQAL_JSON_LEX_STRING:
+        if(con->high_surrogate && c != '\\') {
+          rasqal_json_error(con, "bad \\u surrogate pair");
+          break;
+        }
+
+        if(1) {
+          /* copy the run up to the next quote or escape */
+          const unsigned char* start = p;
+
+          while(p < end && *p != '"' && *p != '\\')
+            p++;
+          if(p > start &&
+             rasqal_json_buffer_append(&con->token, start,
+                                       RASQAL_GOOD_CAST(size_t, p - start))) {
+            rasqal_json_error(con, "out of memory");
+            break;
+          }
+        }
+
+        if(p < end) {
+          if(*p == '"') {
+            /* ensure the token is a terminated string even if empty */
+            rasqal_json_buffer_append(&con->token, p, 0);
+            con->lex_state = RASQAL_JSON_LEX_TOKEN;
+            rasqal_json_token(con, RASQAL_JSON_TOKEN_STRING);
+          } else
+            con->lex_state = RASQAL_JSON_LEX_STRING_ESCAPE;
+          p++;
+        }
+        break;
+
+      case RASQAL_JSON_LEX_STRING_ESCAPE:
+        p++;
+        con->lex_state = RASQAL_JSON_LEX_STRING;
+        if(con->high_surrogate && c != 'u') {
+          rasqal_json_error(con, "bad \\u surrogate pair");
+          break;
+        }
+
+        switch(c) {
+          case '"':
+          case '\\':
+          case '/':
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'f':
+            c = '\f';
+            break;
+          case 'n':
+            c = '\n';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'u':
+            con->unicode_value = 0;
+            con->unicode_digits = 0;
+            con->lex_state = RASQAL_JSON_LEX_STRING_UNICODE;
+            break;
+          default:
+            rasqal_json_error(con, "unknown \\ escape");
+            break;
+        }
+        if(con->lex_state == RASQAL_JSON_LEX_STRING &&
+           rasqal_json_buffer_append(&con->token, &c, 1))
+          rasqal_json_error(con, "out of memory");
+        break;
+
+      case RASQAL_JSON_LEX_STRING_UNICODE:
+        p++;
+        if(c >= '0' && c <= '9')
+          c = RASQAL_GOOD_CAST(unsigned char, c - '0');
+        else if(c >= 'a' && c <= 'f')
+          c = RASQAL_GOOD_CAST(unsigned char, c - 'a' + 10);
+        else if(c >= 'A' && c <= 'F')
+          c = RASQAL_GOOD_CAST(unsigned char, c - 'A' + 10);
+        else {
+          rasqal_json_error(con, "bad \\u escape");
+          break;
+        }
+        con->unicode_value = (con->unicode_value << 4) | c;
+        if(++con->unicode_digits == 4) {
+          con->lex_state = RASQAL_JSON_LEX_STRING;
+          rasqal_json_unicode_escape(con);
+        }
+        break;
+
+      case RASQAL_JSON_LEX_WORD:
+        if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') {
+          rasqal_json_buffer_append(&con->token, &c, 1);
+          p++;
+        } else
+          /* does not use up c */
+          rasqal_json_word_token(con);
+        break;
+    }
+  }
+
+  if(is_end && !con->failed) {
+    if(con->lex_state == RASQAL_JSON_LEX_WORD)
+      rasqal_json_word_token(con);
+    else if(con->lex_state != RASQAL_JSON_LEX_TOKEN)
+      rasqal_json_error(con, "document ends inside a string");
+
+    if(!con->failed && !con->top_done)
+      rasqal_json_error(con, "document ends before the top level object ends");
+  }
+}
+
+
+/*
+ * rasqal_json_read_chunk:
+ * @con: JSON context
+ *
+ * INTERNAL - read and parse one chunk from the iostream
+ *
+ * Return value: non-0 at end of input or on failure
+ */
+static int
+rasqal_json_read_chunk(rasqal_rowsource_json_context* con)
+{
+  size_t read_len;
+
+  if(con->failed || raptor_iostream_read_eof(con->iostr))
+    return 1;
+
+  read_len = RASQAL_BAD_CAST(size_t,
+                             raptor_iostream_read_bytes(RASQAL_GOOD_CAST(char*, con->buffer), 1,
+                                                        FILE_READ_BUF_SIZE,
+                                                        con->iostr));
+  if(read_len < FILE_READ_BUF_SIZE) {
+    /* finished */
+    rasqal_json_parse_chunk(con, con->buffer, read_len, 1);
+    return 1;
+  }
+
+  rasqal_json_parse_chunk(con, con->buffer, read_len, 0);
+  return con->failed;
+}
+
+
+/* Local handlers for turning SPARQL JSON read from an iostream into rows */
+
+static int
+rasqal_rowsource_json_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_json_context* con;
+
+  con = (rasqal_rowsource_json_context*)user_data;
+
+  con->rowsource = rowsource;
+
+  return 0;
+}
+
+
+static void rasqal_json_free_context(rasqal_rowsource_json_context* con);
+
+static int
+rasqal_rowsource_json_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_json_context* con;
+
+  con = (rasqal_rowsource_json_context*)user_data;
+
+  rasqal_json_free_context(con);
+
+  return 0;
+}
+
+
+static void
+rasqal_rowsource_json_process(rasqal_rowsource_json_context* con)
+{
+  /* end with variables done AND at least one row */
+  while(!(con->head_done && raptor_sequence_size(con->results_sequence) > 0)) {
+    if(rasqal_json_read_chunk(con))
+      break;
+  }
+}
+
+
+static int
+rasqal_rowsource_json_ensure_variables(rasqal_rowsource* rowsource,
+                                       void *user_data)
+{
+  rasqal_rowsource_json_context* con;
+
+  con = (rasqal_rowsource_json_context*)user_data;
+
+  rasqal_rowsource_json_process(con);
+
+  return con->failed;
+}
+
+
+static rasqal_row*
+rasqal_rowsource_json_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_rowsource_json_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_rowsource_json_context*)user_data;
+
+  rasqal_rowsource_json_process(con);
+
+  if(!con->failed && raptor_sequence_size(con->results_sequence) > 0) {
+    row = (rasqal_row*)raptor_sequence_unshift(con->results_sequence);
+    /* variables first seen in later rows */
+    if(row->size < rowsource->size)
+      rasqal_row_expand_size(row, rowsource->size);
+  }
+
+  return row;
+}
+
+
+/*
+ * rasqal_json_init_context:
+ * @world: rasqal world object
+ * @iostr: #raptor_iostream to read the query results from
+ * @base_uri: #raptor_uri base URI of the input format
+ * @flags: flags
+ *
+ * INTERNAL - Initialise the SPARQL JSON reader context
+ *
+ * Return value: context or NULL on failure
+ **/
+static rasqal_rowsource_json_context*
+rasqal_json_init_context(rasqal_world *world, raptor_iostream *iostr,
+                         raptor_uri *base_uri, unsigned int flags)
+{
+  rasqal_rowsource_json_context* con;
+
+  con = RASQAL_CALLOC(rasqal_rowsource_json_context*, 1, sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->world = world;
+  con->base_uri = base_uri ? raptor_uri_copy(base_uri) : NULL;
+  con->iostr = iostr;
+  con->flags = flags;
+
+  con->locator.uri = con->base_uri;
+  con->locator.line = 1;
+
+  con->lex_state = RASQAL_JSON_LEX_TOKEN;
+  con->boolean_value = -1;
+
+  return con;
+}
+
+
+/*
+ * rasqal_json_free_context:
+ * @con: SPARQL JSON context
+ *
+ * INTERNAL - Free the SPARQL JSON reader context
+ **/
+static void
+rasqal_json_free_context(rasqal_rowsource_json_context* con)
+{
+  if(con->base_uri)
+    raptor_free_uri(con->base_uri);
+
+  if(con->row)
+    rasqal_free_row(con->row);
+
+  if(con->results_sequence)
+    raptor_free_sequence(con->results_sequence);
+
+  if(con->vars_table)
+    rasqal_free_variables_table(con->vars_table);
+
+  if(con->flags) {
+    if(con->iostr)
+      raptor_free_iostream(con->iostr);
+  }
+
+  rasqal_json_buffer_clear(&con->token);
+  rasqal_json_buffer_clear(&con->name);
+  rasqal_json_buffer_clear(&con->term_type);
+  rasqal_json_buffer_clear(&con->term_value);
+  rasqal_json_buffer_clear(&con->term_language);
+  rasqal_json_buffer_clear(&con->term_datatype);
+
+  RASQAL_FREE(rasqal_rowsource_json_context, con);
+}
+
+
+static int
+rasqal_rowsource_json_get_boolean(rasqal_query_results_formatter *formatter,
+                                  rasqal_world* world, raptor_iostream *iostr,
+                                  raptor_uri *base_uri, unsigned int flags)
+{
+  rasqal_rowsource_json_context* con;
+  int bv;
+
+  con = rasqal_json_init_context(world, iostr, base_uri, flags);
+  if(!con)
+    return -1;
+
+  /* do some parsing - until we get the boolean value */
+  while(con->boolean_value < 0) {
+    if(rasqal_json_read_chunk(con))
+      break;
+  }
+
+  bv = con->failed ? -1 : con->boolean_value;
+
+  rasqal_json_free_context(con);
+
+  return bv;
+}
+
+
+static const rasqal_rowsource_handler rasqal_rowsource_json_handler = {
+  /* .version = */ 1,
+  "SPARQL JSON",
+  /* .init = */ rasqal_rowsource_json_init,
+  /* .finish = */ rasqal_rowsource_json_finish,
+  /* .ensure_variables = */ rasqal_rowsource_json_ensure_variables,
+  /* .read_row = */ rasqal_rowsource_json_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ NULL,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ NULL,
+  /* .set_origin = */ NULL,
+};
+
+
+/*
+ * rasqal_query_results_get_rowsource_json:
+ * @world: rasqal world object
+ * @iostr: #raptor_iostream to read the query results from
+ * @base_uri: #raptor_uri base URI of the input format
+ *
+ * INTERNAL - Read SPARQL JSON query results from an iostream
+ * returning a rowsource.
+ *
+ * Return value: a new rasqal_rowsource or NULL on failure
+ **/
+static rasqal_rowsource*
+rasqal_query_results_get_rowsource_json(rasqal_query_results_formatter* formatter,
+                                        rasqal_world *world,
+                                        rasqal_variables_table* vars_table,
+                                        raptor_iostream *iostr,
+                                        raptor_uri *base_uri,
+                                        unsigned int flags)
+{
+  rasqal_rowsource_json_context* con;
+
+  con = rasqal_json_init_context(world, iostr, base_uri, flags);
+  if(!con)
+    return NULL;
+
+  con->results_sequence = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row, (raptor_data_print_handler)rasqal_row_print);
+
+  con->vars_table = rasqal_new_variables_table_from_variables_table(vars_table);
+
+  return rasqal_new_rowsource_from_handler(world, NULL,
+                                           con,
+                                           &rasqal_rowsource_json_handler,
+                                           con->vars_table,
+                                           0);
+}
+
+
+static int
+rasqal_query_results_json_recognise_syntax(rasqal_query_results_format_factory* factory,
+                                           const unsigned char *buffer,
+                                           size_t len,
+                                           const unsigned char *identifier,
+                                           const unsigned char *suffix,
+                                           const char *mime_type)
+{
+
+  if(suffix && !strcmp(RASQAL_GOOD_CAST(const char*, suffix), "srj"))
+    return 8;
+
+  return 0;
+}
+
+
 static const char* const json_names[] = { "json", NULL};
 
 static const char* const json_uri_strings[] = {
@@ -291,7 +1427,9 @@ rasqal_query_results_json_register_factory(rasqal_query_results_format_factory *
   factory->desc.flags = 0;
   
   factory->write         = rasqal_query_results_write_json1;
-  factory->get_rowsource = NULL;
+  factory->get_rowsource = rasqal_query_results_get_rowsource_json;
+  factory->recognise_syntax = rasqal_query_results_json_recognise_syntax;
+  factory->get_boolean      = rasqal_rowsource_json_get_boolean;
 
   return rc;
 }
@@ -303,3 +1441,300 @@ rasqal_init_result_format_json(rasqal_world* world)
   return !rasqal_world_register_query_results_format_factory(world,
                                                              &rasqal_query_results_json_register_factory);
 }
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+static const char* const json_test_results_1 =
+  "{ \"head\": { \"vars\": [ \"s\", \"o\", \"x\" ] },\n"
+  "  \"results\": { \"bindings\": [\n"
+  "    { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/a\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"xml:lang\": \"fr\",\n"
+  "               \"value\": \"caf\\u00e9 \\\"q\\\"\\t\\ud83d\\ude00\" } },\n"
+  "    { \"s\": { \"type\": \"bnode\", \"value\": \"b1\" },\n"
+  "      \"o\": { \"type\": \"literal\", \"value\": \"42\",\n"
+  "               \"datatype\": \"http://www.w3.org/2001/XMLSchema#integer\" },\n"
+  "      \"x\": { \"type\": \"literal\", \"value\": \"\" } }\n"
+  "  ] }\n"
+  "}\n";
+
+/* results before head */
+static const char* const json_test_results_2 =
+  "{\"results\":{\"bindings\":[{\"b\":{\"type\":\"uri\",\"value\":\"http://example.org/b\"}}]},"
+  "\"head\":{\"vars\":[\"a\",\"b\"]}}";
+
+static const char* const json_test_boolean =
+  "{ \"head\" : { } , \"boolean\" : true }";
+
+/* truncated inside a binding */
+static const char* const json_test_bad =
+  "{ \"head\": { \"vars\": [ \"a\" ] }, \"results\": { \"bindings\": [ { \"a\": { \"type\": \"uri\", \"val";
+
+
+static rasqal_rowsource*
+json_test_new_rowsource(rasqal_world* world, const char* format_name,
+                        rasqal_variables_table* vt, raptor_uri* base_uri,
+                        const void* string, size_t len)
+{
+  rasqal_query_results_formatter* formatter;
+  raptor_iostream* iostr;
+  rasqal_rowsource* rowsource = NULL;
+
+  formatter = rasqal_new_query_results_formatter(world, format_name, NULL,
+                                                 NULL);
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, string),
+                                          len);
+  if(formatter && iostr)
+    /* takes ownership of iostr with flags 1 */
+    rowsource = rasqal_query_results_formatter_get_read_rowsource(world, iostr,
+                                                                  formatter,
+                                                                  vt, base_uri,
+                                                                  1);
+  else if(iostr)
+    raptor_free_iostream(iostr);
+
+  if(formatter)
+    rasqal_free_query_results_formatter(formatter);
+
+  return rowsource;
+}
+
+
+static int
+json_test_value_is(rasqal_rowsource* rowsource, rasqal_row* row,
+                   const char* name, rasqal_literal_type type,
+                   const char* string)
+{
+  rasqal_literal* l;
+  int offset;
+  const unsigned char* lstring;
+
+  offset = rasqal_rowsource_get_variable_offset_by_name(rowsource,
+                                                        RASQAL_GOOD_CAST(const unsigned char*, name));
+  if(offset < 0 || offset >= row->size)
+    return 0;
+
+  l = row->values[offset];
+  if(!string)
+    return (l == NULL);
+
+  if(!l || l->type != type)
+    return 0;
+
+  lstring = rasqal_literal_as_string(l);
+  return lstring && !strcmp(RASQAL_GOOD_CAST(const char*, lstring), string);
+}
+
+
+#define JSON_TEST_ROWS 1000
+
+/* Write the same bindings as SPARQL JSON and SPARQL XML */
+static void
+json_test_make_results(raptor_stringbuffer* json_sb,
+                        raptor_stringbuffer* xml_sb)
+{
+  int i;
+
+  raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, "{ \"head\": { \"vars\": [ \"s\", \"o\" ] },\n  \"results\": { \"bindings\": [\n"), 1);
+  raptor_stringbuffer_append_string(xml_sb, RASQAL_GOOD_CAST(const unsigned char*, "<?xml version=\"1.0\"?>\n<sparql xmlns=\"http://www.w3.org/2005/sparql-results#\">\n  <head>\n    <variable name=\"s\"/>\n    <variable name=\"o\"/>\n  </head>\n  <results>\n"), 1);
+
+  for(i = 0; i < JSON_TEST_ROWS; i++) {
+    if(i)
+      raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, ",\n"), 1);
+    raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, "      { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/resource/"), 1);
+    raptor_stringbuffer_append_decimal(json_sb, i);
+    raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, "\" }, \"o\": { \"type\": \"literal\", \"value\": \"label number "), 1);
+    raptor_stringbuffer_append_decimal(json_sb, i);
+    raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, "\", \"xml:lang\": \"en\" } }"), 1);
+
+    raptor_stringbuffer_append_string(xml_sb, RASQAL_GOOD_CAST(const unsigned char*, "    <result>\n      <binding name=\"s\"><uri>http://example.org/resource/"), 1);
+    raptor_stringbuffer_append_decimal(xml_sb, i);
+    raptor_stringbuffer_append_string(xml_sb, RASQAL_GOOD_CAST(const unsigned char*, "</uri></binding>\n      <binding name=\"o\"><literal xml:lang=\"en\">label number "), 1);
+    raptor_stringbuffer_append_decimal(xml_sb, i);
+    raptor_stringbuffer_append_string(xml_sb, RASQAL_GOOD_CAST(const unsigned char*, "</literal></binding>\n    </result>\n"), 1);
+  }
+
+  raptor_stringbuffer_append_string(json_sb, RASQAL_GOOD_CAST(const unsigned char*, "\n  ] }\n}\n"), 1);
+  raptor_stringbuffer_append_string(xml_sb, RASQAL_GOOD_CAST(const unsigned char*, "  </results>\n</sparql>\n"), 1);
+}
+
+
+static int
+json_test_count_rows(rasqal_world* world, const char* format_name,
+                     raptor_uri* base_uri, raptor_stringbuffer* sb)
+{
+  rasqal_variables_table* vt;
+  rasqal_rowsource* rowsource;
+  int count = 0;
+
+  vt = rasqal_new_variables_table(world);
+
+  rowsource = json_test_new_rowsource(world, format_name, vt, base_uri,
+                                      raptor_stringbuffer_as_string(sb),
+                                      raptor_stringbuffer_length(sb));
+  if(rowsource) {
+    rasqal_row* row;
+
+    while((row = rasqal_rowsource_read_row(rowsource))) {
+      count++;
+      rasqal_free_row(row);
+    }
+    rasqal_free_rowsource(rowsource);
+  }
+
+  rasqal_free_variables_table(vt);
+
+  return count;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  raptor_uri* base_uri;
+  rasqal_variables_table* vt;
+  rasqal_rowsource* rowsource;
+  raptor_sequence* seq;
+  rasqal_row* row;
+  rasqal_query_results* results;
+  rasqal_query_results_formatter* formatter;
+  raptor_iostream* iostr;
+  raptor_stringbuffer* json_sb;
+  raptor_stringbuffer* xml_sb;
+  int count;
+  int failures = 0;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+
+  /* Test 1: all term types */
+  vt = rasqal_new_variables_table(world);
+  rowsource = json_test_new_rowsource(world, "json", vt, base_uri,
+                                      json_test_results_1,
+                                      strlen(json_test_results_1));
+  seq = rowsource ? rasqal_rowsource_read_all_rows(rowsource) : NULL;
+  if(!seq || raptor_sequence_size(seq) != 2 ||
+     rasqal_rowsource_get_size(rowsource) != 3) {
+    fprintf(stderr, "%s: test 1 did not return 2 rows of 3 variables\n",
+            program);
+    failures++;
+  } else {
+    row = (rasqal_row*)raptor_sequence_get_at(seq, 0);
+    if(!json_test_value_is(rowsource, row, "s", RASQAL_LITERAL_URI,
+                           "http://example.org/a") ||
+       !json_test_value_is(rowsource, row, "o", RASQAL_LITERAL_STRING,
+                           "caf\xc3\xa9 \"q\"\t\xf0\x9f\x98\x80") ||
+       !row->values[1]->language || strcmp(row->values[1]->language, "fr") ||
+       !json_test_value_is(rowsource, row, "x", RASQAL_LITERAL_STRING,
+                           NULL)) {
+      fprintf(stderr, "%s: test 1 row 1 has wrong values\n", program);
+      failures++;
+    }
+
+    row = (rasqal_row*)raptor_sequence_get_at(seq, 1);
+    if(!json_test_value_is(rowsource, row, "s", RASQAL_LITERAL_BLANK, "b1") ||
+       !json_test_value_is(rowsource, row, "o", RASQAL_LITERAL_INTEGER, "42") ||
+       !json_test_value_is(rowsource, row, "x", RASQAL_LITERAL_STRING, "")) {
+      fprintf(stderr, "%s: test 1 row 2 has wrong values\n", program);
+      failures++;
+    }
+  }
+  if(seq)
+    raptor_free_sequence(seq);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  rasqal_free_variables_table(vt);
+
+  /* Test 2: results before head */
+  vt = rasqal_new_variables_table(world);
+  rowsource = json_test_new_rowsource(world, "json", vt, base_uri,
+                                      json_test_results_2,
+                                      strlen(json_test_results_2));
+  row = rowsource ? rasqal_rowsource_read_row(rowsource) : NULL;
+  if(!row || rasqal_rowsource_get_size(rowsource) != 2 ||
+     !json_test_value_is(rowsource, row, "b", RASQAL_LITERAL_URI,
+                         "http://example.org/b") ||
+     !json_test_value_is(rowsource, row, "a", RASQAL_LITERAL_URI, NULL)) {
+    fprintf(stderr, "%s: test 2 results before head failed\n", program);
+    failures++;
+  }
+  if(row)
+    rasqal_free_row(row);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  rasqal_free_variables_table(vt);
+
+  /* Test 3: boolean */
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BOOLEAN);
+  formatter = rasqal_new_query_results_formatter(world, "json", NULL, NULL);
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, json_test_boolean),
+                                          strlen(json_test_boolean));
+  if(rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                         base_uri) ||
+     rasqal_query_results_get_boolean(results) != 1) {
+    fprintf(stderr, "%s: test 3 boolean result failed\n", program);
+    failures++;
+  }
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+  rasqal_free_query_results(results);
+
+  /* Test 4: truncated document returns no rows */
+  vt = rasqal_new_variables_table(world);
+  rowsource = json_test_new_rowsource(world, "json", vt, base_uri,
+                                      json_test_bad, strlen(json_test_bad));
+  row = rowsource ? rasqal_rowsource_read_row(rowsource) : NULL;
+  if(row) {
+    fprintf(stderr, "%s: test 4 truncated document returned a row\n",
+            program);
+    rasqal_free_row(row);
+    failures++;
+  }
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  rasqal_free_variables_table(vt);
+
+  /* Test 5: many rows read the same as with the SPARQL XML reader */
+  json_sb = raptor_new_stringbuffer();
+  xml_sb = raptor_new_stringbuffer();
+  json_test_make_results(json_sb, xml_sb);
+
+  count = json_test_count_rows(world, "json", base_uri, json_sb);
+  if(count != JSON_TEST_ROWS) {
+    fprintf(stderr, "%s: JSON reader returned %d rows, expected %d\n",
+            program, count, JSON_TEST_ROWS);
+    failures++;
+  }
+  count = json_test_count_rows(world, "xml", base_uri, xml_sb);
+  if(count != JSON_TEST_ROWS) {
+    fprintf(stderr, "%s: XML reader returned %d rows, expected %d\n",
+            program, count, JSON_TEST_ROWS);
+    failures++;
+  }
+
+  raptor_free_stringbuffer(json_sb);
+  raptor_free_stringbuffer(xml_sb);
+
+  raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -246,6 +246,8 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
     for(i=0; i<rasqal_query_results_get_bindings_count(results); i++) {
       const unsigned char *name=rasqal_query_results_get_binding_name(results, i);
       rasqal_literal *l=rasqal_query_results_get_binding_value(results, i);
+      const unsigned char* str;
+      size_t len;
 
       /*       <binding> */
       binding_element=raptor_new_xml_element_from_namespace_local_name(res_ns,
@@ -289,8 +291,9 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
           if(!element1)
             goto tidy;
           
+          str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->value.uri, &len));
           raptor_xml_writer_start_element(xml_writer, element1);
-          raptor_xml_writer_cdata(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_string(l->value.uri)));
+          rasqal_xml_writer_write_cdata(xml_writer, str, len);
           raptor_xml_writer_end_element(xml_writer, element1);
 
           break;
@@ -303,7 +306,7 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
             goto tidy;
           
           raptor_xml_writer_start_element(xml_writer, element1);
-          raptor_xml_writer_cdata(xml_writer, RASQAL_GOOD_CAST(const unsigned char*, l->string));
+          rasqal_xml_writer_write_cdata(xml_writer, l->string, l->string_len);
           raptor_xml_writer_end_element(xml_writer, element1);
           break;
 
@@ -341,9 +344,7 @@ rasqal_query_results_write_sparql_xml(rasqal_query_results_formatter* formatter,
           raptor_xml_writer_start_element(xml_writer, element1);
 
 
-          raptor_xml_writer_cdata_counted(xml_writer,
-                                          RASQAL_GOOD_CAST(const unsigned char*, l->string),
-                                          l->string_len);
+          rasqal_xml_writer_write_cdata(xml_writer, l->string, l->string_len);
 
           raptor_xml_writer_end_element(xml_writer, element1);
           
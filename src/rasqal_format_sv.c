@@ -55,37 +55,6 @@
 
 #include "sv.h"
 
-static int
-rasqal_iostream_write_csv_string(const unsigned char *string, size_t len,
-                                 raptor_iostream *iostr)
-{
-  const char delim = '\x22';
-  int quoting_needed = 0;
-  size_t i;
-
-  for(i = 0; i < len; i++) {
-    char c = RASQAL_GOOD_CAST(char, string[i]);
-    /* Quoting needed for delim (double quote), comma, linefeed or return */
-    if(c == delim   || c == ',' || c == '\r' || c == '\n') {
-      quoting_needed++;
-      break;
-    }
-  }
-  if(!quoting_needed)
-    return raptor_iostream_counted_string_write(string, len, iostr);
-
-  raptor_iostream_write_byte(delim, iostr);
-  for(i = 0; i < len; i++) {
-    char c = RASQAL_GOOD_CAST(char, string[i]);
-    if(c == delim)
-      raptor_iostream_write_byte(delim, iostr);
-    raptor_iostream_write_byte(c, iostr);
-  }
-  raptor_iostream_write_byte(delim, iostr);
-
-  return 0;
-}
-
 /*
  * rasqal_query_results_write_sv:
  * @iostr: #raptor_iostream to write the query to
@@ -180,7 +149,7 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
             else {
               raptor_iostream_write_byte('<', iostr);
               if(str && len > 0)
-                raptor_string_ntriples_write(str, len, '"', iostr);
+                rasqal_iostream_write_ntriples_string(str, len, '"', iostr);
               raptor_iostream_write_byte('>', iostr);
             }
             break;
@@ -202,13 +171,13 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
                   /* write integer, float, double and decimal XSD typed
                    * data without quotes, datatype or language 
                    */
-                  raptor_string_ntriples_write(l->string, l->string_len, '\0', iostr);
+                  rasqal_iostream_write_ntriples_string(l->string, l->string_len, '\0', iostr);
                   break;
                 }
               }
 
               raptor_iostream_write_byte('"', iostr);
-              raptor_string_ntriples_write(l->string, l->string_len, '"', iostr);
+              rasqal_iostream_write_ntriples_string(l->string, l->string_len, '"', iostr);
               raptor_iostream_write_byte('"', iostr);
 
               if(l->language) {
@@ -219,7 +188,7 @@ rasqal_query_results_write_sv(raptor_iostream *iostr,
               if(l->datatype) {
                 raptor_iostream_string_write("^^<", iostr);
                 str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->datatype, &len));
-                raptor_string_ntriples_write(str, len, '"', iostr);
+                rasqal_iostream_write_ntriples_string(str, len, '"', iostr);
                 raptor_iostream_write_byte('>', iostr);
               }
             }
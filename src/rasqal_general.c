@@ -125,6 +125,8 @@ rasqal_new_world(void)
   
   world->warning_level = RASQAL_WARNING_LEVEL_DEFAULT;
 
+  world->load_threads = 1;
+
   world->genid_counter = 1;
 
   return world;
@@ -230,6 +232,14 @@ rasqal_free_world(rasqal_world* world)
   if(!world)
     return;
   
+  if(world->result_cache)
+    rasqal_free_result_cache(world->result_cache);
+
+  if(world->store)
+    rasqal_free_store(world->store);
+  if(world->data_graphs)
+    raptor_free_sequence(world->data_graphs);
+
   rasqal_finish_result_formats(world);
   rasqal_finish_query_results();
 
@@ -1109,6 +1119,259 @@ rasqal_world_set_warning_level(rasqal_world* world,
 }
 
 
+/**
+ * rasqal_world_set_load_threads:
+ * @world: world
+ * @threads: maximum number of threads (1 or more)
+ *
+ * Set the maximum number of threads used to load data graphs
+ *
+ * When more than 1, local N-Triples data graph files are read and
+ * split into terms by up to this many threads when the data is
+ * loaded for a query.  Triples are still added in data graph order.
+ * The default is 1.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_world_set_load_threads(rasqal_world* world, int threads)
+{
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, 1);
+
+  if(threads < 1)
+    return 1;
+
+  world->load_threads = threads;
+
+  return 0;
+}
+
+
+/**
+ * rasqal_world_get_load_threads:
+ * @world: world
+ *
+ * Get the maximum number of threads used to load data graphs
+ *
+ * See rasqal_world_set_load_threads().
+ *
+ * Return value: number of threads or < 0 on failure
+ */
+int
+rasqal_world_get_load_threads(rasqal_world* world)
+{
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, -1);
+
+  return world->load_threads;
+}
+
+
+/**
+ * rasqal_world_set_result_cache_size:
+ * @world: world
+ * @max_bytes: memory budget in bytes or 0 to disable the cache
+ *
+ * Set the memory budget of the query result cache
+ *
+ * The cache is disabled by default.  When enabled, the result rows
+ * of each query execution are kept keyed by the query algebra and
+ * the data graphs, and a later execution of a query with the same
+ * algebra replays them instead of reading the data again.  The
+ * least recently used results are dropped to stay within
+ * @max_bytes.
+ *
+ * Results are only correct while the data does not change: call
+ * rasqal_world_set_dataset_version() when it does.
+ * rasqal_world_add_data_graph() does this itself.  Queries using
+ * DESCRIBE, SERVICE, RAND(), NOW(), UUID(), STRUUID() or BNODE(),
+ * data graphs read from an iostream, no data graphs and no world
+ * dataset, or a triples source factory registered with
+ * rasqal_set_triples_source_factory() are never cached.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_world_set_result_cache_size(rasqal_world* world, size_t max_bytes)
+{
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, 1);
+
+  if(!max_bytes) {
+    if(world->result_cache) {
+      rasqal_free_result_cache(world->result_cache);
+      world->result_cache = NULL;
+    }
+    return 0;
+  }
+
+  if(world->result_cache)
+    return rasqal_result_cache_set_max_bytes(world->result_cache, max_bytes);
+
+  world->result_cache = rasqal_new_result_cache(world, max_bytes);
+
+  return (world->result_cache == NULL);
+}
+
+
+/**
+ * rasqal_world_set_dataset_version:
+ * @world: world
+ * @version: dataset version
+ *
+ * Set the version of the data queried
+ *
+ * Changing the version drops every result held in the query result
+ * cache; see rasqal_world_set_result_cache_size().  Any value may be
+ * used such as a counter or a load timestamp; the default is 0.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_world_set_dataset_version(rasqal_world* world, unsigned int version)
+{
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, 1);
+
+  if(world->dataset_version != version) {
+    world->dataset_version = version;
+    rasqal_result_cache_flush(world->result_cache);
+  }
+
+  return 0;
+}
+
+
+/* create the world persistent dataset if not already present */
+static int
+rasqal_world_ensure_dataset(rasqal_world* world)
+{
+  if(!world->store) {
+    world->store = rasqal_new_store(world);
+    if(!world->store)
+      return 1;
+  }
+
+  if(!world->data_graphs) {
+    world->data_graphs = raptor_new_sequence((raptor_data_free_handler)rasqal_free_data_graph,
+                                             (raptor_data_print_handler)rasqal_data_graph_print);
+    if(!world->data_graphs)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/* add a graph name to the world dataset if not already present */
+static int
+rasqal_world_add_dataset_graph_name(rasqal_world* world, raptor_uri* name_uri)
+{
+  rasqal_data_graph* dg;
+  int i;
+
+  for(i = 0; (dg = (rasqal_data_graph*)raptor_sequence_get_at(world->data_graphs, i)); i++) {
+    if(raptor_uri_equals(dg->name_uri, name_uri))
+      return 0;
+  }
+
+  /* only the name is kept, for GRAPH in queries */
+  dg = rasqal_new_data_graph_from_uri(world, name_uri, name_uri,
+                                      RASQAL_DATA_GRAPH_NAMED,
+                                      NULL, NULL, NULL);
+  if(!dg)
+    return 1;
+
+  return raptor_sequence_push(world->data_graphs, dg);
+}
+
+
+/**
+ * rasqal_world_add_data_graph:
+ * @world: world
+ * @data_graph: data graph
+ *
+ * Add a data graph to the persistent dataset of the world
+ *
+ * The data graph is parsed once into an in-memory store held by the
+ * world.  Queries with no data graphs of their own (no FROM, FROM
+ * NAMED or rasqal_query_add_data_graph()) are run against this
+ * dataset instead of parsing their data per execution.  A named
+ * data graph is added to the graph of that name and a background
+ * one to the default graph.
+ *
+ * Data graphs may be added while queries run: a query that has
+ * started keeps seeing the dataset as it was then.  Adding a data
+ * graph changes the dataset version which flushes the query result
+ * cache; see rasqal_world_set_dataset_version().
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_world_add_data_graph(rasqal_world* world, rasqal_data_graph* data_graph)
+{
+  int rc;
+
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(world, rasqal_world, 1);
+  RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(data_graph, rasqal_data_graph, 1);
+
+  if(rasqal_world_ensure_dataset(world))
+    return 1;
+
+  rc = rasqal_store_append_data_graph(world->store, data_graph);
+  if(!rc && rasqal_store_merge(world->store) < 0)
+    rc = 1;
+
+  /* quads may have been added even on failure */
+  rasqal_world_set_dataset_version(world, world->dataset_version + 1);
+
+  if(!rc && data_graph->name_uri)
+    rc = rasqal_world_add_dataset_graph_name(world, data_graph->name_uri);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_world_execute_update:
+ * @world: world
+ * @query: prepared update query
+ *
+ * INTERNAL - Execute the update operations of a query on the world persistent dataset
+ *
+ * The dataset is created if there is none yet.  Queries already
+ * running keep seeing the dataset as it was when they started.  The
+ * dataset version is changed since operations before a failing one
+ * are kept.  Graphs created by the update are added to the named
+ * graphs of the dataset.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_world_execute_update(rasqal_world* world, rasqal_query* query)
+{
+  raptor_sequence* names;
+  raptor_uri* name;
+  int rc;
+  int i;
+
+  if(rasqal_world_ensure_dataset(world))
+    return 1;
+
+  rc = rasqal_query_execute_update(query, world->store);
+
+  rasqal_world_set_dataset_version(world, world->dataset_version + 1);
+
+  names = rasqal_store_get_graph_names(world->store);
+  if(!names)
+    return 1;
+
+  for(i = 0; !rc && (name = (raptor_uri*)raptor_sequence_get_at(names, i)); i++)
+    rc = rasqal_world_add_dataset_graph_name(world, name);
+
+  raptor_free_sequence(names);
+
+  return rc;
+}
+
+
 /**
  * rasqal_free_memory:
  * @ptr: memory pointer
@@ -703,6 +703,21 @@ rasqal_rowsource* rasqal_new_sort_rowsource(rasqal_world *world, rasqal_query *q
 /* rasqal_rowsource_triples.c */
 rasqal_rowsource* rasqal_new_triples_rowsource(rasqal_world *world, rasqal_query* query, rasqal_triples_source* triples_source, raptor_sequence* triples, int start_column, int end_column);
 
+/* rasqal_rowsource_diff.c */
+rasqal_rowsource* rasqal_new_diff_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* left, rasqal_rowsource* right, int keep_right);
+
+/* rasqal_rowsource_reduced.c */
+#define RASQAL_REDUCED_ROWSOURCE_DEFAULT_SIZE 1024
+rasqal_rowsource* rasqal_new_reduced_rowsource(rasqal_world *world, rasqal_query *query, rasqal_rowsource* rowsource, int size);
+
+/* rasqal_rowsource_materialize.c */
+typedef struct rasqal_materialization_s rasqal_materialization;
+
+rasqal_materialization* rasqal_new_materialization(rasqal_rowsource* rowsource);
+rasqal_materialization* rasqal_new_materialization_from_materialization(rasqal_materialization* m);
+void rasqal_free_materialization(rasqal_materialization* m);
+rasqal_rowsource* rasqal_new_materialize_rowsource(rasqal_world *world, rasqal_query *query, rasqal_materialization* materialization);
+
 /* rasqal_rowsource_union.c */
 rasqal_rowsource* rasqal_new_union_rowsource(rasqal_world *world, rasqal_query* query, rasqal_rowsource* left, rasqal_rowsource* right);
 
@@ -874,7 +889,8 @@ typedef struct rasqal_results_compare_s rasqal_results_compare;
  * Rowsource Internal flags
  *
  * RASQAL_ROWSOURCE_FLAGS_SAVE_ROWS: need to save all rows in
- * @rows_sequence for reset operation
+ * @rows_sequence for reset operation.  Only used for rowsources with
+ * no reset handler that are not below a materialize rowsource.
  *
  * RASQAL_ROWSOURCE_FLAGS_SAVED_ROWS: have saved rows ready for reply
  */
@@ -1087,6 +1103,25 @@ rasqal_triple* rasqal_dataset_triples_iterator_get(rasqal_dataset_triples_iterat
 int rasqal_dataset_triples_iterator_next(rasqal_dataset_triples_iterator* ti);
 int rasqal_dataset_print(rasqal_dataset* ds, FILE *fh);
 
+/* rasqal_store.c */
+typedef struct rasqal_store_s rasqal_store;
+
+rasqal_store* rasqal_new_store(rasqal_world* world);
+void rasqal_free_store(rasqal_store* store);
+int rasqal_store_get_size(rasqal_store* store);
+int rasqal_store_add_triple(rasqal_store* store, rasqal_triple* triple);
+int rasqal_store_remove_triple(rasqal_store* store, rasqal_triple* triple);
+int rasqal_store_apply(rasqal_store* store, raptor_sequence* deletes, raptor_sequence* inserts);
+int rasqal_store_clear_graph(rasqal_store* store, raptor_uri* graph, rasqal_update_graph_applies applies);
+int rasqal_store_add_graph(rasqal_store* store, raptor_uri* src_graph, raptor_uri* dest_graph);
+raptor_sequence* rasqal_store_get_graph_names(rasqal_store* store);
+int rasqal_store_load_data_graph(rasqal_store* store, rasqal_data_graph* dg);
+int rasqal_store_append_triple(rasqal_store* store, rasqal_triple* triple);
+int rasqal_store_append_data_graph(rasqal_store* store, rasqal_data_graph* dg);
+int rasqal_store_merge(rasqal_store* store);
+int rasqal_store_equals(rasqal_store* store1, rasqal_store* store2);
+rasqal_triples_source* rasqal_store_new_triples_source(rasqal_store* store, rasqal_query* query, raptor_uri* default_graph);
+
 
 /* rasqal_general.c */
 char* rasqal_vsnprintf(const char* message, va_list arguments);
@@ -1175,6 +1210,7 @@ int rasqal_query_expand_wildcards(rasqal_query* rq, rasqal_projection* projectio
 int rasqal_query_remove_duplicate_select_vars(rasqal_query* rq, rasqal_projection* projection);
 int rasqal_query_build_variables_use(rasqal_query* query, rasqal_projection* projection);
 int rasqal_query_prepare_common(rasqal_query *query);
+int rasqal_query_prepare_update_where(rasqal_query *query);
 int rasqal_query_merge_graph_patterns(rasqal_query* query, rasqal_graph_pattern* gp, void* data);
 int rasqal_graph_patterns_join(rasqal_graph_pattern *dest_gp, rasqal_graph_pattern *src_gp);
 int rasqal_graph_pattern_move_constraints(rasqal_graph_pattern* dest_gp, rasqal_graph_pattern* src_gp);
@@ -1191,6 +1227,7 @@ int rasqal_literal_as_integer(rasqal_literal* l, int* error_p);
 double rasqal_literal_as_double(rasqal_literal* l, int* error_p);
 raptor_uri* rasqal_literal_as_uri(rasqal_literal* l);
 int rasqal_literal_string_to_native(rasqal_literal *l, int flags);
+int rasqal_literal_ensure_native(rasqal_literal *l);
 int rasqal_literal_has_qname(rasqal_literal* l);
 int rasqal_literal_expand_qname(void* user_data, rasqal_literal* l);
 int rasqal_literal_is_constant(rasqal_literal* l);
@@ -1271,6 +1308,7 @@ time_t rasqal_timegm(struct tm *tm);
 
 /* rasqal_raptor.c */
 int rasqal_raptor_init(rasqal_world*);
+int rasqal_raptor_is_triples_source_factory(rasqal_world* world);
 
 #ifdef RAPTOR_TRIPLES_SOURCE_REDLAND
 /* rasqal_redland.c */
@@ -1280,6 +1318,8 @@ void rasqal_redland_finish(void);
 
 rasqal_triple* raptor_statement_as_rasqal_triple(rasqal_world* world, const raptor_statement *statement);
 int rasqal_raptor_triple_match(rasqal_world* world, rasqal_triple *triple, rasqal_triple *match, unsigned int parts);
+rasqal_triple_parts rasqal_raptor_triple_match_init(rasqal_triple* match, rasqal_triple_meta* m, rasqal_triple* t);
+rasqal_triple_parts rasqal_raptor_triple_bind(rasqal_triple* triple, rasqal_variable* bindings[4], rasqal_triple_parts parts);
 
 
 /* rasqal_general.c */
@@ -1323,6 +1363,8 @@ void rasqal_expression_write_op(rasqal_expression* e, raptor_iostream* iostr);
 void rasqal_expression_write(rasqal_expression* e, raptor_iostream* iostr);
 int rasqal_literal_write_turtle(rasqal_literal* l, raptor_iostream* iostr);
 int rasqal_literal_array_equals(rasqal_literal** values_a, rasqal_literal** values_b, int size);
+#define RASQAL_LITERAL_HASH_INIT 2166136261U
+unsigned int rasqal_literal_hash(rasqal_literal* l, unsigned int hash);
 int rasqal_literal_array_compare(rasqal_literal** values_a, rasqal_literal** values_b, raptor_sequence* exprs_seq, int size, int compare_flags);
 int rasqal_literal_array_compare_by_order(rasqal_literal** values_a, rasqal_literal** values_b, int* order, int size, int compare_flags);
 rasqal_map* rasqal_new_literal_sequence_sort_map(int is_distinct, int compare_flags);
@@ -1349,6 +1391,8 @@ void* rasqal_map_search(rasqal_map* map, const void* key);
 rasqal_query_results* rasqal_query_execute_with_engine(rasqal_query* query, const rasqal_query_execution_factory* engine);
 int rasqal_query_remove_query_result(rasqal_query* query, rasqal_query_results* query_results);
 int rasqal_query_declare_prefix(rasqal_query* rq, rasqal_prefix* prefix);
+int rasqal_query_uses_world_dataset(rasqal_query* query);
+rasqal_data_graph* rasqal_query_get_dataset_graph(rasqal_query* query, int idx);
 int rasqal_query_declare_prefixes(rasqal_query* rq);
 void rasqal_query_set_base_uri(rasqal_query* rq, raptor_uri* base_uri);
 rasqal_variable* rasqal_query_get_variable_by_offset(rasqal_query* query, int idx);
@@ -1387,12 +1431,31 @@ void rasqal_free_query_results_format_factory(rasqal_query_results_format_factor
 int rasqal_init_result_formats(rasqal_world*);
 void rasqal_finish_result_formats(rasqal_world*);
 
+/* rasqal_escape.c */
+int rasqal_iostream_write_csv_string(const unsigned char *string, size_t len, raptor_iostream *iostr);
+int rasqal_iostream_write_ntriples_string(const unsigned char *string, size_t len, const char delim, raptor_iostream *iostr);
+void rasqal_xml_writer_write_cdata(raptor_xml_writer* xml_writer, const unsigned char *string, size_t len);
+
+/* rasqal_utf8.c */
+size_t rasqal_utf8_ascii_span(const unsigned char* string, size_t len);
+int rasqal_utf8_strlen(const unsigned char* string, size_t len);
+const unsigned char* rasqal_utf8_substr(const unsigned char* string, size_t len, int start, int length, size_t* view_len_p);
+void rasqal_utf8_set_case(unsigned char* dest, const unsigned char* string, size_t len, int upper);
+const unsigned char* rasqal_utf8_find(const unsigned char* haystack, size_t haystack_len, const unsigned char* needle, size_t needle_len);
+size_t rasqal_utf8_encode_for_uri(unsigned char* dest, const unsigned char* string, size_t len);
+
 /* rasqal_format_sv.c */
 int rasqal_init_result_format_sv(rasqal_world* world);
 
 /* rasqal_format_json.c */
 int rasqal_init_result_format_json(rasqal_world*);
 
+/* rasqal_format_binary.c */
+int rasqal_init_result_format_binary(rasqal_world*);
+
+/* rasqal_format_arrow.c */
+int rasqal_init_result_format_arrow(rasqal_world*);
+
 /* rasqal_format_sparql_xml.c */
 int rasqal_init_result_format_sparql_xml(rasqal_world*);
 
@@ -1442,8 +1505,19 @@ rasqal_triple_parts rasqal_triples_match_bind_match(struct rasqal_triples_match_
 void rasqal_triples_match_next_match(struct rasqal_triples_match_s* rtm);
 int rasqal_triples_match_is_end(struct rasqal_triples_match_s* rtm);
 
+/* rasqal_describe.c */
+typedef struct rasqal_describe_s rasqal_describe;
+
+rasqal_describe* rasqal_new_describe(rasqal_query* query, rasqal_triples_source* triples_source);
+void rasqal_free_describe(rasqal_describe* describe);
+int rasqal_describe_add_resource(rasqal_describe* describe, rasqal_literal* resource);
+int rasqal_describe_next_triple(rasqal_describe* describe, rasqal_triple* triple);
+
 
 /* rasqal_xsd_datatypes.c */
+/* size of rasqal_world XSD datatype local name hash: power of 2 */
+#define RASQAL_XSD_DATATYPE_HASH_SIZE 64
+
 int rasqal_xsd_init(rasqal_world*);
 void rasqal_xsd_finish(rasqal_world*);
 rasqal_literal_type rasqal_xsd_datatype_uri_to_type(rasqal_world*, raptor_uri* uri);
@@ -1463,6 +1537,8 @@ int rasqal_xsd_boolean_value_from_string(const unsigned char* string);
 
 typedef struct rasqal_graph_factory_s rasqal_graph_factory;
 
+typedef struct rasqal_result_cache_s rasqal_result_cache;
+
 /* rasqal_world structure */
 struct rasqal_world_s {
   /* opened flag */
@@ -1492,10 +1568,15 @@ struct rasqal_world_s {
 
   /* triples source factory */
   rasqal_triples_source_factory triples_source_factory;
+  /* function that registered @triples_source_factory */
+  rasqal_triples_source_factory_register_fn triples_source_factory_register_fn;
 
   /* rasqal_xsd_datatypes */
   raptor_uri *xsd_namespace_uri;
   raptor_uri **xsd_datatype_uris;
+  /* hash of XSD datatype local names to their xsd_datatype_uris
+   * index or 0 if empty */
+  unsigned char xsd_datatype_hash[RASQAL_XSD_DATATYPE_HASH_SIZE];
 
   /* graph factory */
   rasqal_graph_factory *graph_factory;
@@ -1515,6 +1596,20 @@ struct rasqal_world_s {
 
   rasqal_warning_level warning_level;
 
+  /* maximum number of threads loading N-Triples data graphs; >= 1 */
+  int load_threads;
+
+  /* query result cache or NULL when disabled */
+  rasqal_result_cache* result_cache;
+
+  /* version of the data queried; changing it flushes @result_cache */
+  unsigned int dataset_version;
+
+  /* persistent dataset added by rasqal_world_add_data_graph() or NULL */
+  rasqal_store* store;
+  /* named graphs in @store: sequence of #rasqal_data_graph or NULL */
+  raptor_sequence* data_graphs;
+
   /* generated counter - increments at every generation */
   int genid_counter;
 };
@@ -1679,6 +1774,7 @@ typedef struct
 
 rasqal_algebra_node* rasqal_new_assignment_algebra_node(rasqal_query* query, rasqal_variable *var, rasqal_expression *expr);
 rasqal_algebra_node* rasqal_new_distinct_algebra_node(rasqal_query* query, rasqal_algebra_node* node1);
+rasqal_algebra_node* rasqal_new_reduced_algebra_node(rasqal_query* query, rasqal_algebra_node* node1);
 rasqal_algebra_node* rasqal_new_filter_algebra_node(rasqal_query* query, rasqal_expression* expr, rasqal_algebra_node* node);
 rasqal_algebra_node* rasqal_new_empty_algebra_node(rasqal_query* query);
 rasqal_algebra_node* rasqal_new_triples_algebra_node(rasqal_query* query, raptor_sequence* triples, int start_column, int end_column);
@@ -1712,6 +1808,8 @@ rasqal_algebra_node* rasqal_algebra_query_add_construct_projection(rasqal_query*
 rasqal_algebra_node* rasqal_algebra_query_add_distinct(rasqal_query* query, rasqal_algebra_node* node, rasqal_projection* projection);
 rasqal_algebra_node* rasqal_algebra_query_add_having(rasqal_query* query, rasqal_algebra_node* node, rasqal_solution_modifier* modifier);
 int rasqal_algebra_node_is_empty(rasqal_algebra_node* node);
+int rasqal_algebra_node_is_volatile(rasqal_query* query, rasqal_algebra_node* node);
+int rasqal_algebra_node_is_correlated(rasqal_query* query, rasqal_algebra_node* node);
 
 rasqal_algebra_aggregate* rasqal_algebra_query_prepare_aggregates(rasqal_query* query, rasqal_algebra_node* node, rasqal_projection* projection, rasqal_solution_modifier* modifier);
 void rasqal_free_algebra_aggregate(rasqal_algebra_aggregate* ae);
@@ -1799,6 +1897,13 @@ struct rasqal_query_execution_factory_s {
   /* finish the query execution factory */
   void (*finish_factory)(rasqal_query_execution_factory* factory);
 
+  /*
+   * @ex_data: execution data
+   *
+   * Get the triples source the execution matches against (shared) or NULL
+   */
+  rasqal_triples_source* (*get_triples_source)(void* ex_data);
+
 };
 
 
@@ -1820,6 +1925,7 @@ int rasqal_engine_rowsort_calculate_order_values(rasqal_query* query, raptor_seq
 
 /* New query engine based on executing over query algebra */
 extern const rasqal_query_execution_factory rasqal_query_engine_algebra;
+rasqal_rowsource* rasqal_algebra_query_to_rowsource(rasqal_query* query, rasqal_triples_source* triples_source, rasqal_algebra_node** node_p);
 
 /* rasqal_iostream.c */
 raptor_iostream* rasqal_new_iostream_from_stringbuffer(raptor_world *raptor_world_ptr, raptor_stringbuffer* sb);
@@ -1837,6 +1943,8 @@ rasqal_update_operation* rasqal_new_update_operation(rasqal_update_type type, ra
 void rasqal_free_update_operation(rasqal_update_operation *update);
 int rasqal_update_operation_print(rasqal_update_operation *update, FILE* stream);
 int rasqal_query_add_update_operation(rasqal_query* query, rasqal_update_operation *update);
+int rasqal_query_execute_update(rasqal_query* query, rasqal_store* store);
+int rasqal_world_execute_update(rasqal_world* world, rasqal_query* query);
 
 
 /* rasqal_bindings.c */
@@ -1850,6 +1958,35 @@ rasqal_row* rasqal_bindings_get_row(rasqal_bindings* bindings, int offset);
 /* rasqal_ntriples.c */
 rasqal_literal* rasqal_new_literal_from_ntriples_counted_string(rasqal_world* world, unsigned char* string, size_t length);
 
+/* rasqal_ntriples_load.c */
+/**
+ * rasqal_ntriples_load_handler:
+ * @user_data: user data
+ * @index: index of the data graph the triple is from
+ * @triple: triple (ownership passed to the handler)
+ *
+ * Handler for triples merged by rasqal_ntriples_load_merge_data_graph()
+ *
+ * Return value: non-0 on failure
+ */
+typedef int (*rasqal_ntriples_load_handler)(void* user_data, int index, rasqal_triple* triple);
+
+typedef struct rasqal_ntriples_load_s rasqal_ntriples_load;
+
+rasqal_ntriples_load* rasqal_new_ntriples_load(rasqal_world* world, raptor_sequence* data_graphs, int threads);
+void rasqal_free_ntriples_load(rasqal_ntriples_load* load);
+int rasqal_ntriples_load_has_data_graph(rasqal_ntriples_load* load, int index);
+int rasqal_ntriples_load_merge_data_graph(rasqal_ntriples_load* load, int index, const unsigned char* bnode_prefix, rasqal_ntriples_load_handler handler, void* user_data);
+
+/* rasqal_result_cache.c */
+rasqal_result_cache* rasqal_new_result_cache(rasqal_world* world, size_t max_bytes);
+void rasqal_free_result_cache(rasqal_result_cache* cache);
+int rasqal_result_cache_set_max_bytes(rasqal_result_cache* cache, size_t max_bytes);
+void rasqal_result_cache_flush(rasqal_result_cache* cache);
+unsigned char* rasqal_result_cache_new_key(rasqal_query* query, rasqal_algebra_node* node, size_t* key_len_p);
+rasqal_rowsource* rasqal_result_cache_lookup(rasqal_result_cache* cache, rasqal_query* query, const unsigned char* key, size_t key_len);
+rasqal_rowsource* rasqal_new_result_cache_rowsource(rasqal_result_cache* cache, rasqal_query* query, rasqal_rowsource* rowsource, unsigned char* key, size_t key_len);
+
 /* rasqal_projection.c */
 rasqal_projection* rasqal_new_projection(rasqal_query* query, raptor_sequence* variables, int wildcard, int distinct);
 void rasqal_free_projection(rasqal_projection* projection);
@@ -1863,6 +2000,8 @@ int rasqal_regex_match(rasqal_world* world, raptor_locator* locator, const char*
 rasqal_results_compare* rasqal_new_results_compare(rasqal_world* world, rasqal_query_results *first_qr, const char* first_qr_label, rasqal_query_results *second_qr, const char* second_qr_label);
 void rasqal_free_results_compare(rasqal_results_compare* rrc);
 void rasqal_results_compare_set_log_handler(rasqal_results_compare* rrc, void* log_user_data, raptor_log_handler log_handler);
+void rasqal_results_compare_set_unordered(rasqal_results_compare* rrc, int unordered);
+void rasqal_results_compare_set_max_differences(rasqal_results_compare* rrc, int max_differences);
 int rasqal_results_compare_compare(rasqal_results_compare* rrc);
 rasqal_variable* rasqal_results_compare_get_variable_by_offset(rasqal_results_compare* rrc, int idx);
 int rasqal_results_compare_get_variable_offset_for_result(rasqal_results_compare* rrc, int var_idx, int qr_index);
@@ -842,6 +842,29 @@ rasqal_literal_string_to_native(rasqal_literal *l, int flags)
     return 0;
   }
 
+  if(native_type == RASQAL_LITERAL_DECIMAL ||
+     native_type == RASQAL_LITERAL_DATETIME ||
+     native_type == RASQAL_LITERAL_DATE) {
+    /* already promoted */
+    if(l->type == native_type)
+      return rasqal_literal_ensure_native(l);
+
+    if(!canonicalize) {
+      /* Keep the lexical form and make the native value on first
+       * use with rasqal_literal_ensure_native() */
+      l->valid = rasqal_xsd_datatype_check(native_type, l->string, 0);
+      if(!l->valid) {
+        l->type = RASQAL_LITERAL_UDT;
+        return 0;
+      }
+
+      l->type = native_type;
+      l->parent_type = rasqal_xsd_datatype_parent_type(native_type);
+      l->native_lazy = 1;
+      return 0;
+    }
+  }
+
   rc = rasqal_literal_set_typed_value(l, native_type,
                                       NULL /* existing string */,
                                       canonicalize);
@@ -853,6 +876,104 @@ rasqal_literal_string_to_native(rasqal_literal *l, int flags)
 }
 
 
+/*
+ * rasqal_literal_ensure_native:
+ * @l: #rasqal_literal to operate on inline
+ *
+ * INTERNAL - Make the native value of a lazily promoted literal
+ *
+ * Decimal, dateTime and date literals promoted without
+ * canonicalization by rasqal_literal_string_to_native() only have
+ * their native value parsed from the lexical form here, when it is
+ * first needed.  The lexical form is then replaced by the canonical
+ * one as rasqal_literal_set_typed_value() does, so the literal is
+ * the same as one promoted eagerly.  Does nothing for any other
+ * literal.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+rasqal_literal_ensure_native(rasqal_literal *l)
+{
+  const char* string;
+  unsigned char* new_string = NULL;
+  size_t slen = 0;
+
+  if(!l || !l->native_lazy)
+    return 0;
+
+  string = RASQAL_GOOD_CAST(const char*, l->string);
+
+  switch(l->type) {
+    case RASQAL_LITERAL_DECIMAL:
+      if(!l->value.decimal) {
+        rasqal_xsd_decimal* d;
+
+        d = rasqal_new_xsd_decimal(l->world);
+        if(!d)
+          return 1;
+
+        if(rasqal_xsd_decimal_set_string(d, string)) {
+          rasqal_free_xsd_decimal(d);
+          return 1;
+        }
+        l->value.decimal = d;
+      }
+
+      /* new string is owned by l->value.decimal */
+      new_string = RASQAL_GOOD_CAST(unsigned char*, rasqal_xsd_decimal_as_counted_string(l->value.decimal, &slen));
+      break;
+
+    case RASQAL_LITERAL_DATETIME:
+      if(!l->value.datetime) {
+        l->value.datetime = rasqal_new_xsd_datetime(l->world, string);
+        if(!l->value.datetime)
+          return 1;
+      }
+
+      new_string = RASQAL_GOOD_CAST(unsigned char*, rasqal_xsd_datetime_to_counted_string(l->value.datetime, &slen));
+      break;
+
+    case RASQAL_LITERAL_DATE:
+      if(!l->value.date) {
+        l->value.date = rasqal_new_xsd_date(l->world, string);
+        if(!l->value.date)
+          return 1;
+      }
+
+      new_string = RASQAL_GOOD_CAST(unsigned char*, rasqal_xsd_date_to_counted_string(l->value.date, &slen));
+      break;
+
+    case RASQAL_LITERAL_UNKNOWN:
+    case RASQAL_LITERAL_BLANK:
+    case RASQAL_LITERAL_URI:
+    case RASQAL_LITERAL_STRING:
+    case RASQAL_LITERAL_XSD_STRING:
+    case RASQAL_LITERAL_BOOLEAN:
+    case RASQAL_LITERAL_INTEGER:
+    case RASQAL_LITERAL_FLOAT:
+    case RASQAL_LITERAL_DOUBLE:
+    case RASQAL_LITERAL_UDT:
+    case RASQAL_LITERAL_PATTERN:
+    case RASQAL_LITERAL_QNAME:
+    case RASQAL_LITERAL_VARIABLE:
+    case RASQAL_LITERAL_INTEGER_SUBTYPE:
+    default:
+      return 0;
+  }
+
+  if(!new_string)
+    return 1;
+
+  RASQAL_FREE(char*, l->string);
+  l->string = new_string;
+  l->string_len = RASQAL_BAD_CAST(unsigned int, slen);
+  l->native_lazy = 0;
+
+  return 0;
+}
+
+
 /*
  * rasqal_new_string_literal_common:
  * @world: rasqal world object
@@ -1202,7 +1323,10 @@ rasqal_free_literal(rasqal_literal* l)
       break;
 
     case RASQAL_LITERAL_DECIMAL:
-      /* l->string is owned by l->value.decimal - do not free it */
+      /* l->string is owned by l->value.decimal - do not free it
+       * unless the decimal value was made lazily */
+      if(l->native_lazy && l->string)
+        RASQAL_FREE(char*, l->string);
       if(l->datatype)
         raptor_free_uri(l->datatype);
       if(l->value.decimal)
@@ -1342,6 +1466,8 @@ rasqal_literal_write(rasqal_literal* l, raptor_iostream* iostr)
     return;
   }
 
+  rasqal_literal_ensure_native(l);
+
   if(!l->valid)
     raptor_iostream_counted_string_write("INV:", 4, iostr);
 
@@ -1562,9 +1688,11 @@ rasqal_literal_as_integer(rasqal_literal* l, int *error_p)
 
     case RASQAL_LITERAL_DECIMAL:
       {
-        int error = 0;
-        
-        long lvalue = rasqal_xsd_decimal_get_long(l->value.decimal, &error);
+        int error = rasqal_literal_ensure_native(l);
+        long lvalue = 0;
+
+        if(!error)
+          lvalue = rasqal_xsd_decimal_get_long(l->value.decimal, &error);
         if(lvalue < INT_MIN || lvalue > INT_MAX)
           error = 1;
 
@@ -1657,6 +1785,10 @@ rasqal_literal_as_double(rasqal_literal* l, int *error_p)
       return l->value.floating;
 
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        *error_p = 1;
+        return 0.0;
+      }
       return rasqal_xsd_decimal_get_double(l->value.decimal);
 
     case RASQAL_LITERAL_STRING:
@@ -1742,6 +1874,12 @@ rasqal_literal_as_counted_string(rasqal_literal* l, size_t *len_p,
       *error_p = 1;
     return NULL;
   }
+
+  if(rasqal_literal_ensure_native(l)) {
+    if(error_p)
+      *error_p = 1;
+    return NULL;
+  }
   
   switch(l->type) {
     case RASQAL_LITERAL_XSD_STRING:
@@ -2032,6 +2170,9 @@ rasqal_new_literal_from_promotion(rasqal_literal* lit,
   
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(lit, rasqal_literal, NULL);
 
+  if(rasqal_literal_ensure_native(lit))
+    return NULL;
+
   if(lit->type == type)
     return rasqal_new_literal_from_literal(lit);
 
@@ -2519,6 +2660,11 @@ rasqal_literal_compare(rasqal_literal* l1, rasqal_literal* l2, int flags,
       }
     } else {
       new_lits[i] = lits[i];
+      if(rasqal_literal_ensure_native(new_lits[i])) {
+        if(error_p)
+          *error_p = 1;
+        goto done;
+      }
     }
   }
 
@@ -2890,6 +3036,12 @@ rasqal_literal_equals_flags(rasqal_literal* l1, rasqal_literal* l2,
   } else {
     l1_p = l1;
     l2_p = l2;
+    if(rasqal_literal_ensure_native(l1_p) ||
+       rasqal_literal_ensure_native(l2_p)) {
+      if(error_p)
+        *error_p = 1;
+      goto tidy;
+    }
   }
 
   switch(type) {
@@ -3067,6 +3219,9 @@ rasqal_literal_as_node(rasqal_literal* l)
   
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(l, rasqal_literal, NULL);
 
+  if(rasqal_literal_ensure_native(l))
+    return NULL;
+
   reswitch:
   switch(l->type) {
     case RASQAL_LITERAL_URI:
@@ -3177,6 +3332,7 @@ rasqal_literal_ebv(rasqal_literal* l)
     /* ... The operand is any numeric type with a value of 0. */
     b = 0;
   } else if(l->type == RASQAL_LITERAL_DECIMAL &&
+            !rasqal_literal_ensure_native(l) &&
             rasqal_xsd_decimal_is_zero(l->value.decimal)) {
     /* ... The operand is any numeric type with a value of 0 (decimal) */
     b = 0;
@@ -3827,6 +3983,10 @@ rasqal_literal_negate(rasqal_literal* l, int *error_p)
       break;
       
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        error = 1;
+        break;
+      }
       dec = rasqal_new_xsd_decimal(l->world);
       if(rasqal_xsd_decimal_negate(dec, l->value.decimal)) {
         error = 1;
@@ -3897,6 +4057,10 @@ rasqal_literal_abs(rasqal_literal* l, int *error_p)
       break;
       
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        error = 1;
+        break;
+      }
       dec = rasqal_new_xsd_decimal(l->world);
       if(rasqal_xsd_decimal_abs(dec, l->value.decimal)) {
         error = 1;
@@ -3962,6 +4126,10 @@ rasqal_literal_round(rasqal_literal* l, int *error_p)
       break;
       
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        error = 1;
+        break;
+      }
       dec = rasqal_new_xsd_decimal(l->world);
       if(rasqal_xsd_decimal_round(dec, l->value.decimal)) {
         error = 1;
@@ -4027,6 +4195,10 @@ rasqal_literal_ceil(rasqal_literal* l, int *error_p)
       break;
       
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        error = 1;
+        break;
+      }
       dec = rasqal_new_xsd_decimal(l->world);
       if(rasqal_xsd_decimal_ceil(dec, l->value.decimal)) {
         error = 1;
@@ -4092,6 +4264,10 @@ rasqal_literal_floor(rasqal_literal* l, int *error_p)
       break;
       
     case RASQAL_LITERAL_DECIMAL:
+      if(rasqal_literal_ensure_native(l)) {
+        error = 1;
+        break;
+      }
       dec = rasqal_new_xsd_decimal(l->world);
       if(rasqal_xsd_decimal_floor(dec, l->value.decimal)) {
         error = 1;
@@ -4294,6 +4470,9 @@ rasqal_literal_write_turtle(rasqal_literal* l, raptor_iostream* iostr)
   if(!l)
     return rc;
 
+  if(rasqal_literal_ensure_native(l))
+    return 1;
+
   switch(l->type) {
     case RASQAL_LITERAL_URI:
       str = RASQAL_GOOD_CAST(const unsigned char*, raptor_uri_as_counted_string(l->value.uri, &len));
@@ -4535,6 +4714,43 @@ rasqal_literal_array_equals(rasqal_literal** values_a,
 }
 
 
+/**
+ * rasqal_literal_hash:
+ * @l: literal or NULL
+ * @hash: hash of preceding values or %RASQAL_LITERAL_HASH_INIT
+ *
+ * INTERNAL - fold a literal into a hash value
+ *
+ * Literals that are equal as RDF terms (%RASQAL_COMPARE_RDF) give the
+ * same hash so this can key hash tables checked with
+ * rasqal_literal_equals_flags() or rasqal_literal_array_equals().
+ *
+ * Return value: new hash value
+ */
+unsigned int
+rasqal_literal_hash(rasqal_literal* l, unsigned int hash)
+{
+  const unsigned char* p;
+
+  /* FNV-1a over the RDF term type and the lexical form */
+  hash ^= RASQAL_GOOD_CAST(unsigned int, rasqal_literal_get_rdf_term_type(l));
+  hash *= 16777619U;
+
+  if(!l)
+    return hash;
+
+  p = rasqal_literal_as_string(l);
+  if(p) {
+    while(*p) {
+      hash ^= *p++;
+      hash *= 16777619U;
+    }
+  }
+
+  return hash;
+}
+
+
 /**
  * rasqal_literal_sequence_equals:
  * @values_a: first sequence of literals
@@ -4969,6 +5185,112 @@ static const char* const data_3x6_2_duplicate_rows[] =
 
 
 
+/* typed lexical forms for the lazy promotion tests */
+#define LAZY_TESTS_COUNT 4
+static const struct {
+  rasqal_literal_type dt_type;
+  const char* lexical;
+  rasqal_literal_type expected_type;
+  const char* equal_to;
+} lazy_test_data[LAZY_TESTS_COUNT] = {
+  { RASQAL_LITERAL_DECIMAL, "1.50", RASQAL_LITERAL_DECIMAL, "1.5" },
+  { RASQAL_LITERAL_DATETIME, "2004-12-31T19:01:00.000Z",
+    RASQAL_LITERAL_DATETIME, "2004-12-31T19:01:00Z" },
+  { RASQAL_LITERAL_DATE, "2004-12-31", RASQAL_LITERAL_DATE, "2004-12-31" },
+  { RASQAL_LITERAL_DECIMAL, "abc", RASQAL_LITERAL_UDT, NULL }
+};
+
+
+static rasqal_literal*
+make_typed_literal(rasqal_world* world, rasqal_literal_type dt_type,
+                   const char* lexical, int canonicalize)
+{
+  size_t len = strlen(lexical);
+  unsigned char* str;
+  raptor_uri* dt_uri;
+
+  str = RASQAL_MALLOC(unsigned char*, len + 1);
+  if(!str)
+    return NULL;
+  memcpy(str, lexical, len + 1);
+  dt_uri = raptor_uri_copy(rasqal_xsd_datatype_type_to_uri(world, dt_type));
+
+  if(canonicalize)
+    return rasqal_new_string_literal_node(world, str, NULL, dt_uri);
+
+  return rasqal_new_string_literal(world, str, NULL, dt_uri, NULL);
+}
+
+
+static int
+test_lazy_promotion(rasqal_world* world, const char* program)
+{
+  int failures = 0;
+  int i;
+
+  for(i = 0; i < LAZY_TESTS_COUNT; i++) {
+    rasqal_literal* l;
+    rasqal_literal* l2 = NULL;
+    int error = 0;
+
+    l = make_typed_literal(world, lazy_test_data[i].dt_type,
+                           lazy_test_data[i].lexical, 0);
+    if(!l) {
+      fprintf(stderr, "%s: lazy test %d failed to create literal\n",
+              program, i);
+      failures++;
+      continue;
+    }
+
+    if(l->type != lazy_test_data[i].expected_type) {
+      fprintf(stderr, "%s: lazy test %d literal has type %s expected %s\n",
+              program, i, rasqal_literal_type_label(l->type),
+              rasqal_literal_type_label(lazy_test_data[i].expected_type));
+      failures++;
+      goto next;
+    }
+
+    if(!lazy_test_data[i].equal_to)
+      goto next;
+
+    if(!l->native_lazy || l->value.decimal) {
+      fprintf(stderr, "%s: lazy test %d native value was made eagerly\n",
+              program, i);
+      failures++;
+      goto next;
+    }
+
+    l2 = make_typed_literal(world, lazy_test_data[i].dt_type,
+                            lazy_test_data[i].equal_to, 1);
+    if(!l2 ||
+       !rasqal_literal_equals_flags(l, l2, RASQAL_COMPARE_XQUERY, &error) ||
+       error) {
+      fprintf(stderr, "%s: lazy test %d literal %s is not equal to %s\n",
+              program, i, lazy_test_data[i].lexical,
+              lazy_test_data[i].equal_to);
+      failures++;
+      goto next;
+    }
+
+    /* native value is now made and the lexical form is canonical */
+    if(!l->value.decimal || l->native_lazy ||
+       strcmp(RASQAL_GOOD_CAST(const char*, l->string),
+              lazy_test_data[i].equal_to)) {
+      fprintf(stderr, "%s: lazy test %d literal has string %s value %p\n",
+              program, i, l->string, l->value.decimal);
+      failures++;
+    }
+
+  next:
+    if(l2)
+      rasqal_free_literal(l2);
+    rasqal_free_literal(l);
+  }
+
+  return failures;
+}
+
+
 #define TESTS_COUNT 3
 
 static const struct {
@@ -5066,7 +5388,9 @@ main(int argc, char *argv[])
       failures++;
     }
   }
-  
+
+  fprintf(stderr, "%s: Testing lazy native value promotion\n", program);
+  failures += test_lazy_promotion(world, program);
 
   tidy:
   rasqal_free_world(world);
@@ -0,0 +1,1058 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_ntriples_load.c - Rasqal parallel N-Triples data graph loading
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+#ifdef TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# ifdef HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define RASQAL_NTRIPLES_LOAD_THREADS 1
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+#ifndef HAVE_GETTIMEOFDAY
+#define gettimeofday(x,y) rasqal_gettimeofday(x,y)
+#endif
+
+
+/*
+ * Loading works in two phases:
+ *
+ * 1. Scan: each N-Triples file is split into chunks at line
+ *    boundaries.  Chunks are read and split into N-Triples term
+ *    strings by a pool of worker threads into per-chunk buffers.  The
+ *    workers only use their own chunk and the C library; rasqal and
+ *    raptor objects are reference counted without locking so no
+ *    terms are made here.
+ *
+ * 2. Merge: on the calling thread, the caller asks for each data
+ *    graph in dataset order, so N-Triples files can be merged between
+ *    data graphs the caller parses itself.  The chunks of the file
+ *    are walked in order and the term strings turned into literals
+ *    through a small term cache, so repeated IRIs such as predicates
+ *    are parsed and allocated once.  The triples are passed to the
+ *    caller's handler.
+ */
+
+/* files smaller than this are not split */
+#define RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE (1L << 20)
+
+/* number of entries in the merge term cache: power of 2 */
+#define RASQAL_NTRIPLES_LOAD_CACHE_SIZE 4096
+
+#ifdef STANDALONE
+static long rasqal_ntriples_load_min_chunk_size = RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE;
+#undef RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE
+#define RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE rasqal_ntriples_load_min_chunk_size
+#endif
+
+
+/* the lines of one N-Triples file starting in the byte range [start, end) */
+typedef struct {
+  /* index of the data graph */
+  int index;
+  const char* filename;
+  long start;
+  long end;
+
+  /* term strings, each NUL terminated, three per triple */
+  unsigned char* terms;
+  size_t terms_len;
+  size_t terms_size;
+
+  /* offsets of the term strings into @terms */
+  size_t* offsets;
+  int offsets_count;
+  int offsets_size;
+
+  /* lines scanned */
+  int lines;
+
+  /* first error: message and line in this chunk (counting from 1) */
+  const char* error;
+  int error_line;
+} rasqal_ntriples_chunk;
+
+
+typedef struct {
+  const unsigned char* string;
+  size_t length;
+  /* data graph index for blank nodes, else -1 */
+  int index;
+  rasqal_literal* literal;
+} rasqal_ntriples_cache_entry;
+
+
+struct rasqal_ntriples_load_s {
+  rasqal_world* world;
+  raptor_sequence* data_graphs;
+
+  /* filename per data graph or NULL if it is not scanned here */
+  char** filenames;
+  int data_graphs_count;
+  int files;
+
+  rasqal_ntriples_chunk* chunks;
+  int chunks_count;
+
+  /* next chunk to scan */
+  int next_chunk;
+#ifdef RASQAL_NTRIPLES_LOAD_THREADS
+  pthread_mutex_t lock;
+#endif
+
+  int threads_used;
+  double scan_time;
+
+  /* merge term cache shared by all files */
+  rasqal_ntriples_cache_entry* cache;
+
+  /* files merged, triples made and merge time so far */
+  int files_merged;
+  int triples;
+  double merge_time;
+};
+
+
+/*
+ * rasqal_ntriples_load_data_graph_filename:
+ * @dg: data graph
+ *
+ * INTERNAL - Get the filename of a data graph if it is an N-Triples file
+ *
+ * Return value: filename to free with raptor_free_memory() or NULL
+ */
+static char*
+rasqal_ntriples_load_data_graph_filename(rasqal_data_graph* dg)
+{
+  const unsigned char* uri_string;
+  size_t len;
+
+  if(dg->iostr || !dg->uri)
+    return NULL;
+
+  uri_string = raptor_uri_as_string(dg->uri);
+  if(!raptor_uri_uri_string_is_file_uri(uri_string))
+    return NULL;
+
+  if(dg->format_name) {
+    if(strcmp(dg->format_name, "ntriples"))
+      return NULL;
+  } else {
+    len = strlen(RASQAL_GOOD_CAST(const char*, uri_string));
+    if(len < 3 || strcmp(RASQAL_GOOD_CAST(const char*, uri_string) + len - 3,
+                         ".nt"))
+      return NULL;
+  }
+
+  return raptor_uri_uri_string_to_filename(uri_string);
+}
+
+
+/* grow a buffer from @old_size to @new_size bytes; frees @ptr on failure */
+static void*
+rasqal_ntriples_load_grow(void* ptr, size_t old_size, size_t new_size)
+{
+  void* new_ptr;
+
+  new_ptr = RASQAL_MALLOC(void*, new_size);
+  if(ptr) {
+    if(new_ptr)
+      memcpy(new_ptr, ptr, old_size);
+    RASQAL_FREE(void*, ptr);
+  }
+
+  return new_ptr;
+}
+
+
+static int
+rasqal_ntriples_chunk_add_term(rasqal_ntriples_chunk* chunk,
+                               const unsigned char* term, size_t len)
+{
+  if(chunk->offsets_count == chunk->offsets_size) {
+    int new_size = chunk->offsets_size ? chunk->offsets_size << 1 : 1024;
+
+    chunk->offsets = (size_t*)rasqal_ntriples_load_grow(chunk->offsets,
+                                                        RASQAL_GOOD_CAST(size_t, chunk->offsets_size) * sizeof(size_t),
+                                                        RASQAL_GOOD_CAST(size_t, new_size) * sizeof(size_t));
+    if(!chunk->offsets) {
+      chunk->offsets_size = chunk->offsets_count = 0;
+      return 1;
+    }
+    chunk->offsets_size = new_size;
+  }
+
+  if(chunk->terms_len + len + 1 > chunk->terms_size) {
+    size_t new_size = chunk->terms_size ? chunk->terms_size : 16384;
+
+    while(chunk->terms_len + len + 1 > new_size)
+      new_size <<= 1;
+    chunk->terms = (unsigned char*)rasqal_ntriples_load_grow(chunk->terms,
+                                                             chunk->terms_len,
+                                                             new_size);
+    if(!chunk->terms) {
+      chunk->terms_size = chunk->terms_len = 0;
+      chunk->offsets_count = 0;
+      return 1;
+    }
+    chunk->terms_size = new_size;
+  }
+
+  chunk->offsets[chunk->offsets_count++] = chunk->terms_len;
+  memcpy(chunk->terms + chunk->terms_len, term, len);
+  chunk->terms_len += len;
+  chunk->terms[chunk->terms_len++] = '\0';
+
+  return 0;
+}
+
+
+#define NTRIPLES_IS_SPACE(c) ((c) == ' ' || (c) == '\t' || (c) == '\r')
+
+/*
+ * rasqal_ntriples_scan_term:
+ * @p: start of term
+ * @end: end of line
+ *
+ * INTERNAL - Find the end of an N-Triples term
+ *
+ * Only the extent of the term is found here; the term syntax is
+ * checked when it is turned into a literal.
+ *
+ * Return value: pointer after the term or NULL on error
+ */
+static const unsigned char*
+rasqal_ntriples_scan_term(const unsigned char* p, const unsigned char* end)
+{
+  if(*p == '<') {
+    while(++p < end && *p != '>')
+      ;
+    return (p < end) ? p + 1 : NULL;
+  }
+
+  if(*p == '_') {
+    const unsigned char* start = p;
+
+    while(p < end && !NTRIPLES_IS_SPACE(*p) && *p != '<' && *p != '"')
+      p++;
+    /* a blank node label cannot end with '.' so it ends the triple */
+    if(p[-1] == '.')
+      p--;
+    return (p - start > 2 && start[1] == ':') ? p : NULL;
+  }
+
+  if(*p == '"') {
+    while(++p < end && *p != '"') {
+      if(*p == '\\')
+        p++;
+    }
+    if(p >= end)
+      return NULL;
+    p++;
+
+    if(p < end && *p == '@') {
+      while(++p < end && (*p == '-' ||
+                          (*p >= 'a' && *p <= 'z') ||
+                          (*p >= 'A' && *p <= 'Z') ||
+                          (*p >= '0' && *p <= '9')))
+        ;
+    } else if(p + 2 < end && p[0] == '^' && p[1] == '^' && p[2] == '<') {
+      p += 2;
+      while(++p < end && *p != '>')
+        ;
+      if(p >= end)
+        return NULL;
+      p++;
+    }
+    return p;
+  }
+
+  return NULL;
+}
+
+
+/* scan one line; returns non-0 and sets the chunk error on failure */
+static int
+rasqal_ntriples_scan_line(rasqal_ntriples_chunk* chunk,
+                          const unsigned char* p, const unsigned char* end)
+{
+  int i;
+
+  while(p < end && NTRIPLES_IS_SPACE(*p))
+    p++;
+  if(p == end || *p == '#')
+    return 0;
+
+  for(i = 0; i < 3; i++) {
+    const unsigned char* term_end;
+
+    while(p < end && NTRIPLES_IS_SPACE(*p))
+      p++;
+    if(p == end) {
+      chunk->error = "Incomplete triple";
+      return 1;
+    }
+
+    term_end = rasqal_ntriples_scan_term(p, end);
+    if(!term_end) {
+      chunk->error = "Bad N-Triples term";
+      return 1;
+    }
+
+    if(rasqal_ntriples_chunk_add_term(chunk, p, RASQAL_GOOD_CAST(size_t, term_end - p))) {
+      chunk->error = "Out of memory";
+      return 1;
+    }
+    p = term_end;
+  }
+
+  while(p < end && NTRIPLES_IS_SPACE(*p))
+    p++;
+  if(p == end || *p != '.') {
+    chunk->error = "Expected '.' at end of triple";
+    return 1;
+  }
+  p++;
+  while(p < end && NTRIPLES_IS_SPACE(*p))
+    p++;
+  if(p < end && *p != '#') {
+    chunk->error = "Unexpected text after triple";
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_ntriples_chunk_scan:
+ * @chunk: chunk
+ *
+ * INTERNAL - Read the lines of a chunk and split them into term strings
+ *
+ * A line belongs to the chunk its first byte is in, so the line
+ * running over the start is skipped and the one running over the
+ * end is read to its end.  Runs on a worker thread.
+ */
+static void
+rasqal_ntriples_chunk_scan(rasqal_ntriples_chunk* chunk)
+{
+  FILE* fh;
+  long pos;
+  int c;
+  unsigned char* buffer = NULL;
+  size_t len = 0;
+  size_t size;
+  unsigned char* line;
+  unsigned char* buffer_end;
+
+  fh = fopen(chunk->filename, "rb");
+  if(!fh) {
+    chunk->error = "Failed to open file";
+    return;
+  }
+
+  pos = chunk->start;
+  if(pos > 0) {
+    pos--;
+    if(fseek(fh, pos, SEEK_SET)) {
+      chunk->error = "Failed to seek in file";
+      goto tidy;
+    }
+    do {
+      c = getc(fh);
+      pos++;
+    } while(c != EOF && c != '\n');
+
+    if(c == EOF)
+      goto tidy;
+  }
+
+  if(pos >= chunk->end)
+    goto tidy;
+
+  size = RASQAL_GOOD_CAST(size_t, chunk->end - pos) + 1;
+  buffer = RASQAL_MALLOC(unsigned char*, size);
+  if(!buffer) {
+    chunk->error = "Out of memory";
+    goto tidy;
+  }
+  len = fread(buffer, 1, size - 1, fh);
+
+  /* finish the last line */
+  if(len == size - 1 && buffer[len - 1] != '\n') {
+    while((c = getc(fh)) != EOF) {
+      if(len == size) {
+        buffer = (unsigned char*)rasqal_ntriples_load_grow(buffer, size,
+                                                           size << 1);
+        if(!buffer) {
+          chunk->error = "Out of memory";
+          goto tidy;
+        }
+        size <<= 1;
+      }
+      buffer[len++] = RASQAL_GOOD_CAST(unsigned char, c);
+      if(c == '\n')
+        break;
+    }
+  }
+
+  buffer_end = buffer + len;
+  for(line = buffer; line < buffer_end; ) {
+    unsigned char* line_end;
+
+    line_end = RASQAL_GOOD_CAST(unsigned char*,
+                                memchr(line, '\n', RASQAL_GOOD_CAST(size_t, buffer_end - line)));
+    if(!line_end)
+      line_end = buffer_end;
+
+    chunk->lines++;
+    if(rasqal_ntriples_scan_line(chunk, line, line_end)) {
+      chunk->error_line = chunk->lines;
+      break;
+    }
+
+    line = line_end + 1;
+  }
+
+  tidy:
+  if(buffer)
+    RASQAL_FREE(char*, buffer);
+  fclose(fh);
+}
+
+
+/* take chunks to scan until there are none left */
+static void*
+rasqal_ntriples_load_worker(void* arg)
+{
+  rasqal_ntriples_load* load = (rasqal_ntriples_load*)arg;
+
+  while(1) {
+    int i;
+
+#ifdef RASQAL_NTRIPLES_LOAD_THREADS
+    pthread_mutex_lock(&load->lock);
+#endif
+    i = load->next_chunk++;
+#ifdef RASQAL_NTRIPLES_LOAD_THREADS
+    pthread_mutex_unlock(&load->lock);
+#endif
+
+    if(i >= load->chunks_count)
+      break;
+
+    rasqal_ntriples_chunk_scan(&load->chunks[i]);
+  }
+
+  return NULL;
+}
+
+
+/*
+ * rasqal_ntriples_load_scan:
+ * @load: load
+ * @threads: maximum number of threads
+ *
+ * INTERNAL - Scan all the chunks of a load on up to @threads threads
+ *
+ * Return value: number of threads used
+ */
+static int
+rasqal_ntriples_load_scan(rasqal_ntriples_load* load, int threads)
+{
+#ifdef RASQAL_NTRIPLES_LOAD_THREADS
+  pthread_t* workers;
+  int started = 0;
+
+  if(threads > load->chunks_count)
+    threads = load->chunks_count;
+
+  workers = NULL;
+  if(threads > 1)
+    workers = RASQAL_CALLOC(pthread_t*, RASQAL_GOOD_CAST(size_t, threads - 1),
+                            sizeof(pthread_t));
+
+  pthread_mutex_init(&load->lock, NULL);
+
+  /* the calling thread is one of the workers */
+  if(workers) {
+    while(started < threads - 1) {
+      if(pthread_create(&workers[started], NULL, rasqal_ntriples_load_worker,
+                        load))
+        break;
+      started++;
+    }
+  }
+
+  rasqal_ntriples_load_worker(load);
+
+  if(workers) {
+    int i;
+
+    for(i = 0; i < started; i++)
+      pthread_join(workers[i], NULL);
+    RASQAL_FREE(pthread_t*, workers);
+  }
+
+  pthread_mutex_destroy(&load->lock);
+
+  return started + 1;
+#else
+  rasqal_ntriples_load_worker(load);
+
+  return 1;
+#endif
+}
+
+
+/*
+ * rasqal_ntriples_load_make_literal:
+ * @world: world
+ * @cache: term cache
+ * @bnode_prefix: blank node ID prefix
+ * @index: data graph index
+ * @term: N-Triples term string
+ * @length: length of @term
+ *
+ * INTERNAL - Turn a term string into a literal via the term cache
+ *
+ * Blank node labels are scoped to their data graph with the ID
+ * <bnode_prefix><index>_<label>.
+ *
+ * Return value: new literal or NULL on failure
+ */
+static rasqal_literal*
+rasqal_ntriples_load_make_literal(rasqal_world* world,
+                                  rasqal_ntriples_cache_entry* cache,
+                                  const unsigned char* bnode_prefix,
+                                  int index,
+                                  unsigned char* term, size_t length)
+{
+  rasqal_ntriples_cache_entry* entry;
+  unsigned int hash = 2166136261U;
+  rasqal_literal* l;
+  size_t i;
+  int is_blank = (term[0] == '_');
+
+  /* FNV-1a */
+  for(i = 0; i < length; i++) {
+    hash ^= term[i];
+    hash *= 16777619U;
+  }
+  if(is_blank)
+    hash ^= RASQAL_GOOD_CAST(unsigned int, index);
+
+  entry = &cache[hash & (RASQAL_NTRIPLES_LOAD_CACHE_SIZE - 1)];
+  if(entry->literal && entry->length == length &&
+     entry->index == (is_blank ? index : -1) &&
+     !memcmp(entry->string, term, length))
+    return rasqal_new_literal_from_literal(entry->literal);
+
+  if(is_blank) {
+    size_t prefix_len = strlen(RASQAL_GOOD_CAST(const char*, bnode_prefix));
+    unsigned char* id;
+
+    /* prefix, index, '_', label without "_:" and NUL */
+    id = RASQAL_MALLOC(unsigned char*, prefix_len + 12 + length);
+    if(!id)
+      return NULL;
+    sprintf(RASQAL_GOOD_CAST(char*, id), "%s%d_%s",
+            RASQAL_GOOD_CAST(const char*, bnode_prefix), index,
+            RASQAL_GOOD_CAST(const char*, term + 2));
+    l = rasqal_new_simple_literal(world, RASQAL_LITERAL_BLANK, id);
+  } else
+    l = rasqal_new_literal_from_ntriples_counted_string(world, term, length);
+
+  if(!l)
+    return NULL;
+
+  if(entry->literal)
+    rasqal_free_literal(entry->literal);
+  entry->string = term;
+  entry->length = length;
+  entry->index = is_blank ? index : -1;
+  entry->literal = rasqal_new_literal_from_literal(l);
+
+  return l;
+}
+
+
+static double
+rasqal_ntriples_load_elapsed(struct timeval* from, struct timeval* to)
+{
+  return RASQAL_GOOD_CAST(double, to->tv_sec - from->tv_sec) +
+         RASQAL_GOOD_CAST(double, to->tv_usec - from->tv_usec) / 1000000.0;
+}
+
+
+/**
+ * rasqal_new_ntriples_load:
+ * @world: world
+ * @data_graphs: sequence of #rasqal_data_graph
+ * @threads: maximum number of threads (1 or more)
+ *
+ * INTERNAL - Scan the N-Triples file data graphs of a dataset in parallel
+ *
+ * Data graphs that are local files with format name "ntriples" or
+ * with no format name and a .nt suffix are read on up to @threads
+ * threads, splitting large files into chunks.  No triples are made
+ * until each data graph is merged with
+ * rasqal_ntriples_load_merge_data_graph() so that the caller can keep
+ * the dataset order.
+ *
+ * Return value: new load or NULL on failure
+ */
+rasqal_ntriples_load*
+rasqal_new_ntriples_load(rasqal_world* world, raptor_sequence* data_graphs,
+                         int threads)
+{
+  rasqal_ntriples_load* load;
+  struct timeval start_tv;
+  struct timeval scanned_tv;
+  int i;
+
+  load = RASQAL_CALLOC(rasqal_ntriples_load*, 1, sizeof(*load));
+  if(!load)
+    return NULL;
+
+  load->world = world;
+  load->data_graphs = data_graphs;
+  load->data_graphs_count = raptor_sequence_size(data_graphs);
+  load->threads_used = 1;
+
+  if(!load->data_graphs_count)
+    return load;
+
+  load->filenames = RASQAL_CALLOC(char**,
+                                  RASQAL_GOOD_CAST(size_t, load->data_graphs_count),
+                                  sizeof(char*));
+  load->cache = RASQAL_CALLOC(rasqal_ntriples_cache_entry*,
+                              RASQAL_NTRIPLES_LOAD_CACHE_SIZE,
+                              sizeof(rasqal_ntriples_cache_entry));
+  if(!load->filenames || !load->cache)
+    goto failed;
+
+  gettimeofday(&start_tv, NULL);
+
+  /* split the files into chunks: at most one per thread */
+  for(i = 0; i < load->data_graphs_count; i++) {
+    rasqal_data_graph* dg;
+    FILE* fh;
+    long size;
+    long chunk_size;
+    int n;
+    int j;
+
+    dg = (rasqal_data_graph*)raptor_sequence_get_at(data_graphs, i);
+    load->filenames[i] = rasqal_ntriples_load_data_graph_filename(dg);
+    if(!load->filenames[i])
+      continue;
+
+    fh = fopen(load->filenames[i], "rb");
+    if(!fh || fseek(fh, 0, SEEK_END) || (size = ftell(fh)) < 0) {
+      /* leave it to raptor to report */
+      if(fh)
+        fclose(fh);
+      raptor_free_memory(load->filenames[i]);
+      load->filenames[i] = NULL;
+      continue;
+    }
+    fclose(fh);
+
+    n = 1;
+    if(size > RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE && threads > 1) {
+      n = RASQAL_GOOD_CAST(int, size / RASQAL_NTRIPLES_LOAD_MIN_CHUNK_SIZE);
+      if(n > threads)
+        n = threads;
+    }
+    chunk_size = (size + n - 1) / n;
+
+    load->chunks = (rasqal_ntriples_chunk*)rasqal_ntriples_load_grow(load->chunks,
+                                                                     RASQAL_GOOD_CAST(size_t, load->chunks_count) * sizeof(rasqal_ntriples_chunk),
+                                                                     RASQAL_GOOD_CAST(size_t, load->chunks_count + n) * sizeof(rasqal_ntriples_chunk));
+    if(!load->chunks) {
+      /* the chunk buffers are all still empty */
+      load->chunks_count = 0;
+      goto failed;
+    }
+
+    for(j = 0; j < n; j++) {
+      rasqal_ntriples_chunk* chunk = &load->chunks[load->chunks_count++];
+
+      memset(chunk, '\0', sizeof(*chunk));
+      chunk->index = i;
+      chunk->filename = load->filenames[i];
+      chunk->start = j * chunk_size;
+      chunk->end = (j == n - 1) ? size : (j + 1) * chunk_size;
+    }
+
+    load->files++;
+  }
+
+  if(load->chunks_count) {
+    load->threads_used = rasqal_ntriples_load_scan(load, threads);
+    gettimeofday(&scanned_tv, NULL);
+    load->scan_time = rasqal_ntriples_load_elapsed(&start_tv, &scanned_tv);
+  }
+
+  return load;
+
+  failed:
+  rasqal_free_ntriples_load(load);
+  return NULL;
+}
+
+
+/**
+ * rasqal_free_ntriples_load:
+ * @load: load
+ *
+ * INTERNAL - Destructor - free a load
+ *
+ * When every scanned file was merged, the load time is reported as
+ * an informational log message.
+ */
+void
+rasqal_free_ntriples_load(rasqal_ntriples_load* load)
+{
+  int i;
+
+  if(!load)
+    return;
+
+  if(load->files && load->files_merged == load->files)
+    rasqal_log_error_simple(load->world, RAPTOR_LOG_LEVEL_INFO, NULL,
+                            "Loaded %d triples from %d N-Triples files in %d chunks: scan %.3fs on %d threads, merge %.3fs",
+                            load->triples, load->files, load->chunks_count,
+                            load->scan_time, load->threads_used,
+                            load->merge_time);
+
+  if(load->cache) {
+    for(i = 0; i < RASQAL_NTRIPLES_LOAD_CACHE_SIZE; i++) {
+      if(load->cache[i].literal)
+        rasqal_free_literal(load->cache[i].literal);
+    }
+    RASQAL_FREE(rasqal_ntriples_cache_entry*, load->cache);
+  }
+
+  for(i = 0; i < load->chunks_count; i++) {
+    if(load->chunks[i].terms)
+      RASQAL_FREE(char*, load->chunks[i].terms);
+    if(load->chunks[i].offsets)
+      RASQAL_FREE(size_t*, load->chunks[i].offsets);
+  }
+  if(load->chunks)
+    RASQAL_FREE(rasqal_ntriples_chunk*, load->chunks);
+
+  if(load->filenames) {
+    for(i = 0; i < load->data_graphs_count; i++) {
+      if(load->filenames[i])
+        raptor_free_memory(load->filenames[i]);
+    }
+    RASQAL_FREE(char**, load->filenames);
+  }
+
+  RASQAL_FREE(rasqal_ntriples_load, load);
+}
+
+
+/**
+ * rasqal_ntriples_load_has_data_graph:
+ * @load: load
+ * @index: data graph index
+ *
+ * INTERNAL - Test if a data graph was scanned by the load
+ *
+ * Return value: non-0 if the data graph is merged with rasqal_ntriples_load_merge_data_graph(); else the caller must parse it
+ */
+int
+rasqal_ntriples_load_has_data_graph(rasqal_ntriples_load* load, int index)
+{
+  if(index < 0 || index >= load->data_graphs_count || !load->filenames)
+    return 0;
+
+  return load->filenames[index] != NULL;
+}
+
+
+/**
+ * rasqal_ntriples_load_merge_data_graph:
+ * @load: load
+ * @index: data graph index
+ * @bnode_prefix: blank node ID prefix
+ * @handler: triple handler
+ * @user_data: user data for @handler
+ *
+ * INTERNAL - Turn the scanned chunks of one data graph into triples in file order
+ *
+ * The triples are passed to @handler on the calling thread with the
+ * data graph index.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_ntriples_load_merge_data_graph(rasqal_ntriples_load* load, int index,
+                                      const unsigned char* bnode_prefix,
+                                      rasqal_ntriples_load_handler handler,
+                                      void* user_data)
+{
+  rasqal_world* world = load->world;
+  rasqal_data_graph* dg;
+  raptor_locator locator;
+  struct timeval start_tv;
+  struct timeval merged_tv;
+  int line_base = 0;
+  int i;
+  int rc = 0;
+
+  if(!rasqal_ntriples_load_has_data_graph(load, index))
+    return 1;
+
+  gettimeofday(&start_tv, NULL);
+
+  dg = (rasqal_data_graph*)raptor_sequence_get_at(load->data_graphs, index);
+
+  memset(&locator, '\0', sizeof(locator));
+  locator.uri = dg->uri;
+  locator.line = -1;
+  locator.column = -1;
+  locator.byte = -1;
+
+  for(i = 0; i < load->chunks_count && !rc; i++) {
+    rasqal_ntriples_chunk* chunk = &load->chunks[i];
+    int j;
+
+    if(chunk->index != index)
+      continue;
+
+    for(j = 0; j + 2 < chunk->offsets_count; j += 3) {
+      rasqal_literal* parts[3];
+      rasqal_triple* t;
+      int k;
+
+      for(k = 0; k < 3; k++) {
+        unsigned char* term = chunk->terms + chunk->offsets[j + k];
+        size_t length;
+
+        if(j + k + 1 < chunk->offsets_count)
+          length = chunk->offsets[j + k + 1] - chunk->offsets[j + k] - 1;
+        else
+          length = chunk->terms_len - chunk->offsets[j + k] - 1;
+
+        parts[k] = rasqal_ntriples_load_make_literal(world, load->cache,
+                                                     bnode_prefix,
+                                                     chunk->index,
+                                                     term, length);
+        if(!parts[k])
+          break;
+      }
+
+      if(k < 3 ||
+         (parts[0]->type != RASQAL_LITERAL_URI &&
+          parts[0]->type != RASQAL_LITERAL_BLANK) ||
+         parts[1]->type != RASQAL_LITERAL_URI) {
+        while(k-- > 0)
+          if(parts[k])
+            rasqal_free_literal(parts[k]);
+        rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR, &locator,
+                                "Bad N-Triples triple");
+        rc = 1;
+        break;
+      }
+
+      t = rasqal_new_triple(parts[0], parts[1], parts[2]);
+      if(!t || handler(user_data, chunk->index, t)) {
+        rc = 1;
+        break;
+      }
+      load->triples++;
+    }
+
+    if(!rc && chunk->error) {
+      if(chunk->error_line)
+        locator.line = line_base + chunk->error_line;
+      rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR, &locator,
+                              "%s", chunk->error);
+      rc = 1;
+    }
+
+    line_base += chunk->lines;
+  }
+
+  gettimeofday(&merged_tv, NULL);
+  load->merge_time += rasqal_ntriples_load_elapsed(&start_tv, &merged_tv);
+  if(!rc)
+    load->files_merged++;
+
+  return rc;
+}
+
+
+
+#ifdef STANDALONE
+
+#define NTRIPLES_LOAD_TEST_FILE "rasqal_ntriples_load_test.nt"
+#define NTRIPLES_LOAD_TEST_LINES 2000
+
+static int ntriples_load_test_blanks;
+
+static int
+ntriples_load_test_handler(void* user_data, int index, rasqal_triple* triple)
+{
+  int* count = (int*)user_data;
+
+  if(triple->subject->type == RASQAL_LITERAL_BLANK &&
+     !strncmp(RASQAL_GOOD_CAST(const char*, triple->subject->string),
+              "graphid0_", 9))
+    ntriples_load_test_blanks++;
+
+  (*count)++;
+  rasqal_free_triple(triple);
+  return 0;
+}
+
+
+int main(int argc, char *argv[]);
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  raptor_sequence* data_graphs = NULL;
+  unsigned char* uri_string = NULL;
+  raptor_uri* uri = NULL;
+  FILE* fh;
+  int threads;
+  int i;
+  int failures = 0;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+
+  /* lines of different lengths so chunk boundaries fall mid-line */
+  fh = fopen(NTRIPLES_LOAD_TEST_FILE, "w");
+  if(!fh) {
+    fprintf(stderr, "%s: Failed to write %s\n", program,
+            NTRIPLES_LOAD_TEST_FILE);
+    failures++;
+    goto tidy;
+  }
+  for(i = 0; i < NTRIPLES_LOAD_TEST_LINES; i++) {
+    if(!(i % 10))
+      fprintf(fh, "# line %d\n", i);
+    if(!(i % 2))
+      fprintf(fh, "_:b%d <http://example.org/p> \"v \\\"%d\\\"\"@en .\n", i, i);
+    else
+      fprintf(fh, "<http://example.org/s%d> <http://example.org/p> <http://example.org/o>.\n", i);
+  }
+  fclose(fh);
+
+  uri_string = raptor_uri_filename_to_uri_string(NTRIPLES_LOAD_TEST_FILE);
+  uri = raptor_new_uri(world->raptor_world_ptr, uri_string);
+  data_graphs = raptor_new_sequence((raptor_data_free_handler)rasqal_free_data_graph,
+                                    NULL);
+  if(!uri || !data_graphs ||
+     raptor_sequence_push(data_graphs,
+                          rasqal_new_data_graph_from_uri(world, uri, NULL,
+                                                         RASQAL_DATA_GRAPH_BACKGROUND,
+                                                         NULL, "ntriples",
+                                                         NULL))) {
+    fprintf(stderr, "%s: Failed to create data graph\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  /* small chunks so the file is split */
+  rasqal_ntriples_load_min_chunk_size = 512;
+
+  for(threads = 1; threads <= 8; threads *= 2) {
+    rasqal_ntriples_load* load;
+    int count = 0;
+    int rc = 1;
+
+    ntriples_load_test_blanks = 0;
+
+    load = rasqal_new_ntriples_load(world, data_graphs, threads);
+    if(load && rasqal_ntriples_load_has_data_graph(load, 0))
+      rc = rasqal_ntriples_load_merge_data_graph(load, 0,
+                                                 RASQAL_GOOD_CAST(const unsigned char*, "graphid"),
+                                                 ntriples_load_test_handler,
+                                                 &count);
+    rasqal_free_ntriples_load(load);
+    if(rc) {
+      fprintf(stderr, "%s: load with %d threads FAILED\n", program, threads);
+      failures++;
+      continue;
+    }
+
+    if(count != NTRIPLES_LOAD_TEST_LINES ||
+       ntriples_load_test_blanks != NTRIPLES_LOAD_TEST_LINES / 2) {
+      fprintf(stderr,
+              "%s: load with %d threads gave %d triples, %d blank subjects; expected %d, %d\n",
+              program, threads, count, ntriples_load_test_blanks,
+              NTRIPLES_LOAD_TEST_LINES, NTRIPLES_LOAD_TEST_LINES / 2);
+      failures++;
+    }
+  }
+
+  tidy:
+  remove(NTRIPLES_LOAD_TEST_FILE);
+  if(data_graphs)
+    raptor_free_sequence(data_graphs);
+  if(uri)
+    raptor_free_uri(uri);
+  if(uri_string)
+    raptor_free_memory(uri_string);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
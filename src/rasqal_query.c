@@ -305,6 +305,8 @@ rasqal_query_set_feature(rasqal_query* query, rasqal_feature feature, int value)
   switch(feature) {
     case RASQAL_FEATURE_NO_NET:
     case RASQAL_FEATURE_RAND_SEED:
+    case RASQAL_FEATURE_REDUCED_SIZE:
+    case RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE:
 
       if(feature == RASQAL_FEATURE_RAND_SEED)
         query->user_set_rand = 1;
@@ -372,6 +374,11 @@ rasqal_query_get_feature(rasqal_query *query, rasqal_feature feature)
     case RASQAL_FEATURE_RAND_SEED:
       result = (query->features[RASQAL_GOOD_CAST(int, feature)] != 0);
       break;
+
+    case RASQAL_FEATURE_REDUCED_SIZE:
+    case RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE:
+      result = query->features[RASQAL_GOOD_CAST(int, feature)];
+      break;
   }
   
   return result;
@@ -667,6 +674,53 @@ rasqal_query_get_data_graph(rasqal_query* query, int idx)
 }
 
 
+/*
+ * rasqal_query_uses_world_dataset:
+ * @query: #rasqal_query query object
+ *
+ * INTERNAL - Test if the query runs against the world persistent dataset
+ *
+ * That is when the query has no data graphs of its own and data
+ * graphs were added with rasqal_world_add_data_graph().
+ *
+ * Return value: non-0 if the world dataset is used
+ */
+int
+rasqal_query_uses_world_dataset(rasqal_query* query)
+{
+  if(!query->world->store)
+    return 0;
+
+  return !query->data_graphs || !raptor_sequence_size(query->data_graphs);
+}
+
+
+/*
+ * rasqal_query_get_dataset_graph:
+ * @query: #rasqal_query query object
+ * @idx: index into the dataset (0 or larger)
+ *
+ * INTERNAL - Get a data graph of the dataset the query runs against
+ *
+ * As rasqal_query_get_data_graph() but when the query uses the world
+ * persistent dataset, the named graphs of that.
+ *
+ * Return value: a #rasqal_data_graph pointer or NULL if out of range
+ */
+rasqal_data_graph*
+rasqal_query_get_dataset_graph(rasqal_query* query, int idx)
+{
+  if(rasqal_query_uses_world_dataset(query)) {
+    if(!query->world->data_graphs)
+      return NULL;
+
+    return (rasqal_data_graph*)raptor_sequence_get_at(query->world->data_graphs, idx);
+  }
+
+  return rasqal_query_get_data_graph(query, idx);
+}
+
+
 /**
  * rasqal_query_dataset_contains_named_graph:
  * @query: #rasqal_query query object
@@ -687,7 +741,7 @@ rasqal_query_dataset_contains_named_graph(rasqal_query* query,
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query, rasqal_query, 1);
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(graph_uri, raptor_uri, 1);
 
-  for(idx = 0; (dg = rasqal_query_get_data_graph(query, idx)); idx++) {
+  for(idx = 0; (dg = rasqal_query_get_dataset_graph(query, idx)); idx++) {
     if(dg->name_uri && raptor_uri_equals(dg->name_uri, graph_uri)) {
       /* graph_uri is a graph name in the dataset */
       found = 1;
@@ -1333,6 +1387,28 @@ rasqal_query_get_engine_by_name(const char* name)
 }
 
 
+/* run the update operations of a query on the world dataset */
+static rasqal_query_results*
+rasqal_query_execute_world_update(rasqal_query* query)
+{
+  rasqal_query_results *query_results;
+
+  query_results = rasqal_new_query_results2(query->world, query,
+                                            RASQAL_QUERY_RESULTS_BOOLEAN);
+  if(!query_results)
+    return NULL;
+
+  if(rasqal_world_execute_update(query->world, query) ||
+     rasqal_query_results_set_boolean(query_results, 1) ||
+     rasqal_query_add_query_result(query, query_results)) {
+    rasqal_free_query_results(query_results);
+    query_results = NULL;
+  }
+
+  return query_results;
+}
+
+
 /**
  * rasqal_query_execute_with_engine:
  * @query: the #rasqal_query object
@@ -1354,6 +1430,9 @@ rasqal_query_execute_with_engine(rasqal_query* query,
   if(query->failed)
     return NULL;
 
+  if(query->prepared && rasqal_query_get_update_operation(query, 0))
+    return rasqal_query_execute_world_update(query);
+
   type = rasqal_query_get_result_type(query);
   if(type == RASQAL_QUERY_RESULTS_UNKNOWN)
     return NULL;
@@ -1387,6 +1466,13 @@ rasqal_query_execute_with_engine(rasqal_query* query,
  *
  * Excute a query - run and return results.
  *
+ * The update operations of a SPARQL Update query are run in order
+ * against the world persistent dataset (see
+ * rasqal_world_add_data_graph()), which is created empty if there
+ * is none.  The result is then a boolean true once they succeed.
+ * Queries without data graphs of their own executed later see the
+ * changes.
+ *
  * return value: a #rasqal_query_results structure or NULL on failure.
  **/
 rasqal_query_results*
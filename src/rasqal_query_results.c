@@ -98,9 +98,13 @@
  */
 
 static int rasqal_query_results_execute_and_store_results(rasqal_query_results* query_results);
+static void rasqal_query_results_clear_construct_dedup(rasqal_query_results* query_results);
 static void rasqal_query_results_update_query_bindings(rasqal_query_results* query_results, rasqal_query *query);
 
 
+/* "r" + digits of an int + "q" */
+#define RASQAL_CONSTRUCT_BNODE_PREFIX_SIZE 16
+
 /*
  * A query result for some query
  */
@@ -143,6 +147,40 @@ struct rasqal_query_results_s {
   /* constructed triple result - shared and updated for each triple */
   raptor_statement result_triple;
 
+  /* CONSTRUCT template terms, 3 per template triple: terms that are
+   * the same for every result are made once and copied; NULL for
+   * variables and blank nodes.  Array size @construct_terms_count
+   */
+  raptor_term** construct_terms;
+  int construct_terms_count;
+
+  /* "r" result count "q" prefix of template blank node labels and
+   * the result count it was made for or -1
+   */
+  unsigned char construct_bnode_prefix[RASQAL_CONSTRUCT_BNODE_PREFIX_SIZE];
+  size_t construct_bnode_prefix_len;
+  int construct_bnode_count;
+
+  /* buffer for template blank node labels */
+  unsigned char* construct_bnode_buffer;
+  size_t construct_bnode_buffer_size;
+
+  /* CONSTRUCT duplicate triple cache: @construct_dedup_size slots (a
+   * power of 2 or 0 when disabled) of owned statements and their hashes
+   */
+  raptor_statement** construct_dedup;
+  unsigned int* construct_dedup_hashes;
+  unsigned int construct_dedup_size;
+
+  /* non-0 if @result_triple has been checked against the cache */
+  int construct_dedup_checked;
+
+  /* DESCRIBE description generator or NULL */
+  rasqal_describe* describe;
+
+  /* non-0 if @result_triple holds the current DESCRIBE triple */
+  int describe_have_triple;
+
   /* sequence of stored results */
   raptor_sequence* results_sequence;
 
@@ -219,6 +257,7 @@ rasqal_new_query_results2(rasqal_world* world,
   query_results->ask_result = -1; 
   query_results->store_results = 0; 
   query_results->current_triple_result = -1;
+  query_results->construct_bnode_count = -1;
 
   /* initialize static query_results->result_triple */
   raptor_statement_init(&query_results->result_triple, world->raptor_world_ptr);
@@ -438,6 +477,10 @@ rasqal_free_query_results(rasqal_query_results* query_results)
 
   query = query_results->query;
 
+  /* uses the execution triples source so goes first */
+  if(query_results->describe)
+    rasqal_free_describe(query_results->describe);
+
   if(query_results->executed) {
     if(query_results->execution_factory->execute_finish) {
       rasqal_engine_error execution_error = RASQAL_ENGINE_OK;
@@ -459,6 +502,27 @@ rasqal_free_query_results(rasqal_query_results* query_results)
   /* free terms owned by static query_results->result_triple */
   raptor_free_statement(&query_results->result_triple);
 
+  if(query_results->construct_terms) {
+    int i;
+
+    for(i = 0; i < query_results->construct_terms_count; i++) {
+      if(query_results->construct_terms[i])
+        raptor_free_term(query_results->construct_terms[i]);
+    }
+    RASQAL_FREE(raptor_term**, query_results->construct_terms);
+  }
+
+  if(query_results->construct_bnode_buffer)
+    RASQAL_FREE(char*, query_results->construct_bnode_buffer);
+
+  if(query_results->construct_dedup) {
+    rasqal_query_results_clear_construct_dedup(query_results);
+    RASQAL_FREE(raptor_statement**, query_results->construct_dedup);
+  }
+
+  if(query_results->construct_dedup_hashes)
+    RASQAL_FREE(unsigned int*, query_results->construct_dedup_hashes);
+
   if(query_results->vars_table)
     rasqal_free_variables_table(query_results->vars_table);
 
@@ -1014,6 +1078,16 @@ rasqal_query_results_rewind(rasqal_query_results* query_results)
   if(query && !limit)
     query_results->finished = 1;
   
+  /* triples of the first pass are not duplicates of the second */
+  if(query_results->construct_dedup)
+    rasqal_query_results_clear_construct_dedup(query_results);
+
+  if(query_results->describe) {
+    rasqal_free_describe(query_results->describe);
+    query_results->describe = NULL;
+  }
+  query_results->describe_have_triple = 0;
+
   if(!query_results->finished) {
     /* Reset to first result, index-1 into sequence of results */
     query_results->result_count = 0;
@@ -1080,8 +1154,15 @@ rasqal_query_results_get_bindings(rasqal_query_results* query_results,
   if(names)
     *names = rasqal_variables_table_get_names(query_results->vars_table);
   
-  if(values)
+  if(values) {
+    int i;
+
+    /* values are returned in their canonical lexical form */
+    for(i = 0; i < row->size; i++)
+      rasqal_literal_ensure_native(row->values[i]);
+
     *values = row->values;
+  }
     
   return 0;
 }
@@ -1111,8 +1192,10 @@ rasqal_query_results_get_binding_value(rasqal_query_results* query_results,
     return NULL;
 
   row = rasqal_query_results_get_current_row(query_results);
-  if(row)
+  if(row) {
+    rasqal_literal_ensure_native(row->values[offset]);
     return row->values[offset];
+  }
 
   query_results->finished = 1;
   return NULL;
@@ -1183,6 +1266,7 @@ rasqal_query_results_get_binding_value_by_name(rasqal_query_results* query_resul
   if(!v)
     return NULL;
 
+  rasqal_literal_ensure_native(row->values[v->offset]);
   return row->values[v->offset];
 }
 
@@ -1213,23 +1297,76 @@ rasqal_query_results_get_bindings_count(rasqal_query_results* query_results)
 }
 
 
-static unsigned char*
-rasqal_prefix_id(int prefix_id, const unsigned char *string)
+/*
+ * rasqal_query_results_construct_bnode:
+ * @query_results: query results
+ * @label: template blank node label
+ * @label_len: length of @label
+ *
+ * INTERNAL - Make a blank node term for a template blank node in the current result
+ *
+ * The label is "r" result count "q" @label.  The prefix is only
+ * remade when the result count changes and the label is built in a
+ * buffer kept across calls.
+ *
+ * Return value: new term or NULL on failure
+ */
+static raptor_term*
+rasqal_query_results_construct_bnode(rasqal_query_results* query_results,
+                                     const unsigned char* label,
+                                     size_t label_len)
 {
-  int tmpid = prefix_id;
-  unsigned char* buffer;
-  size_t length = strlen(RASQAL_GOOD_CAST(const char*, string)) + 4;  /* "r" +... + "q" +... \0 */
+  size_t prefix_len;
+  size_t len;
+
+  if(query_results->construct_bnode_count != query_results->result_count) {
+    unsigned char digits[RASQAL_CONSTRUCT_BNODE_PREFIX_SIZE];
+    unsigned int count;
+    size_t ndigits = 0;
+    int negative = (query_results->result_count < 0);
+    unsigned char* p = query_results->construct_bnode_prefix;
+
+    count = negative ? 0U - RASQAL_GOOD_CAST(unsigned int, query_results->result_count)
+                     : RASQAL_GOOD_CAST(unsigned int, query_results->result_count);
+    do {
+      digits[ndigits++] = RASQAL_GOOD_CAST(unsigned char, '0' + (count % 10));
+      count /= 10;
+    } while(count);
+
+    *p++ = 'r';
+    if(negative)
+      *p++ = '-';
+    while(ndigits)
+      *p++ = digits[--ndigits];
+    *p++ = 'q';
+
+    query_results->construct_bnode_prefix_len = RASQAL_GOOD_CAST(size_t, p - query_results->construct_bnode_prefix);
+    query_results->construct_bnode_count = query_results->result_count;
+  }
 
-  while(tmpid /= 10)
-    length++;
-  
-  buffer = RASQAL_MALLOC(unsigned char*, length);
-  if(!buffer)
-    return NULL;
-  
-  sprintf(RASQAL_GOOD_CAST(char*, buffer), "r%dq%s", prefix_id, string);
-  
-  return buffer;
+  prefix_len = query_results->construct_bnode_prefix_len;
+  len = prefix_len + label_len;
+
+  if(len + 1 > query_results->construct_bnode_buffer_size) {
+    size_t size = (len + 1) * 2;
+    unsigned char* buffer = RASQAL_MALLOC(unsigned char*, size);
+    if(!buffer)
+      return NULL;
+
+    if(query_results->construct_bnode_buffer)
+      RASQAL_FREE(char*, query_results->construct_bnode_buffer);
+    query_results->construct_bnode_buffer = buffer;
+    query_results->construct_bnode_buffer_size = size;
+  }
+
+  memcpy(query_results->construct_bnode_buffer,
+         query_results->construct_bnode_prefix, prefix_len);
+  memcpy(query_results->construct_bnode_buffer + prefix_len, label, label_len);
+  query_results->construct_bnode_buffer[len] = '\0';
+
+  return raptor_new_term_from_counted_blank(query_results->world->raptor_world_ptr,
+                                            query_results->construct_bnode_buffer,
+                                            len);
 }
 
 
@@ -1239,7 +1376,6 @@ rasqal_literal_to_result_term(rasqal_query_results* query_results,
 {
   rasqal_literal* nodel;
   raptor_term* t = NULL;
-  unsigned char *nodeid;
   
   nodel = rasqal_literal_as_node(l);
   if(!nodel)
@@ -1256,25 +1392,13 @@ rasqal_literal_to_result_term(rasqal_query_results* query_results,
         /* original was a genuine blank node not a variable with a
          * blank node value so make a new one every result, not every triple
          */
-        nodeid = rasqal_prefix_id(query_results->result_count,
-                                  nodel->string);
-      } else {
-        nodeid = RASQAL_MALLOC(unsigned char*, nodel->string_len + 1);
-        if(nodeid)
-          memcpy(nodeid, nodel->string, nodel->string_len + 1);
-      }
-
-      if(nodeid)
-        l = rasqal_new_simple_literal(query_results->world,
-                                      RASQAL_LITERAL_BLANK,
-                                      nodeid);
-
-      if(!nodeid || !l)
-        goto done;
-      
-      t = raptor_new_term_from_blank(query_results->world->raptor_world_ptr,
-                                     nodeid);
-      rasqal_free_literal(l);
+        t = rasqal_query_results_construct_bnode(query_results,
+                                                 nodel->string,
+                                                 nodel->string_len);
+      } else
+        t = raptor_new_term_from_counted_blank(query_results->world->raptor_world_ptr,
+                                               nodel->string,
+                                               nodel->string_len);
       break;
       
     case RASQAL_LITERAL_STRING:
@@ -1306,8 +1430,6 @@ rasqal_literal_to_result_term(rasqal_query_results* query_results,
       break;
   }
   
-  
-  done:
   if(nodel)
     rasqal_free_literal(nodel);
 
@@ -1315,6 +1437,339 @@ rasqal_literal_to_result_term(rasqal_query_results* query_results,
 }
 
 
+/*
+ * rasqal_query_results_init_construct:
+ * @query_results: query results
+ *
+ * INTERNAL - Prepare CONSTRUCT template terms and the duplicate triple cache
+ *
+ * Template terms that are not variables or blank nodes are the same
+ * for every result so are turned into raptor terms once here.  An
+ * unusable constant is left NULL and made (and warned about) per triple.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_results_init_construct(rasqal_query_results* query_results)
+{
+  rasqal_query* query = query_results->query;
+  int size = raptor_sequence_size(query->constructs);
+  int dedup_size;
+  int i;
+
+  query_results->construct_terms = RASQAL_CALLOC(raptor_term**,
+                                                 RASQAL_GOOD_CAST(size_t, 3 * size + 1),
+                                                 sizeof(raptor_term*));
+  if(!query_results->construct_terms)
+    return 1;
+  query_results->construct_terms_count = 3 * size;
+
+  for(i = 0; i < size; i++) {
+    rasqal_triple* t;
+    rasqal_literal* parts[3];
+    int j;
+
+    t = (rasqal_triple*)raptor_sequence_get_at(query->constructs, i);
+    parts[0] = t->subject;
+    parts[1] = t->predicate;
+    parts[2] = t->object;
+
+    for(j = 0; j < 3; j++) {
+      if(parts[j]->type == RASQAL_LITERAL_VARIABLE ||
+         parts[j]->type == RASQAL_LITERAL_BLANK)
+        continue;
+
+      query_results->construct_terms[3 * i + j] =
+        rasqal_literal_to_result_term(query_results, parts[j]);
+    }
+  }
+
+  dedup_size = rasqal_query_get_feature(query,
+                                        RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE);
+  if(dedup_size > 0) {
+    unsigned int n = 1;
+
+    while(n < RASQAL_GOOD_CAST(unsigned int, dedup_size) && n < (1U << 30))
+      n <<= 1;
+
+    query_results->construct_dedup = RASQAL_CALLOC(raptor_statement**, n,
+                                                   sizeof(raptor_statement*));
+    query_results->construct_dedup_hashes = RASQAL_CALLOC(unsigned int*, n,
+                                                          sizeof(unsigned int));
+    if(!query_results->construct_dedup ||
+       !query_results->construct_dedup_hashes)
+      return 1;
+    query_results->construct_dedup_size = n;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_query_results_construct_term:
+ * @query_results: query results
+ * @index: template term index
+ * @l: template literal
+ *
+ * INTERNAL - Get a new term for template term @l in the current result
+ */
+static raptor_term*
+rasqal_query_results_construct_term(rasqal_query_results* query_results,
+                                    int index, rasqal_literal* l)
+{
+  raptor_term* term = query_results->construct_terms[index];
+
+  if(term)
+    return raptor_term_copy(term);
+
+  return rasqal_literal_to_result_term(query_results, l);
+}
+
+
+static unsigned int
+rasqal_query_results_term_hash(raptor_term* term, unsigned int hash)
+{
+  const unsigned char* s = NULL;
+  size_t len = 0;
+
+  hash = (hash ^ RASQAL_GOOD_CAST(unsigned int, term->type)) * 16777619U;
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      s = raptor_uri_as_counted_string(term->value.uri, &len);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      /* datatype and language are left to the equality check */
+      s = term->value.literal.string;
+      len = term->value.literal.string_len;
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      s = term->value.blank.string;
+      len = term->value.blank.string_len;
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      break;
+  }
+
+  while(len--)
+    hash = (hash ^ *s++) * 16777619U;
+
+  return hash;
+}
+
+
+/*
+ * rasqal_query_results_construct_seen:
+ * @query_results: query results
+ * @rs: constructed triple
+ *
+ * INTERNAL - Check @rs against the CONSTRUCT duplicate triple cache and remember it
+ *
+ * The cache is direct mapped so a triple is only dropped if it
+ * matches the last triple that hashed to the same slot.
+ *
+ * Return value: non-0 if @rs is a duplicate
+ */
+static int
+rasqal_query_results_construct_seen(rasqal_query_results* query_results,
+                                    raptor_statement* rs)
+{
+  unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+  unsigned int slot;
+  raptor_statement* cached;
+
+  hash = rasqal_query_results_term_hash(rs->subject, hash);
+  hash = rasqal_query_results_term_hash(rs->predicate, hash);
+  hash = rasqal_query_results_term_hash(rs->object, hash);
+
+  slot = hash & (query_results->construct_dedup_size - 1);
+  cached = query_results->construct_dedup[slot];
+  if(cached) {
+    if(query_results->construct_dedup_hashes[slot] == hash &&
+       raptor_statement_equals(cached, rs))
+      return 1;
+    raptor_free_statement(cached);
+  }
+
+  /* on copy failure the triple is returned but not remembered */
+  query_results->construct_dedup[slot] = raptor_statement_copy(rs);
+  query_results->construct_dedup_hashes[slot] = hash;
+
+  return 0;
+}
+
+
+static void
+rasqal_query_results_clear_construct_dedup(rasqal_query_results* query_results)
+{
+  unsigned int i;
+
+  for(i = 0; i < query_results->construct_dedup_size; i++) {
+    if(query_results->construct_dedup[i]) {
+      raptor_free_statement(query_results->construct_dedup[i]);
+      query_results->construct_dedup[i] = NULL;
+    }
+  }
+}
+
+
+/*
+ * rasqal_query_results_describe_row:
+ * @query_results: query results
+ *
+ * INTERNAL - Queue the resources to DESCRIBE from the current row
+ *
+ * 'DESCRIBE *' describes every value in the row.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_query_results_describe_row(rasqal_query_results* query_results)
+{
+  rasqal_query* query = query_results->query;
+  rasqal_row* row = query_results->row;
+  rasqal_literal* l;
+  int i;
+
+  if(!query->describes) {
+    for(i = 0; i < row->size; i++) {
+      if(rasqal_describe_add_resource(query_results->describe,
+                                      row->values[i]))
+        return 1;
+    }
+    return 0;
+  }
+
+  for(i = 0;
+      (l = (rasqal_literal*)raptor_sequence_get_at(query->describes, i));
+      i++) {
+    rasqal_variable* v = rasqal_literal_as_variable(l);
+
+    if(v) {
+      v = rasqal_variables_table_get_by_name(query_results->vars_table,
+                                             v->type, v->name);
+      l = v ? row->values[v->offset] : NULL;
+    }
+
+    if(rasqal_describe_add_resource(query_results->describe, l))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_query_results_describe_term:
+ * @query_results: query results
+ * @l: data value
+ *
+ * INTERNAL - Make a term for a DESCRIBE triple part
+ *
+ * Unlike template blank nodes, data blank nodes keep their labels.
+ */
+static raptor_term*
+rasqal_query_results_describe_term(rasqal_query_results* query_results,
+                                   rasqal_literal* l)
+{
+  if(l->type == RASQAL_LITERAL_BLANK)
+    return raptor_new_term_from_counted_blank(query_results->world->raptor_world_ptr,
+                                              l->string, l->string_len);
+
+  return rasqal_literal_to_result_term(query_results, l);
+}
+
+
+/*
+ * rasqal_query_results_get_describe_triple:
+ * @query_results: query results
+ *
+ * INTERNAL - Get the current DESCRIBE triple, reading result rows as needed
+ *
+ * The resources of a row are fully described before the next row is
+ * read so results stream without holding all rows.
+ *
+ * Return value: shared #raptor_statement or NULL if failed or results exhausted
+ */
+static raptor_statement*
+rasqal_query_results_get_describe_triple(rasqal_query_results* query_results)
+{
+  raptor_statement* rs = &query_results->result_triple;
+
+  if(query_results->describe_have_triple)
+    return rs;
+
+  if(rasqal_query_results_ensure_have_row_internal(query_results))
+    return NULL;
+
+  if(!query_results->describe) {
+    const rasqal_query_execution_factory* factory;
+    rasqal_triples_source* triples_source = NULL;
+
+    factory = query_results->execution_factory;
+    if(factory && factory->get_triples_source)
+      triples_source = factory->get_triples_source(query_results->execution_data);
+    if(!triples_source) {
+      query_results->finished = 1;
+      return NULL;
+    }
+
+    query_results->describe = rasqal_new_describe(query_results->query,
+                                                  triples_source);
+    if(!query_results->describe ||
+       rasqal_query_results_describe_row(query_results)) {
+      query_results->failed = 1;
+      return NULL;
+    }
+  }
+
+  while(1) {
+    rasqal_triple t;
+    int rc;
+
+    rc = rasqal_describe_next_triple(query_results->describe, &t);
+    if(rc < 0) {
+      query_results->failed = 1;
+      return NULL;
+    }
+
+    if(!rc) {
+      raptor_statement_clear(rs);
+
+      rs->subject = rasqal_query_results_describe_term(query_results,
+                                                       t.subject);
+      rs->predicate = rasqal_query_results_describe_term(query_results,
+                                                         t.predicate);
+      rs->object = rasqal_query_results_describe_term(query_results,
+                                                      t.object);
+      if(rs->subject && rs->predicate && rs->object)
+        break;
+
+      /* skip a triple that cannot be turned into terms */
+      continue;
+    }
+
+    /* described everything from this row */
+    if(rasqal_query_results_next_internal(query_results))
+      return NULL;
+
+    if(rasqal_query_results_describe_row(query_results)) {
+      query_results->failed = 1;
+      return NULL;
+    }
+  }
+
+  query_results->describe_have_triple = 1;
+
+  return rs;
+}
+
+
 /**
  * rasqal_query_results_get_triple:
  * @query_results: #rasqal_query_results query_results
@@ -1331,6 +1786,7 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
   rasqal_query* query;
   rasqal_triple *t;
   raptor_statement *rs = NULL;
+  int index;
   
   RASQAL_ASSERT_OBJECT_POINTER_RETURN_VALUE(query_results, rasqal_query_results, NULL);
 
@@ -1345,13 +1801,19 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
     return NULL;
   
   if(query->verb == RASQAL_QUERY_VERB_DESCRIBE)
-    return NULL;
+    return rasqal_query_results_get_describe_triple(query_results);
 
  
   /* ensure we have a row to work on */
   if(rasqal_query_results_ensure_have_row_internal(query_results))
     return NULL;
 
+  if(!query_results->construct_terms &&
+     rasqal_query_results_init_construct(query_results)) {
+    query_results->failed = 1;
+    return NULL;
+  }
+
   while(1) {
     int skip = 0;
 
@@ -1361,11 +1823,14 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
     t = (rasqal_triple*)raptor_sequence_get_at(query->constructs,
                                                query_results->current_triple_result);
 
+    index = 3 * query_results->current_triple_result;
+
     rs = &query_results->result_triple;
 
     raptor_statement_clear(rs);
 
-    rs->subject = rasqal_literal_to_result_term(query_results, t->subject);
+    rs->subject = rasqal_query_results_construct_term(query_results, index,
+                                                      t->subject);
     if(!rs->subject || rs->subject->type == RAPTOR_TERM_TYPE_LITERAL) {
       rasqal_log_warning_simple(query_results->world,
                                 RASQAL_WARNING_LEVEL_BAD_TRIPLE,
@@ -1373,7 +1838,9 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
                                 "Triple with non-RDF subject term skipped");
       skip = 1;
     } else {
-      rs->predicate = rasqal_literal_to_result_term(query_results, t->predicate);
+      rs->predicate = rasqal_query_results_construct_term(query_results,
+                                                          index + 1,
+                                                          t->predicate);
       if(!rs->predicate || rs->predicate->type != RAPTOR_TERM_TYPE_URI) {
         rasqal_log_warning_simple(query_results->world,
                                   RASQAL_WARNING_LEVEL_BAD_TRIPLE,
@@ -1381,7 +1848,9 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
                                   "Triple with non-RDF predicate term skipped");
         skip = 1;
       } else {
-        rs->object = rasqal_literal_to_result_term(query_results, t->object);
+        rs->object = rasqal_query_results_construct_term(query_results,
+                                                         index + 2,
+                                                         t->object);
         if(!rs->object) {
           rasqal_log_warning_simple(query_results->world,
                                     RASQAL_WARNING_LEVEL_BAD_TRIPLE,
@@ -1392,6 +1861,17 @@ rasqal_query_results_get_triple(rasqal_query_results* query_results)
       }
     }
 
+    /* drop a recently returned triple unless this one has already
+     * been returned by an earlier call
+     */
+    if(!skip && query_results->construct_dedup_size &&
+       !query_results->construct_dedup_checked) {
+      if(rasqal_query_results_construct_seen(query_results, rs))
+        skip = 1;
+      else
+        query_results->construct_dedup_checked = 1;
+    }
+
     if(!skip)
       /* got triple, return it */
       break;
@@ -1434,8 +1914,12 @@ rasqal_query_results_next_triple(rasqal_query_results* query_results)
   if(!query)
     return 1;
 
-  if(query->verb == RASQAL_QUERY_VERB_DESCRIBE)
-    return 1;
+  if(query->verb == RASQAL_QUERY_VERB_DESCRIBE) {
+    query_results->describe_have_triple = 0;
+    return (rasqal_query_results_get_describe_triple(query_results) == NULL);
+  }
+
+  query_results->construct_dedup_checked = 0;
   
   if(++query_results->current_triple_result >= raptor_sequence_size(query->constructs)) {
     if(rasqal_query_results_next_internal(query_results))
@@ -1983,6 +2467,117 @@ print_bindings_results_simple(rasqal_query_results *results, FILE* output)
 }
 #endif
 
+#define CONSTRUCT_TEST_ROWS 20000
+#define CONSTRUCT_TEST_SUBJECTS 100
+
+/*
+ * Make a CONSTRUCT over CONSTRUCT_TEST_ROWS VALUES rows where subject
+ * ex:sN repeats every CONSTRUCT_TEST_SUBJECTS rows so the ex:type
+ * triple is a duplicate in all but the first row for each subject.
+ */
+static char*
+construct_test_query(void)
+{
+  static const char* const head =
+    "PREFIX ex: <http://example.org/>\n"
+    "CONSTRUCT { ?s ex:p ?o . ?s ex:type ex:T . _:b ex:of ?s }\n"
+    "WHERE { VALUES (?s ?o) {\n";
+  static const char* const tail = "} }\n";
+  char* query_string;
+  char* p;
+  int i;
+
+  query_string = RASQAL_MALLOC(char*, strlen(head) + strlen(tail) + 1 +
+                               CONSTRUCT_TEST_ROWS * 40);
+  if(!query_string)
+    return NULL;
+
+  p = query_string;
+  memcpy(p, head, strlen(head));
+  p += strlen(head);
+  for(i = 0; i < CONSTRUCT_TEST_ROWS; i++)
+    p += sprintf(p, "(ex:s%d %d)\n", i % CONSTRUCT_TEST_SUBJECTS, i);
+  memcpy(p, tail, strlen(tail) + 1);
+
+  return query_string;
+}
+
+
+/* returns number of triples or -1 on failure */
+static int
+construct_test_count(rasqal_world* world, const char* query_string,
+                     int dedup_size)
+{
+  rasqal_query* query;
+  rasqal_query_results* results = NULL;
+  int count = -1;
+
+  query = rasqal_new_query(world, "sparql11", NULL);
+  if(!query)
+    return -1;
+
+  rasqal_query_set_feature(query, RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE,
+                           dedup_size);
+  if(rasqal_query_prepare(query, (const unsigned char*)query_string, NULL))
+    goto tidy;
+
+  results = rasqal_query_execute(query);
+  if(results) {
+    count = 0;
+    while(rasqal_query_results_get_triple(results)) {
+      count++;
+      if(rasqal_query_results_next_triple(results))
+        break;
+    }
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  rasqal_free_query(query);
+
+  return count;
+}
+
+
+static int
+construct_test(const char* program, rasqal_world* world)
+{
+  char* query_string;
+  int failures = 0;
+  int count;
+
+  query_string = construct_test_query();
+  if(!query_string)
+    return 1;
+
+  /* no cache: every template triple of every row */
+  count = construct_test_count(world, query_string, 0);
+  if(count != 3 * CONSTRUCT_TEST_ROWS) {
+    fprintf(stderr, "%s: FAILED CONSTRUCT returned %d triples expected %d\n",
+            program, count, 3 * CONSTRUCT_TEST_ROWS);
+    failures++;
+  }
+
+  /* the ex:p and blank node triples are all different so only
+   * repeated ex:type triples can be dropped; the cache is direct
+   * mapped so most but not all of them are
+   */
+  count = construct_test_count(world, query_string, 1024);
+  if(count < 2 * CONSTRUCT_TEST_ROWS + CONSTRUCT_TEST_SUBJECTS ||
+     count > 2 * CONSTRUCT_TEST_ROWS + CONSTRUCT_TEST_ROWS / 2) {
+    fprintf(stderr, "%s: FAILED CONSTRUCT with duplicate cache returned %d triples expected %d to %d\n",
+            program, count, 2 * CONSTRUCT_TEST_ROWS + CONSTRUCT_TEST_SUBJECTS,
+            2 * CONSTRUCT_TEST_ROWS + CONSTRUCT_TEST_ROWS / 2);
+    failures++;
+  }
+
+  RASQAL_FREE(char*, query_string);
+
+  return failures;
+}
+
+
 int
 main(int argc, char *argv[])
 {
@@ -2039,6 +2634,8 @@ main(int argc, char *argv[])
       rasqal_free_query_results(qr);
   }
 
+  failures += construct_test(program, world);
+
   if(world)
     rasqal_free_world(world);
 
@@ -57,6 +57,7 @@ static int rasqal_query_let_build_variables_use_map_binds(rasqal_graph_pattern*
 static int rasqal_query_select_build_variables_use_map(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp);
 static int rasqal_query_select_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
 static int rasqal_query_union_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
+static int rasqal_query_minus_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp);
 static int rasqal_query_values_build_variables_use_map_binds(rasqal_query* query, unsigned short *use_map, int width, rasqal_graph_pattern* gp, unsigned short* vars_scope);
 
 
@@ -1388,6 +1389,36 @@ rasqal_query_prepare_common(rasqal_query *query)
 }
 
 
+/**
+ * rasqal_query_prepare_update_where:
+ * @query: query
+ *
+ * INTERNAL - prepare the query graph pattern of an update WHERE for execution
+ *
+ * The caller sets the query graph pattern to the WHERE graph pattern
+ * of an update operation.  This enumerates the graph patterns and
+ * builds the variable use maps for it alone, without the checks for
+ * unused variables done by rasqal_query_prepare_common() since
+ * variables may be used only in the update templates.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_query_prepare_update_where(rasqal_query *query)
+{
+  int rc;
+
+  if(!query->query_graph_pattern)
+    return 1;
+
+  rc = rasqal_query_enumerate_graph_patterns(query);
+  if(rc)
+    return rc;
+
+  return rasqal_query_build_variables_use_map(query, NULL);
+}
+
+
 /**
  * rasqal_graph_patterns_join:
  * @dest_gp: destination graph pattern
@@ -1946,8 +1977,14 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
                                                              vars_scope);
       break;
 
-    case RASQAL_GRAPH_PATTERN_OPERATOR_SERVICE:
     case RASQAL_GRAPH_PATTERN_OPERATOR_MINUS:
+      rc = rasqal_query_minus_build_variables_use_map_binds(query,
+                                                            use_map,
+                                                            width,
+                                                            gp);
+      break;
+
+    case RASQAL_GRAPH_PATTERN_OPERATOR_SERVICE:
     case RASQAL_GRAPH_PATTERN_OPERATOR_UNKNOWN:
       break;
   }
@@ -1958,8 +1995,9 @@ rasqal_query_graph_pattern_build_variables_use_map_binds(rasqal_query* query,
   rasqal_query_dump_vars_scope(query, width, vars_scope);
 #endif
 
-  /* Bind sub-graph patterns but not sub-SELECT gp twice */
-  if(gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_SELECT && gp->graph_patterns) {
+  /* Bind sub-graph patterns but not sub-SELECT or MINUS gp twice */
+  if(gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_SELECT &&
+     gp->op != RASQAL_GRAPH_PATTERN_OPERATOR_MINUS && gp->graph_patterns) {
     int gp_size = raptor_sequence_size(gp->graph_patterns);
     int i;
     
@@ -2757,6 +2795,59 @@ rasqal_query_union_build_variables_use_map_binds(rasqal_query* query,
 }
 
 
+/**
+ * rasqal_query_minus_build_variables_use_map_binds:
+ * @use_map: 2D array of (num. variables x num. GPs) to READ and WRITE
+ * @width: width of array (num. variables)
+ * @gp: graph pattern to use
+ *
+ * INTERNAL - Mark variables bound in a MINUS sub-graph pattern
+ *
+ * The MINUS graph pattern is evaluated independently of the outer
+ * graph patterns so it starts with no variables in scope and the
+ * variables it binds do not become bound outside it.
+ * 
+ **/
+static int
+rasqal_query_minus_build_variables_use_map_binds(rasqal_query* query,
+                                                 unsigned short *use_map,
+                                                 int width,
+                                                 rasqal_graph_pattern* gp)
+{
+  unsigned short* inner_vars_scope;
+  raptor_sequence* seq;
+  int gp_size;
+  int i;
+  int rc = 0;
+
+  seq = gp->graph_patterns;
+  gp_size = raptor_sequence_size(seq);
+  
+  inner_vars_scope = RASQAL_CALLOC(unsigned short*, RASQAL_GOOD_CAST(size_t, width),
+                                   sizeof(unsigned short));
+  if(!inner_vars_scope)
+    return 1;
+
+  for(i = 0; i < gp_size; i++) {
+    rasqal_graph_pattern *sgp;
+    
+    sgp = (rasqal_graph_pattern*)raptor_sequence_get_at(seq, i);
+
+    rc = rasqal_query_graph_pattern_build_variables_use_map_binds(query,
+                                                                  use_map,
+                                                                  width,
+                                                                  sgp,
+                                                                  inner_vars_scope);
+    if(rc)
+      break;
+  }
+  
+  RASQAL_FREE(intarray, inner_vars_scope);
+  
+  return rc;
+}
+
+
 /**
  * rasqal_query_values_build_variables_use_map_binds:
  * @use_map: 2D array of (num. variables x num. GPs) to READ and WRITE
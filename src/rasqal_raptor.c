@@ -43,11 +43,26 @@
 
 struct rasqal_raptor_triple_s {
   struct rasqal_raptor_triple_s *next;
+  /* next triple with the same subject */
+  struct rasqal_raptor_triple_s *next_subject;
   rasqal_triple *triple;
 };
 
 typedef struct rasqal_raptor_triple_s rasqal_raptor_triple;
 
+/* triples with one subject, in a subject index hash bucket chain */
+struct rasqal_raptor_subject_s {
+  struct rasqal_raptor_subject_s *next;
+  unsigned int hash;
+  rasqal_raptor_triple *head;
+  rasqal_raptor_triple *tail;
+};
+
+typedef struct rasqal_raptor_subject_s rasqal_raptor_subject;
+
+/* initial size of subject index: power of 2 */
+#define RASQAL_RAPTOR_SUBJECTS_INITIAL_SIZE 64
+
 typedef struct {
   rasqal_world* world;
 
@@ -72,6 +87,14 @@ typedef struct {
   unsigned char* mapped_id_base;
   /* length of above string */
   size_t mapped_id_base_len;
+
+  /* subject index: hash buckets of triples by subject.  Size is 0 or
+   * a power of 2.  If building it ever failed, matches scan all triples.
+   */
+  rasqal_raptor_subject** subjects;
+  unsigned int subjects_size;
+  unsigned int subjects_count;
+  int subjects_failed;
 } rasqal_raptor_triples_source_user_data;
 
 
@@ -95,25 +118,164 @@ raptor_statement_as_rasqal_triple(rasqal_world* world,
 }
 
 
-static void
-rasqal_raptor_statement_handler(void *user_data,
-                                raptor_statement *statement)
+/*
+ * rasqal_raptor_find_subject:
+ * @rtsc: triples source
+ * @subject: subject URI or blank node literal
+ * @hash: rasqal_literal_hash() of @subject
+ *
+ * INTERNAL - Find the triples with subject @subject in the subject index
+ *
+ * Return value: subject entry or NULL if there are no such triples
+ */
+static rasqal_raptor_subject*
+rasqal_raptor_find_subject(rasqal_raptor_triples_source_user_data* rtsc,
+                           rasqal_literal* subject, unsigned int hash)
+{
+  rasqal_raptor_subject* s;
+
+  if(!rtsc->subjects_size)
+    return NULL;
+
+  for(s = rtsc->subjects[hash & (rtsc->subjects_size - 1)]; s; s = s->next) {
+    if(s->hash == hash &&
+       rasqal_literal_equals_flags(s->head->triple->subject, subject,
+                                   RASQAL_COMPARE_RDF, NULL))
+      return s;
+  }
+
+  return NULL;
+}
+
+
+/*
+ * rasqal_raptor_index_triple:
+ * @rtsc: triples source
+ * @triple: triple just added to the end of the triples list
+ *
+ * INTERNAL - Add a triple to the subject index
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_raptor_index_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                           rasqal_raptor_triple* triple)
+{
+  rasqal_raptor_subject* s;
+  unsigned int hash;
+  unsigned int b;
+
+  hash = rasqal_literal_hash(triple->triple->subject, RASQAL_LITERAL_HASH_INIT);
+
+  s = rasqal_raptor_find_subject(rtsc, triple->triple->subject, hash);
+  if(s) {
+    s->tail->next_subject = triple;
+    s->tail = triple;
+    return 0;
+  }
+
+  if(rtsc->subjects_count >= rtsc->subjects_size) {
+    unsigned int new_size;
+    rasqal_raptor_subject** new_subjects;
+    unsigned int i;
+
+    new_size = rtsc->subjects_size ? rtsc->subjects_size << 1 : RASQAL_RAPTOR_SUBJECTS_INITIAL_SIZE;
+    new_subjects = RASQAL_CALLOC(rasqal_raptor_subject**, new_size,
+                                 sizeof(rasqal_raptor_subject*));
+    if(!new_subjects)
+      return 1;
+
+    for(i = 0; i < rtsc->subjects_size; i++) {
+      rasqal_raptor_subject* next;
+
+      for(s = rtsc->subjects[i]; s; s = next) {
+        next = s->next;
+        b = s->hash & (new_size - 1);
+        s->next = new_subjects[b];
+        new_subjects[b] = s;
+      }
+    }
+
+    if(rtsc->subjects)
+      RASQAL_FREE(rasqal_raptor_subject**, rtsc->subjects);
+    rtsc->subjects = new_subjects;
+    rtsc->subjects_size = new_size;
+  }
+
+  s = RASQAL_MALLOC(rasqal_raptor_subject*, sizeof(*s));
+  if(!s)
+    return 1;
+
+  b = hash & (rtsc->subjects_size - 1);
+  s->hash = hash;
+  s->head = triple;
+  s->tail = triple;
+  s->next = rtsc->subjects[b];
+  rtsc->subjects[b] = s;
+  rtsc->subjects_count++;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_raptor_subject_triples:
+ * @rtsc: triples source
+ * @subject: match subject literal
+ * @triple_p: pointer to store first triple with @subject (or NULL)
+ *
+ * INTERNAL - Find the first triple for a match subject from the subject index
+ *
+ * Return value: non-0 if the index was used; else all triples must be scanned
+ */
+static int
+rasqal_raptor_subject_triples(rasqal_raptor_triples_source_user_data* rtsc,
+                              rasqal_literal* subject,
+                              rasqal_raptor_triple** triple_p)
+{
+  rasqal_raptor_subject* s;
+
+  if(!subject || rtsc->subjects_failed)
+    return 0;
+
+  /* triple subjects are only ever URIs or blank nodes */
+  if(subject->type != RASQAL_LITERAL_URI &&
+     subject->type != RASQAL_LITERAL_BLANK)
+    return 0;
+
+  s = rasqal_raptor_find_subject(rtsc, subject,
+                                 rasqal_literal_hash(subject,
+                                                     RASQAL_LITERAL_HASH_INIT));
+  *triple_p = s ? s->head : NULL;
+
+  return 1;
+}
+
+
+/* append a triple read from data graph @source_index (ownership taken) */
+static int
+rasqal_raptor_add_triple(rasqal_raptor_triples_source_user_data* rtsc,
+                         rasqal_triple* t, int source_index)
 {
-  rasqal_raptor_triples_source_user_data* rtsc;
   rasqal_raptor_triple *triple;
-  
-  rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
+
+  if(!t)
+    return 1;
 
   triple = RASQAL_MALLOC(rasqal_raptor_triple*, sizeof(rasqal_raptor_triple));
+  if(!triple) {
+    rasqal_free_triple(t);
+    return 1;
+  }
   triple->next = NULL;
-  triple->triple = raptor_statement_as_rasqal_triple(rtsc->world,
-                                                     statement);
+  triple->next_subject = NULL;
+  triple->triple = t;
 
   /* this origin URI literal is shared amongst the triples and
    * freed only in rasqal_raptor_free_triples_source
    */
   rasqal_triple_set_origin(triple->triple, 
-                           rtsc->source_literals[rtsc->source_index]);
+                           rtsc->source_literals[source_index]);
 
   if(rtsc->tail)
     rtsc->tail->next = triple;
@@ -121,6 +283,35 @@ rasqal_raptor_statement_handler(void *user_data,
     rtsc->head = triple;
 
   rtsc->tail = triple;
+
+  if(!rtsc->subjects_failed && rasqal_raptor_index_triple(rtsc, triple))
+    rtsc->subjects_failed = 1;
+
+  return 0;
+}
+
+
+static void
+rasqal_raptor_statement_handler(void *user_data,
+                                raptor_statement *statement)
+{
+  rasqal_raptor_triples_source_user_data* rtsc;
+  
+  rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
+
+  rasqal_raptor_add_triple(rtsc,
+                           raptor_statement_as_rasqal_triple(rtsc->world,
+                                                             statement),
+                           rtsc->source_index);
+}
+
+
+static int
+rasqal_raptor_ntriples_handler(void *user_data, int index,
+                               rasqal_triple* triple)
+{
+  return rasqal_raptor_add_triple((rasqal_raptor_triples_source_user_data*)user_data,
+                                  triple, index);
 }
 
 
@@ -207,6 +398,7 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
 {
   rasqal_raptor_triples_source_user_data* rtsc;
   raptor_parser *parser;
+  rasqal_ntriples_load* load = NULL;
   int i;
   int rc = 0;
 
@@ -239,6 +431,24 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
     return 0;
   }
 
+  for(i = 0; i < rtsc->sources_count; i++) {
+    rasqal_data_graph *dg;
+
+    dg = (rasqal_data_graph*)raptor_sequence_get_at(data_graphs, i);
+    if(dg->name_uri)
+      rtsc->source_literals[i] = rasqal_new_uri_literal(world,
+                                                        raptor_uri_copy(dg->name_uri)
+                                                        );
+  }
+
+  if(world->load_threads > 1) {
+    /* N-Triples files are scanned in parallel now and merged in
+     * data graph order below */
+    load = rasqal_new_ntriples_load(world, data_graphs, world->load_threads);
+    if(!load)
+      return 1;
+  }
+
   for(i = 0; i < rtsc->sources_count; i++) {
     rasqal_data_graph *dg;
     raptor_uri* uri = NULL;
@@ -247,6 +457,16 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
     const char* parser_name;
     raptor_iostream* iostr = NULL;
     
+    if(load && rasqal_ntriples_load_has_data_graph(load, i)) {
+      rc = rasqal_ntriples_load_merge_data_graph(load, i,
+                                                 RASQAL_GOOD_CAST(const unsigned char*, "graphid"),
+                                                 rasqal_raptor_ntriples_handler,
+                                                 rtsc);
+      if(rc)
+        break;
+      continue;
+    }
+
     dg = (rasqal_data_graph*)raptor_sequence_get_at(data_graphs, i);
     uri = dg->uri;
     name_uri = dg->name_uri;
@@ -256,11 +476,7 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
     if(uri)
       rtsc->source_uri = raptor_uri_copy(uri);
 
-    if(name_uri)
-      rtsc->source_literals[i] = rasqal_new_uri_literal(world,
-                                                        raptor_uri_copy(name_uri)
-                                                        );
-    else if(uri) {
+    if(!name_uri && uri) {
       name_uri = raptor_uri_copy(uri);
       free_name_uri = 1;
     }
@@ -323,6 +539,9 @@ rasqal_raptor_init_triples_source_common(rasqal_world* world,
       break;
   }
 
+  if(load)
+    rasqal_free_ntriples_load(load);
+
   return rc;
 }
 
@@ -468,6 +687,174 @@ rasqal_raptor_triple_match(rasqal_world* world,
 }
 
 
+/**
+ * rasqal_raptor_triple_bind:
+ * @triple: matched triple
+ * @bindings: variables for the subject, predicate, object and origin
+ * @parts: parts of the triple to bind
+ *
+ * INTERNAL - Bind variables to the fields of a matched triple
+ *
+ * Return value: parts bound or 0 if a repeated variable does not match
+ */
+rasqal_triple_parts
+rasqal_raptor_triple_bind(rasqal_triple* triple,
+                          rasqal_variable* bindings[4],
+                          rasqal_triple_parts parts)
+{
+  int error = 0;
+  rasqal_triple_parts result = (rasqal_triple_parts)0;
+  
+  /* set variable values from the fields of statement */
+
+  if(bindings[0] && (parts & RASQAL_TRIPLE_SUBJECT)) {
+    rasqal_literal *l = triple->subject;
+    RASQAL_DEBUG1("binding subject to variable\n");
+    rasqal_variable_set_value(bindings[0], rasqal_new_literal_from_literal(l));
+    result = RASQAL_TRIPLE_SUBJECT;
+  }
+
+  if(bindings[1] && (parts & RASQAL_TRIPLE_PREDICATE)) {
+    if(bindings[0] == bindings[1]) {
+      if(!rasqal_literal_equals_flags(triple->subject,
+                                      triple->predicate,
+                                      RASQAL_COMPARE_RDF, &error))
+        return (rasqal_triple_parts)0;
+      if(error)
+        return (rasqal_triple_parts)0;
+      
+      RASQAL_DEBUG1("subject and predicate values match\n");
+    } else {
+      rasqal_literal *l = triple->predicate;
+      RASQAL_DEBUG1("binding predicate to variable\n");
+      rasqal_variable_set_value(bindings[1], rasqal_new_literal_from_literal(l));
+      result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_PREDICATE);
+    }
+  }
+
+  if(bindings[2] && (parts & RASQAL_TRIPLE_OBJECT)) {
+    int bind = 1;
+    
+    if(bindings[0] == bindings[2]) {
+      if(!rasqal_literal_equals_flags(triple->subject,
+                                      triple->object,
+                                      RASQAL_COMPARE_RDF, &error))
+        return (rasqal_triple_parts)0;
+      if(error)
+        return (rasqal_triple_parts)0;
+
+      bind = 0;
+      RASQAL_DEBUG1("subject and object values match\n");
+    }
+    if(bindings[1] == bindings[2] &&
+       !(bindings[0] == bindings[1]) /* don't do this check if ?x ?x ?x */
+       ) {
+      if(!rasqal_literal_equals_flags(triple->predicate,
+                                      triple->object,
+                                      RASQAL_COMPARE_RDF, &error))
+        return (rasqal_triple_parts)0;
+      if(error)
+        return (rasqal_triple_parts)0;
+
+      bind = 0;
+      RASQAL_DEBUG1("predicate and object values match\n");
+    }
+    
+    if(bind) {
+      rasqal_literal *l = triple->object;
+      RASQAL_DEBUG1("binding object to variable\n");
+      rasqal_variable_set_value(bindings[2], rasqal_new_literal_from_literal(l));
+      result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_OBJECT);
+    }
+  }
+
+  if(bindings[3] && (parts & RASQAL_TRIPLE_ORIGIN)) {
+    rasqal_literal *l;
+    l = rasqal_new_literal_from_literal(triple->origin);
+    RASQAL_DEBUG1("binding origin to variable\n");
+    rasqal_variable_set_value(bindings[3], l);
+    result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_ORIGIN);
+  }
+
+  return result;
+}
+
+
+/**
+ * rasqal_raptor_triple_match_init:
+ * @match: triple to fill with the fixed parts of @t to match against
+ * @m: triple pattern metadata
+ * @t: triple pattern
+ *
+ * INTERNAL - Set up the match triple and variable bindings for a triple pattern
+ *
+ * Variables in @t that are bound by @m are reset and recorded in the
+ * @m bindings; those already bound elsewhere are matched by value.
+ * The fields of @match hold new references.
+ *
+ * Return value: parts of @match to compare with rasqal_raptor_triple_match()
+ */
+rasqal_triple_parts
+rasqal_raptor_triple_match_init(rasqal_triple* match, rasqal_triple_meta* m,
+                                rasqal_triple* t)
+{
+  rasqal_variable* var;
+  rasqal_triple_parts parts;
+
+  if((var = rasqal_literal_as_variable(t->subject))) {
+    if(m->parts & RASQAL_TRIPLE_SUBJECT)
+      /* we bind it so reset it */
+      rasqal_variable_set_value(var, NULL);
+    else if(var->value)
+      match->subject = rasqal_new_literal_from_literal(var->value);
+  } else
+    match->subject = rasqal_new_literal_from_literal(t->subject);
+
+  m->bindings[0] = var;
+  
+
+  if((var = rasqal_literal_as_variable(t->predicate))) {
+    if(m->parts & RASQAL_TRIPLE_PREDICATE)
+      /* we bind it so reset it */
+      rasqal_variable_set_value(var, NULL);
+    else if(var->value)
+      match->predicate = rasqal_new_literal_from_literal(var->value);
+  } else
+    match->predicate = rasqal_new_literal_from_literal(t->predicate);
+
+  m->bindings[1] = var;
+  
+
+  if((var = rasqal_literal_as_variable(t->object))) {
+    if(m->parts & RASQAL_TRIPLE_OBJECT)
+      /* we bind it so reset it */
+      rasqal_variable_set_value(var, NULL);
+    else if(var->value)
+      match->object = rasqal_new_literal_from_literal(var->value);
+  } else
+    match->object = rasqal_new_literal_from_literal(t->object);
+
+  m->bindings[2] = var;
+  
+  parts = RASQAL_TRIPLE_SPO;
+
+  if(t->origin) {
+    if((var = rasqal_literal_as_variable(t->origin))) {
+    if(m->parts & RASQAL_TRIPLE_ORIGIN)
+      /* we bind it so reset it */
+      rasqal_variable_set_value(var, NULL);
+    else if(var->value)
+        match->origin = rasqal_new_literal_from_literal(var->value);
+    } else
+      match->origin = rasqal_new_literal_from_literal(t->origin);
+    m->bindings[3] = var;
+    parts = (rasqal_triple_parts)(parts | RASQAL_TRIPLE_GRAPH);
+  }
+  
+  return parts;
+}
+
+
 /* non-0 if present */
 static int
 rasqal_raptor_triple_present(rasqal_triples_source *rts, void *user_data, 
@@ -482,6 +869,14 @@ rasqal_raptor_triple_present(rasqal_triples_source *rts, void *user_data,
   if(t->origin)
     parts = (rasqal_triple_parts)(parts | RASQAL_TRIPLE_GRAPH);
 
+  if(rasqal_raptor_subject_triples(rtsc, t->subject, &triple)) {
+    for(; triple; triple = triple->next_subject) {
+      if(rasqal_raptor_triple_match(rtsc->world, triple->triple, t, parts))
+        return 1;
+    }
+    return 0;
+  }
+
   for(triple = rtsc->head; triple; triple = triple->next) {
     if(rasqal_raptor_triple_match(rtsc->world, triple->triple, t, parts))
       return 1;
@@ -509,6 +904,21 @@ rasqal_raptor_free_triples_source(void *user_data)
     cur = next;
   }
 
+  if(rtsc->subjects) {
+    unsigned int j;
+
+    for(j = 0; j < rtsc->subjects_size; j++) {
+      rasqal_raptor_subject* s = rtsc->subjects[j];
+
+      while(s) {
+        rasqal_raptor_subject* next = s->next;
+        RASQAL_FREE(rasqal_raptor_subject, s);
+        s = next;
+      }
+    }
+    RASQAL_FREE(rasqal_raptor_subject**, rtsc->subjects);
+  }
+
   for(i = 0; i < rtsc->sources_count; i++) {
     if(rtsc->source_literals[i])
       rasqal_free_literal(rtsc->source_literals[i]);
@@ -544,6 +954,9 @@ typedef struct {
   rasqal_triple_parts parts;
 
   unsigned int bind_parts;
+
+  /* non-0 if walking the subject index chain rather than all triples */
+  int by_subject;
 } rasqal_raptor_triples_match_context;
 
 
@@ -554,8 +967,6 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
                          rasqal_triple_parts parts)
 {
   rasqal_raptor_triples_match_context* rtmc;
-  int error = 0;
-  rasqal_triple_parts result = (rasqal_triple_parts)0;
   
   rtmc = (rasqal_raptor_triples_match_context*)rtm->user_data;
 
@@ -568,78 +979,7 @@ rasqal_raptor_bind_match(struct rasqal_triples_match_s* rtm,
     RASQAL_FATAL1("  matched NO statement - BUG\n");
 #endif
 
-  /* set variable values from the fields of statement */
-
-  if(bindings[0] && (parts & RASQAL_TRIPLE_SUBJECT)) {
-    rasqal_literal *l = rtmc->cur->triple->subject;
-    RASQAL_DEBUG1("binding subject to variable\n");
-    rasqal_variable_set_value(bindings[0], rasqal_new_literal_from_literal(l));
-    result = RASQAL_TRIPLE_SUBJECT;
-  }
-
-  if(bindings[1] && (parts & RASQAL_TRIPLE_PREDICATE)) {
-    if(bindings[0] == bindings[1]) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->subject,
-                                      rtmc->cur->triple->predicate,
-                                      RASQAL_COMPARE_RDF, &error))
-        return (rasqal_triple_parts)0;
-      if(error)
-        return (rasqal_triple_parts)0;
-      
-      RASQAL_DEBUG1("subject and predicate values match\n");
-    } else {
-      rasqal_literal *l = rtmc->cur->triple->predicate;
-      RASQAL_DEBUG1("binding predicate to variable\n");
-      rasqal_variable_set_value(bindings[1], rasqal_new_literal_from_literal(l));
-      result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_PREDICATE);
-    }
-  }
-
-  if(bindings[2] && (parts & RASQAL_TRIPLE_OBJECT)) {
-    int bind = 1;
-    
-    if(bindings[0] == bindings[2]) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->subject,
-                                      rtmc->cur->triple->object,
-                                      RASQAL_COMPARE_RDF, &error))
-        return (rasqal_triple_parts)0;
-      if(error)
-        return (rasqal_triple_parts)0;
-
-      bind = 0;
-      RASQAL_DEBUG1("subject and object values match\n");
-    }
-    if(bindings[1] == bindings[2] &&
-       !(bindings[0] == bindings[1]) /* don't do this check if ?x ?x ?x */
-       ) {
-      if(!rasqal_literal_equals_flags(rtmc->cur->triple->predicate,
-                                      rtmc->cur->triple->object,
-                                      RASQAL_COMPARE_RDF, &error))
-        return (rasqal_triple_parts)0;
-      if(error)
-        return (rasqal_triple_parts)0;
-
-      bind = 0;
-      RASQAL_DEBUG1("predicate and object values match\n");
-    }
-    
-    if(bind) {
-      rasqal_literal *l = rtmc->cur->triple->object;
-      RASQAL_DEBUG1("binding object to variable\n");
-      rasqal_variable_set_value(bindings[2], rasqal_new_literal_from_literal(l));
-      result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_OBJECT);
-    }
-  }
-
-  if(bindings[3] && (parts & RASQAL_TRIPLE_ORIGIN)) {
-    rasqal_literal *l;
-    l = rasqal_new_literal_from_literal(rtmc->cur->triple->origin);
-    RASQAL_DEBUG1("binding origin to variable\n");
-    rasqal_variable_set_value(bindings[3], l);
-    result = (rasqal_triple_parts)(result | RASQAL_TRIPLE_ORIGIN);
-  }
-
-  return result;
+  return rasqal_raptor_triple_bind(rtmc->cur->triple, bindings, parts);
 }
 
 
@@ -675,7 +1015,7 @@ rasqal_raptor_next_match(struct rasqal_triples_match_s* rtm, void *user_data)
 #endif
 
   while(rtmc->cur) {
-    rtmc->cur = rtmc->cur->next;
+    rtmc->cur = rtmc->by_subject ? rtmc->cur->next_subject : rtmc->cur->next;
 #ifdef RASQAL_DEBUG
     if(!rtmc->cur) {
       RASQAL_DEBUG1("triple match ended when matching ");
@@ -732,7 +1072,6 @@ rasqal_raptor_init_triples_match(rasqal_triples_match* rtm,
 {
   rasqal_raptor_triples_source_user_data* rtsc;
   rasqal_raptor_triples_match_context* rtmc;
-  rasqal_variable* var;
 
   rtsc = (rasqal_raptor_triples_source_user_data*)user_data;
 
@@ -756,63 +1095,17 @@ rasqal_raptor_init_triples_match(rasqal_triples_match* rtm,
   /* at least one of the triple terms is a variable and we need to
    * do a triplesMatching() over the list of stored raptor_statements
    */
+  rtmc->parts = rasqal_raptor_triple_match_init(&rtmc->match, m, t);
 
-  if((var = rasqal_literal_as_variable(t->subject))) {
-    if(rtmc->bind_parts & RASQAL_TRIPLE_SUBJECT)
-      /* we bind it so reset it */
-      rasqal_variable_set_value(var, NULL);
-    else if(var->value)
-      rtmc->match.subject = rasqal_new_literal_from_literal(var->value);
-  } else
-    rtmc->match.subject = rasqal_new_literal_from_literal(t->subject);
-
-  m->bindings[0] = var;
-  
-
-  if((var = rasqal_literal_as_variable(t->predicate))) {
-    if(rtmc->bind_parts & RASQAL_TRIPLE_PREDICATE)
-      /* we bind it so reset it */
-      rasqal_variable_set_value(var, NULL);
-    else if(var->value)
-      rtmc->match.predicate = rasqal_new_literal_from_literal(var->value);
-  } else
-    rtmc->match.predicate = rasqal_new_literal_from_literal(t->predicate);
-
-  m->bindings[1] = var;
-  
-
-  if((var = rasqal_literal_as_variable(t->object))) {
-    if(rtmc->bind_parts & RASQAL_TRIPLE_OBJECT)
-      /* we bind it so reset it */
-      rasqal_variable_set_value(var, NULL);
-    else if(var->value)
-      rtmc->match.object = rasqal_new_literal_from_literal(var->value);
-  } else
-    rtmc->match.object = rasqal_new_literal_from_literal(t->object);
-
-  m->bindings[2] = var;
-  
-  rtmc->parts = RASQAL_TRIPLE_SPO;
-
-  if(t->origin) {
-    if((var = rasqal_literal_as_variable(t->origin))) {
-    if(rtmc->bind_parts & RASQAL_TRIPLE_ORIGIN)
-      /* we bind it so reset it */
-      rasqal_variable_set_value(var, NULL);
-    else if(var->value)
-        rtmc->match.origin = rasqal_new_literal_from_literal(var->value);
-    } else
-      rtmc->match.origin = rasqal_new_literal_from_literal(t->origin);
-    m->bindings[3] = var;
-    rtmc->parts = (rasqal_triple_parts)(rtmc->parts | RASQAL_TRIPLE_GRAPH);
-  }
-  
+  /* with a known subject only walk the triples with that subject */
+  rtmc->by_subject = rasqal_raptor_subject_triples(rtsc, rtmc->match.subject,
+                                                   &rtmc->cur);
 
   while(rtmc->cur) {
     if(rasqal_raptor_triple_match(rtm->world, rtmc->cur->triple, &rtmc->match,
                                   rtmc->parts))
       break;
-    rtmc->cur = rtmc->cur->next;
+    rtmc->cur = rtmc->by_subject ? rtmc->cur->next_subject : rtmc->cur->next;
   }
   
   return 0;
@@ -827,3 +1120,18 @@ rasqal_raptor_init(rasqal_world* world)
                                     (void*)NULL);
   return 0;
 }
+
+
+/*
+ * rasqal_raptor_is_triples_source_factory:
+ * @world: world
+ *
+ * INTERNAL - Test if the default raptor triples source factory is registered
+ *
+ * Return value: non-0 if the raptor factory is used
+ */
+int
+rasqal_raptor_is_triples_source_factory(rasqal_world* world)
+{
+  return world->triples_source_factory_register_fn == rasqal_raptor_register_triples_source_factory;
+}
@@ -0,0 +1,1177 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_result_cache.c - Rasqal query result cache
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+/*
+ * The cache maps a key describing a query execution - the written
+ * form of the final algebra plus the verb, limit, offset and data
+ * graphs - to the result rows the algebra rowsource returned for it.
+ * Rows are held as arrays of literal references so an entry does not
+ * depend on the query, variables or rowsource that produced it.
+ *
+ * Entries are found by hash and full key comparison and are kept on
+ * a doubly linked list in order of use; the least recently used
+ * entries are dropped when the total size goes over the budget.
+ * Entries are reference counted so a rowsource replaying an entry
+ * stays valid if the entry is evicted meanwhile.
+ *
+ * A new entry is recorded by a rowsource wrapped around the query
+ * plan while the query results read through it.  It is added once
+ * the plan is exhausted or once more rows than the query LIMIT and
+ * OFFSET need have been read, since the query results never read
+ * further than that.
+ */
+
+#define RASQAL_RESULT_CACHE_BUCKETS 256
+
+
+typedef struct rasqal_result_cache_entry_s rasqal_result_cache_entry;
+
+struct rasqal_result_cache_entry_s {
+  /* next entry in hash bucket */
+  rasqal_result_cache_entry* bucket_next;
+
+  /* LRU list neighbours: prev is more recently used */
+  rasqal_result_cache_entry* prev;
+  rasqal_result_cache_entry* next;
+
+  int usage;
+
+  unsigned int hash;
+  unsigned char* key;
+  size_t key_len;
+
+  /* number of columns and their variable names and types */
+  int size;
+  unsigned char** names;
+  rasqal_variable_type* types;
+
+  /* rows_count * size literal references; NULL for unbound */
+  int rows_count;
+  rasqal_literal** values;
+
+  /* estimated memory used */
+  size_t bytes;
+};
+
+
+struct rasqal_result_cache_s {
+  rasqal_world* world;
+
+  /* memory budget and estimated memory used by entries */
+  size_t max_bytes;
+  size_t bytes;
+
+  rasqal_result_cache_entry* buckets[RASQAL_RESULT_CACHE_BUCKETS];
+
+  /* most and least recently used entries */
+  rasqal_result_cache_entry* head;
+  rasqal_result_cache_entry* tail;
+
+  int entries_count;
+
+  /* statistics */
+  int hits;
+  int misses;
+  int evictions;
+};
+
+
+static unsigned int
+rasqal_result_cache_hash(const unsigned char* key, size_t key_len)
+{
+  unsigned int hash = 2166136261U;
+  size_t i;
+
+  /* FNV-1a */
+  for(i = 0; i < key_len; i++) {
+    hash ^= key[i];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+static size_t
+rasqal_result_cache_literal_bytes(rasqal_literal* l)
+{
+  size_t bytes;
+
+  if(!l)
+    return 0;
+
+  bytes = sizeof(*l) + l->string_len + 1;
+  if(l->language)
+    bytes += strlen(l->language) + 1;
+
+  return bytes;
+}
+
+
+static void
+rasqal_free_result_cache_entry(rasqal_result_cache_entry* entry)
+{
+  int i;
+
+  if(!entry)
+    return;
+
+  if(--entry->usage)
+    return;
+
+  if(entry->values) {
+    for(i = 0; i < entry->rows_count * entry->size; i++) {
+      if(entry->values[i])
+        rasqal_free_literal(entry->values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, entry->values);
+  }
+
+  if(entry->names) {
+    for(i = 0; i < entry->size; i++) {
+      if(entry->names[i])
+        RASQAL_FREE(char*, entry->names[i]);
+    }
+    RASQAL_FREE(char**, entry->names);
+  }
+
+  if(entry->types)
+    RASQAL_FREE(rasqal_variable_type*, entry->types);
+
+  if(entry->key)
+    RASQAL_FREE(char*, entry->key);
+
+  RASQAL_FREE(rasqal_result_cache_entry, entry);
+}
+
+
+/**
+ * rasqal_new_result_cache:
+ * @world: world
+ * @max_bytes: memory budget in bytes (> 0)
+ *
+ * INTERNAL - Constructor - create a new query result cache
+ *
+ * Return value: new result cache or NULL on failure
+ */
+rasqal_result_cache*
+rasqal_new_result_cache(rasqal_world* world, size_t max_bytes)
+{
+  rasqal_result_cache* cache;
+
+  if(!world || !max_bytes)
+    return NULL;
+
+  cache = RASQAL_CALLOC(rasqal_result_cache*, 1, sizeof(*cache));
+  if(!cache)
+    return NULL;
+
+  cache->world = world;
+  cache->max_bytes = max_bytes;
+
+  return cache;
+}
+
+
+static void
+rasqal_result_cache_remove_entry(rasqal_result_cache* cache,
+                                 rasqal_result_cache_entry* entry)
+{
+  rasqal_result_cache_entry** entry_p;
+
+  entry_p = &cache->buckets[entry->hash % RASQAL_RESULT_CACHE_BUCKETS];
+  while(*entry_p != entry)
+    entry_p = &(*entry_p)->bucket_next;
+  *entry_p = entry->bucket_next;
+
+  if(entry->prev)
+    entry->prev->next = entry->next;
+  else
+    cache->head = entry->next;
+  if(entry->next)
+    entry->next->prev = entry->prev;
+  else
+    cache->tail = entry->prev;
+
+  cache->bytes -= entry->bytes;
+  cache->entries_count--;
+
+  rasqal_free_result_cache_entry(entry);
+}
+
+
+/* evict least recently used entries until @bytes more fit the budget */
+static void
+rasqal_result_cache_evict(rasqal_result_cache* cache, size_t bytes)
+{
+  while(cache->tail && cache->bytes + bytes > cache->max_bytes) {
+    RASQAL_DEBUG3("Evicting cached result of %d rows, %d bytes\n",
+                  cache->tail->rows_count,
+                  RASQAL_GOOD_CAST(int, cache->tail->bytes));
+    rasqal_result_cache_remove_entry(cache, cache->tail);
+    cache->evictions++;
+  }
+}
+
+
+/**
+ * rasqal_result_cache_flush:
+ * @cache: result cache
+ *
+ * INTERNAL - Remove all entries from a result cache
+ */
+void
+rasqal_result_cache_flush(rasqal_result_cache* cache)
+{
+  if(!cache)
+    return;
+
+  while(cache->head)
+    rasqal_result_cache_remove_entry(cache, cache->head);
+}
+
+
+/**
+ * rasqal_free_result_cache:
+ * @cache: result cache
+ *
+ * INTERNAL - Destructor - destroy a query result cache
+ */
+void
+rasqal_free_result_cache(rasqal_result_cache* cache)
+{
+  if(!cache)
+    return;
+
+  rasqal_result_cache_flush(cache);
+
+  RASQAL_FREE(rasqal_result_cache, cache);
+}
+
+
+/**
+ * rasqal_result_cache_set_max_bytes:
+ * @cache: result cache
+ * @max_bytes: memory budget in bytes (> 0)
+ *
+ * INTERNAL - Change the memory budget of a result cache
+ *
+ * Entries are evicted until they fit the new budget.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_result_cache_set_max_bytes(rasqal_result_cache* cache, size_t max_bytes)
+{
+  if(!cache || !max_bytes)
+    return 1;
+
+  cache->max_bytes = max_bytes;
+  rasqal_result_cache_evict(cache, 0);
+
+  return 0;
+}
+
+
+/**
+ * rasqal_result_cache_new_key:
+ * @query: query
+ * @node: final algebra node for the query
+ * @key_len_p: pointer to store the key length
+ *
+ * INTERNAL - Build the result cache key for executing a query
+ *
+ * The key is the written algebra plus everything outside it that
+ * changes the result rows: the verb, limit, offset and the dataset -
+ * the data graphs or the world persistent dataset.  Queries whose
+ * results are not a function of that dataset get no key: DESCRIBE,
+ * SERVICE, data graphs read from an iostream, non-deterministic
+ * functions such as RAND() and NOW() and data from a triples source
+ * factory other than the default raptor one, which rasqal cannot
+ * see change.
+ *
+ * Return value: new key string or NULL if the query cannot be cached
+ */
+unsigned char*
+rasqal_result_cache_new_key(rasqal_query* query, rasqal_algebra_node* node,
+                            size_t* key_len_p)
+{
+  raptor_iostream* iostr;
+  unsigned char* key = NULL;
+  rasqal_data_graph* dg;
+  int world_dataset;
+  int i;
+
+  if(query->verb == RASQAL_QUERY_VERB_DESCRIBE)
+    return NULL;
+
+  /* changes to the world dataset bump the dataset version; anything
+   * else must be data graphs parsed by the raptor factory */
+  world_dataset = rasqal_query_uses_world_dataset(query);
+  if(!world_dataset &&
+     (!rasqal_query_get_data_graph(query, 0) ||
+      !rasqal_raptor_is_triples_source_factory(query->world)))
+    return NULL;
+
+  if(rasqal_algebra_node_is_volatile(query, node))
+    return NULL;
+
+  for(i = 0; (dg = rasqal_query_get_data_graph(query, i)); i++) {
+    if(dg->iostr || !dg->uri)
+      return NULL;
+  }
+
+  iostr = raptor_new_iostream_to_string(query->world->raptor_world_ptr,
+                                        (void**)&key, key_len_p,
+                                        rasqal_alloc_memory);
+  if(!iostr)
+    return NULL;
+
+  raptor_iostream_string_write(rasqal_query_verb_as_string(query->verb),
+                               iostr);
+  raptor_iostream_string_write(" limit ", iostr);
+  raptor_iostream_decimal_write(rasqal_query_get_limit(query), iostr);
+  raptor_iostream_string_write(" offset ", iostr);
+  raptor_iostream_decimal_write(rasqal_query_get_offset(query), iostr);
+  raptor_iostream_write_byte('\n', iostr);
+
+  if(world_dataset)
+    raptor_iostream_string_write("data world\n", iostr);
+
+  for(i = 0; (dg = rasqal_query_get_data_graph(query, i)); i++) {
+    raptor_iostream_string_write("data <", iostr);
+    raptor_iostream_string_write(raptor_uri_as_string(dg->uri), iostr);
+    raptor_iostream_write_byte('>', iostr);
+    if(dg->flags == RASQAL_DATA_GRAPH_NAMED && dg->name_uri) {
+      raptor_iostream_string_write(" named <", iostr);
+      raptor_iostream_string_write(raptor_uri_as_string(dg->name_uri), iostr);
+      raptor_iostream_write_byte('>', iostr);
+    }
+    if(dg->format_name) {
+      raptor_iostream_string_write(" format ", iostr);
+      raptor_iostream_string_write(dg->format_name, iostr);
+    }
+    raptor_iostream_write_byte('\n', iostr);
+  }
+
+  rasqal_algebra_algebra_node_write(node, iostr);
+
+  raptor_free_iostream(iostr);
+
+  return key;
+}
+
+
+/*
+ * Replay rowsource - returns the rows of a cache entry
+ */
+
+typedef struct
+{
+  rasqal_result_cache_entry* entry;
+
+  /* index of next row to return */
+  int offset;
+} rasqal_result_cache_replay_rowsource_context;
+
+
+static int
+rasqal_result_cache_replay_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                                      void *user_data)
+{
+  rasqal_result_cache_replay_rowsource_context* con;
+  rasqal_result_cache_entry* entry;
+  int i;
+
+  con = (rasqal_result_cache_replay_rowsource_context*)user_data;
+  entry = con->entry;
+
+  rowsource->size = 0;
+  for(i = 0; i < entry->size; i++) {
+    rasqal_variable* v;
+    int rc;
+
+    /* the query algebra was built again so its variables are present */
+    v = rasqal_variables_table_get_by_name(rowsource->vars_table,
+                                           entry->types[i], entry->names[i]);
+    if(v) {
+      rc = rasqal_rowsource_add_variable(rowsource, v);
+    } else {
+      v = rasqal_variables_table_add2(rowsource->vars_table, entry->types[i],
+                                      entry->names[i], 0, NULL);
+      if(!v)
+        return 1;
+      rc = rasqal_rowsource_add_variable(rowsource, v);
+      rasqal_free_variable(v);
+    }
+
+    if(rc < 0)
+      return 1;
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_result_cache_replay_rowsource_finish(rasqal_rowsource* rowsource,
+                                            void *user_data)
+{
+  rasqal_result_cache_replay_rowsource_context* con;
+
+  con = (rasqal_result_cache_replay_rowsource_context*)user_data;
+
+  rasqal_free_result_cache_entry(con->entry);
+
+  RASQAL_FREE(rasqal_result_cache_replay_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_result_cache_replay_rowsource_read_row(rasqal_rowsource* rowsource,
+                                              void *user_data)
+{
+  rasqal_result_cache_replay_rowsource_context* con;
+  rasqal_result_cache_entry* entry;
+  rasqal_literal** values;
+  rasqal_row* row;
+  int i;
+
+  con = (rasqal_result_cache_replay_rowsource_context*)user_data;
+  entry = con->entry;
+
+  if(con->offset >= entry->rows_count)
+    return NULL;
+
+  row = rasqal_new_row(rowsource);
+  if(!row)
+    return NULL;
+
+  values = &entry->values[con->offset * entry->size];
+  for(i = 0; i < row->size && i < entry->size; i++) {
+    if(values[i])
+      row->values[i] = rasqal_new_literal_from_literal(values[i]);
+  }
+
+  row->offset = con->offset++;
+
+  return row;
+}
+
+
+static int
+rasqal_result_cache_replay_rowsource_reset(rasqal_rowsource* rowsource,
+                                           void *user_data)
+{
+  rasqal_result_cache_replay_rowsource_context* con;
+
+  con = (rasqal_result_cache_replay_rowsource_context*)user_data;
+  con->offset = 0;
+
+  return 0;
+}
+
+
+static const rasqal_rowsource_handler rasqal_result_cache_replay_rowsource_handler = {
+  /* .version =          */ 1,
+  "result cache replay",
+  /* .init =             */ NULL,
+  /* .finish =           */ rasqal_result_cache_replay_rowsource_finish,
+  /* .ensure_variables = */ rasqal_result_cache_replay_rowsource_ensure_variables,
+  /* .read_row =         */ rasqal_result_cache_replay_rowsource_read_row,
+  /* .read_all_rows =    */ NULL,
+  /* .reset =            */ rasqal_result_cache_replay_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ NULL,
+  /* .set_origin =       */ NULL,
+};
+
+
+/**
+ * rasqal_result_cache_lookup:
+ * @cache: result cache
+ * @query: query being executed
+ * @key: key from rasqal_result_cache_new_key()
+ * @key_len: length of @key
+ *
+ * INTERNAL - Get a rowsource replaying the cached result rows for a key
+ *
+ * Return value: new rowsource or NULL if not cached or on failure
+ */
+rasqal_rowsource*
+rasqal_result_cache_lookup(rasqal_result_cache* cache, rasqal_query* query,
+                           const unsigned char* key, size_t key_len)
+{
+  rasqal_result_cache_replay_rowsource_context* con;
+  rasqal_result_cache_entry* entry;
+  unsigned int hash;
+
+  hash = rasqal_result_cache_hash(key, key_len);
+  for(entry = cache->buckets[hash % RASQAL_RESULT_CACHE_BUCKETS];
+      entry;
+      entry = entry->bucket_next) {
+    if(entry->hash == hash && entry->key_len == key_len &&
+       !memcmp(entry->key, key, key_len))
+      break;
+  }
+
+  if(!entry) {
+    cache->misses++;
+    return NULL;
+  }
+
+  cache->hits++;
+
+  /* move to front of LRU list */
+  if(entry->prev) {
+    entry->prev->next = entry->next;
+    if(entry->next)
+      entry->next->prev = entry->prev;
+    else
+      cache->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = cache->head;
+    cache->head->prev = entry;
+    cache->head = entry;
+  }
+
+  con = RASQAL_CALLOC(rasqal_result_cache_replay_rowsource_context*, 1,
+                      sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->entry = entry;
+  entry->usage++;
+
+  return rasqal_new_rowsource_from_handler(query->world, query,
+                                           con,
+                                           &rasqal_result_cache_replay_rowsource_handler,
+                                           query->vars_table,
+                                           0);
+}
+
+
+/*
+ * Recording rowsource - passes through rows from an inner rowsource
+ * and copies them into a new cache entry
+ */
+
+typedef struct
+{
+  rasqal_result_cache* cache;
+
+  /* inner rowsource */
+  rasqal_rowsource* rowsource;
+
+  unsigned char* key;
+  size_t key_len;
+
+  /* dataset version when recording started */
+  unsigned int dataset_version;
+
+  /* number of rows after which the query results stop reading or <0 */
+  int rows_needed;
+
+  /* non-0 while rows are being copied */
+  int recording;
+
+  int rows_count;
+  rasqal_literal** values;
+  int values_size;
+
+  size_t bytes;
+} rasqal_result_cache_record_rowsource_context;
+
+
+static void
+rasqal_result_cache_record_stop(rasqal_result_cache_record_rowsource_context* con)
+{
+  int i;
+
+  if(con->values) {
+    for(i = 0; i < con->values_size; i++) {
+      if(con->values[i])
+        rasqal_free_literal(con->values[i]);
+    }
+    RASQAL_FREE(rasqal_literal**, con->values);
+    con->values = NULL;
+  }
+
+  con->values_size = 0;
+  con->rows_count = 0;
+  con->recording = 0;
+}
+
+
+/* add the recorded rows to the cache as a new entry */
+static void
+rasqal_result_cache_record_add(rasqal_rowsource* rowsource,
+                               rasqal_result_cache_record_rowsource_context* con)
+{
+  rasqal_result_cache* cache = con->cache;
+  rasqal_result_cache_entry* entry = NULL;
+  rasqal_result_cache_entry* e;
+  int size = rowsource->size;
+  size_t bytes;
+  int i;
+
+  bytes = sizeof(*entry) + con->key_len + 1 + con->bytes;
+
+  /* dataset changed while executing or too big to ever fit */
+  if(con->dataset_version != cache->world->dataset_version ||
+     bytes > cache->max_bytes)
+    goto tidy;
+
+  entry = RASQAL_CALLOC(rasqal_result_cache_entry*, 1, sizeof(*entry));
+  if(!entry)
+    goto tidy;
+
+  entry->usage = 1;
+  entry->size = size;
+  entry->hash = rasqal_result_cache_hash(con->key, con->key_len);
+
+  for(e = cache->buckets[entry->hash % RASQAL_RESULT_CACHE_BUCKETS];
+      e;
+      e = e->bucket_next) {
+    /* already added by another execution of the same query */
+    if(e->hash == entry->hash && e->key_len == con->key_len &&
+       !memcmp(e->key, con->key, con->key_len))
+      goto tidy;
+  }
+
+  if(size > 0) {
+    entry->names = RASQAL_CALLOC(unsigned char**, RASQAL_GOOD_CAST(size_t, size),
+                                 sizeof(unsigned char*));
+    entry->types = RASQAL_CALLOC(rasqal_variable_type*,
+                                 RASQAL_GOOD_CAST(size_t, size),
+                                 sizeof(rasqal_variable_type));
+    if(!entry->names || !entry->types)
+      goto tidy;
+  }
+
+  for(i = 0; i < size; i++) {
+    rasqal_variable* v;
+    size_t len;
+
+    v = rasqal_rowsource_get_variable_by_offset(rowsource, i);
+    if(!v)
+      goto tidy;
+
+    len = strlen(RASQAL_GOOD_CAST(const char*, v->name));
+    entry->names[i] = RASQAL_MALLOC(unsigned char*, len + 1);
+    if(!entry->names[i])
+      goto tidy;
+    memcpy(entry->names[i], v->name, len + 1);
+    entry->types[i] = v->type;
+    bytes += sizeof(unsigned char*) + sizeof(rasqal_variable_type) + len + 1;
+  }
+
+  entry->key = con->key;
+  entry->key_len = con->key_len;
+  con->key = NULL;
+
+  /* entry takes the recorded values */
+  entry->rows_count = con->rows_count;
+  entry->values = con->values;
+  entry->bytes = bytes;
+  con->values = NULL;
+  con->values_size = 0;
+
+  rasqal_result_cache_evict(cache, bytes);
+
+  entry->bucket_next = cache->buckets[entry->hash % RASQAL_RESULT_CACHE_BUCKETS];
+  cache->buckets[entry->hash % RASQAL_RESULT_CACHE_BUCKETS] = entry;
+
+  entry->next = cache->head;
+  if(cache->head)
+    cache->head->prev = entry;
+  else
+    cache->tail = entry;
+  cache->head = entry;
+
+  cache->bytes += bytes;
+  cache->entries_count++;
+
+  RASQAL_DEBUG3("Cached result of %d rows, %d bytes\n", entry->rows_count,
+                RASQAL_GOOD_CAST(int, bytes));
+  entry = NULL;
+
+  tidy:
+  if(entry)
+    rasqal_free_result_cache_entry(entry);
+
+  rasqal_result_cache_record_stop(con);
+}
+
+
+/* copy a row's values onto the end of the recorded values */
+static int
+rasqal_result_cache_record_row(rasqal_rowsource* rowsource,
+                               rasqal_result_cache_record_rowsource_context* con,
+                               rasqal_row* row)
+{
+  int size = rowsource->size;
+  int needed = (con->rows_count + 1) * size;
+  int i;
+
+  if(needed > con->values_size) {
+    rasqal_literal** values;
+    int values_size = con->values_size ? con->values_size * 2 : size * 16;
+
+    if(values_size < needed)
+      values_size = needed;
+
+    values = RASQAL_CALLOC(rasqal_literal**,
+                           RASQAL_GOOD_CAST(size_t, values_size),
+                           sizeof(rasqal_literal*));
+    if(!values)
+      return 1;
+
+    if(con->values) {
+      memcpy(values, con->values,
+             RASQAL_GOOD_CAST(size_t, con->rows_count * size) *
+             sizeof(rasqal_literal*));
+      RASQAL_FREE(rasqal_literal**, con->values);
+    }
+    con->values = values;
+    con->values_size = values_size;
+  }
+
+  for(i = 0; i < size; i++) {
+    rasqal_literal* l = (i < row->size) ? row->values[i] : NULL;
+
+    if(l) {
+      con->values[con->rows_count * size + i] = rasqal_new_literal_from_literal(l);
+      con->bytes += rasqal_result_cache_literal_bytes(l);
+    }
+    con->bytes += sizeof(rasqal_literal*);
+  }
+  con->rows_count++;
+
+  return 0;
+}
+
+
+static int
+rasqal_result_cache_record_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                                      void *user_data)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+
+  con = (rasqal_result_cache_record_rowsource_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->rowsource))
+    return 1;
+
+  rowsource->size = 0;
+  if(rasqal_rowsource_copy_variables(rowsource, con->rowsource))
+    return 1;
+
+  return 0;
+}
+
+
+static int
+rasqal_result_cache_record_rowsource_finish(rasqal_rowsource* rowsource,
+                                            void *user_data)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+
+  con = (rasqal_result_cache_record_rowsource_context*)user_data;
+
+  rasqal_result_cache_record_stop(con);
+
+  if(con->rowsource)
+    rasqal_free_rowsource(con->rowsource);
+
+  if(con->key)
+    RASQAL_FREE(char*, con->key);
+
+  RASQAL_FREE(rasqal_result_cache_record_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_result_cache_record_rowsource_read_row(rasqal_rowsource* rowsource,
+                                              void *user_data)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+  rasqal_row* row;
+
+  con = (rasqal_result_cache_record_rowsource_context*)user_data;
+
+  row = rasqal_rowsource_read_row(con->rowsource);
+
+  if(con->recording) {
+    if(!row)
+      rasqal_result_cache_record_add(rowsource, con);
+    else if(rasqal_result_cache_record_row(rowsource, con, row) ||
+            con->bytes > con->cache->max_bytes)
+      rasqal_result_cache_record_stop(con);
+    else if(con->rows_needed >= 0 && con->rows_count >= con->rows_needed)
+      rasqal_result_cache_record_add(rowsource, con);
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_result_cache_record_rowsource_reset(rasqal_rowsource* rowsource,
+                                           void *user_data)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+
+  con = (rasqal_result_cache_record_rowsource_context*)user_data;
+
+  /* a partial recording cannot be continued */
+  rasqal_result_cache_record_stop(con);
+
+  return rasqal_rowsource_reset(con->rowsource);
+}
+
+
+static rasqal_rowsource*
+rasqal_result_cache_record_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                                         void *user_data,
+                                                         int offset)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+
+  con = (rasqal_result_cache_record_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->rowsource;
+  return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_result_cache_record_rowsource_handler = {
+  /* .version =          */ 1,
+  "result cache record",
+  /* .init =             */ NULL,
+  /* .finish =           */ rasqal_result_cache_record_rowsource_finish,
+  /* .ensure_variables = */ rasqal_result_cache_record_rowsource_ensure_variables,
+  /* .read_row =         */ rasqal_result_cache_record_rowsource_read_row,
+  /* .read_all_rows =    */ NULL,
+  /* .reset =            */ rasqal_result_cache_record_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_result_cache_record_rowsource_get_inner_rowsource,
+  /* .set_origin =       */ NULL,
+};
+
+
+/**
+ * rasqal_new_result_cache_rowsource:
+ * @cache: result cache
+ * @query: query being executed
+ * @rowsource: query plan rowsource
+ * @key: key from rasqal_result_cache_new_key()
+ * @key_len: length of @key
+ *
+ * INTERNAL - create a rowsource adding the rows of @rowsource to the cache
+ *
+ * The @rowsource and @key become owned by the new rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_result_cache_rowsource(rasqal_result_cache* cache,
+                                  rasqal_query* query,
+                                  rasqal_rowsource* rowsource,
+                                  unsigned char* key, size_t key_len)
+{
+  rasqal_result_cache_record_rowsource_context* con;
+  int limit;
+  int offset;
+
+  if(!cache || !query || !rowsource || !key)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_result_cache_record_rowsource_context*, 1,
+                      sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->cache = cache;
+  con->rowsource = rowsource;
+  con->key = key;
+  con->key_len = key_len;
+  con->dataset_version = query->world->dataset_version;
+  con->recording = 1;
+
+  /* the query results read one row past the LIMIT to finish */
+  limit = rasqal_query_get_limit(query);
+  offset = rasqal_query_get_offset(query);
+  con->rows_needed = -1;
+  if(limit >= 0)
+    con->rows_needed = (offset > 0 ? offset : 0) + limit + 1;
+
+  return rasqal_new_rowsource_from_handler(query->world, query,
+                                           con,
+                                           &rasqal_result_cache_record_rowsource_handler,
+                                           query->vars_table,
+                                           0);
+
+  fail:
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(key)
+    RASQAL_FREE(char*, key);
+  return NULL;
+}
+
+
+
+#ifdef STANDALONE
+
+#define RESULT_CACHE_TEST_QUERY "SELECT ?x WHERE { VALUES ?x { 3 1 2 } }"
+
+#define RESULT_CACHE_TEST_DATA "<http://example.org/a> <http://example.org/p> \"1\" .\n"
+
+
+/* add a data graph to the world dataset */
+static int
+result_cache_test_add_data(rasqal_world* world, raptor_uri* base_uri)
+{
+  raptor_iostream* iostr;
+  rasqal_data_graph* dg = NULL;
+  int rc = 1;
+
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          (void*)RESULT_CACHE_TEST_DATA,
+                                          strlen(RESULT_CACHE_TEST_DATA));
+  if(iostr)
+    dg = rasqal_new_data_graph_from_iostream(world, iostr, base_uri,
+                                             /* name */ NULL,
+                                             RASQAL_DATA_GRAPH_BACKGROUND,
+                                             NULL, "ntriples", NULL);
+  if(dg)
+    rc = rasqal_world_add_data_graph(world, dg);
+
+  if(dg)
+    rasqal_free_data_graph(dg);
+  if(iostr)
+    raptor_free_iostream(iostr);
+
+  return rc;
+}
+
+
+/* execute a query returning the number of rows or <0 on failure */
+static int
+result_cache_test_execute(rasqal_world* world, raptor_uri* base_uri,
+                          const char* query_string, int* first_p)
+{
+  rasqal_query* query;
+  rasqal_query_results* results = NULL;
+  int count = -1;
+
+  query = rasqal_new_query(world, "sparql11-query", NULL);
+  if(!query ||
+     rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          base_uri))
+    goto tidy;
+
+  results = rasqal_query_execute(query);
+  if(!results)
+    goto tidy;
+
+  for(count = 0; !rasqal_query_results_finished(results); count++) {
+    if(!count && first_p) {
+      rasqal_literal* l = rasqal_query_results_get_binding_value(results, 0);
+      *first_p = l ? rasqal_literal_as_integer(l, NULL) : -1;
+    }
+    rasqal_query_results_next(results);
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+
+  return count;
+}
+
+
+int main(int argc, char *argv[]);
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  rasqal_result_cache* cache;
+  raptor_uri* base_uri = NULL;
+  size_t entry_bytes;
+  int count;
+  int first = 0;
+  int failures = 0;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+  if(!base_uri || rasqal_world_set_result_cache_size(world, 1 << 20)) {
+    fprintf(stderr, "%s: failed to enable result cache\n", program);
+    failures++;
+    goto tidy;
+  }
+  cache = world->result_cache;
+
+  /* queries with no data graphs and no world dataset are not cached */
+  count = result_cache_test_execute(world, base_uri, RESULT_CACHE_TEST_QUERY,
+                                    NULL);
+  if(count != 3 || cache->entries_count) {
+    fprintf(stderr, "%s: query with no dataset returned %d rows and cached %d entries\n",
+            program, count, cache->entries_count);
+    failures++;
+  }
+
+  /* the rest run against the world dataset */
+  if(result_cache_test_add_data(world, base_uri)) {
+    fprintf(stderr, "%s: failed to add world data graph\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  /* first execution records, second replays */
+  count = result_cache_test_execute(world, base_uri, RESULT_CACHE_TEST_QUERY,
+                                    NULL);
+  if(count != 3 || cache->entries_count != 1 || cache->misses != 1) {
+    fprintf(stderr, "%s: first execution returned %d rows and cached %d entries\n",
+            program, count, cache->entries_count);
+    failures++;
+  }
+  count = result_cache_test_execute(world, base_uri, RESULT_CACHE_TEST_QUERY,
+                                    NULL);
+  if(count != 3 || cache->hits != 1) {
+    fprintf(stderr, "%s: cached execution returned %d rows with %d hits\n",
+            program, count, cache->hits);
+    failures++;
+  }
+  entry_bytes = cache->bytes;
+
+  /* LIMIT is part of the key and only the rows it needs are kept */
+  count = result_cache_test_execute(world, base_uri,
+                                    RESULT_CACHE_TEST_QUERY " LIMIT 1", NULL);
+  if(count != 1 || cache->entries_count != 2) {
+    fprintf(stderr, "%s: LIMIT query returned %d rows and cached %d entries\n",
+            program, count, cache->entries_count);
+    failures++;
+  }
+  count = result_cache_test_execute(world, base_uri,
+                                    RESULT_CACHE_TEST_QUERY " LIMIT 1", NULL);
+  if(count != 1 || cache->hits != 2) {
+    fprintf(stderr, "%s: cached LIMIT query returned %d rows with %d hits\n",
+            program, count, cache->hits);
+    failures++;
+  }
+
+  /* stored and ordered results replay in order */
+  count = result_cache_test_execute(world, base_uri,
+                                    RESULT_CACHE_TEST_QUERY " ORDER BY ?x",
+                                    NULL);
+  count = result_cache_test_execute(world, base_uri,
+                                    RESULT_CACHE_TEST_QUERY " ORDER BY ?x",
+                                    &first);
+  if(count != 3 || first != 1 || cache->hits != 3) {
+    fprintf(stderr, "%s: cached ORDER BY query returned %d rows first %d\n",
+            program, count, first);
+    failures++;
+  }
+
+  /* a new dataset version drops every entry */
+  rasqal_world_set_dataset_version(world, 1);
+  if(cache->entries_count || cache->bytes) {
+    fprintf(stderr, "%s: %d entries left after dataset version change\n",
+            program, cache->entries_count);
+    failures++;
+  }
+
+  /* adding to the world dataset drops every entry */
+  result_cache_test_execute(world, base_uri, RESULT_CACHE_TEST_QUERY, NULL);
+  if(result_cache_test_add_data(world, base_uri) || cache->entries_count) {
+    fprintf(stderr, "%s: %d entries left after adding a world data graph\n",
+            program, cache->entries_count);
+    failures++;
+  }
+
+  /* non-deterministic results are not cached */
+  count = result_cache_test_execute(world, base_uri,
+                                    "SELECT ?x ?r WHERE { VALUES ?x { 1 } BIND(RAND() AS ?r) }",
+                                    NULL);
+  if(count != 1 || cache->entries_count) {
+    fprintf(stderr, "%s: RAND() query returned %d rows and cached %d entries\n",
+            program, count, cache->entries_count);
+    failures++;
+  }
+
+  /* room for one entry: the least recently used one is evicted */
+  rasqal_world_set_result_cache_size(world, entry_bytes + entry_bytes / 2);
+  result_cache_test_execute(world, base_uri, RESULT_CACHE_TEST_QUERY, NULL);
+  count = result_cache_test_execute(world, base_uri,
+                                    "SELECT ?y WHERE { VALUES ?y { 6 4 5 } }",
+                                    NULL);
+  if(count != 3 || cache->entries_count != 1 || cache->evictions != 1) {
+    fprintf(stderr, "%s: budget kept %d entries after %d evictions\n",
+            program, cache->entries_count, cache->evictions);
+    failures++;
+  }
+
+  tidy:
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
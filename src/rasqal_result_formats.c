@@ -135,6 +135,10 @@ rasqal_init_result_formats(rasqal_world* world)
 
   rc += rasqal_init_result_format_rdf(world) != 0;
 
+  rc += rasqal_init_result_format_binary(world) != 0;
+
+  rc += rasqal_init_result_format_arrow(world) != 0;
+
   return rc;
 }
 
@@ -49,6 +49,8 @@
  * @second_count: number of variables in second query result
  * @variables_count: number of variables in @vt and @defined_in_map
  * @variables_in_both_count: number of shared variables in both query results
+ * @unordered: non-0 to compare results as multisets of rows
+ * @max_differences: number of differing rows an unordered compare reports
  *
  * Lookup data constructed for comparing two query results to enable
  * quick mapping between values.
@@ -72,9 +74,63 @@ struct rasqal_results_compare_s {
   unsigned int second_count;
   unsigned int variables_count;
   unsigned int variables_in_both_count;
+
+  int unordered;
+  int max_differences;
 };
 
 
+/* default number of differing rows an unordered compare reports */
+#define RASQAL_RESULTS_COMPARE_MAX_DIFFERENCES 10
+
+/*
+ * A blank node in one of the results being compared.  The label is
+ * shared with the row value.  @color is the current refinement class
+ * and @sum accumulates the hashes of the rows it appears in.
+ */
+typedef struct rasqal_results_compare_bnode_s {
+  struct rasqal_results_compare_bnode_s* next;
+  struct rasqal_results_compare_bnode_s* all_next;
+  unsigned int hash;
+  const unsigned char* label;
+  size_t label_len;
+  unsigned int color;
+  unsigned int sum;
+} rasqal_results_compare_bnode;
+
+
+/*
+ * One side of an unordered compare: all rows plus, for each row and
+ * compare variable, either the blank node of the value or the hash of
+ * the value.
+ */
+typedef struct {
+  rasqal_row** rows;
+  int rows_count;
+  int columns_count;
+
+  /* rows_count * columns_count cells */
+  rasqal_literal** values;
+  rasqal_results_compare_bnode** cell_bnodes;
+  unsigned int* cell_hashes;
+
+  /* blank nodes: hash buckets (size a power of 2) and list of all */
+  rasqal_results_compare_bnode** bnodes;
+  unsigned int bnodes_size;
+  unsigned int bnodes_count;
+  rasqal_results_compare_bnode* bnodes_list;
+} rasqal_results_compare_side;
+
+
+/* multiset entry for equal rows of the first results */
+typedef struct rasqal_results_compare_entry_s {
+  struct rasqal_results_compare_entry_s* next;
+  unsigned int hash;
+  int row;
+  int count;
+} rasqal_results_compare_entry;
+
+
 
 rasqal_results_compare*
 rasqal_new_results_compare(rasqal_world* world,
@@ -107,6 +163,8 @@ rasqal_new_results_compare(rasqal_world* world,
   rrc->message.locator = NULL;
   rrc->message.text = NULL;
 
+  rrc->max_differences = RASQAL_RESULTS_COMPARE_MAX_DIFFERENCES;
+
   rrc->first_count = RASQAL_GOOD_CAST(unsigned int, rasqal_variables_table_get_total_variables_count(first_vt));
   rrc->second_count = RASQAL_GOOD_CAST(unsigned int, rasqal_variables_table_get_total_variables_count(second_vt));
   rrc->variables_count = 0;
@@ -199,6 +257,42 @@ rasqal_results_compare_set_log_handler(rasqal_results_compare* rrc,
 }
 
 
+/**
+ * rasqal_results_compare_set_unordered:
+ * @rrc: results compare object
+ * @unordered: non-0 to compare results as multisets of rows
+ *
+ * Set whether the row order of results is ignored
+ *
+ * An unordered compare hashes every row of both results so it does
+ * not depend on the order the rows were generated in, and compares
+ * blank nodes by finding a consistent mapping between the blank
+ * nodes of the two results rather than treating all as equal.
+ * Values are compared as RDF terms.
+ */
+void
+rasqal_results_compare_set_unordered(rasqal_results_compare* rrc,
+                                     int unordered)
+{
+  rrc->unordered = unordered;
+}
+
+
+/**
+ * rasqal_results_compare_set_max_differences:
+ * @rrc: results compare object
+ * @max_differences: number of differing rows to report (<0 for all)
+ *
+ * Set how many differing rows an unordered compare reports to the log handler
+ */
+void
+rasqal_results_compare_set_max_differences(rasqal_results_compare* rrc,
+                                           int max_differences)
+{
+  rrc->max_differences = max_differences;
+}
+
+
 /**
  * rasqal_results_compare_variables_equal:
  * @rrc: results compare object
@@ -307,6 +401,571 @@ rasqal_print_results_compare(FILE *handle, rasqal_results_compare* rrc)
 }
 
 
+/* final mix so sums of row hashes are not dominated by low bits */
+static unsigned int
+rasqal_results_compare_mix(unsigned int h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+  return h;
+}
+
+
+static void
+rasqal_results_compare_side_clear(rasqal_results_compare_side* side)
+{
+  int i;
+
+  if(side->rows) {
+    for(i = 0; i < side->rows_count; i++)
+      rasqal_free_row(side->rows[i]);
+    RASQAL_FREE(rasqal_row**, side->rows);
+  }
+
+  while(side->bnodes_list) {
+    rasqal_results_compare_bnode* next = side->bnodes_list->all_next;
+    RASQAL_FREE(rasqal_results_compare_bnode, side->bnodes_list);
+    side->bnodes_list = next;
+  }
+
+  if(side->bnodes)
+    RASQAL_FREE(rasqal_results_compare_bnode**, side->bnodes);
+  if(side->values)
+    RASQAL_FREE(rasqal_literal**, side->values);
+  if(side->cell_bnodes)
+    RASQAL_FREE(rasqal_results_compare_bnode**, side->cell_bnodes);
+  if(side->cell_hashes)
+    RASQAL_FREE(unsigned int*, side->cell_hashes);
+}
+
+
+/*
+ * rasqal_results_compare_side_bnode:
+ * @side: compare side
+ * @l: blank node literal
+ *
+ * INTERNAL - Find or add the blank node for a blank node value
+ *
+ * Return value: blank node or NULL on failure
+ */
+static rasqal_results_compare_bnode*
+rasqal_results_compare_side_bnode(rasqal_results_compare_side* side,
+                                  rasqal_literal* l)
+{
+  rasqal_results_compare_bnode* b;
+  unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+  size_t i;
+  unsigned int bucket;
+
+  for(i = 0; i < l->string_len; i++)
+    hash = (hash ^ l->string[i]) * 16777619U;
+
+  if(side->bnodes_size) {
+    for(b = side->bnodes[hash & (side->bnodes_size - 1)]; b; b = b->next) {
+      if(b->hash == hash && b->label_len == l->string_len &&
+         !memcmp(b->label, l->string, l->string_len))
+        return b;
+    }
+  }
+
+  if(side->bnodes_count >= side->bnodes_size) {
+    unsigned int new_size = side->bnodes_size ? side->bnodes_size << 1 : 64;
+    rasqal_results_compare_bnode** new_bnodes;
+
+    new_bnodes = RASQAL_CALLOC(rasqal_results_compare_bnode**, new_size,
+                               sizeof(rasqal_results_compare_bnode*));
+    if(!new_bnodes)
+      return NULL;
+
+    for(b = side->bnodes_list; b; b = b->all_next) {
+      bucket = b->hash & (new_size - 1);
+      b->next = new_bnodes[bucket];
+      new_bnodes[bucket] = b;
+    }
+
+    if(side->bnodes)
+      RASQAL_FREE(rasqal_results_compare_bnode**, side->bnodes);
+    side->bnodes = new_bnodes;
+    side->bnodes_size = new_size;
+  }
+
+  b = RASQAL_CALLOC(rasqal_results_compare_bnode*, 1, sizeof(*b));
+  if(!b)
+    return NULL;
+
+  b->hash = hash;
+  b->label = l->string;
+  b->label_len = l->string_len;
+  /* every blank node starts in one class */
+  b->color = 1;
+
+  bucket = hash & (side->bnodes_size - 1);
+  b->next = side->bnodes[bucket];
+  side->bnodes[bucket] = b;
+  b->all_next = side->bnodes_list;
+  side->bnodes_list = b;
+  side->bnodes_count++;
+
+  return b;
+}
+
+
+/*
+ * rasqal_results_compare_side_init:
+ * @rrc: results compare object
+ * @side: compare side to initialise
+ * @qr: query results
+ * @qr_index: 0 for first results, 1 for second
+ *
+ * INTERNAL - Read all rows of a results and index their values by compare variable
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_results_compare_side_init(rasqal_results_compare* rrc,
+                                 rasqal_results_compare_side* side,
+                                 rasqal_query_results* qr, int qr_index)
+{
+  int rows_size = 0;
+  int columns = RASQAL_GOOD_CAST(int, rrc->variables_count);
+  int i;
+
+  memset(side, '\0', sizeof(*side));
+  side->columns_count = columns;
+
+  while(1) {
+    rasqal_row* row = rasqal_query_results_get_row_by_offset(qr, side->rows_count);
+    if(!row)
+      break;
+
+    if(side->rows_count == rows_size) {
+      rasqal_row** new_rows;
+
+      rows_size = rows_size ? rows_size << 1 : 64;
+      new_rows = RASQAL_MALLOC(rasqal_row**,
+                               RASQAL_GOOD_CAST(size_t, rows_size) * sizeof(rasqal_row*));
+      if(!new_rows) {
+        rasqal_free_row(row);
+        return 1;
+      }
+      if(side->rows) {
+        memcpy(new_rows, side->rows,
+               RASQAL_GOOD_CAST(size_t, side->rows_count) * sizeof(rasqal_row*));
+        RASQAL_FREE(rasqal_row**, side->rows);
+      }
+      side->rows = new_rows;
+    }
+    side->rows[side->rows_count++] = row;
+  }
+
+  if(!side->rows_count || !columns)
+    return 0;
+
+  side->values = RASQAL_CALLOC(rasqal_literal**,
+                               RASQAL_GOOD_CAST(size_t, side->rows_count * columns),
+                               sizeof(rasqal_literal*));
+  side->cell_bnodes = RASQAL_CALLOC(rasqal_results_compare_bnode**,
+                                    RASQAL_GOOD_CAST(size_t, side->rows_count * columns),
+                                    sizeof(rasqal_results_compare_bnode*));
+  side->cell_hashes = RASQAL_CALLOC(unsigned int*,
+                                    RASQAL_GOOD_CAST(size_t, side->rows_count * columns),
+                                    sizeof(unsigned int));
+  if(!side->values || !side->cell_bnodes || !side->cell_hashes)
+    return 1;
+
+  for(i = 0; i < side->rows_count; i++) {
+    rasqal_row* row = side->rows[i];
+    int column;
+
+    for(column = 0; column < columns; column++) {
+      int offset;
+      int cell = i * columns + column;
+      rasqal_literal* l = NULL;
+
+      offset = rasqal_results_compare_get_variable_offset_for_result(rrc, column, qr_index);
+      if(offset >= 0 && offset < row->size)
+        l = row->values[offset];
+
+      side->values[cell] = l;
+      if(l && l->type == RASQAL_LITERAL_BLANK) {
+        side->cell_bnodes[cell] = rasqal_results_compare_side_bnode(side, l);
+        if(!side->cell_bnodes[cell])
+          return 1;
+      } else
+        side->cell_hashes[cell] = rasqal_literal_hash(l, RASQAL_LITERAL_HASH_INIT);
+    }
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_results_compare_row_hash:
+ * @side: compare side
+ * @rowi: row index
+ * @marked: blank node to hash as a marker rather than by its class (or NULL)
+ *
+ * INTERNAL - Hash a row with blank nodes replaced by their current classes
+ *
+ * Return value: hash
+ */
+static unsigned int
+rasqal_results_compare_row_hash(rasqal_results_compare_side* side, int rowi,
+                                rasqal_results_compare_bnode* marked)
+{
+  unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+  int column;
+  int cell = rowi * side->columns_count;
+
+  for(column = 0; column < side->columns_count; column++, cell++) {
+    rasqal_results_compare_bnode* b = side->cell_bnodes[cell];
+    unsigned int v;
+
+    if(b)
+      v = (b == marked) ? 0U : b->color;
+    else
+      v = side->cell_hashes[cell];
+
+    hash = (hash ^ v) * 16777619U;
+    hash = (hash ^ (v >> 16)) * 16777619U;
+  }
+
+  return rasqal_results_compare_mix(hash);
+}
+
+
+static int
+rasqal_results_compare_color_compare(const void *a, const void *b)
+{
+  unsigned int ca = *(const unsigned int*)a;
+  unsigned int cb = *(const unsigned int*)b;
+
+  return (ca > cb) - (ca < cb);
+}
+
+
+/*
+ * rasqal_results_compare_side_refine:
+ * @side: compare side
+ * @colors: array of at least side->bnodes_count for counting classes
+ *
+ * INTERNAL - Do one round of blank node class refinement
+ *
+ * The new class of a blank node is a hash of its class and the
+ * multiset of the rows it appears in, with the blank node itself
+ * marked in each row and other blank nodes replaced by their class.
+ * The multiset is hashed as a sum so it is independent of row order.
+ *
+ * Return value: number of distinct classes after refinement
+ */
+static unsigned int
+rasqal_results_compare_side_refine(rasqal_results_compare_side* side,
+                                   unsigned int* colors)
+{
+  rasqal_results_compare_bnode* b;
+  unsigned int i;
+  unsigned int distinct;
+  int rowi;
+
+  for(b = side->bnodes_list; b; b = b->all_next)
+    b->sum = 0;
+
+  for(rowi = 0; rowi < side->rows_count; rowi++) {
+    int cell = rowi * side->columns_count;
+    int column;
+
+    for(column = 0; column < side->columns_count; column++) {
+      int prev;
+
+      b = side->cell_bnodes[cell + column];
+      if(!b)
+        continue;
+
+      /* count a blank node once per row */
+      for(prev = 0; prev < column; prev++) {
+        if(side->cell_bnodes[cell + prev] == b)
+          break;
+      }
+      if(prev < column)
+        continue;
+
+      b->sum += rasqal_results_compare_row_hash(side, rowi, b);
+    }
+  }
+
+  i = 0;
+  for(b = side->bnodes_list; b; b = b->all_next) {
+    b->color = rasqal_results_compare_mix(b->color * 31U + b->sum) | 1U;
+    colors[i++] = b->color;
+  }
+
+  if(!i)
+    return 0;
+
+  qsort(colors, i, sizeof(unsigned int), rasqal_results_compare_color_compare);
+  distinct = 1;
+  for(i = 1; i < side->bnodes_count; i++) {
+    if(colors[i] != colors[i - 1])
+      distinct++;
+  }
+
+  return distinct;
+}
+
+
+/*
+ * rasqal_results_compare_rows_equal:
+ * @side1: first side
+ * @row1: row index in @side1
+ * @side2: second side
+ * @row2: row index in @side2
+ *
+ * INTERNAL - Compare rows as RDF terms with blank nodes compared by class
+ *
+ * Return value: non-0 if equal
+ */
+static int
+rasqal_results_compare_rows_equal(rasqal_results_compare_side* side1, int row1,
+                                  rasqal_results_compare_side* side2, int row2)
+{
+  int cell1 = row1 * side1->columns_count;
+  int cell2 = row2 * side2->columns_count;
+  int column;
+
+  for(column = 0; column < side1->columns_count; column++, cell1++, cell2++) {
+    rasqal_results_compare_bnode* b1 = side1->cell_bnodes[cell1];
+    rasqal_results_compare_bnode* b2 = side2->cell_bnodes[cell2];
+
+    if(b1 || b2) {
+      if(!b1 || !b2 || b1->color != b2->color)
+        return 0;
+    } else {
+      int error = 0;
+
+      if(side1->cell_hashes[cell1] != side2->cell_hashes[cell2])
+        return 0;
+      if(!rasqal_literal_equals_flags(side1->values[cell1],
+                                      side2->values[cell2],
+                                      RASQAL_COMPARE_RDF, &error) || error)
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+
+static void
+rasqal_results_compare_report_row(rasqal_results_compare* rrc,
+                                  rasqal_results_compare_side* side, int rowi,
+                                  const char* label, const char* other_label,
+                                  int count)
+{
+  raptor_world* raptor_world_ptr;
+  void *string;
+  size_t length;
+  raptor_iostream* string_iostr;
+  int column;
+
+  raptor_world_ptr = rasqal_world_get_raptor(rrc->world);
+
+  string_iostr = raptor_new_iostream_to_string(raptor_world_ptr,
+                                               &string, &length,
+                                               (raptor_data_malloc_handler)malloc);
+  if(!string_iostr)
+    return;
+
+  raptor_iostream_string_write(label, string_iostr);
+  raptor_iostream_counted_string_write(" row ", 5, string_iostr);
+  raptor_iostream_decimal_write(rowi + 1, string_iostr);
+  if(count > 1) {
+    raptor_iostream_counted_string_write(" (", 2, string_iostr);
+    raptor_iostream_decimal_write(count, string_iostr);
+    raptor_iostream_counted_string_write(" times)", 7, string_iostr);
+  }
+  raptor_iostream_counted_string_write(" not in ", 8, string_iostr);
+  raptor_iostream_string_write(other_label, string_iostr);
+  raptor_iostream_counted_string_write(":", 1, string_iostr);
+
+  for(column = 0; column < side->columns_count; column++) {
+    rasqal_variable* v;
+
+    v = rasqal_results_compare_get_variable_by_offset(rrc, column);
+    raptor_iostream_write_byte(' ', string_iostr);
+    raptor_iostream_string_write(v->name, string_iostr);
+    raptor_iostream_write_byte('=', string_iostr);
+    rasqal_literal_write(side->values[rowi * side->columns_count + column],
+                         string_iostr);
+  }
+
+  /* this allocates and copies result into 'string' */
+  raptor_free_iostream(string_iostr);
+
+  rrc->message.level = RAPTOR_LOG_LEVEL_ERROR;
+  rrc->message.text = (const char*)string;
+  if(rrc->log_handler)
+    rrc->log_handler(rrc->log_user_data, &rrc->message);
+
+  free(string);
+}
+
+
+/*
+ * rasqal_results_compare_unordered:
+ * @rrc: results compare object
+ *
+ * INTERNAL - Compare results as multisets of rows
+ *
+ * Blank node classes are refined on both sides in step until the
+ * number of classes stops growing, then the rows of the first
+ * results are counted in a hash table keyed on the row hash and
+ * each row of the second results removes one equal row.  Rows left
+ * over on either side are the differences; the first
+ * @max_differences of them are reported.
+ *
+ * Classes that stay the same size on both sides but are not split
+ * completely (such as blank nodes in symmetric cycles) are assumed
+ * to map onto each other.
+ *
+ * Return value: number of differing rows or <0 on failure
+ */
+static int
+rasqal_results_compare_unordered(rasqal_results_compare* rrc)
+{
+  rasqal_results_compare_side side1;
+  rasqal_results_compare_side side2;
+  rasqal_results_compare_entry** table = NULL;
+  rasqal_results_compare_entry* entry;
+  unsigned int* colors = NULL;
+  unsigned int table_size = 1;
+  unsigned int i;
+  int differences = 0;
+  int reported = 0;
+  int rowi;
+  int rc = -1;
+
+  memset(&side2, '\0', sizeof(side2));
+  if(rasqal_results_compare_side_init(rrc, &side1, rrc->first_qr, 0) ||
+     rasqal_results_compare_side_init(rrc, &side2, rrc->second_qr, 1))
+    goto tidy;
+
+  if(side1.bnodes_count || side2.bnodes_count) {
+    unsigned int distinct1 = 1;
+    unsigned int distinct2 = 1;
+    unsigned int rounds;
+
+    colors = RASQAL_MALLOC(unsigned int*,
+                           (side1.bnodes_count > side2.bnodes_count ? side1.bnodes_count : side2.bnodes_count) * sizeof(unsigned int));
+    if(!colors)
+      goto tidy;
+
+    /* each round that changes anything splits at least one class */
+    for(rounds = 0; rounds <= side1.bnodes_count + side2.bnodes_count; rounds++) {
+      unsigned int new_distinct1 = rasqal_results_compare_side_refine(&side1, colors);
+      unsigned int new_distinct2 = rasqal_results_compare_side_refine(&side2, colors);
+
+      if(new_distinct1 == distinct1 && new_distinct2 == distinct2)
+        break;
+      distinct1 = new_distinct1;
+      distinct2 = new_distinct2;
+    }
+  }
+
+  while(table_size < RASQAL_GOOD_CAST(unsigned int, side1.rows_count))
+    table_size <<= 1;
+  table = RASQAL_CALLOC(rasqal_results_compare_entry**, table_size,
+                        sizeof(rasqal_results_compare_entry*));
+  if(!table)
+    goto tidy;
+
+  for(rowi = 0; rowi < side1.rows_count; rowi++) {
+    unsigned int hash = rasqal_results_compare_row_hash(&side1, rowi, NULL);
+
+    for(entry = table[hash & (table_size - 1)]; entry; entry = entry->next) {
+      if(entry->hash == hash &&
+         rasqal_results_compare_rows_equal(&side1, entry->row, &side1, rowi))
+        break;
+    }
+
+    if(entry)
+      entry->count++;
+    else {
+      entry = RASQAL_MALLOC(rasqal_results_compare_entry*, sizeof(*entry));
+      if(!entry)
+        goto tidy;
+      entry->hash = hash;
+      entry->row = rowi;
+      entry->count = 1;
+      entry->next = table[hash & (table_size - 1)];
+      table[hash & (table_size - 1)] = entry;
+    }
+  }
+
+  for(rowi = 0; rowi < side2.rows_count; rowi++) {
+    unsigned int hash = rasqal_results_compare_row_hash(&side2, rowi, NULL);
+
+    for(entry = table[hash & (table_size - 1)]; entry; entry = entry->next) {
+      if(entry->count > 0 && entry->hash == hash &&
+         rasqal_results_compare_rows_equal(&side1, entry->row, &side2, rowi))
+        break;
+    }
+
+    if(entry) {
+      entry->count--;
+      continue;
+    }
+
+    differences++;
+    if(rrc->max_differences < 0 || reported < rrc->max_differences) {
+      rasqal_results_compare_report_row(rrc, &side2, rowi,
+                                        rrc->second_qr_label,
+                                        rrc->first_qr_label, 1);
+      reported++;
+    }
+  }
+
+  for(i = 0; i < table_size; i++) {
+    for(entry = table[i]; entry; entry = entry->next) {
+      if(entry->count <= 0)
+        continue;
+
+      differences += entry->count;
+      if(rrc->max_differences < 0 || reported < rrc->max_differences) {
+        rasqal_results_compare_report_row(rrc, &side1, entry->row,
+                                          rrc->first_qr_label,
+                                          rrc->second_qr_label,
+                                          entry->count);
+        reported++;
+      }
+    }
+  }
+
+  rc = differences;
+
+  tidy:
+  if(table) {
+    for(i = 0; i < table_size; i++) {
+      while(table[i]) {
+        entry = table[i]->next;
+        RASQAL_FREE(rasqal_results_compare_entry, table[i]);
+        table[i] = entry;
+      }
+    }
+    RASQAL_FREE(rasqal_results_compare_entry**, table);
+  }
+  if(colors)
+    RASQAL_FREE(unsigned int*, colors);
+  rasqal_results_compare_side_clear(&side1);
+  rasqal_results_compare_side_clear(&side2);
+
+  return rc;
+}
+
+
 /**
  * rasqal_results_compare_compare:
  * @cqr: query results object
@@ -360,6 +1019,20 @@ rasqal_results_compare_compare(rasqal_results_compare* rrc)
     }
   }
 
+  if(rrc->unordered) {
+    int rc = rasqal_results_compare_unordered(rrc);
+
+    if(rc) {
+      rrc->message.level = RAPTOR_LOG_LEVEL_ERROR;
+      rrc->message.text = (rc < 0) ? "Results could not be compared" : "Results have different values";
+      if(rrc->log_handler)
+        rrc->log_handler(rrc->log_user_data, &rrc->message);
+
+      differences++;
+    }
+    goto done;
+  }
+
   /* set results to be stored? */
 
   /* sort rows by something ?  As long as the sort is the same it
@@ -514,6 +1187,114 @@ const struct {
 };
 
 
+#define NUNORDERED_TESTS 5
+
+const struct {
+  const char* first_qr_string;
+  const char* second_qr_string;
+  int expected_equality;
+} unordered_data[NUNORDERED_TESTS] = {
+  /* same rows in another order */
+  {
+    "a\tb\n\"1\"\t\"x\"\n\"2\"\t\"y\"\n\"2\"\t\"y\"\n",
+    "a\tb\n\"2\"\t\"y\"\n\"1\"\t\"x\"\n\"2\"\t\"y\"\n",
+    1
+  },
+  /* same rows but different duplicate counts */
+  {
+    "a\tb\n\"1\"\t\"x\"\n\"2\"\t\"y\"\n\"2\"\t\"y\"\n",
+    "a\tb\n\"1\"\t\"x\"\n\"1\"\t\"x\"\n\"2\"\t\"y\"\n",
+    0
+  },
+  /* blank nodes relabelled: _:x = _:q and _:y = _:p */
+  {
+    "a\tb\n_:x\t\"1\"\n_:y\t\"2\"\n_:x\t\"3\"\n",
+    "a\tb\n_:q\t\"3\"\n_:p\t\"2\"\n_:q\t\"1\"\n",
+    1
+  },
+  /* no mapping: _:x would have to be both _:q and _:r */
+  {
+    "a\tb\n_:x\t\"1\"\n_:y\t\"2\"\n_:x\t\"3\"\n",
+    "a\tb\n_:q\t\"3\"\n_:p\t\"2\"\n_:r\t\"1\"\n",
+    0
+  },
+  /* blank nodes linked through rows: a chain x-y-z against a chain p-q-r */
+  {
+    "a\tb\n_:x\t_:y\n_:y\t_:z\n_:z\t\"end\"\n",
+    "a\tb\n_:r\t\"end\"\n_:q\t_:r\n_:p\t_:q\n",
+    1
+  }
+};
+
+/* large unordered compare: rows with a value and one of a few blank
+ * nodes, compared with the rows reversed and blank nodes relabelled
+ */
+#define UNORDERED_LARGE_ROWS 2000
+#define UNORDERED_LARGE_BNODES 100
+
+
+static char*
+make_unordered_large_string(int rows, int reversed)
+{
+  char* string;
+  char* p;
+  int i;
+
+  string = RASQAL_MALLOC(char*, RASQAL_GOOD_CAST(size_t, rows) * 32 + 8);
+  if(!string)
+    return NULL;
+
+  p = string;
+  p += sprintf(p, "a\tb\n");
+  for(i = 0; i < rows; i++) {
+    int r = reversed ? rows - 1 - i : i;
+
+    p += sprintf(p, "\"%d\"\t_:%c%d\n", r, (reversed ? 'y' : 'x'),
+                 r % UNORDERED_LARGE_BNODES);
+  }
+
+  return string;
+}
+
+
+static int
+unordered_compare(rasqal_world* world, const char* first_string,
+                  const char* second_string)
+{
+  raptor_uri* base_uri;
+  rasqal_query_results *first_qr;
+  rasqal_query_results *second_qr;
+  rasqal_results_compare* rrc = NULL;
+  int equal = -1;
+
+  base_uri = raptor_new_uri(rasqal_world_get_raptor(world),
+                            (const unsigned char*)"http://example.org/");
+  first_qr = rasqal_new_query_results_from_string(world,
+                                                  RASQAL_QUERY_RESULTS_BINDINGS,
+                                                  base_uri, first_string, 0);
+  second_qr = rasqal_new_query_results_from_string(world,
+                                                   RASQAL_QUERY_RESULTS_BINDINGS,
+                                                   base_uri, second_string, 0);
+  raptor_free_uri(base_uri);
+
+  if(first_qr && second_qr)
+    rrc = rasqal_new_results_compare(world, first_qr, "first",
+                                     second_qr, "second");
+  if(rrc) {
+    rasqal_results_compare_set_unordered(rrc, 1);
+    equal = rasqal_results_compare_compare(rrc);
+    rasqal_free_results_compare(rrc);
+  }
+
+  if(first_qr)
+    rasqal_free_query_results(first_qr);
+  if(second_qr)
+    rasqal_free_query_results(second_qr);
+
+  return equal;
+}
+
+
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 1
 static void
 print_bindings_results_simple(rasqal_query_results *results, FILE* output)
@@ -615,6 +1396,41 @@ main(int argc, char *argv[])
       rasqal_free_results_compare(rrc);
   }
 
+  for(i = 0; i < NUNORDERED_TESTS; i++) {
+    int expected_equality = unordered_data[i].expected_equality;
+    int equal;
+
+    equal = unordered_compare(world, unordered_data[i].first_qr_string,
+                              unordered_data[i].second_qr_string);
+    if(equal != expected_equality) {
+      fprintf(stderr,
+              "%s: FAILED unordered results test %d returned %d  expected %d\n",
+              program, i, equal, expected_equality);
+      failures++;
+    }
+  }
+
+  if(1) {
+    char* first_string = make_unordered_large_string(UNORDERED_LARGE_ROWS, 0);
+    char* second_string = make_unordered_large_string(UNORDERED_LARGE_ROWS, 1);
+    int equal = -1;
+
+    if(first_string && second_string)
+      equal = unordered_compare(world, first_string, second_string);
+
+    if(equal != 1) {
+      fprintf(stderr,
+              "%s: FAILED unordered compare of %d rows returned %d  expected 1\n",
+              program, UNORDERED_LARGE_ROWS, equal);
+      failures++;
+    }
+
+    if(first_string)
+      RASQAL_FREE(char*, first_string);
+    if(second_string)
+      RASQAL_FREE(char*, second_string);
+  }
+
   if(world)
     rasqal_free_world(world);
 
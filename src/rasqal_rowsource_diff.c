@@ -0,0 +1,1074 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_diff.c - Rasqal MINUS (diff) rowsource class
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+#ifndef STANDALONE
+
+/*
+ * SPARQL 1.1 Query section 18.5 Minus:
+ *
+ *   Minus(Omega1, Omega2) = { mu | mu in Omega1 . for all mu' in Omega2,
+ *     either mu and mu' are not compatible or dom(mu) and dom(mu') are
+ *     disjoint }
+ *
+ * This is done as a hash anti-join: all rows of the right rowsource
+ * are read first and stored in hash tables keyed on the values of the
+ * variables shared with the left rowsource.  Right rows are grouped
+ * by which of the shared variables they bind so that rows with
+ * unbound (OPTIONAL) values can still be found by key.  Left rows are
+ * then streamed and returned unless some right row is compatible
+ * with them on a non-empty set of shared variables.
+ *
+ * Values are compared as RDF terms as required by the definition of
+ * compatible solution mappings.
+ */
+
+#define RASQAL_DIFF_INITIAL_BUCKETS 64
+
+
+typedef struct rasqal_diff_entry_s {
+  struct rasqal_diff_entry_s* next;
+
+  unsigned int hash;
+
+  /* right row (owned) */
+  rasqal_row* row;
+} rasqal_diff_entry;
+
+
+/*
+ * rasqal_diff_group:
+ *
+ * INTERNAL - hash table of right rows that bind the same shared variables
+ */
+typedef struct rasqal_diff_group_s {
+  struct rasqal_diff_group_s* next;
+
+  /* array of size shared_count: non-0 if shared variable is bound */
+  char* bound;
+
+  /* array of size buckets_size */
+  rasqal_diff_entry** buckets;
+
+  /* number of buckets: power of 2 */
+  unsigned int buckets_size;
+
+  /* number of entries in @buckets */
+  unsigned int entries_count;
+} rasqal_diff_group;
+
+
+typedef struct
+{
+  rasqal_rowsource* left;
+
+  rasqal_rowsource* right;
+
+  /* number of variables in both left and right rowsources */
+  int shared_count;
+
+  /* arrays of size @shared_count with the offsets of shared variables
+   * in left and right rows */
+  int* left_offsets;
+  int* right_offsets;
+
+  /* groups of right rows */
+  rasqal_diff_group* groups;
+
+  /* non-0 when right rows have been read into @groups */
+  int right_read;
+
+  /* non-0 if @right returns the same rows wherever it is executed so
+   * @groups can be kept across a reset */
+  int keep_right;
+
+  int failed;
+
+  /* row offset for read_row() */
+  int offset;
+} rasqal_diff_rowsource_context;
+
+
+/*
+ * rasqal_diff_hash_row:
+ * @values: row values
+ * @offsets: offsets of shared variables in @values
+ * @bound: which shared variables to use in the key
+ * @count: number of shared variables
+ *
+ * INTERNAL - hash the values of a row for a set of shared variables
+ */
+static unsigned int
+rasqal_diff_hash_row(rasqal_literal** values, int* offsets, char* bound,
+                     int count)
+{
+  unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+  int i;
+
+  for(i = 0; i < count; i++) {
+    if(bound[i])
+      hash = rasqal_literal_hash(values[offsets[i]], hash);
+  }
+
+  return hash;
+}
+
+
+/*
+ * rasqal_diff_rows_compatible:
+ * @con: diff context
+ * @left_row: left row
+ * @right_row: right row
+ * @bound: which shared variables to compare
+ *
+ * INTERNAL - check left and right rows have equal values for a set of shared variables
+ *
+ * Return value: non-0 if equal
+ */
+static int
+rasqal_diff_rows_compatible(rasqal_diff_rowsource_context* con,
+                            rasqal_row* left_row, rasqal_row* right_row,
+                            char* bound)
+{
+  int i;
+
+  for(i = 0; i < con->shared_count; i++) {
+    rasqal_literal* l1;
+    rasqal_literal* l2;
+
+    if(!bound[i])
+      continue;
+
+    l1 = left_row->values[con->left_offsets[i]];
+    l2 = right_row->values[con->right_offsets[i]];
+    if(!rasqal_literal_equals_flags(l1, l2, RASQAL_COMPARE_RDF, NULL))
+      return 0;
+  }
+
+  return 1;
+}
+
+
+static void
+rasqal_free_diff_group(rasqal_diff_group* group)
+{
+  unsigned int i;
+
+  if(group->buckets) {
+    for(i = 0; i < group->buckets_size; i++) {
+      rasqal_diff_entry* entry = group->buckets[i];
+      while(entry) {
+        rasqal_diff_entry* next = entry->next;
+        rasqal_free_row(entry->row);
+        RASQAL_FREE(rasqal_diff_entry, entry);
+        entry = next;
+      }
+    }
+    RASQAL_FREE(rasqal_diff_entry**, group->buckets);
+  }
+
+  if(group->bound)
+    RASQAL_FREE(char*, group->bound);
+
+  RASQAL_FREE(rasqal_diff_group, group);
+}
+
+
+static rasqal_diff_group*
+rasqal_new_diff_group(rasqal_diff_rowsource_context* con, char* bound)
+{
+  rasqal_diff_group* group;
+
+  group = RASQAL_CALLOC(rasqal_diff_group*, 1, sizeof(*group));
+  if(!group)
+    return NULL;
+
+  group->bound = RASQAL_MALLOC(char*, RASQAL_GOOD_CAST(size_t, con->shared_count));
+  group->buckets_size = RASQAL_DIFF_INITIAL_BUCKETS;
+  group->buckets = RASQAL_CALLOC(rasqal_diff_entry**, group->buckets_size,
+                                 sizeof(rasqal_diff_entry*));
+  if(!group->bound || !group->buckets) {
+    rasqal_free_diff_group(group);
+    return NULL;
+  }
+
+  memcpy(group->bound, bound, RASQAL_GOOD_CAST(size_t, con->shared_count));
+
+  return group;
+}
+
+
+/*
+ * rasqal_diff_group_grow:
+ * @group: group
+ *
+ * INTERNAL - double the number of buckets in a group
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_diff_group_grow(rasqal_diff_group* group)
+{
+  unsigned int new_size = group->buckets_size << 1;
+  rasqal_diff_entry** new_buckets;
+  unsigned int i;
+
+  new_buckets = RASQAL_CALLOC(rasqal_diff_entry**, new_size,
+                              sizeof(rasqal_diff_entry*));
+  if(!new_buckets)
+    return 1;
+
+  for(i = 0; i < group->buckets_size; i++) {
+    rasqal_diff_entry* entry = group->buckets[i];
+    while(entry) {
+      rasqal_diff_entry* next = entry->next;
+      unsigned int b = entry->hash & (new_size - 1);
+
+      entry->next = new_buckets[b];
+      new_buckets[b] = entry;
+      entry = next;
+    }
+  }
+
+  RASQAL_FREE(rasqal_diff_entry**, group->buckets);
+  group->buckets = new_buckets;
+  group->buckets_size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * rasqal_diff_rowsource_add_right_row:
+ * @con: diff context
+ * @row: right row (ownership taken)
+ * @bound: buffer of size shared_count
+ *
+ * INTERNAL - Add a right row to the group for the shared variables it binds
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_diff_rowsource_add_right_row(rasqal_diff_rowsource_context* con,
+                                    rasqal_row* row, char* bound)
+{
+  rasqal_diff_group* group;
+  rasqal_diff_entry* entry;
+  unsigned int b;
+  int bound_count = 0;
+  int i;
+
+  for(i = 0; i < con->shared_count; i++) {
+    bound[i] = (row->values[con->right_offsets[i]] != NULL);
+    if(bound[i])
+      bound_count++;
+  }
+
+  /* Domain disjoint with the left rowsource: can never remove a row */
+  if(!bound_count) {
+    rasqal_free_row(row);
+    return 0;
+  }
+
+  for(group = con->groups; group; group = group->next) {
+    if(!memcmp(group->bound, bound, RASQAL_GOOD_CAST(size_t, con->shared_count)))
+      break;
+  }
+
+  if(!group) {
+    group = rasqal_new_diff_group(con, bound);
+    if(!group) {
+      rasqal_free_row(row);
+      return 1;
+    }
+    group->next = con->groups;
+    con->groups = group;
+  }
+
+  entry = RASQAL_MALLOC(rasqal_diff_entry*, sizeof(*entry));
+  if(!entry) {
+    rasqal_free_row(row);
+    return 1;
+  }
+
+  entry->hash = rasqal_diff_hash_row(row->values, con->right_offsets, bound,
+                                     con->shared_count);
+  entry->row = row;
+
+  if(group->entries_count >= group->buckets_size)
+    rasqal_diff_group_grow(group);
+
+  b = entry->hash & (group->buckets_size - 1);
+  entry->next = group->buckets[b];
+  group->buckets[b] = entry;
+  group->entries_count++;
+
+  return 0;
+}
+
+
+static int
+rasqal_diff_rowsource_read_right(rasqal_diff_rowsource_context* con)
+{
+  char* bound;
+  int rc = 0;
+
+  con->right_read = 1;
+
+  if(!con->shared_count)
+    return 0;
+
+  bound = RASQAL_MALLOC(char*, RASQAL_GOOD_CAST(size_t, con->shared_count));
+  if(!bound)
+    return 1;
+
+  while(1) {
+    rasqal_row* row;
+
+    row = rasqal_rowsource_read_row(con->right);
+    if(!row)
+      break;
+
+    rc = rasqal_diff_rowsource_add_right_row(con, row, bound);
+    if(rc)
+      break;
+  }
+
+  RASQAL_FREE(char*, bound);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_diff_rowsource_row_removed:
+ * @con: diff context
+ * @left_row: left row
+ *
+ * INTERNAL - Check if any right row removes a left row
+ *
+ * Return value: 1 if the left row is removed by MINUS, 0 if not or <0 on failure
+ */
+static int
+rasqal_diff_rowsource_row_removed(rasqal_diff_rowsource_context* con,
+                                  rasqal_row* left_row)
+{
+  rasqal_diff_group* group;
+  int i;
+
+  for(group = con->groups; group; group = group->next) {
+    char* bound = group->bound;
+    int subset = 1;
+    int intersects = 0;
+    unsigned int b;
+
+    for(i = 0; i < con->shared_count; i++) {
+      if(!bound[i])
+        continue;
+      if(left_row->values[con->left_offsets[i]])
+        intersects = 1;
+      else
+        subset = 0;
+    }
+
+    /* dom(mu) and dom(mu') are disjoint for every row in this group */
+    if(!intersects)
+      continue;
+
+    if(subset) {
+      /* Left row binds all of the group key: hash lookup */
+      unsigned int hash;
+      rasqal_diff_entry* entry;
+
+      hash = rasqal_diff_hash_row(left_row->values, con->left_offsets, bound,
+                                  con->shared_count);
+      b = hash & (group->buckets_size - 1);
+      for(entry = group->buckets[b]; entry; entry = entry->next) {
+        if(entry->hash == hash &&
+           rasqal_diff_rows_compatible(con, left_row, entry->row, bound))
+          return 1;
+      }
+    } else {
+      /* Left row binds part of the group key: compare on that part */
+      char* common;
+      int removed = 0;
+
+      common = RASQAL_MALLOC(char*, RASQAL_GOOD_CAST(size_t, con->shared_count));
+      if(!common)
+        return -1;
+      for(i = 0; i < con->shared_count; i++)
+        common[i] = RASQAL_GOOD_CAST(char, bound[i] &&
+                                     left_row->values[con->left_offsets[i]]);
+
+      for(b = 0; b < group->buckets_size && !removed; b++) {
+        rasqal_diff_entry* entry;
+        for(entry = group->buckets[b]; entry; entry = entry->next) {
+          if(rasqal_diff_rows_compatible(con, left_row, entry->row, common)) {
+            removed = 1;
+            break;
+          }
+        }
+      }
+
+      RASQAL_FREE(char*, common);
+      if(removed)
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+static int
+rasqal_diff_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_diff_rowsource_context* con;
+
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  con->failed = 0;
+
+  rasqal_rowsource_set_requirements(con->left, RASQAL_ROWSOURCE_REQUIRE_RESET);
+  if(!con->keep_right)
+    rasqal_rowsource_set_requirements(con->right,
+                                      RASQAL_ROWSOURCE_REQUIRE_RESET);
+
+  return 0;
+}
+
+
+static void
+rasqal_diff_rowsource_free_groups(rasqal_diff_rowsource_context* con)
+{
+  while(con->groups) {
+    rasqal_diff_group* next = con->groups->next;
+    rasqal_free_diff_group(con->groups);
+    con->groups = next;
+  }
+  con->right_read = 0;
+}
+
+
+static int
+rasqal_diff_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_diff_rowsource_context* con;
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  rasqal_diff_rowsource_free_groups(con);
+
+  if(con->left)
+    rasqal_free_rowsource(con->left);
+
+  if(con->right)
+    rasqal_free_rowsource(con->right);
+
+  if(con->left_offsets)
+    RASQAL_FREE(int*, con->left_offsets);
+
+  if(con->right_offsets)
+    RASQAL_FREE(int*, con->right_offsets);
+
+  RASQAL_FREE(rasqal_diff_rowsource_context, con);
+
+  return 0;
+}
+
+
+static int
+rasqal_diff_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                       void *user_data)
+{
+  rasqal_diff_rowsource_context* con;
+  int left_size;
+  int i;
+
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  if(rasqal_rowsource_ensure_variables(con->left))
+    return 1;
+
+  if(rasqal_rowsource_ensure_variables(con->right))
+    return 1;
+
+  rowsource->size = 0;
+
+  /* result variables are only those of the left rowsource */
+  if(rasqal_rowsource_copy_variables(rowsource, con->left))
+    return 1;
+
+  left_size = rasqal_rowsource_get_size(con->left);
+  if(!left_size)
+    return 0;
+
+  con->left_offsets = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, left_size),
+                                    sizeof(int));
+  con->right_offsets = RASQAL_CALLOC(int*, RASQAL_GOOD_CAST(size_t, left_size),
+                                     sizeof(int));
+  if(!con->left_offsets || !con->right_offsets)
+    return 1;
+
+  con->shared_count = 0;
+  for(i = 0; i < left_size; i++) {
+    rasqal_variable* v;
+    int right_offset;
+
+    v = rasqal_rowsource_get_variable_by_offset(con->left, i);
+    right_offset = rasqal_rowsource_get_variable_offset_by_name(con->right,
+                                                                v->name);
+    if(right_offset < 0)
+      continue;
+
+    con->left_offsets[con->shared_count] = i;
+    con->right_offsets[con->shared_count] = right_offset;
+    con->shared_count++;
+  }
+
+  RASQAL_DEBUG3("rowsource %p has %d shared variables\n", rowsource,
+                con->shared_count);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_diff_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_diff_rowsource_context* con;
+  rasqal_row* row = NULL;
+
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  if(con->failed)
+    return NULL;
+
+  /* Right rows are all read before the first left row so the two
+   * sides never bind the shared query variables at the same time. */
+  if(!con->right_read) {
+    if(rasqal_diff_rowsource_read_right(con)) {
+      con->failed = 1;
+      return NULL;
+    }
+  }
+
+  while(1) {
+    int removed;
+
+    row = rasqal_rowsource_read_row(con->left);
+    if(!row)
+      break;
+
+    if(!con->groups)
+      break;
+
+    removed = rasqal_diff_rowsource_row_removed(con, row);
+    if(removed < 0) {
+      rasqal_free_row(row);
+      row = NULL;
+      con->failed = 1;
+      break;
+    }
+    if(!removed)
+      break;
+
+#ifdef RASQAL_DEBUG
+    RASQAL_DEBUG2("rowsource %p removed left row : ", rowsource);
+    rasqal_row_print(row, DEBUG_FH);
+    fputc('\n', DEBUG_FH);
+#endif
+    rasqal_free_row(row);
+  }
+
+  if(row) {
+    rasqal_row_set_rowsource(row, rowsource);
+    row->offset = con->offset++;
+
+    rasqal_row_bind_variables(row, rowsource->query->vars_table);
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_diff_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_diff_rowsource_context* con;
+
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  con->failed = 0;
+  con->offset = 0;
+
+  /* A right side reading variables bound outside it, such as when
+   * the MINUS is inside an OPTIONAL that is reset for every outer
+   * row, may return different rows after a reset so is read again */
+  if(!con->keep_right) {
+    rasqal_diff_rowsource_free_groups(con);
+    if(rasqal_rowsource_reset(con->right))
+      return 1;
+  }
+
+  return rasqal_rowsource_reset(con->left);
+}
+
+
+static rasqal_rowsource*
+rasqal_diff_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                          void *user_data, int offset)
+{
+  rasqal_diff_rowsource_context *con;
+  con = (rasqal_diff_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->left;
+  else if(offset == 1)
+    return con->right;
+  else
+    return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_diff_rowsource_handler = {
+  /* .version = */ 1,
+  "diff",
+  /* .init = */ rasqal_diff_rowsource_init,
+  /* .finish = */ rasqal_diff_rowsource_finish,
+  /* .ensure_variables = */ rasqal_diff_rowsource_ensure_variables,
+  /* .read_row = */ rasqal_diff_rowsource_read_row,
+  /* .read_all_rows = */ NULL,
+  /* .reset = */ rasqal_diff_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_diff_rowsource_get_inner_rowsource,
+  /* .set_origin = */ NULL,
+};
+
+
+/**
+ * rasqal_new_diff_rowsource:
+ * @world: world object
+ * @query: query object
+ * @left: input left (first) rowsource
+ * @right: input right (second) rowsource
+ * @keep_right: non-0 if @right returns the same rows after a reset
+ *
+ * INTERNAL - create a new MINUS (diff) of two rowsources
+ *
+ * Returns the rows of @left that are not compatible with any row of
+ * @right sharing at least one bound variable with it.
+ *
+ * The rows of @right are read once and kept across resets when
+ * @keep_right is set, otherwise they are read again after a reset.
+ *
+ * The @left and @right rowsources become owned by the rowsource.
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_diff_rowsource(rasqal_world *world,
+                          rasqal_query* query,
+                          rasqal_rowsource* left,
+                          rasqal_rowsource* right,
+                          int keep_right)
+{
+  rasqal_diff_rowsource_context* con;
+  int flags = 0;
+
+  if(!world || !query || !left || !right)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_diff_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->left = left;
+  con->right = right;
+  con->keep_right = keep_right;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_diff_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(left)
+    rasqal_free_rowsource(left);
+  if(right)
+    rasqal_free_rowsource(right);
+  return NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const diff_left_data_2x4_rows[] =
+{
+  /* 2 variable names and 4 rows */
+  "a",   NULL, "b",   NULL,
+  /* row 1 data - removed by right row 1 */
+  "foo", NULL, "red", NULL,
+  /* row 2 data */
+  "baz", NULL, "blue", NULL,
+  /* row 3 data - b unbound so domains are disjoint with all right rows */
+  "bob", NULL, NULL, NULL,
+  /* row 4 data - removed by right row 3 (only b is shared) */
+  "bar", NULL, "green", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+const char* const diff_right_data_2x3_rows[] =
+{
+  /* 2 variable names and 3 rows */
+  "b",     NULL, "c",      NULL,
+  /* row 1 data */
+  "red",   NULL, "orange", NULL,
+  /* row 2 data - b unbound so never removes a row */
+  NULL,    NULL, "indigo", NULL,
+  /* row 3 data */
+  "green", NULL, "violet", NULL,
+  /* end of data */
+  NULL, NULL, NULL, NULL
+};
+
+const char* const diff_right_data_1x2_rows[] =
+{
+  /* 1 variable name and 2 rows - no shared variables */
+  "d",     NULL,
+  "red",   NULL,
+  "blue",  NULL,
+  NULL, NULL
+};
+
+
+typedef struct {
+  const char* const* right_data;
+  int right_vars_count;
+  int keep_right;
+  int expected;
+} diff_test_config_type;
+
+#define DIFF_TESTS_COUNT 4
+const diff_test_config_type diff_test_config[DIFF_TESTS_COUNT] = {
+  { diff_right_data_2x3_rows, 2, 1, 2 },
+  { diff_right_data_1x2_rows, 1, 1, 4 },
+  { diff_right_data_2x3_rows, 2, 0, 2 },
+  { diff_right_data_1x2_rows, 1, 0, 4 }
+};
+
+
+/* MINUS must give the same rows as the OPTIONAL / !BOUND() form */
+#define CHECK_PEOPLE 200
+#define CHECK_SEED 2121
+
+static const char* const check_queries[2] = {
+  "PREFIX : <http://example.org/ns#>\n\
+SELECT ?p WHERE { ?p :name ?n MINUS { ?p :blocked ?b } }",
+  "PREFIX : <http://example.org/ns#>\n\
+SELECT ?p WHERE { ?p :name ?n OPTIONAL { ?p :blocked ?b } FILTER(!BOUND(?b)) }"
+};
+
+static int
+diff_check_run(rasqal_world* world, const char* program,
+               raptor_stringbuffer* data, const char* query_string)
+{
+  rasqal_query* query = NULL;
+  rasqal_query_results* results = NULL;
+  raptor_uri* base_uri;
+  raptor_iostream* iostr = NULL;
+  rasqal_data_graph* dg;
+  int count = -1;
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+
+  iostr = raptor_new_iostream_from_string(world->raptor_world_ptr,
+                                          raptor_stringbuffer_as_string(data),
+                                          raptor_stringbuffer_length(data));
+  dg = rasqal_new_data_graph_from_iostream(world, iostr, base_uri, NULL,
+                                           RASQAL_DATA_GRAPH_BACKGROUND,
+                                           NULL, "ntriples", NULL);
+
+  query = rasqal_new_query(world, "sparql11", NULL);
+  if(!query || !dg || rasqal_query_add_data_graph(query, dg) ||
+     rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          base_uri)) {
+    fprintf(stderr, "%s: failed to prepare query %s\n", program, query_string);
+    goto tidy;
+  }
+
+  results = rasqal_query_execute(query);
+  if(!results) {
+    fprintf(stderr, "%s: failed to execute query %s\n", program, query_string);
+    goto tidy;
+  }
+
+  count = 0;
+  while(!rasqal_query_results_finished(results)) {
+    count++;
+    rasqal_query_results_next(results);
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+  if(iostr)
+    raptor_free_iostream(iostr);
+  raptor_free_uri(base_uri);
+
+  return count;
+}
+
+
+static int
+diff_check(rasqal_world* world, const char* program, int people)
+{
+  raptor_stringbuffer* sb;
+  rasqal_random* r;
+  int counts[2];
+  int i;
+  int failures = 0;
+
+  sb = raptor_new_stringbuffer();
+  r = rasqal_new_random(world);
+  rasqal_random_seed(r, CHECK_SEED);
+
+  for(i = 0; i < people; i++) {
+    char line[128];
+
+    sprintf(line,
+            "<http://example.org/ns#p%d> <http://example.org/ns#name> \"p%d\" .\n",
+            i, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, line), 1);
+    if(!(rasqal_random_irand(r) % 4)) {
+      sprintf(line,
+              "<http://example.org/ns#p%d> <http://example.org/ns#blocked> \"true\" .\n",
+              i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, line), 1);
+    }
+  }
+  rasqal_free_random(r);
+
+  for(i = 0; i < 2; i++)
+    counts[i] = diff_check_run(world, program, sb, check_queries[i]);
+
+  if(counts[0] < 0 || counts[0] != counts[1]) {
+    fprintf(stderr, "%s: MINUS returned %d rows, expected %d\n", program,
+            counts[0], counts[1]);
+    failures++;
+  }
+
+  raptor_free_stringbuffer(sb);
+
+  return failures;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *left_rs = NULL;
+  rasqal_rowsource *right_rs = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  int count;
+  raptor_sequence* seq = NULL;
+  int failures = 0;
+  rasqal_variables_table* vt;
+  raptor_sequence* vars_seq = NULL;
+  int test_count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  for(test_count = 0; test_count < DIFF_TESTS_COUNT; test_count++) {
+    int expected_count = diff_test_config[test_count].expected;
+    int vars_count;
+
+    fprintf(stderr, "%s: test #%d\n", program, test_count);
+
+    /* 2 variables and 4 rows */
+    vars_count = 2;
+    seq = rasqal_new_row_sequence(world, vt, diff_left_data_2x4_rows,
+                                  vars_count, &vars_seq);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: failed to create left sequence of %d vars\n", program,
+              vars_count);
+      failures++;
+      goto tidy;
+    }
+
+    left_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!left_rs) {
+      fprintf(stderr, "%s: failed to create left rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by left_rs */
+    vars_seq = seq = NULL;
+
+    vars_count = diff_test_config[test_count].right_vars_count;
+    seq = rasqal_new_row_sequence(world, vt,
+                                  diff_test_config[test_count].right_data,
+                                  vars_count, &vars_seq);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: failed to create right sequence of %d vars\n", program,
+              vars_count);
+      failures++;
+      goto tidy;
+    }
+
+    right_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq, vars_seq);
+    if(!right_rs) {
+      fprintf(stderr, "%s: failed to create right rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by right_rs */
+    vars_seq = seq = NULL;
+
+    rowsource = rasqal_new_diff_rowsource(world, query, left_rs, right_rs,
+                                          diff_test_config[test_count].keep_right);
+    if(!rowsource) {
+      fprintf(stderr, "%s: failed to create diff rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* left_rs and right_rs are now owned by rowsource */
+    left_rs = right_rs = NULL;
+
+    seq = rasqal_rowsource_read_all_rows(rowsource);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: read_rows returned a NULL seq for a diff rowsource\n",
+              program);
+      failures++;
+      goto tidy;
+    }
+    count = raptor_sequence_size(seq);
+    if(count != expected_count) {
+      fprintf(stderr,
+              "%s: read_rows returned %d rows for a diff rowsource, expected %d\n",
+              program, count, expected_count);
+      failures++;
+      goto tidy;
+    }
+
+    if(rasqal_rowsource_get_size(rowsource) != 2) {
+      fprintf(stderr,
+              "%s: diff rowsource has %d columns, expected 2\n",
+              program, rasqal_rowsource_get_size(rowsource));
+      failures++;
+      goto tidy;
+    }
+
+    raptor_free_sequence(seq); seq = NULL;
+
+    /* reset must give the same rows whether or not the right rows
+     * were kept */
+    if(rasqal_rowsource_reset(rowsource)) {
+      fprintf(stderr, "%s: failed to reset diff rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    count = 0;
+    while(1) {
+      rasqal_row* row = rasqal_rowsource_read_row(rowsource);
+      if(!row)
+        break;
+      count++;
+      rasqal_free_row(row);
+    }
+    if(count != expected_count) {
+      fprintf(stderr,
+              "%s: diff rowsource returned %d rows after reset, expected %d\n",
+              program, count, expected_count);
+      failures++;
+      goto tidy;
+    }
+
+    rasqal_free_rowsource(rowsource); rowsource = NULL;
+  }
+
+  failures += diff_check(world, program, CHECK_PEOPLE);
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(left_rs)
+    rasqal_free_rowsource(left_rs);
+  if(right_rs)
+    rasqal_free_rowsource(right_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
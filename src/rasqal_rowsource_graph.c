@@ -104,7 +104,7 @@ rasqal_graph_next_dg(rasqal_graph_rowsource_context *con)
     rasqal_literal *o;
 
     con->dg_offset++;
-    dg = rasqal_query_get_data_graph(query, con->dg_offset);
+    dg = rasqal_query_get_dataset_graph(query, con->dg_offset);
     if(!dg) {
       con->finished = 1;
       break;
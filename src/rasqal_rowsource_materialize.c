@@ -0,0 +1,481 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_materialize.c - Rasqal shared materialized rowsource class
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+
+/*
+ * A materialization runs an inner rowsource at most once and keeps
+ * every row it returns.  Any number of materialize rowsources read
+ * from one materialization, each with its own position: rows already
+ * kept are replayed and the inner rowsource is only read when a
+ * reader goes past the end of them.  Resetting a reader rewinds its
+ * position and never resets the inner rowsource.
+ */
+struct rasqal_materialization_s {
+  int usage;
+
+  /* inner rowsource */
+  rasqal_rowsource* rowsource;
+
+  /* sequence of #rasqal_row read from @rowsource */
+  raptor_sequence* rows;
+
+  /* non-0 when @rowsource is exhausted */
+  int finished;
+};
+
+
+/**
+ * rasqal_new_materialization:
+ * @rowsource: input rowsource
+ *
+ * INTERNAL - create a new shared materialization of a rowsource
+ *
+ * The @rowsource becomes owned by the new materialization
+ *
+ * Return value: new materialization or NULL on failure
+ */
+rasqal_materialization*
+rasqal_new_materialization(rasqal_rowsource* rowsource)
+{
+  rasqal_materialization* m;
+
+  if(!rowsource)
+    return NULL;
+
+  m = RASQAL_CALLOC(rasqal_materialization*, 1, sizeof(*m));
+  if(!m)
+    goto fail;
+
+  m->rows = raptor_new_sequence((raptor_data_free_handler)rasqal_free_row,
+                                (raptor_data_print_handler)rasqal_row_print);
+  if(!m->rows) {
+    RASQAL_FREE(rasqal_materialization, m);
+    goto fail;
+  }
+
+  m->usage = 1;
+  m->rowsource = rowsource;
+
+  return m;
+
+  fail:
+  rasqal_free_rowsource(rowsource);
+  return NULL;
+}
+
+
+/**
+ * rasqal_new_materialization_from_materialization:
+ * @m: materialization
+ *
+ * INTERNAL - Copy Constructor - get a new reference to a materialization
+ *
+ * Return value: @m with an increased usage count
+ */
+rasqal_materialization*
+rasqal_new_materialization_from_materialization(rasqal_materialization* m)
+{
+  m->usage++;
+  return m;
+}
+
+
+/**
+ * rasqal_free_materialization:
+ * @m: materialization
+ *
+ * INTERNAL - Destructor - destroy a materialization
+ */
+void
+rasqal_free_materialization(rasqal_materialization* m)
+{
+  if(!m)
+    return;
+
+  if(--m->usage)
+    return;
+
+  if(m->rows)
+    raptor_free_sequence(m->rows);
+
+  if(m->rowsource)
+    rasqal_free_rowsource(m->rowsource);
+
+  RASQAL_FREE(rasqal_materialization, m);
+}
+
+
+/* get kept row at @offset reading the inner rowsource if needed */
+static rasqal_row*
+rasqal_materialization_get_row(rasqal_materialization* m, int offset)
+{
+  while(offset >= raptor_sequence_size(m->rows)) {
+    rasqal_row* row;
+
+    if(m->finished)
+      return NULL;
+
+    row = rasqal_rowsource_read_row(m->rowsource);
+    if(!row) {
+      m->finished = 1;
+      RASQAL_DEBUG3("materialization %p kept %d rows\n", m,
+                    raptor_sequence_size(m->rows));
+      return NULL;
+    }
+
+    if(raptor_sequence_push(m->rows, row))
+      return NULL;
+  }
+
+  return (rasqal_row*)raptor_sequence_get_at(m->rows, offset);
+}
+
+
+typedef struct
+{
+  rasqal_materialization* materialization;
+
+  /* offset of next row to return */
+  int offset;
+} rasqal_materialize_rowsource_context;
+
+
+static int
+rasqal_materialize_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                              void *user_data)
+{
+  rasqal_materialize_rowsource_context* con;
+  rasqal_rowsource* inner;
+
+  con = (rasqal_materialize_rowsource_context*)user_data;
+  inner = con->materialization->rowsource;
+
+  if(rasqal_rowsource_ensure_variables(inner))
+    return 1;
+
+  rowsource->size = 0;
+  if(rasqal_rowsource_copy_variables(rowsource, inner))
+    return 1;
+
+  return 0;
+}
+
+
+static int
+rasqal_materialize_rowsource_finish(rasqal_rowsource* rowsource,
+                                    void *user_data)
+{
+  rasqal_materialize_rowsource_context* con;
+
+  con = (rasqal_materialize_rowsource_context*)user_data;
+
+  rasqal_free_materialization(con->materialization);
+
+  RASQAL_FREE(rasqal_materialize_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_materialize_rowsource_read_row(rasqal_rowsource* rowsource,
+                                      void *user_data)
+{
+  rasqal_materialize_rowsource_context* con;
+  rasqal_row* kept_row;
+  rasqal_row* row;
+  int i;
+
+  con = (rasqal_materialize_rowsource_context*)user_data;
+
+  kept_row = rasqal_materialization_get_row(con->materialization, con->offset);
+  if(!kept_row)
+    return NULL;
+
+  /* a new row since readers may change the values of rows they get */
+  row = rasqal_new_row(rowsource);
+  if(!row)
+    return NULL;
+
+  for(i = 0; i < row->size && i < kept_row->size; i++) {
+    if(kept_row->values[i])
+      row->values[i] = rasqal_new_literal_from_literal(kept_row->values[i]);
+  }
+  row->group_id = kept_row->group_id;
+  row->offset = con->offset++;
+
+  /* set variables as if the inner rowsource had just returned the row */
+  rasqal_row_bind_variables(row, rowsource->query->vars_table);
+
+  return row;
+}
+
+
+static int
+rasqal_materialize_rowsource_reset(rasqal_rowsource* rowsource,
+                                   void *user_data)
+{
+  rasqal_materialize_rowsource_context* con;
+
+  con = (rasqal_materialize_rowsource_context*)user_data;
+  con->offset = 0;
+
+  return 0;
+}
+
+
+static int
+rasqal_materialize_rowsource_set_requirements(rasqal_rowsource* rowsource,
+                                              void *user_data,
+                                              unsigned int flags)
+{
+  /* resets are replayed from the kept rows so the inner rowsources
+   * need not save or regenerate any rows; stop the visit here */
+  return 1;
+}
+
+
+static rasqal_rowsource*
+rasqal_materialize_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                                 void *user_data, int offset)
+{
+  rasqal_materialize_rowsource_context* con;
+
+  con = (rasqal_materialize_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->materialization->rowsource;
+  return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_materialize_rowsource_handler = {
+  /* .version =          */ 1,
+  "materialize",
+  /* .init =             */ NULL,
+  /* .finish =           */ rasqal_materialize_rowsource_finish,
+  /* .ensure_variables = */ rasqal_materialize_rowsource_ensure_variables,
+  /* .read_row =         */ rasqal_materialize_rowsource_read_row,
+  /* .read_all_rows =    */ NULL,
+  /* .reset =            */ rasqal_materialize_rowsource_reset,
+  /* .set_requirements = */ rasqal_materialize_rowsource_set_requirements,
+  /* .get_inner_rowsource = */ rasqal_materialize_rowsource_get_inner_rowsource,
+  /* .set_origin =       */ NULL,
+};
+
+
+/**
+ * rasqal_new_materialize_rowsource:
+ * @world: world object
+ * @query: query object
+ * @materialization: shared materialization
+ *
+ * INTERNAL - create a new rowsource reading a shared materialization
+ *
+ * The new rowsource takes a new reference to @materialization
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_materialize_rowsource(rasqal_world *world,
+                                 rasqal_query *query,
+                                 rasqal_materialization* materialization)
+{
+  rasqal_materialize_rowsource_context *con;
+  int flags = 0;
+
+  if(!world || !query || !materialization)
+    return NULL;
+
+  con = RASQAL_CALLOC(rasqal_materialize_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->materialization = rasqal_new_materialization_from_materialization(materialization);
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_materialize_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+}
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const materialize_1_data_1x3_rows[] =
+{
+  /* 1 variable name and 3 rows */
+  "a",   NULL,
+  "foo", NULL,
+  "bar", NULL,
+  "baz", NULL,
+  /* end of data */
+  NULL, NULL
+};
+
+
+/* read rows from a rowsource returning the number read */
+static int
+materialize_test_read(rasqal_rowsource* rowsource, int count)
+{
+  int i;
+
+  for(i = 0; i < count; i++) {
+    rasqal_row* row = rasqal_rowsource_read_row(rowsource);
+    if(!row)
+      break;
+    rasqal_free_row(row);
+  }
+
+  return i;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *input_rs = NULL;
+  rasqal_rowsource *rs1 = NULL;
+  rasqal_rowsource *rs2 = NULL;
+  rasqal_materialization* m = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  rasqal_variables_table* vt;
+  int failures = 0;
+  int count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  seq = rasqal_new_row_sequence(world, vt, materialize_1_data_1x3_rows, 1,
+                                &vars_seq);
+  if(!seq) {
+    fprintf(stderr, "%s: failed to create sequence\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  input_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq,
+                                              vars_seq);
+  if(!input_rs) {
+    fprintf(stderr, "%s: failed to create input rowsource\n", program);
+    failures++;
+    goto tidy;
+  }
+  /* vars_seq and seq are now owned by input_rs */
+  vars_seq = seq = NULL;
+
+  m = rasqal_new_materialization(input_rs);
+  /* input_rs is now owned by m */
+  input_rs = NULL;
+  if(m) {
+    rs1 = rasqal_new_materialize_rowsource(world, query, m);
+    rs2 = rasqal_new_materialize_rowsource(world, query, m);
+  }
+  if(!rs1 || !rs2) {
+    fprintf(stderr, "%s: failed to create materialize rowsources\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  /* readers interleave: the second replays what the first read */
+  count = materialize_test_read(rs1, 2);
+  count += materialize_test_read(rs2, 10);
+  count += materialize_test_read(rs1, 10);
+  if(count != 6) {
+    fprintf(stderr, "%s: two readers read %d rows, expected 6\n", program,
+            count);
+    failures++;
+  }
+
+  /* a reset replays without resetting or reading the input again */
+  rasqal_rowsource_reset(rs1);
+  count = materialize_test_read(rs1, 10);
+  if(count != 3 || m->rowsource->count != 3) {
+    fprintf(stderr,
+            "%s: reset read %d rows and input returned %d rows, expected 3 and 3\n",
+            program, count, m->rowsource->count);
+    failures++;
+  }
+
+  if(rasqal_rowsource_get_size(rs1) != 1) {
+    fprintf(stderr, "%s: materialize rowsource has %d variables, expected 1\n",
+            program, rasqal_rowsource_get_size(rs1));
+    failures++;
+  }
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(vars_seq)
+    raptor_free_sequence(vars_seq);
+  if(input_rs)
+    rasqal_free_rowsource(input_rs);
+  if(rs1)
+    rasqal_free_rowsource(rs1);
+  if(rs2)
+    rasqal_free_rowsource(rs2);
+  if(m)
+    rasqal_free_materialization(m);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
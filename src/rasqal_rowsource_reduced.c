@@ -0,0 +1,433 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_rowsource_reduced.c - Rasqal reduced rowsource class
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+#define DEBUG_FH stderr
+
+#ifndef STANDALONE
+
+/*
+ * SELECT REDUCED permits eliminating some but not necessarily all
+ * duplicate solutions.  Rather than remembering every row seen, as
+ * the DISTINCT rowsource does, this keeps a fixed size direct-mapped
+ * cache of recent rows indexed by row hash.  A row equal to the one
+ * in its cache slot is dropped, otherwise it replaces it.  Memory use
+ * is bounded by the cache size and work per row is constant.
+ */
+
+typedef struct
+{
+  /* inner rowsource to reduce */
+  rasqal_rowsource *rowsource;
+
+  /* number of slots in cache: power of 2 */
+  unsigned int cache_size;
+
+  /* array of @cache_size rows (shared references) or NULL */
+  rasqal_row** cache;
+
+  /* array of @cache_size hashes of rows in @cache */
+  unsigned int* hashes;
+
+  /* offset into results for current row */
+  int offset;
+
+} rasqal_reduced_rowsource_context;
+
+
+static void
+rasqal_reduced_rowsource_clear_cache(rasqal_reduced_rowsource_context* con)
+{
+  unsigned int i;
+
+  if(!con->cache)
+    return;
+
+  for(i = 0; i < con->cache_size; i++) {
+    if(con->cache[i]) {
+      rasqal_free_row(con->cache[i]);
+      con->cache[i] = NULL;
+    }
+  }
+}
+
+
+static int
+rasqal_reduced_rowsource_init(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  con->offset = 0;
+
+  con->cache = RASQAL_CALLOC(rasqal_row**, con->cache_size,
+                             sizeof(rasqal_row*));
+  con->hashes = RASQAL_CALLOC(unsigned int*, con->cache_size,
+                              sizeof(unsigned int));
+  if(!con->cache || !con->hashes)
+    return 1;
+
+  return 0;
+}
+
+
+static int
+rasqal_reduced_rowsource_ensure_variables(rasqal_rowsource* rowsource,
+                                          void *user_data)
+{
+  rasqal_reduced_rowsource_context* con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  rasqal_rowsource_ensure_variables(con->rowsource);
+
+  rowsource->size = 0;
+  rasqal_rowsource_copy_variables(rowsource, con->rowsource);
+
+  return 0;
+}
+
+
+static int
+rasqal_reduced_rowsource_finish(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  if(con->rowsource)
+    rasqal_free_rowsource(con->rowsource);
+
+  if(con->cache) {
+    rasqal_reduced_rowsource_clear_cache(con);
+    RASQAL_FREE(rasqal_row**, con->cache);
+  }
+
+  if(con->hashes)
+    RASQAL_FREE(unsigned int*, con->hashes);
+
+  RASQAL_FREE(rasqal_reduced_rowsource_context, con);
+
+  return 0;
+}
+
+
+static rasqal_row*
+rasqal_reduced_rowsource_read_row(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+  rasqal_row *row = NULL;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  while(1) {
+    unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+    unsigned int slot;
+    rasqal_row* cached;
+    int i;
+
+    row = rasqal_rowsource_read_row(con->rowsource);
+    if(!row)
+      break;
+
+    for(i = 0; i < row->size; i++)
+      hash = rasqal_literal_hash(row->values[i], hash);
+
+    slot = hash & (con->cache_size - 1);
+    cached = con->cache[slot];
+
+    if(cached && con->hashes[slot] == hash && cached->size == row->size &&
+       rasqal_literal_array_equals(cached->values, row->values, row->size)) {
+      RASQAL_DEBUG2("row is a duplicate of cache slot %u\n", slot);
+      rasqal_free_row(row);
+      continue;
+    }
+
+    /* remember this row in place of any older one */
+    if(cached)
+      rasqal_free_row(cached);
+    con->cache[slot] = rasqal_new_row_from_row(row);
+    con->hashes[slot] = hash;
+    break;
+  }
+
+  if(row) {
+    rasqal_row_set_rowsource(row, rowsource);
+    row->offset = con->offset++;
+  }
+
+  return row;
+}
+
+
+static int
+rasqal_reduced_rowsource_reset(rasqal_rowsource* rowsource, void *user_data)
+{
+  rasqal_reduced_rowsource_context *con;
+
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  rasqal_reduced_rowsource_clear_cache(con);
+  con->offset = 0;
+
+  return rasqal_rowsource_reset(con->rowsource);
+}
+
+
+static rasqal_rowsource*
+rasqal_reduced_rowsource_get_inner_rowsource(rasqal_rowsource* rowsource,
+                                             void *user_data, int offset)
+{
+  rasqal_reduced_rowsource_context *con;
+  con = (rasqal_reduced_rowsource_context*)user_data;
+
+  if(offset == 0)
+    return con->rowsource;
+  return NULL;
+}
+
+
+static const rasqal_rowsource_handler rasqal_reduced_rowsource_handler = {
+  /* .version =          */ 1,
+  "reduced",
+  /* .init =             */ rasqal_reduced_rowsource_init,
+  /* .finish =           */ rasqal_reduced_rowsource_finish,
+  /* .ensure_variables = */ rasqal_reduced_rowsource_ensure_variables,
+  /* .read_row =         */ rasqal_reduced_rowsource_read_row,
+  /* .read_all_rows =    */ NULL,
+  /* .reset =            */ rasqal_reduced_rowsource_reset,
+  /* .set_requirements = */ NULL,
+  /* .get_inner_rowsource = */ rasqal_reduced_rowsource_get_inner_rowsource,
+  /* .set_origin =       */ NULL,
+};
+
+
+/**
+ * rasqal_new_reduced_rowsource:
+ * @world: world object
+ * @query: query object
+ * @rowsource: input rowsource
+ * @size: number of rows to remember or 0 for the default
+ *
+ * INTERNAL - create a new REDUCED rowsource
+ *
+ * Drops a row when it equals a recently seen row with the same hash
+ * bucket in a cache of @size rows (rounded up to a power of 2).  The
+ * default size is #RASQAL_REDUCED_ROWSOURCE_DEFAULT_SIZE.
+ *
+ * The @rowsource becomes owned by the new rowsource
+ *
+ * Return value: new rowsource or NULL on failure
+ */
+rasqal_rowsource*
+rasqal_new_reduced_rowsource(rasqal_world *world,
+                             rasqal_query *query,
+                             rasqal_rowsource* rowsource,
+                             int size)
+{
+  rasqal_reduced_rowsource_context *con;
+  int flags = 0;
+
+  if(!world || !query || !rowsource)
+    goto fail;
+
+  con = RASQAL_CALLOC(rasqal_reduced_rowsource_context*, 1, sizeof(*con));
+  if(!con)
+    goto fail;
+
+  con->rowsource = rowsource;
+
+  if(size <= 0)
+    size = RASQAL_REDUCED_ROWSOURCE_DEFAULT_SIZE;
+  con->cache_size = 1;
+  while(con->cache_size < RASQAL_GOOD_CAST(unsigned int, size))
+    con->cache_size <<= 1;
+
+  return rasqal_new_rowsource_from_handler(world, query,
+                                           con,
+                                           &rasqal_reduced_rowsource_handler,
+                                           query->vars_table,
+                                           flags);
+
+  fail:
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  return NULL;
+}
+
+
+#endif /* not STANDALONE */
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+const char* const reduced_1_data_1x7_rows[] =
+{
+  /* 1 variable name and 7 rows */
+  "a",   NULL,
+  "foo", NULL,
+  "foo", NULL,
+  "bar", NULL,
+  "foo", NULL,
+  "baz", NULL,
+  "baz", NULL,
+  "bar", NULL,
+  /* end of data */
+  NULL, NULL
+};
+
+
+typedef struct {
+  int size;
+  int expected_min;
+  int expected_max;
+} reduced_test_config_type;
+
+#define REDUCED_TESTS_COUNT 2
+const reduced_test_config_type reduced_test_config[REDUCED_TESTS_COUNT] = {
+  /* single slot: only runs of duplicates are guaranteed to be dropped */
+  { 1, 3, 5 },
+  /* large cache: all 3 distinct rows and no more */
+  { 1024, 3, 3 }
+};
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_rowsource *rowsource = NULL;
+  rasqal_rowsource *input_rs = NULL;
+  rasqal_world* world = NULL;
+  rasqal_query* query = NULL;
+  raptor_sequence* seq = NULL;
+  raptor_sequence* vars_seq = NULL;
+  rasqal_variables_table* vt;
+  int failures = 0;
+  int test_count;
+
+  world = rasqal_new_world(); rasqal_world_open(world);
+
+  query = rasqal_new_query(world, "sparql", NULL);
+
+  vt = query->vars_table;
+
+  for(test_count = 0; test_count < REDUCED_TESTS_COUNT; test_count++) {
+    int size = reduced_test_config[test_count].size;
+    int count;
+
+    fprintf(stderr, "%s: test #%d  cache size %d\n", program, test_count,
+            size);
+
+    seq = rasqal_new_row_sequence(world, vt, reduced_1_data_1x7_rows, 1,
+                                  &vars_seq);
+    if(!seq) {
+      fprintf(stderr, "%s: failed to create sequence\n", program);
+      failures++;
+      goto tidy;
+    }
+
+    input_rs = rasqal_new_rowsequence_rowsource(world, query, vt, seq,
+                                                vars_seq);
+    if(!input_rs) {
+      fprintf(stderr, "%s: failed to create input rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* vars_seq and seq are now owned by input_rs */
+    vars_seq = seq = NULL;
+
+    rowsource = rasqal_new_reduced_rowsource(world, query, input_rs, size);
+    if(!rowsource) {
+      fprintf(stderr, "%s: failed to create reduced rowsource\n", program);
+      failures++;
+      goto tidy;
+    }
+    /* input_rs is now owned by rowsource */
+    input_rs = NULL;
+
+    seq = rasqal_rowsource_read_all_rows(rowsource);
+    if(!seq) {
+      fprintf(stderr,
+              "%s: read_rows returned a NULL seq for a reduced rowsource\n",
+              program);
+      failures++;
+      goto tidy;
+    }
+
+    count = raptor_sequence_size(seq);
+    if(count < reduced_test_config[test_count].expected_min ||
+       count > reduced_test_config[test_count].expected_max) {
+      fprintf(stderr,
+              "%s: read_rows returned %d rows for a reduced rowsource, expected %d to %d\n",
+              program, count, reduced_test_config[test_count].expected_min,
+              reduced_test_config[test_count].expected_max);
+      failures++;
+      goto tidy;
+    }
+
+    raptor_free_sequence(seq); seq = NULL;
+    rasqal_free_rowsource(rowsource); rowsource = NULL;
+  }
+
+  tidy:
+  if(seq)
+    raptor_free_sequence(seq);
+  if(input_rs)
+    rasqal_free_rowsource(input_rs);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(query)
+    rasqal_free_query(query);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -43,7 +43,7 @@
 #include "rasqal_internal.h"
 
 
-#define DEFAULT_FORMAT "application/sparql-results+xml"
+#define DEFAULT_FORMAT "application/sparql-results+json, application/sparql-results+xml;q=0.9"
 
 
 struct rasqal_service_s
@@ -222,6 +222,10 @@ rasqal_service_set_www(rasqal_service* svc, raptor_www* www)
  * @format: service mime type (or NULL)
  *
  * Set the MIME Type to use in HTTP Accept when executing the service
+ *
+ * The default asks for SPARQL JSON or XML results.  When the service
+ * is known to be a rasqal endpoint the compact binary results format
+ * can be requested with "application/x-rasqal-results-binary".
  * 
  * Return value: non 0 on failure
  **/
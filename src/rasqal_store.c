@@ -0,0 +1,1923 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_store.c - Rasqal mutable in-memory quad store
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+
+/*
+ * The store holds quads: a #rasqal_triple with an origin URI literal
+ * for a named graph or no origin for the default graph.  Each quad is
+ * on three lists so it can be added or removed in constant time
+ * while keeping the indexes current:
+ *   - the list of all quads, in insertion order
+ *   - a quad hash bucket chain, used to find duplicates and deletes
+ *   - the list of quads with the same subject, used for matching
+ *
+ * Quads are stamped with the store generation they were added in.
+ * Every triples source takes a snapshot of the current generation and
+ * starts a new one, so it never sees quads added after it was created.
+ * New quads are only ever appended to the lists, so generations never
+ * decrease along a list and a match can stop at the first newer quad.
+ *
+ * A removed quad that a live snapshot can still see is kept on the
+ * lists as a tombstone stamped with the generation it was removed in.
+ * A snapshot sees a quad if it was added in or before the snapshot
+ * and not removed by then.  Tombstones are freed when the last
+ * snapshot that sees them is freed.
+ */
+struct rasqal_store_triple_s {
+  struct rasqal_store_triple_s *prev;
+  struct rasqal_store_triple_s *next;
+
+  /* next quad in the same quad hash bucket */
+  struct rasqal_store_triple_s *next_hash;
+
+  /* quads with the same subject */
+  struct rasqal_store_subject_s *subject;
+  struct rasqal_store_triple_s *prev_subject;
+  struct rasqal_store_triple_s *next_subject;
+
+  unsigned int hash;
+
+  /* store generation the quad was added in */
+  unsigned long generation;
+
+  /* store generation the quad was removed in or 0 if present */
+  unsigned long removed;
+
+  rasqal_triple *triple;
+};
+
+typedef struct rasqal_store_triple_s rasqal_store_triple;
+
+/* quads with one subject, in a subject index hash bucket chain */
+struct rasqal_store_subject_s {
+  struct rasqal_store_subject_s *next;
+  unsigned int hash;
+  rasqal_store_triple *head;
+  rasqal_store_triple *tail;
+};
+
+typedef struct rasqal_store_subject_s rasqal_store_subject;
+
+/* initial size of the hash indexes: power of 2 */
+#define RASQAL_STORE_INDEX_INITIAL_SIZE 64
+
+struct rasqal_store_s {
+  rasqal_world* world;
+
+  rasqal_store_triple *head;
+  rasqal_store_triple *tail;
+
+  /* number of quads not counting tombstones */
+  int size;
+
+  /* number of removed quads kept for live snapshots */
+  int tombstones;
+
+  /* quad index: hash buckets of all quads.  Size is 0 or a power of 2 */
+  rasqal_store_triple** quads;
+  unsigned int quads_size;
+
+  /* subject index: hash buckets of quads by subject. Size is 0 or a
+   * power of 2 */
+  rasqal_store_subject** subjects;
+  unsigned int subjects_size;
+  unsigned int subjects_count;
+
+  /* generation stamped on quads added now */
+  unsigned long generation;
+
+  /* appended quads not yet merged into the indexes: sequence of
+   * #rasqal_triple owned here
+   */
+  raptor_sequence* pending;
+
+  /* graph name for quads being loaded by rasqal_store_load_data_graph() */
+  rasqal_literal* load_origin;
+  int load_failed;
+  /* non-0 to append loaded quads to the pending batch */
+  int load_pending;
+
+  /* generations of the live triples source snapshots in ascending
+   * order */
+  unsigned long* snapshots;
+  int snapshots_count;
+  int snapshots_size;
+};
+
+
+/**
+ * rasqal_new_store:
+ * @world: rasqal world
+ *
+ * INTERNAL - Constructor - create a new empty in-memory quad store
+ *
+ * Return value: new store or NULL on failure
+ */
+rasqal_store*
+rasqal_new_store(rasqal_world* world)
+{
+  rasqal_store* store;
+
+  store = RASQAL_CALLOC(rasqal_store*, 1, sizeof(*store));
+  if(!store)
+    return NULL;
+
+  store->world = world;
+  /* generation 0 is never a snapshot */
+  store->generation = 1;
+
+  store->pending = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                       (raptor_data_print_handler)rasqal_triple_print);
+  if(!store->pending) {
+    RASQAL_FREE(rasqal_store, store);
+    return NULL;
+  }
+
+  return store;
+}
+
+
+static void
+rasqal_store_free_triples(rasqal_store* store)
+{
+  rasqal_store_triple *cur;
+  unsigned int i;
+
+  cur = store->head;
+  while(cur) {
+    rasqal_store_triple *next = cur->next;
+    rasqal_free_triple(cur->triple);
+    RASQAL_FREE(rasqal_store_triple, cur);
+    cur = next;
+  }
+  store->head = store->tail = NULL;
+  store->size = 0;
+  store->tombstones = 0;
+
+  if(store->quads)
+    memset(store->quads, '\0',
+           store->quads_size * sizeof(rasqal_store_triple*));
+
+  for(i = 0; i < store->subjects_size; i++) {
+    rasqal_store_subject* s = store->subjects[i];
+
+    while(s) {
+      rasqal_store_subject* next = s->next;
+      RASQAL_FREE(rasqal_store_subject, s);
+      s = next;
+    }
+    store->subjects[i] = NULL;
+  }
+  store->subjects_count = 0;
+}
+
+
+/**
+ * rasqal_free_store:
+ * @store: store
+ *
+ * INTERNAL - Destructor - destroy a store and all its quads
+ */
+void
+rasqal_free_store(rasqal_store* store)
+{
+  if(!store)
+    return;
+
+  rasqal_store_free_triples(store);
+
+  if(store->pending)
+    raptor_free_sequence(store->pending);
+  if(store->quads)
+    RASQAL_FREE(rasqal_store_triple**, store->quads);
+  if(store->subjects)
+    RASQAL_FREE(rasqal_store_subject**, store->subjects);
+  if(store->snapshots)
+    RASQAL_FREE(unsigned long*, store->snapshots);
+
+  RASQAL_FREE(rasqal_store, store);
+}
+
+
+/**
+ * rasqal_store_get_size:
+ * @store: store
+ *
+ * INTERNAL - Get the number of quads in a store
+ *
+ * Appended quads are not counted until they are merged.
+ *
+ * Return value: number of quads
+ */
+int
+rasqal_store_get_size(rasqal_store* store)
+{
+  return store->size;
+}
+
+
+static unsigned int
+rasqal_store_triple_hash(rasqal_triple* t)
+{
+  unsigned int hash = RASQAL_LITERAL_HASH_INIT;
+
+  hash = rasqal_literal_hash(t->subject, hash);
+  hash = rasqal_literal_hash(t->predicate, hash);
+  hash = rasqal_literal_hash(t->object, hash);
+  return rasqal_literal_hash(t->origin, hash);
+}
+
+
+/* non-0 if the two quads are equal RDF terms, including the graph */
+static int
+rasqal_store_triple_equals(rasqal_triple* t1, rasqal_triple* t2)
+{
+  return rasqal_literal_equals_flags(t1->subject, t2->subject,
+                                     RASQAL_COMPARE_RDF, NULL) &&
+         rasqal_literal_equals_flags(t1->predicate, t2->predicate,
+                                     RASQAL_COMPARE_RDF, NULL) &&
+         rasqal_literal_equals_flags(t1->object, t2->object,
+                                     RASQAL_COMPARE_RDF, NULL) &&
+         rasqal_literal_equals_flags(t1->origin, t2->origin,
+                                     RASQAL_COMPARE_RDF, NULL);
+}
+
+
+/*
+ * rasqal_store_reserve:
+ * @store: store
+ * @count: number of quads about to be added
+ *
+ * INTERNAL - Grow the quad index so @count more quads fit without rehashing
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_store_reserve(rasqal_store* store, int count)
+{
+  unsigned int needed = RASQAL_GOOD_CAST(unsigned int, store->size + count);
+  unsigned int new_size;
+  rasqal_store_triple** new_quads;
+  rasqal_store_triple* st;
+
+  if(needed <= store->quads_size)
+    return 0;
+
+  new_size = store->quads_size ? store->quads_size : RASQAL_STORE_INDEX_INITIAL_SIZE;
+  while(new_size < needed)
+    new_size <<= 1;
+
+  new_quads = RASQAL_CALLOC(rasqal_store_triple**, new_size,
+                            sizeof(rasqal_store_triple*));
+  if(!new_quads)
+    return 1;
+
+  for(st = store->head; st; st = st->next) {
+    unsigned int b = st->hash & (new_size - 1);
+    st->next_hash = new_quads[b];
+    new_quads[b] = st;
+  }
+
+  if(store->quads)
+    RASQAL_FREE(rasqal_store_triple**, store->quads);
+  store->quads = new_quads;
+  store->quads_size = new_size;
+
+  return 0;
+}
+
+
+static rasqal_store_triple*
+rasqal_store_find_triple(rasqal_store* store, rasqal_triple* t,
+                         unsigned int hash)
+{
+  rasqal_store_triple* st;
+
+  if(!store->quads_size)
+    return NULL;
+
+  for(st = store->quads[hash & (store->quads_size - 1)]; st;
+      st = st->next_hash) {
+    if(!st->removed && st->hash == hash &&
+       rasqal_store_triple_equals(st->triple, t))
+      return st;
+  }
+
+  return NULL;
+}
+
+
+/* non-0 if a quad is seen by the store snapshot @snapshot */
+static int
+rasqal_store_triple_visible(rasqal_store_triple* st, unsigned long snapshot)
+{
+  return st->generation <= snapshot &&
+         (!st->removed || st->removed > snapshot);
+}
+
+
+/* find a quad as seen by the store snapshot @snapshot */
+static rasqal_store_triple*
+rasqal_store_find_visible_triple(rasqal_store* store, rasqal_triple* t,
+                                 unsigned long snapshot)
+{
+  rasqal_store_triple* st;
+  unsigned int hash;
+
+  if(!store->quads_size)
+    return NULL;
+
+  hash = rasqal_store_triple_hash(t);
+  for(st = store->quads[hash & (store->quads_size - 1)]; st;
+      st = st->next_hash) {
+    if(st->hash == hash && rasqal_store_triple_visible(st, snapshot) &&
+       rasqal_store_triple_equals(st->triple, t))
+      return st;
+  }
+
+  return NULL;
+}
+
+
+static rasqal_store_subject*
+rasqal_store_find_subject(rasqal_store* store, rasqal_literal* subject,
+                          unsigned int hash)
+{
+  rasqal_store_subject* s;
+
+  if(!store->subjects_size)
+    return NULL;
+
+  for(s = store->subjects[hash & (store->subjects_size - 1)]; s; s = s->next) {
+    if(s->hash == hash &&
+       rasqal_literal_equals_flags(s->head->triple->subject, subject,
+                                   RASQAL_COMPARE_RDF, NULL))
+      return s;
+  }
+
+  return NULL;
+}
+
+
+/*
+ * rasqal_store_index_subject:
+ * @store: store
+ * @st: quad
+ *
+ * INTERNAL - Add a quad to the end of its subject index chain
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_store_index_subject(rasqal_store* store, rasqal_store_triple* st)
+{
+  rasqal_store_subject* s;
+  unsigned int hash;
+  unsigned int b;
+
+  hash = rasqal_literal_hash(st->triple->subject, RASQAL_LITERAL_HASH_INIT);
+
+  s = rasqal_store_find_subject(store, st->triple->subject, hash);
+  if(s) {
+    st->prev_subject = s->tail;
+    s->tail->next_subject = st;
+    s->tail = st;
+    st->subject = s;
+    return 0;
+  }
+
+  if(store->subjects_count >= store->subjects_size) {
+    unsigned int new_size;
+    rasqal_store_subject** new_subjects;
+    unsigned int i;
+
+    new_size = store->subjects_size ? store->subjects_size << 1 : RASQAL_STORE_INDEX_INITIAL_SIZE;
+    new_subjects = RASQAL_CALLOC(rasqal_store_subject**, new_size,
+                                 sizeof(rasqal_store_subject*));
+    if(!new_subjects)
+      return 1;
+
+    for(i = 0; i < store->subjects_size; i++) {
+      rasqal_store_subject* next;
+
+      for(s = store->subjects[i]; s; s = next) {
+        next = s->next;
+        b = s->hash & (new_size - 1);
+        s->next = new_subjects[b];
+        new_subjects[b] = s;
+      }
+    }
+
+    if(store->subjects)
+      RASQAL_FREE(rasqal_store_subject**, store->subjects);
+    store->subjects = new_subjects;
+    store->subjects_size = new_size;
+  }
+
+  s = RASQAL_MALLOC(rasqal_store_subject*, sizeof(*s));
+  if(!s)
+    return 1;
+
+  b = hash & (store->subjects_size - 1);
+  s->hash = hash;
+  s->head = st;
+  s->tail = st;
+  s->next = store->subjects[b];
+  store->subjects[b] = s;
+  store->subjects_count++;
+
+  st->subject = s;
+
+  return 0;
+}
+
+
+/* remove a quad from its subject chain, dropping the chain when empty */
+static void
+rasqal_store_unindex_subject(rasqal_store* store, rasqal_store_triple* st)
+{
+  rasqal_store_subject* s = st->subject;
+  rasqal_store_subject** sp;
+
+  if(st->prev_subject)
+    st->prev_subject->next_subject = st->next_subject;
+  else
+    s->head = st->next_subject;
+
+  if(st->next_subject)
+    st->next_subject->prev_subject = st->prev_subject;
+  else
+    s->tail = st->prev_subject;
+
+  if(s->head)
+    return;
+
+  for(sp = &store->subjects[s->hash & (store->subjects_size - 1)]; *sp;
+      sp = &(*sp)->next) {
+    if(*sp == s) {
+      *sp = s->next;
+      break;
+    }
+  }
+  RASQAL_FREE(rasqal_store_subject, s);
+  store->subjects_count--;
+}
+
+
+/*
+ * rasqal_store_add_new_triple:
+ * @store: store
+ * @t: quad to add (ownership taken)
+ *
+ * INTERNAL - Add a quad to the store and its indexes unless already present
+ *
+ * Return value: <0 on failure, >0 if already present, 0 if added
+ */
+static int
+rasqal_store_add_new_triple(rasqal_store* store, rasqal_triple* t)
+{
+  rasqal_store_triple* st;
+  unsigned int hash;
+  unsigned int b;
+
+  hash = rasqal_store_triple_hash(t);
+  if(rasqal_store_find_triple(store, t, hash)) {
+    rasqal_free_triple(t);
+    return 1;
+  }
+
+  if(rasqal_store_reserve(store, 1)) {
+    rasqal_free_triple(t);
+    return -1;
+  }
+
+  st = RASQAL_CALLOC(rasqal_store_triple*, 1, sizeof(*st));
+  if(!st) {
+    rasqal_free_triple(t);
+    return -1;
+  }
+
+  st->triple = t;
+  st->hash = hash;
+  st->generation = store->generation;
+
+  if(rasqal_store_index_subject(store, st)) {
+    rasqal_free_triple(t);
+    RASQAL_FREE(rasqal_store_triple, st);
+    return -1;
+  }
+
+  b = hash & (store->quads_size - 1);
+  st->next_hash = store->quads[b];
+  store->quads[b] = st;
+
+  st->prev = store->tail;
+  if(store->tail)
+    store->tail->next = st;
+  else
+    store->head = st;
+  store->tail = st;
+
+  store->size++;
+
+  return 0;
+}
+
+
+/* remove a quad from all the lists and free it */
+static void
+rasqal_store_remove_store_triple(rasqal_store* store, rasqal_store_triple* st)
+{
+  rasqal_store_triple** stp;
+
+  for(stp = &store->quads[st->hash & (store->quads_size - 1)]; *stp;
+      stp = &(*stp)->next_hash) {
+    if(*stp == st) {
+      *stp = st->next_hash;
+      break;
+    }
+  }
+
+  rasqal_store_unindex_subject(store, st);
+
+  if(st->prev)
+    st->prev->next = st->next;
+  else
+    store->head = st->next;
+  if(st->next)
+    st->next->prev = st->prev;
+  else
+    store->tail = st->prev;
+
+  if(st->removed)
+    store->tombstones--;
+  else
+    store->size--;
+
+  rasqal_free_triple(st->triple);
+  RASQAL_FREE(rasqal_store_triple, st);
+}
+
+
+/* non-0 if a live snapshot sees the quad */
+static int
+rasqal_store_triple_in_snapshot(rasqal_store* store, rasqal_store_triple* st)
+{
+  int i;
+
+  for(i = 0; i < store->snapshots_count; i++) {
+    if(rasqal_store_triple_visible(st, store->snapshots[i]))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_store_delete_store_triple:
+ * @store: store
+ * @st: quad
+ *
+ * INTERNAL - Remove a quad, keeping it as a tombstone while a live snapshot sees it
+ */
+static void
+rasqal_store_delete_store_triple(rasqal_store* store, rasqal_store_triple* st)
+{
+  if(!rasqal_store_triple_in_snapshot(store, st)) {
+    rasqal_store_remove_store_triple(store, st);
+    return;
+  }
+
+  /* newer than every live snapshot so none of them stop seeing it */
+  st->removed = store->generation;
+  store->size--;
+  store->tombstones++;
+}
+
+
+/* free the tombstones no live snapshot sees */
+static void
+rasqal_store_purge(rasqal_store* store)
+{
+  rasqal_store_triple* st;
+  rasqal_store_triple* next;
+
+  for(st = store->head; st && store->tombstones; st = next) {
+    next = st->next;
+    if(st->removed && !rasqal_store_triple_in_snapshot(store, st))
+      rasqal_store_remove_store_triple(store, st);
+  }
+}
+
+
+/**
+ * rasqal_store_add_triple:
+ * @store: store
+ * @triple: triple with origin set to the graph name or NULL for the default graph
+ *
+ * INTERNAL - Add a quad to the store
+ *
+ * The store takes new references to the parts of @triple.
+ *
+ * Return value: <0 on failure, >0 if already present, 0 if added
+ */
+int
+rasqal_store_add_triple(rasqal_store* store, rasqal_triple* triple)
+{
+  rasqal_triple* t;
+
+  t = rasqal_new_triple_from_triple(triple);
+  if(!t)
+    return -1;
+
+  if(triple->origin)
+    rasqal_triple_set_origin(t, rasqal_new_literal_from_literal(triple->origin));
+
+  return rasqal_store_add_new_triple(store, t);
+}
+
+
+/**
+ * rasqal_store_remove_triple:
+ * @store: store
+ * @triple: triple with origin set to the graph name or NULL for the default graph
+ *
+ * INTERNAL - Remove a quad from the store
+ *
+ * Triples sources created before the removal still see the quad.
+ *
+ * Return value: 1 if the quad was present and removed, 0 if it was not present
+ */
+int
+rasqal_store_remove_triple(rasqal_store* store, rasqal_triple* triple)
+{
+  rasqal_store_triple* st;
+
+  st = rasqal_store_find_triple(store, triple,
+                                rasqal_store_triple_hash(triple));
+  if(!st)
+    return 0;
+
+  rasqal_store_delete_store_triple(store, st);
+  return 1;
+}
+
+
+/**
+ * rasqal_store_apply:
+ * @store: store
+ * @deletes: sequence of #rasqal_triple quads to remove (or NULL)
+ * @inserts: sequence of #rasqal_triple quads to add (or NULL)
+ *
+ * INTERNAL - Apply a batch of quad deletes and then inserts to the store
+ *
+ * The indexes are updated per quad; the quad index is grown once for
+ * the whole batch of inserts.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_store_apply(rasqal_store* store, raptor_sequence* deletes,
+                   raptor_sequence* inserts)
+{
+  rasqal_triple* t;
+  int i;
+
+  if(deletes) {
+    for(i = 0; (t = (rasqal_triple*)raptor_sequence_get_at(deletes, i)); i++)
+      rasqal_store_remove_triple(store, t);
+  }
+
+  if(inserts) {
+    if(rasqal_store_reserve(store, raptor_sequence_size(inserts)))
+      return 1;
+
+    for(i = 0; (t = (rasqal_triple*)raptor_sequence_get_at(inserts, i)); i++) {
+      if(rasqal_store_add_triple(store, t) < 0)
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/* non-0 if a quad origin is in the graph(s) given by @graph and @applies */
+static int
+rasqal_store_origin_applies(rasqal_literal* origin, raptor_uri* graph,
+                            rasqal_update_graph_applies applies)
+{
+  switch(applies) {
+    case RASQAL_UPDATE_GRAPH_ALL:
+      return 1;
+
+    case RASQAL_UPDATE_GRAPH_DEFAULT:
+      return !origin;
+
+    case RASQAL_UPDATE_GRAPH_NAMED:
+      return origin != NULL;
+
+    case RASQAL_UPDATE_GRAPH_ONE:
+    default:
+      if(!graph)
+        return !origin;
+      return origin && raptor_uri_equals(origin->value.uri, graph);
+  }
+}
+
+
+/**
+ * rasqal_store_clear_graph:
+ * @store: store
+ * @graph: graph name URI or NULL for the default graph
+ * @applies: the graph(s) to clear; @graph is only used for #RASQAL_UPDATE_GRAPH_ONE
+ *
+ * INTERNAL - Remove all quads in a graph or set of graphs
+ *
+ * Return value: number of quads removed
+ */
+int
+rasqal_store_clear_graph(rasqal_store* store, raptor_uri* graph,
+                         rasqal_update_graph_applies applies)
+{
+  rasqal_store_triple* st;
+  rasqal_store_triple* next;
+  int count = 0;
+
+  if(applies == RASQAL_UPDATE_GRAPH_ALL && !store->snapshots_count) {
+    count = store->size;
+    rasqal_store_free_triples(store);
+    return count;
+  }
+
+  for(st = store->head; st; st = next) {
+    next = st->next;
+    if(!st->removed &&
+       rasqal_store_origin_applies(st->triple->origin, graph, applies)) {
+      rasqal_store_delete_store_triple(store, st);
+      count++;
+    }
+  }
+
+  return count;
+}
+
+
+/**
+ * rasqal_store_add_graph:
+ * @store: store
+ * @src_graph: source graph name URI or NULL for the default graph
+ * @dest_graph: destination graph name URI or NULL for the default graph
+ *
+ * INTERNAL - Add all quads in one graph to another graph
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_store_add_graph(rasqal_store* store, raptor_uri* src_graph,
+                       raptor_uri* dest_graph)
+{
+  raptor_sequence* inserts;
+  rasqal_literal* dest_origin = NULL;
+  rasqal_store_triple* st;
+  int rc = 1;
+
+  if(src_graph == dest_graph ||
+     (src_graph && dest_graph && raptor_uri_equals(src_graph, dest_graph)))
+    return 0;
+
+  inserts = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                (raptor_data_print_handler)rasqal_triple_print);
+  if(!inserts)
+    return 1;
+
+  if(dest_graph) {
+    dest_origin = rasqal_new_uri_literal(store->world,
+                                         raptor_uri_copy(dest_graph));
+    if(!dest_origin)
+      goto tidy;
+  }
+
+  /* collect first since the inserts are appended to the same list */
+  for(st = store->head; st; st = st->next) {
+    rasqal_triple* t;
+
+    if(st->removed ||
+       !rasqal_store_origin_applies(st->triple->origin, src_graph,
+                                    RASQAL_UPDATE_GRAPH_ONE))
+      continue;
+
+    t = rasqal_new_triple_from_triple(st->triple);
+    if(!t)
+      goto tidy;
+    if(dest_origin)
+      rasqal_triple_set_origin(t, rasqal_new_literal_from_literal(dest_origin));
+    if(raptor_sequence_push(inserts, t))
+      goto tidy;
+  }
+
+  rc = rasqal_store_apply(store, NULL, inserts);
+
+  tidy:
+  if(dest_origin)
+    rasqal_free_literal(dest_origin);
+  raptor_free_sequence(inserts);
+
+  return rc;
+}
+
+
+/**
+ * rasqal_store_get_graph_names:
+ * @store: store
+ *
+ * INTERNAL - Get the names of the graphs with quads in the store
+ *
+ * Return value: new sequence of #raptor_uri or NULL on failure
+ */
+raptor_sequence*
+rasqal_store_get_graph_names(rasqal_store* store)
+{
+  raptor_sequence* names;
+  rasqal_store_triple* st;
+  raptor_uri* last = NULL;
+
+  names = raptor_new_sequence((raptor_data_free_handler)raptor_free_uri,
+                              (raptor_data_print_handler)raptor_uri_print);
+  if(!names)
+    return NULL;
+
+  for(st = store->head; st; st = st->next) {
+    raptor_uri* name;
+    raptor_uri* u;
+    int i;
+
+    if(st->removed || !st->triple->origin)
+      continue;
+
+    name = st->triple->origin->value.uri;
+    /* quads of one graph are usually adjacent */
+    if(last && raptor_uri_equals(last, name))
+      continue;
+
+    for(i = 0; (u = (raptor_uri*)raptor_sequence_get_at(names, i)); i++) {
+      if(raptor_uri_equals(u, name))
+        break;
+    }
+    last = name;
+    if(u)
+      continue;
+
+    if(raptor_sequence_push(names, raptor_uri_copy(name))) {
+      raptor_free_sequence(names);
+      return NULL;
+    }
+  }
+
+  return names;
+}
+
+
+/* non-0 if the terms are equal or are both blank nodes */
+static int
+rasqal_store_term_matches(rasqal_literal* l1, rasqal_literal* l2)
+{
+  if(!l1 || !l2)
+    return l1 == l2;
+
+  if(l1->type == RASQAL_LITERAL_BLANK && l2->type == RASQAL_LITERAL_BLANK)
+    return 1;
+
+  return rasqal_literal_equals_flags(l1, l2, RASQAL_COMPARE_RDF, NULL);
+}
+
+
+/* non-0 if @store has a quad matching @t with blank nodes matching any blank node */
+static int
+rasqal_store_has_matching_triple(rasqal_store* store, rasqal_triple* t)
+{
+  rasqal_store_triple* st;
+
+  if(t->subject->type != RASQAL_LITERAL_BLANK &&
+     t->object->type != RASQAL_LITERAL_BLANK)
+    return rasqal_store_find_triple(store, t,
+                                    rasqal_store_triple_hash(t)) != NULL;
+
+  for(st = store->head; st; st = st->next) {
+    rasqal_triple* st_t = st->triple;
+
+    if(!st->removed &&
+       rasqal_store_term_matches(st_t->subject, t->subject) &&
+       rasqal_store_term_matches(st_t->predicate, t->predicate) &&
+       rasqal_store_term_matches(st_t->object, t->object) &&
+       rasqal_store_term_matches(st_t->origin, t->origin))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/**
+ * rasqal_store_equals:
+ * @store1: first store
+ * @store2: second store
+ *
+ * INTERNAL - Compare the quads in two stores
+ *
+ * Pending appended quads are merged first.  Blank nodes match any
+ * blank node, so this is weaker than a graph isomorphism check: it
+ * is enough for checking the results of update operations.
+ *
+ * Return value: non-0 if the stores have the same quads
+ */
+int
+rasqal_store_equals(rasqal_store* store1, rasqal_store* store2)
+{
+  rasqal_store_triple* st;
+
+  if(rasqal_store_merge(store1) < 0 || rasqal_store_merge(store2) < 0)
+    return 0;
+
+  if(store1->size != store2->size)
+    return 0;
+
+  for(st = store1->head; st; st = st->next) {
+    if(!st->removed &&
+       !rasqal_store_has_matching_triple(store2, st->triple))
+      return 0;
+  }
+
+  return 1;
+}
+
+
+static void
+rasqal_store_statement_handler(void *user_data,
+                               raptor_statement *statement)
+{
+  rasqal_store* store;
+  rasqal_triple* t;
+
+  store = (rasqal_store*)user_data;
+  if(store->load_failed)
+    return;
+
+  t = raptor_statement_as_rasqal_triple(store->world, statement);
+  if(!t) {
+    store->load_failed = 1;
+    return;
+  }
+
+  if(store->load_origin)
+    rasqal_triple_set_origin(t,
+                             rasqal_new_literal_from_literal(store->load_origin));
+
+  if(store->load_pending) {
+    if(raptor_sequence_push(store->pending, t))
+      store->load_failed = 1;
+  } else if(rasqal_store_add_new_triple(store, t) < 0)
+    store->load_failed = 1;
+}
+
+
+static int
+rasqal_store_parse_data_graph(rasqal_store* store, rasqal_data_graph* dg,
+                              int pending)
+{
+  rasqal_world* world = store->world;
+  raptor_parser* parser;
+  const char* parser_name;
+  int rc;
+
+  parser_name = dg->format_name;
+  if(parser_name &&
+     !raptor_world_is_parser_name(world->raptor_world_ptr, parser_name)) {
+    rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR,
+                            /* locator */ NULL,
+                            "Invalid rdf syntax name %s ignored",
+                            parser_name);
+    parser_name = NULL;
+  }
+  if(!parser_name)
+    parser_name = "guess";
+
+  parser = raptor_new_parser(world->raptor_world_ptr, parser_name);
+  if(!parser)
+    return 1;
+
+  raptor_parser_set_statement_handler(parser, store,
+                                      rasqal_store_statement_handler);
+
+  store->load_failed = 0;
+  store->load_pending = pending;
+  if(dg->name_uri && dg->flags == RASQAL_DATA_GRAPH_NAMED)
+    store->load_origin = rasqal_new_uri_literal(world,
+                                                raptor_uri_copy(dg->name_uri));
+
+  if(dg->iostr)
+    rc = raptor_parser_parse_iostream(parser, dg->iostr, dg->base_uri);
+  else
+    rc = raptor_parser_parse_uri(parser, dg->uri,
+                                 dg->base_uri ? dg->base_uri : dg->uri);
+
+  raptor_free_parser(parser);
+
+  if(store->load_origin) {
+    rasqal_free_literal(store->load_origin);
+    store->load_origin = NULL;
+  }
+  store->load_pending = 0;
+
+  return rc || store->load_failed;
+}
+
+
+/**
+ * rasqal_store_load_data_graph:
+ * @store: store
+ * @dg: data graph to read
+ *
+ * INTERNAL - Parse a data graph into the store
+ *
+ * A named data graph is loaded into the graph with the data graph
+ * name, a background one into the default graph.  Iostream data
+ * graphs are consumed.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_store_load_data_graph(rasqal_store* store, rasqal_data_graph* dg)
+{
+  return rasqal_store_parse_data_graph(store, dg, 0);
+}
+
+
+/**
+ * rasqal_store_append_triple:
+ * @store: store
+ * @triple: triple with origin set to the graph name or NULL for the default graph
+ *
+ * INTERNAL - Append a quad to the pending batch of the store
+ *
+ * The quad is only copied here; indexing and duplicate removal are
+ * done for the whole batch by rasqal_store_merge() which happens at
+ * the latest when the next triples source is created.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_store_append_triple(rasqal_store* store, rasqal_triple* triple)
+{
+  rasqal_triple* t;
+
+  t = rasqal_new_triple_from_triple(triple);
+  if(!t)
+    return 1;
+
+  if(triple->origin)
+    rasqal_triple_set_origin(t, rasqal_new_literal_from_literal(triple->origin));
+
+  return raptor_sequence_push(store->pending, t);
+}
+
+
+/**
+ * rasqal_store_append_data_graph:
+ * @store: store
+ * @dg: data graph to read
+ *
+ * INTERNAL - Parse a data graph into the pending batch of the store
+ *
+ * As rasqal_store_load_data_graph() but the quads are appended as
+ * with rasqal_store_append_triple().  On failure the quads parsed so
+ * far stay in the batch.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_store_append_data_graph(rasqal_store* store, rasqal_data_graph* dg)
+{
+  return rasqal_store_parse_data_graph(store, dg, 1);
+}
+
+
+/**
+ * rasqal_store_merge:
+ * @store: store
+ *
+ * INTERNAL - Merge the pending batch of appended quads into the store indexes
+ *
+ * The quad index is grown once for the whole batch.  Quads already
+ * in the store are dropped.
+ *
+ * Return value: number of quads added or <0 on failure
+ */
+int
+rasqal_store_merge(rasqal_store* store)
+{
+  int count = 0;
+  int size;
+
+  size = raptor_sequence_size(store->pending);
+  if(!size)
+    return 0;
+
+  if(rasqal_store_reserve(store, size))
+    return -1;
+
+  /* take the quads off the front to keep the append order */
+  while(raptor_sequence_size(store->pending) > 0) {
+    rasqal_triple* t;
+    int rc;
+
+    t = (rasqal_triple*)raptor_sequence_unshift(store->pending);
+    rc = rasqal_store_add_new_triple(store, t);
+    if(rc < 0)
+      return -1;
+    if(!rc)
+      count++;
+  }
+
+  return count;
+}
+
+
+
+/*
+ * Triples source over a store
+ *
+ * Quads may be added to or removed from the store while a triples
+ * match from it is in use; the match keeps seeing the store as it
+ * was when the triples source was created.
+ */
+
+typedef struct {
+  rasqal_store* store;
+
+  /* last store generation visible */
+  unsigned long snapshot;
+
+  /* graph matched by patterns outside GRAPH or NULL for the store
+   * default graph */
+  rasqal_literal* default_graph;
+} rasqal_store_triples_source_user_data;
+
+
+typedef struct {
+  rasqal_store* store;
+
+  rasqal_store_triple *cur;
+  rasqal_triple match;
+
+  /* parts of the triple above to match: always (S,P,O) sometimes C */
+  rasqal_triple_parts parts;
+
+  /* non-0 if walking the subject index chain rather than all quads */
+  int by_subject;
+
+  /* last store generation visible */
+  unsigned long snapshot;
+} rasqal_store_triples_match_context;
+
+
+/*
+ * rasqal_store_subject_triples:
+ * @store: store
+ * @subject: match subject literal
+ * @triple_p: pointer to store first quad with @subject (or NULL)
+ *
+ * INTERNAL - Find the first quad for a match subject from the subject index
+ *
+ * Return value: non-0 if the index was used; else all quads must be scanned
+ */
+static int
+rasqal_store_subject_triples(rasqal_store* store, rasqal_literal* subject,
+                             rasqal_store_triple** triple_p)
+{
+  rasqal_store_subject* s;
+
+  if(!subject)
+    return 0;
+
+  /* triple subjects are only ever URIs or blank nodes */
+  if(subject->type != RASQAL_LITERAL_URI &&
+     subject->type != RASQAL_LITERAL_BLANK)
+    return 0;
+
+  s = rasqal_store_find_subject(store, subject,
+                                rasqal_literal_hash(subject,
+                                                    RASQAL_LITERAL_HASH_INIT));
+  *triple_p = s ? s->head : NULL;
+
+  return 1;
+}
+
+
+static rasqal_triple_parts
+rasqal_store_bind_match(struct rasqal_triples_match_s* rtm,
+                        void *user_data,
+                        rasqal_variable* bindings[4],
+                        rasqal_triple_parts parts)
+{
+  rasqal_store_triples_match_context* rtmc;
+
+  rtmc = (rasqal_store_triples_match_context*)rtm->user_data;
+
+  return rasqal_raptor_triple_bind(rtmc->cur->triple, bindings, parts);
+}
+
+
+/* move to the next matching quad from @st inclusive */
+static rasqal_store_triple*
+rasqal_store_match_from(rasqal_triples_match* rtm,
+                        rasqal_store_triples_match_context* rtmc,
+                        rasqal_store_triple* st)
+{
+  for(; st; st = rtmc->by_subject ? st->next_subject : st->next) {
+    /* all later quads on the list are newer too */
+    if(st->generation > rtmc->snapshot)
+      return NULL;
+
+    if(st->removed && st->removed <= rtmc->snapshot)
+      continue;
+
+    if(rasqal_raptor_triple_match(rtm->world, st->triple, &rtmc->match,
+                                  rtmc->parts))
+      break;
+  }
+
+  return st;
+}
+
+
+static void
+rasqal_store_next_match(struct rasqal_triples_match_s* rtm, void *user_data)
+{
+  rasqal_store_triples_match_context* rtmc;
+  rasqal_store_triple* st;
+
+  rtmc = (rasqal_store_triples_match_context*)rtm->user_data;
+
+  if(!rtmc->cur)
+    return;
+
+  st = rtmc->by_subject ? rtmc->cur->next_subject : rtmc->cur->next;
+  rtmc->cur = rasqal_store_match_from(rtm, rtmc, st);
+}
+
+
+static int
+rasqal_store_is_end(struct rasqal_triples_match_s* rtm, void *user_data)
+{
+  rasqal_store_triples_match_context* rtmc;
+
+  rtmc = (rasqal_store_triples_match_context*)rtm->user_data;
+
+  return !rtmc || rtmc->cur == NULL;
+}
+
+
+static void
+rasqal_store_finish_triples_match(struct rasqal_triples_match_s* rtm,
+                                  void *user_data)
+{
+  rasqal_store_triples_match_context* rtmc;
+
+  rtmc = (rasqal_store_triples_match_context*)rtm->user_data;
+
+  if(rtmc->match.subject)
+    rasqal_free_literal(rtmc->match.subject);
+  if(rtmc->match.predicate)
+    rasqal_free_literal(rtmc->match.predicate);
+  if(rtmc->match.object)
+    rasqal_free_literal(rtmc->match.object);
+  if(rtmc->match.origin)
+    rasqal_free_literal(rtmc->match.origin);
+
+  RASQAL_FREE(rasqal_store_triples_match_context, rtmc);
+}
+
+
+static int
+rasqal_store_init_triples_match(rasqal_triples_match* rtm,
+                                rasqal_triples_source *rts, void *user_data,
+                                rasqal_triple_meta *m, rasqal_triple *t)
+{
+  rasqal_store_triples_source_user_data* rtsc;
+  rasqal_store* store;
+  rasqal_store_triples_match_context* rtmc;
+
+  rtsc = (rasqal_store_triples_source_user_data*)user_data;
+  store = rtsc->store;
+
+  rtm->bind_match = rasqal_store_bind_match;
+  rtm->next_match = rasqal_store_next_match;
+  rtm->is_end = rasqal_store_is_end;
+  rtm->finish = rasqal_store_finish_triples_match;
+
+  rtmc = RASQAL_CALLOC(rasqal_store_triples_match_context*, 1, sizeof(*rtmc));
+  if(!rtmc)
+    return -1;
+
+  rtm->user_data = rtmc;
+
+  rtmc->store = store;
+
+  rtmc->parts = rasqal_raptor_triple_match_init(&rtmc->match, m, t);
+  rtmc->snapshot = rtsc->snapshot;
+
+  if(!(rtmc->parts & RASQAL_TRIPLE_GRAPH) && rtsc->default_graph) {
+    rtmc->match.origin = rasqal_new_literal_from_literal(rtsc->default_graph);
+    rtmc->parts = (rasqal_triple_parts)(rtmc->parts | RASQAL_TRIPLE_GRAPH);
+  }
+
+  rtmc->cur = store->head;
+  rtmc->by_subject = rasqal_store_subject_triples(store, rtmc->match.subject,
+                                                  &rtmc->cur);
+  rtmc->cur = rasqal_store_match_from(rtm, rtmc, rtmc->cur);
+
+  return 0;
+}
+
+
+/* non-0 if present */
+static int
+rasqal_store_triple_present(rasqal_triples_source *rts, void *user_data,
+                            rasqal_triple *t)
+{
+  rasqal_store_triples_source_user_data* rtsc;
+  rasqal_store* store;
+  rasqal_store_triple* st;
+  unsigned int parts = RASQAL_TRIPLE_SPO | RASQAL_TRIPLE_GRAPH;
+  int by_subject;
+
+  rtsc = (rasqal_store_triples_source_user_data*)user_data;
+  store = rtsc->store;
+
+  if(!t->origin && rtsc->default_graph) {
+    rasqal_triple gt = *t;
+
+    gt.origin = rtsc->default_graph;
+    return rasqal_store_find_visible_triple(store, &gt, rtsc->snapshot) != NULL;
+  }
+
+  if(!t->origin || t->origin->type == RASQAL_LITERAL_URI)
+    /* exact quad */
+    return rasqal_store_find_visible_triple(store, t, rtsc->snapshot) != NULL;
+
+  /* in any named graph */
+  by_subject = rasqal_store_subject_triples(store, t->subject, &st);
+  if(!by_subject)
+    st = store->head;
+  for(; st; st = by_subject ? st->next_subject : st->next) {
+    if(st->generation > rtsc->snapshot)
+      break;
+    if(st->removed && st->removed <= rtsc->snapshot)
+      continue;
+    if(rasqal_raptor_triple_match(store->world, st->triple, t, parts))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_store_add_snapshot:
+ * @store: store
+ *
+ * INTERNAL - Start a new store generation and record the current one as a live snapshot
+ *
+ * Return value: snapshot generation or 0 on failure
+ */
+static unsigned long
+rasqal_store_add_snapshot(rasqal_store* store)
+{
+  if(store->snapshots_count == store->snapshots_size) {
+    int new_size = store->snapshots_size ? store->snapshots_size << 1 : 4;
+    unsigned long* new_snapshots;
+
+    new_snapshots = RASQAL_MALLOC(unsigned long*,
+                                  RASQAL_GOOD_CAST(size_t, new_size) * sizeof(unsigned long));
+    if(!new_snapshots)
+      return 0;
+
+    if(store->snapshots) {
+      memcpy(new_snapshots, store->snapshots,
+             RASQAL_GOOD_CAST(size_t, store->snapshots_count) * sizeof(unsigned long));
+      RASQAL_FREE(unsigned long*, store->snapshots);
+    }
+    store->snapshots = new_snapshots;
+    store->snapshots_size = new_size;
+  }
+
+  /* generations only increase so the array stays in order */
+  store->snapshots[store->snapshots_count++] = store->generation;
+
+  return store->generation++;
+}
+
+
+/* forget a live snapshot and free the tombstones only it saw */
+static void
+rasqal_store_remove_snapshot(rasqal_store* store, unsigned long snapshot)
+{
+  int i;
+
+  for(i = 0; i < store->snapshots_count; i++) {
+    if(store->snapshots[i] == snapshot)
+      break;
+  }
+  if(i == store->snapshots_count)
+    return;
+
+  store->snapshots_count--;
+  memmove(&store->snapshots[i], &store->snapshots[i + 1],
+          RASQAL_GOOD_CAST(size_t, store->snapshots_count - i) * sizeof(unsigned long));
+
+  if(store->tombstones)
+    rasqal_store_purge(store);
+}
+
+
+static void
+rasqal_store_free_triples_source(void *user_data)
+{
+  rasqal_store_triples_source_user_data* rtsc;
+
+  rtsc = (rasqal_store_triples_source_user_data*)user_data;
+
+  /* the store is not owned by the triples source */
+  rasqal_store_remove_snapshot(rtsc->store, rtsc->snapshot);
+
+  if(rtsc->default_graph)
+    rasqal_free_literal(rtsc->default_graph);
+}
+
+
+static int
+rasqal_store_support_feature(void *user_data,
+                             rasqal_triples_source_feature feature)
+{
+  return 0;
+}
+
+
+/**
+ * rasqal_store_new_triples_source:
+ * @store: store
+ * @query: query to match for
+ * @default_graph: graph matched by triple patterns outside GRAPH or NULL for the store default graph
+ *
+ * INTERNAL - Create a triples source matching the quads in a store
+ *
+ * Any pending appended quads are merged first.  The triples source
+ * sees a snapshot of the store as it is now; later additions and
+ * removals are only seen by triples sources created after them.  The
+ * store is shared and must outlive the triples source.
+ *
+ * Return value: new triples source or NULL on failure
+ */
+rasqal_triples_source*
+rasqal_store_new_triples_source(rasqal_store* store, rasqal_query* query,
+                                raptor_uri* default_graph)
+{
+  rasqal_triples_source* rts;
+  rasqal_store_triples_source_user_data* rtsc;
+
+  if(rasqal_store_merge(store) < 0)
+    return NULL;
+
+  rts = RASQAL_CALLOC(rasqal_triples_source*, 1, sizeof(*rts));
+  if(!rts)
+    return NULL;
+
+  rtsc = RASQAL_CALLOC(rasqal_store_triples_source_user_data*, 1,
+                       sizeof(*rtsc));
+  if(!rtsc) {
+    RASQAL_FREE(rasqal_triples_source, rts);
+    return NULL;
+  }
+  rtsc->store = store;
+  if(default_graph) {
+    rtsc->default_graph = rasqal_new_uri_literal(store->world,
+                                                 raptor_uri_copy(default_graph));
+    if(!rtsc->default_graph) {
+      RASQAL_FREE(rasqal_store_triples_source_user_data, rtsc);
+      RASQAL_FREE(rasqal_triples_source, rts);
+      return NULL;
+    }
+  }
+  rtsc->snapshot = rasqal_store_add_snapshot(store);
+  if(!rtsc->snapshot) {
+    if(rtsc->default_graph)
+      rasqal_free_literal(rtsc->default_graph);
+    RASQAL_FREE(rasqal_store_triples_source_user_data, rtsc);
+    RASQAL_FREE(rasqal_triples_source, rts);
+    return NULL;
+  }
+
+  rts->version = 2;
+  rts->query = query;
+  rts->user_data = rtsc;
+  rts->init_triples_match = rasqal_store_init_triples_match;
+  rts->triple_present = rasqal_store_triple_present;
+  rts->free_triples_source = rasqal_store_free_triples_source;
+  rts->support_feature = rasqal_store_support_feature;
+
+  return rts;
+}
+
+#ifdef STANDALONE
+
+#define STORE_TEST_PREFIX "PREFIX ex: <http://example.org/> "
+
+static const struct {
+  const char* update;
+  int expected_size;
+} store_update_tests[] = {
+  { STORE_TEST_PREFIX "INSERT DATA { ex:a ex:p 1 . ex:b ex:p 2 . GRAPH ex:g { ex:a ex:q ex:b } }", 3 },
+  /* adding existing quads leaves the store unchanged */
+  { STORE_TEST_PREFIX "INSERT DATA { ex:a ex:p 1 }", 3 },
+  { STORE_TEST_PREFIX "DELETE { ?s ex:p ?o } INSERT { ?s ex:r ?o } WHERE { ?s ex:p ?o }", 3 },
+  { STORE_TEST_PREFIX "INSERT { ?s ex:copied ?o } WHERE { GRAPH ex:g { ?s ex:q ?o } }", 4 },
+  /* new blank node per solution */
+  { STORE_TEST_PREFIX "INSERT { _:n ex:of ?s } WHERE { ?s ex:r ?o }", 6 },
+  { STORE_TEST_PREFIX "DELETE DATA { ex:a ex:r 1 }", 5 },
+  { STORE_TEST_PREFIX "DELETE WHERE { ?n ex:of ?s }", 3 },
+  { STORE_TEST_PREFIX "COPY ex:g TO ex:h", 4 },
+  { STORE_TEST_PREFIX "CLEAR GRAPH ex:g", 3 },
+  /* replaces the default graph */
+  { STORE_TEST_PREFIX "MOVE ex:h TO DEFAULT", 1 },
+  /* WITH scopes the WHERE to the graph which is empty */
+  { STORE_TEST_PREFIX "WITH ex:w INSERT { ?s ex:w ?o } WHERE { ?s ex:q ?o }", 1 },
+  { STORE_TEST_PREFIX "INSERT DATA { GRAPH ex:w { ex:c ex:q ex:d } }", 2 },
+  { STORE_TEST_PREFIX "WITH ex:w INSERT { ?s ex:w ?o } WHERE { ?s ex:q ?o }", 3 },
+  { STORE_TEST_PREFIX "CLEAR ALL", 0 }
+};
+
+
+static rasqal_triple*
+store_test_new_triple(rasqal_world* world, const char* object)
+{
+  raptor_world* raptor_world_ptr = world->raptor_world_ptr;
+  const char* terms[3] = { "http://example.org/a", "http://example.org/p", NULL };
+  rasqal_literal* l[3];
+  int i;
+
+  terms[2] = object;
+  for(i = 0; i < 3; i++) {
+    raptor_uri* u;
+
+    u = raptor_new_uri(raptor_world_ptr,
+                       RASQAL_GOOD_CAST(const unsigned char*, terms[i]));
+    l[i] = u ? rasqal_new_uri_literal(world, u) : NULL;
+  }
+
+  return rasqal_new_triple(l[0], l[1], l[2]);
+}
+
+
+/* appended quads are seen by triples sources created after the merge
+ * only; removed quads are still seen by older triples sources and
+ * their matches */
+static int
+store_append_test(const char* program, rasqal_world* world)
+{
+  rasqal_store* store;
+  rasqal_triple* t1;
+  rasqal_triple* t2;
+  rasqal_triples_source* rts1 = NULL;
+  rasqal_triples_source* rts2 = NULL;
+  rasqal_triples_source* rts3 = NULL;
+  rasqal_triples_match rtm;
+  rasqal_triple_meta meta;
+  int failures = 0;
+
+  store = rasqal_new_store(world);
+  t1 = store_test_new_triple(world, "http://example.org/b");
+  t2 = store_test_new_triple(world, "http://example.org/c");
+  if(!store || !t1 || !t2) {
+    fprintf(stderr, "%s: append test setup FAILED\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  if(rasqal_store_append_triple(store, t1) ||
+     rasqal_store_get_size(store) != 0) {
+    fprintf(stderr, "%s: append was not deferred\n", program);
+    failures++;
+  }
+
+  rts1 = rasqal_store_new_triples_source(store, NULL, NULL);
+  if(!rts1 || rasqal_store_get_size(store) != 1 ||
+     !rasqal_triples_source_triple_present(rts1, t1)) {
+    fprintf(stderr, "%s: appended quad not merged for new triples source\n",
+            program);
+    failures++;
+    goto tidy;
+  }
+
+  rasqal_store_append_triple(store, t1);
+  rasqal_store_append_triple(store, t2);
+  rts2 = rasqal_store_new_triples_source(store, NULL, NULL);
+  if(!rts2 || rasqal_store_get_size(store) != 2 ||
+     !rasqal_triples_source_triple_present(rts2, t2)) {
+    fprintf(stderr, "%s: second append batch not merged\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  if(rasqal_triples_source_triple_present(rts1, t2)) {
+    fprintf(stderr, "%s: quad appended later seen by older triples source\n",
+            program);
+    failures++;
+  }
+
+  /* a removal is not seen by older triples sources, with or without
+   * an open triples match */
+  memset(&rtm, '\0', sizeof(rtm));
+  memset(&meta, '\0', sizeof(meta));
+  rtm.world = world;
+  if(rts2->init_triples_match(&rtm, rts2, rts2->user_data, &meta, t1)) {
+    fprintf(stderr, "%s: triples match init FAILED\n", program);
+    failures++;
+    goto tidy;
+  }
+  if(rasqal_store_remove_triple(store, t1) != 1 ||
+     rasqal_store_get_size(store) != 1) {
+    fprintf(stderr, "%s: quad not removed\n", program);
+    failures++;
+  }
+  if(rtm.is_end(&rtm, rtm.user_data)) {
+    fprintf(stderr, "%s: open triples match lost a removed quad\n", program);
+    failures++;
+  }
+  rtm.finish(&rtm, rtm.user_data);
+
+  if(!rasqal_triples_source_triple_present(rts1, t1) ||
+     !rasqal_triples_source_triple_present(rts2, t1)) {
+    fprintf(stderr, "%s: removed quad not seen by older triples source\n",
+            program);
+    failures++;
+  }
+
+  rts3 = rasqal_store_new_triples_source(store, NULL, NULL);
+  if(!rts3 || rasqal_triples_source_triple_present(rts3, t1)) {
+    fprintf(stderr, "%s: removed quad seen by newer triples source\n",
+            program);
+    failures++;
+  }
+
+  /* the removed quad is freed with the last triples source seeing it */
+  rasqal_free_triples_source(rts1);
+  rts1 = NULL;
+  rasqal_free_triples_source(rts2);
+  rts2 = NULL;
+  if(store->tombstones) {
+    fprintf(stderr, "%s: removed quad kept after its triples sources were freed\n",
+            program);
+    failures++;
+  }
+
+  tidy:
+  if(rts3)
+    rasqal_free_triples_source(rts3);
+  if(rts2)
+    rasqal_free_triples_source(rts2);
+  if(rts1)
+    rasqal_free_triples_source(rts1);
+  if(t2)
+    rasqal_free_triple(t2);
+  if(t1)
+    rasqal_free_triple(t1);
+  if(store)
+    rasqal_free_store(store);
+
+  return failures;
+}
+
+
+/* execute a query with the public API returning the number of rows,
+ * 1 or 0 for a boolean result or <0 on failure */
+static int
+store_test_execute(rasqal_world* world, raptor_uri* base_uri,
+                   const char* ql_name, const char* query_string)
+{
+  rasqal_query* query;
+  rasqal_query_results* results = NULL;
+  int count = -1;
+
+  query = rasqal_new_query(world, ql_name, NULL);
+  if(!query ||
+     rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          base_uri))
+    goto tidy;
+
+  results = rasqal_query_execute(query);
+  if(!results)
+    goto tidy;
+
+  if(rasqal_query_results_is_boolean(results))
+    count = rasqal_query_results_get_boolean(results);
+  else {
+    count = 0;
+    while(!rasqal_query_results_finished(results)) {
+      count++;
+      rasqal_query_results_next(results);
+    }
+  }
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+
+  return count;
+}
+
+
+/* update queries run by rasqal_query_execute() change the world
+ * dataset seen by later queries */
+static int
+store_world_update_test(const char* program)
+{
+  rasqal_world* world;
+  raptor_uri* base_uri = NULL;
+  int failures = 0;
+  int count;
+
+  world = rasqal_new_world();
+  if(world && !rasqal_world_open(world))
+    base_uri = raptor_new_uri(world->raptor_world_ptr,
+                              RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+  if(!base_uri) {
+    fprintf(stderr, "%s: world update test setup FAILED\n", program);
+    if(world)
+      rasqal_free_world(world);
+    return 1;
+  }
+
+  count = store_test_execute(world, base_uri, "sparql11-update",
+                             STORE_TEST_PREFIX "INSERT DATA { ex:a ex:p 1 . ex:b ex:p 2 . GRAPH ex:g { ex:a ex:q ex:b } }");
+  if(count != 1) {
+    fprintf(stderr, "%s: world INSERT DATA returned %d, expected true\n",
+            program, count);
+    failures++;
+  }
+
+  count = store_test_execute(world, base_uri, "sparql11-query",
+                             STORE_TEST_PREFIX "SELECT ?s WHERE { ?s ex:p ?o }");
+  if(count != 2) {
+    fprintf(stderr, "%s: world dataset has %d inserted rows, expected 2\n",
+            program, count);
+    failures++;
+  }
+
+  count = store_test_execute(world, base_uri, "sparql11-query",
+                             "SELECT ?g WHERE { GRAPH ?g { ?s ?p ?o } }");
+  if(count != 1) {
+    fprintf(stderr, "%s: world dataset has %d rows in inserted graph, expected 1\n",
+            program, count);
+    failures++;
+  }
+
+  count = store_test_execute(world, base_uri, "sparql11-update",
+                             STORE_TEST_PREFIX "DELETE WHERE { ?s ex:p 1 }");
+  if(count != 1) {
+    fprintf(stderr, "%s: world DELETE WHERE returned %d, expected true\n",
+            program, count);
+    failures++;
+  }
+
+  count = store_test_execute(world, base_uri, "sparql11-query",
+                             STORE_TEST_PREFIX "SELECT ?s WHERE { ?s ex:p ?o }");
+  if(count != 1) {
+    fprintf(stderr, "%s: world dataset has %d rows after delete, expected 1\n",
+            program, count);
+    failures++;
+  }
+
+  raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+
+int main(int argc, char *argv[]);
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world;
+  rasqal_store* store = NULL;
+  raptor_uri* base_uri = NULL;
+  unsigned int i;
+  int failures = 0;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+
+  base_uri = raptor_new_uri(world->raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, "http://example.org/"));
+  store = rasqal_new_store(world);
+  if(!base_uri || !store) {
+    fprintf(stderr, "%s: failed to create store\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  for(i = 0; i < sizeof(store_update_tests) / sizeof(store_update_tests[0]); i++) {
+    const char* update = store_update_tests[i].update;
+    int expected_size = store_update_tests[i].expected_size;
+    rasqal_query* query;
+    int size;
+
+    query = rasqal_new_query(world, "sparql11-update", NULL);
+    if(!query ||
+       rasqal_query_prepare(query, RASQAL_GOOD_CAST(const unsigned char*, update),
+                            base_uri)) {
+      fprintf(stderr, "%s: update %u '%s' prepare FAILED\n", program, i,
+              update);
+      if(query)
+        rasqal_free_query(query);
+      failures++;
+      continue;
+    }
+
+    if(rasqal_query_execute_update(query, store)) {
+      fprintf(stderr, "%s: update %u '%s' execute FAILED\n", program, i,
+              update);
+      failures++;
+    } else {
+      size = rasqal_store_get_size(store);
+      if(size != expected_size) {
+        fprintf(stderr,
+                "%s: update %u '%s' gave %d quads, expected %d\n",
+                program, i, update, size, expected_size);
+        failures++;
+      }
+    }
+
+    rasqal_free_query(query);
+  }
+
+  failures += store_append_test(program, world);
+  failures += store_world_update_test(program);
+
+  tidy:
+  if(store)
+    rasqal_free_store(store);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
@@ -73,6 +73,7 @@ rasqal_set_triples_source_factory(rasqal_world* world,
   rasqal_world_open(world);
   
   world->triples_source_factory.user_data = user_data;
+  world->triples_source_factory_register_fn = register_fn;
   rc = register_fn(&world->triples_source_factory);
 
   /* Failed if the factory API version is not in the supported range */
@@ -134,6 +135,10 @@ rasqal_triples_source_error_handler2(rasqal_world* world,
  *
  * INTERNAL - Create a new triples source
  *
+ * A query with no data graphs of its own is matched against the
+ * world persistent dataset when there is one, otherwise the
+ * registered triples source factory is used.
+ *
  * Return value: a new triples source or NULL on failure
  */
 rasqal_triples_source*
@@ -143,6 +148,9 @@ rasqal_new_triples_source(rasqal_query* query)
   rasqal_triples_source* rts;
   int rc = 0;
   
+  if(rasqal_query_uses_world_dataset(query))
+    return rasqal_store_new_triples_source(query->world->store, query, NULL);
+
   rts = RASQAL_CALLOC(rasqal_triples_source*, 1, sizeof(*rts));
   if(!rts)
     return NULL;
@@ -219,3 +219,527 @@ rasqal_update_operation_print(rasqal_update_operation *update, FILE* stream)
 }
 
 
+
+
+/*
+ * rasqal_update_instantiate_term:
+ * @query: query
+ * @l: template term
+ * @rowsource: WHERE rowsource or NULL
+ * @row: WHERE solution row or NULL
+ * @bnodes: blank node label map for this solution or NULL to copy blank nodes
+ *
+ * INTERNAL - Get the value of a template term for one solution
+ *
+ * @bnodes is a sequence of (template blank node, new blank node)
+ * pairs so that each solution gets new blank nodes.
+ *
+ * Return value: new literal or NULL if the term is unbound or on failure
+ */
+static rasqal_literal*
+rasqal_update_instantiate_term(rasqal_query* query, rasqal_literal* l,
+                               rasqal_rowsource* rowsource, rasqal_row* row,
+                               raptor_sequence* bnodes)
+{
+  rasqal_variable* v;
+  rasqal_literal* bl;
+  unsigned char* id;
+  int i;
+
+  if(!l)
+    return NULL;
+
+  v = rasqal_literal_as_variable(l);
+  if(v) {
+    int offset;
+
+    if(!row)
+      return NULL;
+
+    offset = rasqal_rowsource_get_variable_offset_by_name(rowsource, v->name);
+    if(offset < 0 || !row->values[offset])
+      return NULL;
+
+    return rasqal_new_literal_from_literal(row->values[offset]);
+  }
+
+  if(l->type != RASQAL_LITERAL_BLANK || !bnodes)
+    return rasqal_new_literal_from_literal(l);
+
+  for(i = 0; (bl = (rasqal_literal*)raptor_sequence_get_at(bnodes, i)); i += 2) {
+    if(!strcmp(RASQAL_GOOD_CAST(const char*, bl->string),
+               RASQAL_GOOD_CAST(const char*, l->string)))
+      return rasqal_new_literal_from_literal((rasqal_literal*)raptor_sequence_get_at(bnodes, i + 1));
+  }
+
+  id = rasqal_world_generate_bnodeid(query->world, NULL);
+  if(!id)
+    return NULL;
+
+  bl = rasqal_new_simple_literal(query->world, RASQAL_LITERAL_BLANK, id);
+  if(!bl)
+    return NULL;
+
+  if(raptor_sequence_push(bnodes, rasqal_new_literal_from_literal(l)) ||
+     raptor_sequence_push(bnodes, rasqal_new_literal_from_literal(bl))) {
+    rasqal_free_literal(bl);
+    return NULL;
+  }
+
+  return bl;
+}
+
+
+/*
+ * rasqal_update_instantiate_templates:
+ * @query: query
+ * @templates: sequence of #rasqal_triple templates or NULL
+ * @graph_uri: graph for templates with no origin or NULL for the default graph
+ * @rowsource: WHERE rowsource or NULL
+ * @row: WHERE solution row or NULL
+ * @new_bnodes: non-0 to make new blank nodes for each solution
+ * @triples: sequence to add the quads to
+ *
+ * INTERNAL - Add the quads made from the templates for one solution
+ *
+ * Templates with unbound variables or that do not make a valid quad
+ * are skipped.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_update_instantiate_templates(rasqal_query* query,
+                                    raptor_sequence* templates,
+                                    raptor_uri* graph_uri,
+                                    rasqal_rowsource* rowsource,
+                                    rasqal_row* row,
+                                    int new_bnodes,
+                                    raptor_sequence* triples)
+{
+  raptor_sequence* bnodes = NULL;
+  rasqal_triple* tt;
+  int i;
+  int rc = 0;
+
+  if(!templates)
+    return 0;
+
+  if(new_bnodes) {
+    bnodes = raptor_new_sequence((raptor_data_free_handler)rasqal_free_literal,
+                                 (raptor_data_print_handler)rasqal_literal_print);
+    if(!bnodes)
+      return 1;
+  }
+
+  for(i = 0; (tt = (rasqal_triple*)raptor_sequence_get_at(templates, i)); i++) {
+    rasqal_literal *s, *p, *o, *origin = NULL;
+    rasqal_triple* t;
+
+    s = rasqal_update_instantiate_term(query, tt->subject, rowsource, row,
+                                       bnodes);
+    p = rasqal_update_instantiate_term(query, tt->predicate, rowsource, row,
+                                       bnodes);
+    o = rasqal_update_instantiate_term(query, tt->object, rowsource, row,
+                                       bnodes);
+    if(tt->origin)
+      origin = rasqal_update_instantiate_term(query, tt->origin, rowsource,
+                                              row, NULL);
+    else if(graph_uri)
+      origin = rasqal_new_uri_literal(query->world, raptor_uri_copy(graph_uri));
+
+    if(!s || !p || !o || (tt->origin && !origin) ||
+       (s->type != RASQAL_LITERAL_URI && s->type != RASQAL_LITERAL_BLANK) ||
+       p->type != RASQAL_LITERAL_URI ||
+       (origin && origin->type != RASQAL_LITERAL_URI)) {
+      if(s)
+        rasqal_free_literal(s);
+      if(p)
+        rasqal_free_literal(p);
+      if(o)
+        rasqal_free_literal(o);
+      if(origin)
+        rasqal_free_literal(origin);
+      continue;
+    }
+
+    t = rasqal_new_triple(s, p, o);
+    if(!t) {
+      if(origin)
+        rasqal_free_literal(origin);
+      rc = 1;
+      break;
+    }
+    if(origin)
+      rasqal_triple_set_origin(t, origin);
+
+    if(raptor_sequence_push(triples, t)) {
+      rc = 1;
+      break;
+    }
+  }
+
+  if(bnodes)
+    raptor_free_sequence(bnodes);
+
+  return rc;
+}
+
+
+/* non-0 if any template has a variable term */
+static int
+rasqal_update_templates_have_variables(raptor_sequence* templates)
+{
+  rasqal_triple* t;
+  int i;
+
+  for(i = 0; (t = (rasqal_triple*)raptor_sequence_get_at(templates, i)); i++) {
+    if(rasqal_literal_as_variable(t->subject) ||
+       rasqal_literal_as_variable(t->predicate) ||
+       rasqal_literal_as_variable(t->object) ||
+       (t->origin && rasqal_literal_as_variable(t->origin)))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+ * rasqal_update_where_graph_pattern:
+ * @query: query
+ * @templates: DELETE WHERE templates
+ *
+ * INTERNAL - Make a basic graph pattern matching DELETE WHERE templates
+ *
+ * The triple patterns are appended to the query triples and must be
+ * removed with rasqal_update_free_where_graph_pattern().
+ *
+ * Return value: new graph pattern or NULL on failure
+ */
+static rasqal_graph_pattern*
+rasqal_update_where_graph_pattern(rasqal_query* query,
+                                  raptor_sequence* templates)
+{
+  raptor_sequence* triples;
+  rasqal_triple* tt;
+  int i;
+
+  triples = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                (raptor_data_print_handler)rasqal_triple_print);
+  if(!triples)
+    return NULL;
+
+  for(i = 0; (tt = (rasqal_triple*)raptor_sequence_get_at(templates, i)); i++) {
+    rasqal_triple* t = rasqal_new_triple_from_triple(tt);
+
+    if(!t) {
+      raptor_free_sequence(triples);
+      return NULL;
+    }
+    if(tt->origin)
+      rasqal_triple_set_origin(t, rasqal_new_literal_from_literal(tt->origin));
+    if(raptor_sequence_push(triples, t)) {
+      raptor_free_sequence(triples);
+      return NULL;
+    }
+  }
+
+  return rasqal_new_basic_graph_pattern_from_triples(query, triples);
+}
+
+
+static void
+rasqal_update_free_where_graph_pattern(rasqal_query* query,
+                                       rasqal_graph_pattern* gp)
+{
+  int count = gp->end_column - gp->start_column + 1;
+
+  rasqal_free_graph_pattern(gp);
+
+  while(count-- > 0) {
+    rasqal_triple* t = (rasqal_triple*)raptor_sequence_pop(query->triples);
+    if(t)
+      rasqal_free_triple(t);
+  }
+}
+
+
+/*
+ * rasqal_update_execute_modify:
+ * @query: query
+ * @store: store
+ * @update: INSERT / DELETE update operation
+ *
+ * INTERNAL - Execute an INSERT / DELETE DATA or DELETE / INSERT WHERE operation
+ *
+ * All the WHERE solutions are found before the store is changed and
+ * then the deletes and inserts are applied as two batches.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_update_execute_modify(rasqal_query* query, rasqal_store* store,
+                             rasqal_update_operation* update)
+{
+  raptor_sequence* deletes = NULL;
+  raptor_sequence* inserts = NULL;
+  rasqal_graph_pattern* where = update->where;
+  rasqal_graph_pattern* delete_where = NULL;
+  rasqal_graph_pattern* saved_gp = query->query_graph_pattern;
+  raptor_sequence* saved_data_graphs = query->data_graphs;
+  raptor_sequence* data_graphs = NULL;
+  rasqal_triples_source* triples_source = NULL;
+  rasqal_algebra_node* node = NULL;
+  rasqal_rowsource* rowsource = NULL;
+  raptor_sequence* rows = NULL;
+  int rc = 1;
+
+  deletes = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                (raptor_data_print_handler)rasqal_triple_print);
+  inserts = raptor_new_sequence((raptor_data_free_handler)rasqal_free_triple,
+                                (raptor_data_print_handler)rasqal_triple_print);
+  if(!deletes || !inserts)
+    goto tidy;
+
+  if(update->flags & RASQAL_UPDATE_FLAGS_DATA) {
+    if(rasqal_update_instantiate_templates(query, update->delete_templates,
+                                           update->graph_uri, NULL, NULL, 0,
+                                           deletes) ||
+       rasqal_update_instantiate_templates(query, update->insert_templates,
+                                           update->graph_uri, NULL, NULL, 0,
+                                           inserts))
+      goto tidy;
+
+    rc = rasqal_store_apply(store, deletes, inserts);
+    goto tidy;
+  }
+
+  /* DELETE WHERE { pattern } is DELETE { pattern } WHERE { pattern } */
+  if(!where && update->delete_templates &&
+     rasqal_update_templates_have_variables(update->delete_templates)) {
+    delete_where = rasqal_update_where_graph_pattern(query,
+                                                     update->delete_templates);
+    if(!delete_where)
+      goto tidy;
+    where = delete_where;
+  }
+
+  if(!where) {
+    /* no WHERE: one empty solution */
+    if(rasqal_update_instantiate_templates(query, update->delete_templates,
+                                           NULL, NULL, NULL, 0, deletes) ||
+       rasqal_update_instantiate_templates(query, update->insert_templates,
+                                           NULL, NULL, NULL, 1, inserts))
+      goto tidy;
+  } else {
+    raptor_sequence* names;
+    raptor_uri* name;
+    rasqal_row* row;
+    int i;
+
+    /* the store named graphs are the dataset for GRAPH in the WHERE */
+    data_graphs = raptor_new_sequence((raptor_data_free_handler)rasqal_free_data_graph,
+                                      (raptor_data_print_handler)rasqal_data_graph_print);
+    names = rasqal_store_get_graph_names(store);
+    if(!data_graphs || !names) {
+      if(names)
+        raptor_free_sequence(names);
+      goto tidy;
+    }
+    for(i = 0; (name = (raptor_uri*)raptor_sequence_get_at(names, i)); i++) {
+      rasqal_data_graph* dg;
+
+      dg = rasqal_new_data_graph_from_uri(query->world, name, name,
+                                          RASQAL_DATA_GRAPH_NAMED,
+                                          NULL, NULL, NULL);
+      if(!dg || raptor_sequence_push(data_graphs, dg)) {
+        raptor_free_sequence(names);
+        goto tidy;
+      }
+    }
+    raptor_free_sequence(names);
+
+    query->query_graph_pattern = where;
+    query->data_graphs = data_graphs;
+
+    if(rasqal_query_prepare_update_where(query))
+      goto tidy;
+
+    /* WITH graph is the WHERE default graph */
+    triples_source = rasqal_store_new_triples_source(store, query,
+                                                     update->graph_uri);
+    if(!triples_source)
+      goto tidy;
+
+    rowsource = rasqal_algebra_query_to_rowsource(query, triples_source, &node);
+    if(!rowsource)
+      goto tidy;
+
+    /* all solutions are found before the store changes */
+    rows = rasqal_rowsource_read_all_rows(rowsource);
+    if(!rows)
+      goto tidy;
+
+    for(i = 0; (row = (rasqal_row*)raptor_sequence_get_at(rows, i)); i++) {
+      if(rasqal_update_instantiate_templates(query, update->delete_templates,
+                                             NULL, rowsource, row, 0,
+                                             deletes) ||
+         rasqal_update_instantiate_templates(query, update->insert_templates,
+                                             NULL, rowsource, row, 1,
+                                             inserts))
+        goto tidy;
+    }
+
+    /* end the store triples matches so the deletes may be applied */
+    raptor_free_sequence(rows);
+    rows = NULL;
+    rasqal_free_rowsource(rowsource);
+    rowsource = NULL;
+    rasqal_free_algebra_node(node);
+    node = NULL;
+    rasqal_free_triples_source(triples_source);
+    triples_source = NULL;
+  }
+
+  rc = rasqal_store_apply(store, deletes, inserts);
+
+  tidy:
+  query->query_graph_pattern = saved_gp;
+  query->data_graphs = saved_data_graphs;
+
+  if(rows)
+    raptor_free_sequence(rows);
+  if(rowsource)
+    rasqal_free_rowsource(rowsource);
+  if(node)
+    rasqal_free_algebra_node(node);
+  if(triples_source)
+    rasqal_free_triples_source(triples_source);
+  if(data_graphs)
+    raptor_free_sequence(data_graphs);
+  if(delete_where)
+    rasqal_update_free_where_graph_pattern(query, delete_where);
+  if(deletes)
+    raptor_free_sequence(deletes);
+  if(inserts)
+    raptor_free_sequence(inserts);
+
+  return rc;
+}
+
+
+/*
+ * rasqal_update_execute_operation:
+ * @query: query
+ * @store: store
+ * @update: update operation
+ *
+ * INTERNAL - Execute one update operation on a store
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rasqal_update_execute_operation(rasqal_query* query, rasqal_store* store,
+                                rasqal_update_operation* update)
+{
+  rasqal_data_graph* dg;
+  int rc = 0;
+
+  /* appended quads come before this operation */
+  if(rasqal_store_merge(store) < 0)
+    return 1;
+
+  switch(update->type) {
+    case RASQAL_UPDATE_TYPE_UPDATE:
+      rc = rasqal_update_execute_modify(query, store, update);
+      break;
+
+    case RASQAL_UPDATE_TYPE_CLEAR:
+    case RASQAL_UPDATE_TYPE_DROP:
+      /* graphs only exist while they have quads so these are the same */
+      if(rasqal_store_clear_graph(store, update->graph_uri,
+                                  update->applies) < 0)
+        rc = 1;
+      break;
+
+    case RASQAL_UPDATE_TYPE_CREATE:
+      break;
+
+    case RASQAL_UPDATE_TYPE_LOAD:
+      dg = rasqal_new_data_graph_from_uri(query->world, update->document_uri,
+                                          update->graph_uri,
+                                          update->graph_uri ? RASQAL_DATA_GRAPH_NAMED : RASQAL_DATA_GRAPH_BACKGROUND,
+                                          NULL, NULL, NULL);
+      if(!dg)
+        return 1;
+      rc = rasqal_store_load_data_graph(store, dg);
+      rasqal_free_data_graph(dg);
+      break;
+
+    case RASQAL_UPDATE_TYPE_ADD:
+      rc = rasqal_store_add_graph(store, update->graph_uri,
+                                  update->document_uri);
+      break;
+
+    case RASQAL_UPDATE_TYPE_COPY:
+    case RASQAL_UPDATE_TYPE_MOVE:
+      if(update->graph_uri == update->document_uri ||
+         (update->graph_uri && update->document_uri &&
+          raptor_uri_equals(update->graph_uri, update->document_uri)))
+        break;
+
+      if(rasqal_store_clear_graph(store, update->document_uri,
+                                  RASQAL_UPDATE_GRAPH_ONE) < 0)
+        return 1;
+      rc = rasqal_store_add_graph(store, update->graph_uri,
+                                  update->document_uri);
+      if(!rc && update->type == RASQAL_UPDATE_TYPE_MOVE &&
+         rasqal_store_clear_graph(store, update->graph_uri,
+                                  RASQAL_UPDATE_GRAPH_ONE) < 0)
+        rc = 1;
+      break;
+
+    case RASQAL_UPDATE_TYPE_UNKNOWN:
+    default:
+      rc = 1;
+      break;
+  }
+
+  return rc;
+}
+
+
+/**
+ * rasqal_query_execute_update:
+ * @query: prepared update query
+ * @store: store to change
+ *
+ * INTERNAL - Execute the update operations of a query on a store
+ *
+ * The operations are run in order.  A failing operation with the
+ * SILENT flag is ignored; otherwise execution stops there, leaving
+ * the changes made by the earlier operations.
+ *
+ * Return value: non-0 on failure
+ */
+int
+rasqal_query_execute_update(rasqal_query* query, rasqal_store* store)
+{
+  rasqal_update_operation* update;
+  int i;
+
+  for(i = 0; (update = rasqal_query_get_update_operation(query, i)); i++) {
+    if(rasqal_update_execute_operation(query, store, update)) {
+      if(update->flags & RASQAL_UPDATE_FLAGS_SILENT)
+        continue;
+
+      rasqal_log_error_simple(query->world, RAPTOR_LOG_LEVEL_ERROR,
+                              &query->locator,
+                              "Update operation %d %s failed", i + 1,
+                              rasqal_update_type_label(update->type));
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,717 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_utf8.c - Rasqal UTF-8 string kernels for string functions
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#include <raptor.h>
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RASQAL_UTF8_AVX2 1
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RASQAL_UTF8_SSE2 1
+#endif
+
+
+/*
+ * Literal strings in data are overwhelmingly ASCII.  These kernels
+ * find the ASCII prefix of a string 32 or 16 bytes at a time when
+ * AVX2 or SSE2 is available at compile time, where character and
+ * byte offsets are the same, and only walk UTF-8 sequences after it.
+ * Anything that is not well-formed UTF-8 is reported back so that
+ * callers can keep using the raptor functions and get the same
+ * answer as before.
+ */
+
+
+#if defined(RASQAL_UTF8_SSE2) || defined(RASQAL_UTF8_AVX2)
+static RASQAL_INLINE size_t
+rasqal_utf8_first_bit(unsigned int mask)
+{
+#ifdef __GNUC__
+  return RASQAL_GOOD_CAST(size_t, __builtin_ctz(mask));
+#else
+  size_t i = 0;
+
+  while(!(mask & 1)) {
+    mask >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+#endif
+
+
+/*
+ * rasqal_utf8_ascii_span:
+ * @string: string
+ * @len: length of @string
+ *
+ * INTERNAL - Get the length of the ASCII prefix of @string
+ *
+ * Return value: number of bytes before the first byte >= 0x80 or @len
+ */
+size_t
+rasqal_utf8_ascii_span(const unsigned char* string, size_t len)
+{
+  size_t i = 0;
+
+#ifdef RASQAL_UTF8_AVX2
+  for(; len - i >= 32; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(string + i));
+    unsigned int mask = RASQAL_GOOD_CAST(unsigned int, _mm256_movemask_epi8(v));
+
+    if(mask)
+      return i + rasqal_utf8_first_bit(mask);
+  }
+#endif
+
+#ifdef RASQAL_UTF8_SSE2
+  for(; len - i >= 16; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(string + i));
+    unsigned int mask = RASQAL_GOOD_CAST(unsigned int, _mm_movemask_epi8(v));
+
+    if(mask)
+      return i + rasqal_utf8_first_bit(mask);
+  }
+#endif
+
+  for(; i < len; i++) {
+    if(string[i] & 0x80)
+      break;
+  }
+
+  return i;
+}
+
+
+/*
+ * rasqal_utf8_char_length:
+ * @string: string
+ * @len: length of @string, at least 1
+ *
+ * INTERNAL - Get the length of the well-formed UTF-8 character at @string
+ *
+ * Overlong forms, surrogates and code points above U+10FFFF are not
+ * well-formed.
+ *
+ * Return value: 1 to 4 or 0 if the bytes are not a well-formed character
+ */
+static int
+rasqal_utf8_char_length(const unsigned char* string, size_t len)
+{
+  unsigned char c = string[0];
+  unsigned char lo = 0x80;
+  unsigned char hi = 0xBF;
+  int n;
+  int i;
+
+  if(c < 0x80)
+    return 1;
+
+  if(c < 0xC2)
+    return 0;
+  else if(c < 0xE0)
+    n = 2;
+  else if(c < 0xF0) {
+    n = 3;
+    if(c == 0xE0)
+      lo = 0xA0;
+    else if(c == 0xED)
+      hi = 0x9F;
+  } else if(c < 0xF5) {
+    n = 4;
+    if(c == 0xF0)
+      lo = 0x90;
+    else if(c == 0xF4)
+      hi = 0x8F;
+  } else
+    return 0;
+
+  if(len < RASQAL_GOOD_CAST(size_t, n))
+    return 0;
+
+  /* the first continuation byte has the tighter range */
+  if(string[1] < lo || string[1] > hi)
+    return 0;
+  for(i = 2; i < n; i++) {
+    if((string[i] & 0xC0) != 0x80)
+      return 0;
+  }
+
+  return n;
+}
+
+
+/*
+ * rasqal_utf8_strlen:
+ * @string: UTF-8 string
+ * @len: length of @string in bytes
+ *
+ * INTERNAL - Count the characters in a UTF-8 string
+ *
+ * Return value: number of characters or <0 if @string is not valid UTF-8
+ */
+int
+rasqal_utf8_strlen(const unsigned char* string, size_t len)
+{
+  size_t i = 0;
+  int count = 0;
+
+  while(i < len) {
+    size_t ascii = rasqal_utf8_ascii_span(string + i, len - i);
+    int n;
+
+    i += ascii;
+    count += RASQAL_GOOD_CAST(int, ascii);
+    if(i == len)
+      break;
+
+    n = rasqal_utf8_char_length(string + i, len - i);
+    if(!n)
+      return raptor_unicode_utf8_strlen(string, len);
+
+    i += RASQAL_GOOD_CAST(size_t, n);
+    count++;
+  }
+
+  return count;
+}
+
+
+/*
+ * rasqal_utf8_substr:
+ * @string: UTF-8 string
+ * @len: length of @string in bytes
+ * @start: index of first character from 0
+ * @length: number of characters or -1 for the rest of @string
+ * @view_len_p: pointer to store length of substring in bytes
+ *
+ * INTERNAL - Find a non-empty substring of a UTF-8 string by character
+ *
+ * The substring is returned as a pointer into @string and is not
+ * NUL terminated.
+ *
+ * Return value: start of substring or NULL if @start or @length are
+ * negative or 0, the substring would be empty or @string is not valid
+ * UTF-8 up to its end.
+ */
+const unsigned char*
+rasqal_utf8_substr(const unsigned char* string, size_t len,
+                   int start, int length, size_t* view_len_p)
+{
+  size_t ascii;
+  size_t i;
+  size_t begin;
+  int count;
+
+  if(start < 0 || !(length > 0 || length == -1))
+    return NULL;
+
+  /* characters and bytes are the same in the ASCII prefix */
+  if(length > 0 && RASQAL_GOOD_CAST(size_t, start) + RASQAL_GOOD_CAST(size_t, length) <= len) {
+    size_t end = RASQAL_GOOD_CAST(size_t, start) + RASQAL_GOOD_CAST(size_t, length);
+
+    ascii = rasqal_utf8_ascii_span(string, end);
+    if(ascii == end) {
+      *view_len_p = RASQAL_GOOD_CAST(size_t, length);
+      return string + start;
+    }
+  } else
+    ascii = rasqal_utf8_ascii_span(string, len);
+
+  if(RASQAL_GOOD_CAST(size_t, start) <= ascii) {
+    i = RASQAL_GOOD_CAST(size_t, start);
+    count = start;
+  } else {
+    i = ascii;
+    count = RASQAL_GOOD_CAST(int, ascii);
+  }
+
+  /* skip to character @start */
+  while(count < start && i < len) {
+    int n = rasqal_utf8_char_length(string + i, len - i);
+    if(!n)
+      return NULL;
+    i += RASQAL_GOOD_CAST(size_t, n);
+    count++;
+  }
+  begin = i;
+
+  /* take @length characters */
+  count = 0;
+  while(i < len && (length < 0 || count < length)) {
+    int n = rasqal_utf8_char_length(string + i, len - i);
+    if(!n)
+      return NULL;
+    i += RASQAL_GOOD_CAST(size_t, n);
+    count++;
+  }
+
+  if(i == begin)
+    return NULL;
+
+  *view_len_p = i - begin;
+  return string + begin;
+}
+
+
+/*
+ * rasqal_utf8_set_case:
+ * @dest: destination of at least @len bytes
+ * @string: string
+ * @len: length of @string
+ * @upper: non-0 to map to upper case, otherwise lower case
+ *
+ * INTERNAL - Copy a string mapping ASCII letters to upper or lower case
+ *
+ * Bytes that are not ASCII letters are copied unchanged.  @dest is
+ * not NUL terminated.
+ */
+void
+rasqal_utf8_set_case(unsigned char* dest, const unsigned char* string,
+                     size_t len, int upper)
+{
+  /* letters to change are in [first, first+25] */
+  const unsigned char first = upper ? 'a' : 'A';
+  size_t i = 0;
+
+#ifdef RASQAL_UTF8_AVX2
+  if(len >= 32) {
+    const __m256i below = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, first - 1));
+    const __m256i above = _mm256_set1_epi8(RASQAL_GOOD_CAST(char, first + 26));
+    const __m256i bit = _mm256_set1_epi8(0x20);
+
+    for(; len - i >= 32; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(string + i));
+      /* signed compares so bytes >= 0x80 never match */
+      __m256i m = _mm256_and_si256(_mm256_cmpgt_epi8(v, below),
+                                   _mm256_cmpgt_epi8(above, v));
+
+      v = _mm256_xor_si256(v, _mm256_and_si256(m, bit));
+      _mm256_storeu_si256((__m256i*)(dest + i), v);
+    }
+  }
+#endif
+
+#ifdef RASQAL_UTF8_SSE2
+  if(len - i >= 16) {
+    const __m128i below = _mm_set1_epi8(RASQAL_GOOD_CAST(char, first - 1));
+    const __m128i above = _mm_set1_epi8(RASQAL_GOOD_CAST(char, first + 26));
+    const __m128i bit = _mm_set1_epi8(0x20);
+
+    for(; len - i >= 16; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(string + i));
+      /* signed compares so bytes >= 0x80 never match */
+      __m128i m = _mm_and_si128(_mm_cmpgt_epi8(v, below),
+                                _mm_cmplt_epi8(v, above));
+
+      v = _mm_xor_si128(v, _mm_and_si128(m, bit));
+      _mm_storeu_si128((__m128i*)(dest + i), v);
+    }
+  }
+#endif
+
+  for(; i < len; i++) {
+    unsigned char c = string[i];
+
+    if(RASQAL_GOOD_CAST(unsigned char, c - first) < 26)
+      c ^= 0x20;
+    dest[i] = c;
+  }
+}
+
+
+/*
+ * rasqal_utf8_find:
+ * @haystack: string to search
+ * @haystack_len: length of @haystack
+ * @needle: string to find
+ * @needle_len: length of @needle
+ *
+ * INTERNAL - Find the first occurrence of a counted string in another
+ *
+ * Since UTF-8 is self-synchronising a byte match is a character match.
+ *
+ * Return value: pointer to match in @haystack or NULL if not found
+ */
+const unsigned char*
+rasqal_utf8_find(const unsigned char* haystack, size_t haystack_len,
+                 const unsigned char* needle, size_t needle_len)
+{
+  const unsigned char* p = haystack;
+  const unsigned char* last;
+
+  if(!needle_len)
+    return haystack;
+
+  if(needle_len > haystack_len)
+    return NULL;
+
+  last = haystack + (haystack_len - needle_len);
+  while(p <= last) {
+    p = RASQAL_GOOD_CAST(const unsigned char*,
+                         memchr(p, needle[0], RASQAL_GOOD_CAST(size_t, last - p) + 1));
+    if(!p)
+      break;
+
+    if(!memcmp(p + 1, needle + 1, needle_len - 1))
+      return p;
+    p++;
+  }
+
+  return NULL;
+}
+
+
+/* RFC 3986 unreserved: A-Z a-z 0-9 - _ . ~ as a 256 bit map */
+static const unsigned int rasqal_utf8_uri_unreserved[8] = {
+  0x00000000U, 0x03FF6000U, 0x87FFFFFEU, 0x47FFFFFEU,
+  0x00000000U, 0x00000000U, 0x00000000U, 0x00000000U
+};
+
+#define RASQAL_UTF8_URI_UNRESERVED(c) \
+  ((rasqal_utf8_uri_unreserved[(c) >> 5] >> ((c) & 31)) & 1)
+
+
+/*
+ * rasqal_utf8_encode_for_uri:
+ * @dest: destination of at least 3 * @len + 1 bytes
+ * @string: UTF-8 string
+ * @len: length of @string
+ *
+ * INTERNAL - Percent-encode all but the RFC 3986 unreserved characters
+ *
+ * Return value: length of NUL terminated string written to @dest
+ */
+size_t
+rasqal_utf8_encode_for_uri(unsigned char* dest, const unsigned char* string,
+                           size_t len)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  unsigned char* p = dest;
+  size_t i = 0;
+
+  while(i < len) {
+    size_t run;
+
+    /* copy a run of unreserved bytes */
+    for(run = i; run < len; run++) {
+      if(!RASQAL_UTF8_URI_UNRESERVED(string[run]))
+        break;
+    }
+    if(run > i) {
+      memcpy(p, string + i, run - i);
+      p += run - i;
+      i = run;
+      if(i == len)
+        break;
+    }
+
+    *p++ = '%';
+    *p++ = RASQAL_GOOD_CAST(unsigned char, hex[string[i] >> 4]);
+    *p++ = RASQAL_GOOD_CAST(unsigned char, hex[string[i] & 0x0f]);
+    i++;
+  }
+  *p = '\0';
+
+  return RASQAL_GOOD_CAST(size_t, p - dest);
+}
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+#define UTF8_TEST_SEED 54321U
+#define UTF8_TEST_VALUES_COUNT 20000
+#define UTF8_TEST_VALUE_MAX_LEN 120
+
+/* label-like words with some multi-byte characters and bad UTF-8 */
+static const char* const utf8_test_pieces[] = {
+  "Label", "of", "the", "Resource", "name", "Example", "2014", " ", " ",
+  "-", "_", "~", ".", "/", "%", "+", "@", "ZYX", "abc",
+  "\xc3\xa9", "\xc3\x89", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+  "\xff", "\xc3", "\xe0\x80\x80"
+};
+#define UTF8_TEST_PIECES_COUNT \
+  (sizeof(utf8_test_pieces) / sizeof(utf8_test_pieces[0]))
+/* pieces from these indexes are multi-byte or invalid */
+#define UTF8_TEST_FIRST_MULTIBYTE 19
+#define UTF8_TEST_FIRST_INVALID 23
+
+
+/* reference: the byte at a time ENCODE_FOR_URI */
+static size_t
+utf8_test_encode_reference(unsigned char* dest, const unsigned char* s,
+                           size_t len)
+{
+  unsigned char* p = dest;
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    unsigned char c = s[i];
+
+    if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+       (c >= '0' && c <= '9') ||
+       c == '-' || c == '_' || c == '.' || c == '~') {
+      *p++ = c;
+    } else {
+      unsigned short hex;
+
+      *p++ = '%';
+      hex = (c & 0xf0) >> 4;
+      *p++ = RASQAL_GOOD_CAST(unsigned char, (hex < 10) ? ('0' + hex) : ('A' + hex - 10));
+      hex = (c & 0x0f);
+      *p++ = RASQAL_GOOD_CAST(unsigned char, (hex < 10) ? ('0' + hex) : ('A' + hex - 10));
+    }
+  }
+  *p = '\0';
+
+  return RASQAL_GOOD_CAST(size_t, p - dest);
+}
+
+
+/* reference: LCASE / UCASE with ctype */
+static void
+utf8_test_set_case_reference(unsigned char* dest, const unsigned char* s,
+                             size_t len, int upper)
+{
+  size_t i;
+
+  for(i = 0; i < len; i++) {
+    unsigned char c = s[i];
+
+    if(upper && c >= 'a' && c <= 'z')
+      c = RASQAL_GOOD_CAST(unsigned char, c - 'a' + 'A');
+    else if(!upper && c >= 'A' && c <= 'Z')
+      c = RASQAL_GOOD_CAST(unsigned char, c - 'A' + 'a');
+    dest[i] = c;
+  }
+}
+
+
+static int
+utf8_test_check(const char* program, const unsigned char* s, size_t len,
+                unsigned char* buffer, unsigned char* ref_buffer)
+{
+  static const unsigned char* const needles[4] = {
+    (const unsigned char*)"e", (const unsigned char*)"Resource",
+    (const unsigned char*)"\xc3\xa9", (const unsigned char*)"nomatch"
+  };
+  int failures = 0;
+  int len1;
+  int len2;
+  int start;
+  int upper;
+  int i;
+
+  len1 = rasqal_utf8_strlen(s, len);
+  len2 = raptor_unicode_utf8_strlen(s, len);
+  if(len1 != len2) {
+    fprintf(stderr, "%s: strlen of '%s' is %d expected %d\n", program,
+            s, len1, len2);
+    failures++;
+  }
+
+  for(start = 0; start < 12; start += 3) {
+    int length;
+
+    for(length = -1; length < 8; length += 4) {
+      const unsigned char* view;
+      size_t view_len = 0;
+      size_t ref_len;
+
+      ref_len = raptor_unicode_utf8_substr(ref_buffer, NULL, s, len,
+                                           start, length);
+      view = rasqal_utf8_substr(s, len, start, length, &view_len);
+      if(view && (view_len != ref_len || memcmp(view, ref_buffer, ref_len))) {
+        fprintf(stderr,
+                "%s: substr of '%s' from %d for %d is %d bytes expected %d\n",
+                program, s, start, length, RASQAL_GOOD_CAST(int, view_len),
+                RASQAL_GOOD_CAST(int, ref_len));
+        failures++;
+      }
+      if(!view && ref_len && len1 >= 0) {
+        fprintf(stderr, "%s: substr of valid '%s' from %d for %d failed\n",
+                program, s, start, length);
+        failures++;
+      }
+    }
+  }
+
+  for(upper = 0; upper < 2; upper++) {
+    rasqal_utf8_set_case(buffer, s, len, upper);
+    utf8_test_set_case_reference(ref_buffer, s, len, upper);
+    if(memcmp(buffer, ref_buffer, len)) {
+      fprintf(stderr, "%s: %s of '%s' differs\n", program,
+              upper ? "UCASE" : "LCASE", s);
+      failures++;
+    }
+  }
+
+  for(i = 0; i < 4; i++) {
+    const unsigned char* p1;
+    const char* p2;
+
+    p1 = rasqal_utf8_find(s, len, needles[i],
+                          strlen(RASQAL_GOOD_CAST(const char*, needles[i])));
+    p2 = strstr(RASQAL_GOOD_CAST(const char*, s),
+                RASQAL_GOOD_CAST(const char*, needles[i]));
+    if(RASQAL_GOOD_CAST(const char*, p1) != p2) {
+      fprintf(stderr, "%s: find '%s' in '%s' differs\n", program,
+              needles[i], s);
+      failures++;
+    }
+  }
+
+  len1 = RASQAL_GOOD_CAST(int, rasqal_utf8_encode_for_uri(buffer, s, len));
+  len2 = RASQAL_GOOD_CAST(int, utf8_test_encode_reference(ref_buffer, s, len));
+  if(len1 != len2 || strcmp(RASQAL_GOOD_CAST(const char*, buffer),
+                            RASQAL_GOOD_CAST(const char*, ref_buffer))) {
+    fprintf(stderr, "%s: encode_for_uri of '%s' is '%s' expected '%s'\n",
+            program, s, buffer, ref_buffer);
+    failures++;
+  }
+
+  return failures;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  rasqal_world* world = NULL;
+  rasqal_random* r = NULL;
+  unsigned char** values = NULL;
+  size_t* lens = NULL;
+  unsigned char* buffer = NULL;
+  unsigned char* ref_buffer = NULL;
+  int failures = 0;
+  int i;
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return(1);
+  }
+
+  r = rasqal_new_random(world);
+  rasqal_random_seed(r, UTF8_TEST_SEED);
+
+  values = RASQAL_CALLOC(unsigned char**, UTF8_TEST_VALUES_COUNT,
+                         sizeof(unsigned char*));
+  lens = RASQAL_CALLOC(size_t*, UTF8_TEST_VALUES_COUNT, sizeof(size_t));
+  buffer = RASQAL_MALLOC(unsigned char*, 3 * UTF8_TEST_VALUE_MAX_LEN + 1);
+  ref_buffer = RASQAL_MALLOC(unsigned char*, 3 * UTF8_TEST_VALUE_MAX_LEN + 1);
+  if(!values || !lens || !buffer || !ref_buffer) {
+    failures++;
+    goto tidy;
+  }
+
+  /* Most values are ASCII, every 4th has multi-byte characters and
+   * every 32nd may have bytes that are not valid UTF-8.
+   */
+  for(i = 0; i < UTF8_TEST_VALUES_COUNT; i++) {
+    unsigned int limit = UTF8_TEST_FIRST_MULTIBYTE;
+    size_t len = 0;
+
+    if(!(i % 32))
+      limit = UTF8_TEST_PIECES_COUNT;
+    else if(!(i % 4))
+      limit = UTF8_TEST_FIRST_INVALID;
+
+    values[i] = RASQAL_MALLOC(unsigned char*, UTF8_TEST_VALUE_MAX_LEN + 1);
+    if(!values[i]) {
+      failures++;
+      goto tidy;
+    }
+
+    while(1) {
+      const char* piece;
+      size_t piece_len;
+      unsigned int n;
+
+      n = RASQAL_GOOD_CAST(unsigned int, rasqal_random_irand(r)) % limit;
+      piece = utf8_test_pieces[n];
+      piece_len = strlen(piece);
+      if(len + piece_len > UTF8_TEST_VALUE_MAX_LEN ||
+         (len && !(rasqal_random_irand(r) % 24)))
+        break;
+      memcpy(values[i] + len, piece, piece_len);
+      len += piece_len;
+    }
+    values[i][len] = '\0';
+    lens[i] = len;
+
+    failures += utf8_test_check(program, values[i], len, buffer, ref_buffer);
+    if(failures > 10)
+      goto tidy;
+  }
+
+  tidy:
+  if(values) {
+    for(i = 0; i < UTF8_TEST_VALUES_COUNT; i++) {
+      if(values[i])
+        RASQAL_FREE(unsigned char*, values[i]);
+    }
+    RASQAL_FREE(unsigned char**, values);
+  }
+  if(lens)
+    RASQAL_FREE(size_t*, lens);
+  if(buffer)
+    RASQAL_FREE(unsigned char*, buffer);
+  if(ref_buffer)
+    RASQAL_FREE(unsigned char*, ref_buffer);
+  if(r)
+    rasqal_free_random(r);
+  if(world)
+    rasqal_free_world(world);
+
+  return failures;
+}
+
+#endif /* STANDALONE */
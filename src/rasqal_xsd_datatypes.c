@@ -541,6 +541,44 @@ static int (*const sparql_xsd_checkfns[CHECKFNS_COUNT])(const unsigned char* str
 #define CHECKFN_DATE_OFFSET (RASQAL_LITERAL_DATETIME - RASQAL_LITERAL_FIRST_XSD + 1)
 
 
+/*
+ * Datatype URIs are resolved by checking the URI string starts with
+ * the XSD namespace and then looking the local name up in a small
+ * open addressed hash table in the world, built once at init time,
+ * rather than comparing the URI against every datatype URI in turn.
+ */
+
+/* FNV-1a hash of an XSD datatype local name */
+static unsigned int
+rasqal_xsd_datatype_name_hash(const unsigned char* name, size_t len)
+{
+  unsigned int hash = 2166136261U;
+
+  while(len--) {
+    hash ^= *name++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+static void
+rasqal_xsd_datatype_hash_add(rasqal_world* world, int i)
+{
+  const char* name = sparql_xsd_names[i];
+  unsigned int slot;
+
+  slot = rasqal_xsd_datatype_name_hash(RASQAL_GOOD_CAST(const unsigned char*, name),
+                                       strlen(name));
+  slot &= (RASQAL_XSD_DATATYPE_HASH_SIZE - 1);
+  while(world->xsd_datatype_hash[slot])
+    slot = (slot + 1) & (RASQAL_XSD_DATATYPE_HASH_SIZE - 1);
+
+  world->xsd_datatype_hash[slot] = RASQAL_GOOD_CAST(unsigned char, i);
+}
+
+
 int
 rasqal_xsd_init(rasqal_world* world) 
 {
@@ -564,6 +602,12 @@ rasqal_xsd_init(rasqal_world* world)
       return 1;
   }
 
+  /* only the names recognised by rasqal_xsd_datatype_uri_to_type() */
+  memset(world->xsd_datatype_hash, '\0', sizeof(world->xsd_datatype_hash));
+  for(i = RASQAL_LITERAL_FIRST_XSD; i <= XSD_INTEGER_DERIVED_LAST; i++)
+    rasqal_xsd_datatype_hash_add(world, i);
+  rasqal_xsd_datatype_hash_add(world, XSD_DATE_OFFSET);
+
   return 0;
 }
 
@@ -594,42 +638,63 @@ rasqal_xsd_finish(rasqal_world* world)
 rasqal_literal_type
 rasqal_xsd_datatype_uri_to_type(rasqal_world* world, raptor_uri* uri)
 {
+  const unsigned char* uri_string;
+  const unsigned char* ns_string;
+  const unsigned char* local_name;
+  size_t uri_len;
+  size_t ns_len;
+  size_t local_len;
+  unsigned int slot;
   int i;
-  rasqal_literal_type native_type = RASQAL_LITERAL_UNKNOWN;
   
   if(!uri || !world->xsd_datatype_uris)
-    return native_type;
-  
-  for(i = RASQAL_GOOD_CAST(int, RASQAL_LITERAL_FIRST_XSD); i <= RASQAL_GOOD_CAST(int, XSD_INTEGER_DERIVED_LAST); i++) {
-    if(raptor_uri_equals(uri, world->xsd_datatype_uris[i])) {
+    return RASQAL_LITERAL_UNKNOWN;
+
+  uri_string = raptor_uri_as_counted_string(uri, &uri_len);
+  ns_string = raptor_uri_as_counted_string(world->xsd_namespace_uri, &ns_len);
+  if(uri_len <= ns_len || memcmp(uri_string, ns_string, ns_len))
+    return RASQAL_LITERAL_UNKNOWN;
+
+  local_name = uri_string + ns_len;
+  local_len = uri_len - ns_len;
+
+  slot = rasqal_xsd_datatype_name_hash(local_name, local_len);
+  slot &= (RASQAL_XSD_DATATYPE_HASH_SIZE - 1);
+  while((i = world->xsd_datatype_hash[slot])) {
+    const char* name = sparql_xsd_names[i];
+
+    if(!strncmp(name, RASQAL_GOOD_CAST(const char*, local_name), local_len) &&
+       !name[local_len]) {
+      /* DATE is not in the range FIRST_XSD .. INTEGER_DERIVED_LAST */
+      if(i == XSD_DATE_OFFSET)
+        return RASQAL_LITERAL_DATE;
+
       if(i >= XSD_INTEGER_DERIVED_FIRST)
-        native_type = RASQAL_LITERAL_INTEGER_SUBTYPE;
-      else
-        native_type = (rasqal_literal_type)i;
-      break;
+        return RASQAL_LITERAL_INTEGER_SUBTYPE;
+
+      return (rasqal_literal_type)i;
     }
-  }
 
-  if(native_type == RASQAL_LITERAL_UNKNOWN) {
-    /* DATE is not in the range FIRST_XSD .. INTEGER_DERIVED_LAST */
-    i = RASQAL_GOOD_CAST(int, XSD_DATE_OFFSET);
-    if(raptor_uri_equals(uri, world->xsd_datatype_uris[i]))
-      native_type = RASQAL_LITERAL_DATE;
+    slot = (slot + 1) & (RASQAL_XSD_DATATYPE_HASH_SIZE - 1);
   }
 
-  return native_type;
+  return RASQAL_LITERAL_UNKNOWN;
 }
 
 
 raptor_uri*
 rasqal_xsd_datatype_type_to_uri(rasqal_world* world, rasqal_literal_type type)
 {
-  if(world->xsd_datatype_uris &&
-     ((type >= RASQAL_LITERAL_FIRST_XSD &&
-       type <= RASQAL_LITERAL_LAST_XSD) ||
-      type == RASQAL_LITERAL_DATE))
+  if(!world->xsd_datatype_uris)
+    return NULL;
+
+  if(type >= RASQAL_LITERAL_FIRST_XSD && type <= RASQAL_LITERAL_LAST_XSD)
     return world->xsd_datatype_uris[RASQAL_GOOD_CAST(int, type)];
 
+  /* DATE is not stored at its type offset */
+  if(type == RASQAL_LITERAL_DATE)
+    return world->xsd_datatype_uris[XSD_DATE_OFFSET];
+
   return NULL;
 }
 
@@ -734,6 +799,140 @@ rasqal_xsd_datatype_parent_type(rasqal_literal_type type)
 
 int main(int argc, char *argv[]);
 
+
+/* XSD datatype local names and the types they resolve to */
+#define N_XSD_NAMES 20
+static const struct {
+  const char* name;
+  rasqal_literal_type type;
+} xsd_names[N_XSD_NAMES] = {
+  { "string", RASQAL_LITERAL_XSD_STRING },
+  { "boolean", RASQAL_LITERAL_BOOLEAN },
+  { "integer", RASQAL_LITERAL_INTEGER },
+  { "float", RASQAL_LITERAL_FLOAT },
+  { "double", RASQAL_LITERAL_DOUBLE },
+  { "decimal", RASQAL_LITERAL_DECIMAL },
+  { "dateTime", RASQAL_LITERAL_DATETIME },
+  { "nonPositiveInteger", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "negativeInteger", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "long", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "int", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "short", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "byte", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "nonNegativeInteger", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "unsignedLong", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "postiveInteger", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "unsignedInt", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "unsignedShort", RASQAL_LITERAL_INTEGER_SUBTYPE },
+  { "date", RASQAL_LITERAL_DATE },
+  /* not recognised */
+  { "unsignedByte", RASQAL_LITERAL_UNKNOWN }
+};
+
+
+#define N_NON_XSD_URIS 5
+static const char* const non_xsd_uris[N_NON_XSD_URIS] = {
+  "http://www.w3.org/2001/XMLSchema#",
+  "http://www.w3.org/2001/XMLSchema#strin",
+  "http://www.w3.org/2001/XMLSchema#stringx",
+  "http://www.w3.org/2001/XMLSchema#Integer",
+  "http://example.org/ns#integer"
+};
+
+
+/* typed lexical forms that must be promoted to their datatype */
+#define N_TYPED_LITERALS 6
+static const struct {
+  rasqal_literal_type type;
+  const char* lexical;
+} typed_literals[N_TYPED_LITERALS] = {
+  { RASQAL_LITERAL_INTEGER, "42" },
+  { RASQAL_LITERAL_DOUBLE, "1.5E2" },
+  { RASQAL_LITERAL_DECIMAL, "3.25" },
+  { RASQAL_LITERAL_BOOLEAN, "true" },
+  { RASQAL_LITERAL_DATETIME, "2004-12-31T19:01:00Z" },
+  { RASQAL_LITERAL_DATE, "2004-12-31" }
+};
+
+static int
+xsd_test_datatype_lookup(rasqal_world* world, const char* program,
+                         raptor_uri** uris)
+{
+  int failures = 0;
+  int i;
+
+  for(i = 0; i < N_XSD_NAMES; i++) {
+    rasqal_literal_type got = rasqal_xsd_datatype_uri_to_type(world, uris[i]);
+
+    if(got != xsd_names[i].type) {
+      fprintf(stderr, "%s: datatype %s resolved to type %d, expected %d\n",
+              program, xsd_names[i].name, RASQAL_GOOD_CAST(int, got),
+              RASQAL_GOOD_CAST(int, xsd_names[i].type));
+      failures++;
+    }
+  }
+
+  for(i = 0; i < N_NON_XSD_URIS; i++) {
+    const unsigned char* str;
+    raptor_uri* uri;
+    rasqal_literal_type got;
+
+    str = RASQAL_GOOD_CAST(const unsigned char*, non_xsd_uris[i]);
+    uri = raptor_new_uri(world->raptor_world_ptr, str);
+    if(!uri) {
+      failures++;
+      continue;
+    }
+
+    got = rasqal_xsd_datatype_uri_to_type(world, uri);
+    if(got != RASQAL_LITERAL_UNKNOWN) {
+      fprintf(stderr, "%s: URI %s resolved to type %d, expected unknown\n",
+              program, str, RASQAL_GOOD_CAST(int, got));
+      failures++;
+    }
+    raptor_free_uri(uri);
+  }
+
+  return failures;
+}
+
+
+static int
+xsd_test_typed_literals(rasqal_world* world, const char* program)
+{
+  int failures = 0;
+  int i;
+
+  for(i = 0; i < N_TYPED_LITERALS; i++) {
+    size_t len = strlen(typed_literals[i].lexical);
+    unsigned char* str;
+    raptor_uri* dt_uri;
+    rasqal_literal* l;
+
+    str = RASQAL_MALLOC(unsigned char*, len + 1);
+    if(!str) {
+      failures++;
+      break;
+    }
+    memcpy(str, typed_literals[i].lexical, len + 1);
+    dt_uri = raptor_uri_copy(rasqal_xsd_datatype_type_to_uri(world,
+                                                             typed_literals[i].type));
+
+    l = rasqal_new_string_literal_node(world, str, NULL, dt_uri);
+    if(!l || l->type != typed_literals[i].type) {
+      fprintf(stderr, "%s: typed literal %s was not promoted to type %d\n",
+              program, typed_literals[i].lexical,
+              RASQAL_GOOD_CAST(int, typed_literals[i].type));
+      failures++;
+    }
+    if(l)
+      rasqal_free_literal(l);
+  }
+
+  return failures;
+}
+
+
 #define N_VALID_TESTS 27
 const char *double_valid_tests[N_VALID_TESTS+1] = {
   "-INF", "INF", 
@@ -768,6 +967,9 @@ main(int argc, char *argv[])
   const char *program = rasqal_basename(argv[0]);
   int failures = 0;
   int test = 0;
+  raptor_uri* xsd_uris[N_XSD_NAMES];
+
+  memset(xsd_uris, '\0', sizeof(xsd_uris));
 
   world = rasqal_new_world();
   if(!world || rasqal_world_open(world)) {
@@ -805,8 +1007,31 @@ main(int argc, char *argv[])
     }
   }
 
+  for(test = 0; test < N_XSD_NAMES; test++) {
+    const unsigned char* name;
+
+    name = RASQAL_GOOD_CAST(const unsigned char*, xsd_names[test].name);
+    xsd_uris[test] = raptor_new_uri_from_uri_local_name(world->raptor_world_ptr,
+                                                        world->xsd_namespace_uri,
+                                                        name);
+    if(!xsd_uris[test]) {
+      fprintf(stderr, "%s: failed to create datatype URI %s\n", program,
+              name);
+      failures++;
+      goto tidy;
+    }
+  }
+
+  failures += xsd_test_datatype_lookup(world, program, xsd_uris);
+  failures += xsd_test_typed_literals(world, program);
+
   tidy:
 
+  for(test = 0; test < N_XSD_NAMES; test++) {
+    if(xsd_uris[test])
+      raptor_free_uri(xsd_uris[test]);
+  }
+
   rasqal_free_world(world);
 
   return failures;
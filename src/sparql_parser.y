@@ -1645,8 +1645,7 @@ UpdateQuery: WITH URI_LITERAL
   if($2) {
     rasqal_literal* origin_literal;
 
-    origin_literal = rasqal_new_uri_literal(rq->world, $2);
-    $2 = NULL;
+    origin_literal = rasqal_new_uri_literal(rq->world, raptor_uri_copy($2));
 
     rasqal_triples_sequence_set_origin(/* dest */ NULL, $9, origin_literal);
     rasqal_triples_sequence_set_origin(/* dest */ NULL, $5, origin_literal);
@@ -1654,9 +1653,9 @@ UpdateQuery: WITH URI_LITERAL
     rasqal_free_literal(origin_literal);
   }
 
-  /* after this $5, $9 and $12 are owned by update */
+  /* after this $2, $5, $9 and $12 are owned by update */
   update = rasqal_new_update_operation(RASQAL_UPDATE_TYPE_UPDATE,
-                                       NULL /* graph uri */, 
+                                       $2 /* graph uri */, 
                                        NULL /* document uri */,
                                        $9 /* insert templates */,
                                        $5 /* delete templates */,
@@ -1688,17 +1687,16 @@ UpdateQuery: WITH URI_LITERAL
   if($2) {
     rasqal_literal* origin_literal;
     
-    origin_literal = rasqal_new_uri_literal(rq->world, $2);
-    $2 = NULL;
+    origin_literal = rasqal_new_uri_literal(rq->world, raptor_uri_copy($2));
 
     rasqal_triples_sequence_set_origin(/* dest */ NULL, $5, origin_literal);
 
     rasqal_free_literal(origin_literal);
   }
   
-  /* after this $5 and $7 are owned by update */
+  /* after this $2, $5 and $7 are owned by update */
   update = rasqal_new_update_operation(RASQAL_UPDATE_TYPE_UPDATE,
-                                       NULL /* graph uri */, 
+                                       $2 /* graph uri */, 
                                        NULL /* document uri */,
                                        NULL /* insert templates */,
                                        $5 /* delete templates */,
@@ -1730,17 +1728,16 @@ UpdateQuery: WITH URI_LITERAL
   if($2) {
     rasqal_literal* origin_literal;
     
-    origin_literal = rasqal_new_uri_literal(rq->world, $2);
-    $2 = NULL;
+    origin_literal = rasqal_new_uri_literal(rq->world, raptor_uri_copy($2));
 
     rasqal_triples_sequence_set_origin(/* dest */ NULL, $5, origin_literal);
 
     rasqal_free_literal(origin_literal);
   }
 
-  /* after this $5 and $7 are owned by update */
+  /* after this $2, $5 and $7 are owned by update */
   update = rasqal_new_update_operation(RASQAL_UPDATE_TYPE_UPDATE,
-                                       NULL /* graph uri */, 
+                                       $2 /* graph uri */, 
                                        NULL /* document uri */,
                                        $5 /* insert templates */,
                                        NULL /* delete templates */,
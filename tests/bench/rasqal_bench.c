@@ -0,0 +1,656 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_bench.c - Rasqal query engine benchmark
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ * Generates a deterministic synthetic graph (a social graph plus a
+ * product catalogue with reviews) from a seeded random number
+ * generator, runs a fixed SPARQL query mix over it and writes the
+ * timings as JSON to stdout.
+ *
+ * The data is loaded once into the world dataset with
+ * rasqal_world_add_data_graph() and the load time reported on its
+ * own.  Query latencies cover preparing, executing and reading all
+ * the results of a query over that dataset.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+#ifndef HAVE_GETTIMEOFDAY
+#define gettimeofday(x,y) rasqal_gettimeofday(x,y)
+#endif
+
+
+#ifdef RASQAL_QUERY_SPARQL
+
+#define QUERY_LANGUAGE "sparql"
+
+#define BENCH_DEFAULT_SCALE 1000
+#define BENCH_DEFAULT_ITERATIONS 10
+#define BENCH_DEFAULT_SEED 1
+#define BENCH_DEFAULT_DATA_FILE "rasqal-bench.nt"
+
+#define BENCH_CITIES 20
+#define BENCH_MAX_KNOWS 10
+#define BENCH_CATEGORIES 30
+#define BENCH_MAX_REVIEWS 4
+
+#define EX_NS "http://example.org/"
+#define FOAF_NS "http://xmlns.com/foaf/0.1/"
+#define RDF_TYPE "<http://www.w3.org/1999/02/22-rdf-syntax-ns#type>"
+#define RDFS_LABEL "<http://www.w3.org/2000/01/rdf-schema#label>"
+#define XSD_NS "http://www.w3.org/2001/XMLSchema#"
+
+#define QUERY_PREFIXES "\
+PREFIX ex: <" EX_NS "> \n\
+PREFIX foaf: <" FOAF_NS "> \n\
+PREFIX rdfs: <http://www.w3.org/2000/01/rdf-schema#> \n"
+
+
+typedef struct {
+  const char* name;
+  const char* query_string;
+} bench_query;
+
+static const bench_query bench_queries[] = {
+  { "bgp", QUERY_PREFIXES "\
+SELECT ?name ?friend WHERE { \n\
+  ?p ex:city \"City3\" ; foaf:name ?name ; foaf:knows ?f . \n\
+  ?f foaf:name ?friend \n\
+}" },
+  { "bgp_reviews", QUERY_PREFIXES "\
+SELECT ?reviewer ?label WHERE { \n\
+  ?r ex:rating 5 ; ex:reviewOf ?prod ; ex:reviewer ?reviewer . \n\
+  ?prod rdfs:label ?label \n\
+}" },
+  { "optional", QUERY_PREFIXES "\
+SELECT ?p ?mbox WHERE { \n\
+  ?p a foaf:Person \n\
+  OPTIONAL { ?p foaf:mbox ?mbox } \n\
+}" },
+  { "union", QUERY_PREFIXES "\
+SELECT ?x ?label WHERE { \n\
+  { ?x a foaf:Person ; foaf:name ?label } \n\
+  UNION \n\
+  { ?x a ex:Product ; rdfs:label ?label } \n\
+}" },
+  { "filter", QUERY_PREFIXES "\
+SELECT ?prod ?price WHERE { \n\
+  ?prod ex:price ?price \n\
+  FILTER(?price < 50) \n\
+}" },
+  { "group_by", QUERY_PREFIXES "\
+SELECT ?cat (COUNT(?prod) AS ?count) (AVG(?price) AS ?avg) WHERE { \n\
+  ?prod ex:category ?cat ; ex:price ?price \n\
+} GROUP BY ?cat" },
+  { "order_by_limit", QUERY_PREFIXES "\
+SELECT ?prod ?price WHERE { \n\
+  ?prod ex:price ?price \n\
+} ORDER BY DESC(?price) LIMIT 10" },
+  { "distinct", QUERY_PREFIXES "\
+SELECT DISTINCT ?city WHERE { \n\
+  ?p ex:city ?city \n\
+}" },
+  { NULL, NULL }
+};
+
+
+typedef struct {
+  FILE* fh;
+  rasqal_random* random;
+  unsigned long triples;
+} bench_generator;
+
+
+/* latency summary in microseconds */
+typedef struct {
+  double min;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+  double mean;
+  double total;
+} bench_stats;
+
+
+int main(int argc, char *argv[]);
+
+
+static int
+bench_rand(bench_generator* gen, int n)
+{
+  return rasqal_random_irand(gen->random) % n;
+}
+
+
+static void
+bench_generate_social(bench_generator* gen, int people)
+{
+  int i;
+
+  for(i = 0; i < people; i++) {
+    int knows[BENCH_MAX_KNOWS];
+    int degree;
+    int k;
+
+    fprintf(gen->fh, "<" EX_NS "person/%d> " RDF_TYPE " <" FOAF_NS "Person> .\n",
+            i);
+    fprintf(gen->fh, "<" EX_NS "person/%d> <" FOAF_NS "name> \"Person %d\" .\n",
+            i, i);
+    fprintf(gen->fh, "<" EX_NS "person/%d> <" FOAF_NS "age> \"%d\"^^<" XSD_NS "integer> .\n",
+            i, 18 + bench_rand(gen, 63));
+    fprintf(gen->fh, "<" EX_NS "person/%d> <" EX_NS "city> \"City%d\" .\n",
+            i, bench_rand(gen, BENCH_CITIES));
+    gen->triples += 4;
+
+    if(!bench_rand(gen, 2)) {
+      fprintf(gen->fh, "<" EX_NS "person/%d> <" FOAF_NS "mbox> <mailto:person%d@example.org> .\n",
+              i, i);
+      gen->triples++;
+    }
+
+    if(people < 2)
+      continue;
+
+    /* distinct, non-self targets */
+    degree = bench_rand(gen, BENCH_MAX_KNOWS + 1);
+    for(k = 0; k < degree; k++) {
+      int target = (i + 1 + bench_rand(gen, people - 1)) % people;
+      int j;
+
+      for(j = 0; j < k; j++) {
+        if(knows[j] == target)
+          break;
+      }
+      if(j < k) {
+        degree--;
+        k--;
+        continue;
+      }
+      knows[k] = target;
+
+      fprintf(gen->fh, "<" EX_NS "person/%d> <" FOAF_NS "knows> <" EX_NS "person/%d> .\n",
+              i, target);
+      gen->triples++;
+    }
+  }
+}
+
+
+static void
+bench_generate_catalogue(bench_generator* gen, int products, int people)
+{
+  int vendors = products / 50 + 1;
+  int review = 0;
+  int i;
+
+  for(i = 0; i < products; i++) {
+    int price = 100 + bench_rand(gen, 49900);
+    int reviews;
+    int r;
+
+    fprintf(gen->fh, "<" EX_NS "product/%d> " RDF_TYPE " <" EX_NS "Product> .\n",
+            i);
+    fprintf(gen->fh, "<" EX_NS "product/%d> " RDFS_LABEL " \"Product %d\" .\n",
+            i, i);
+    fprintf(gen->fh, "<" EX_NS "product/%d> <" EX_NS "category> <" EX_NS "category/%d> .\n",
+            i, bench_rand(gen, BENCH_CATEGORIES));
+    fprintf(gen->fh, "<" EX_NS "product/%d> <" EX_NS "vendor> <" EX_NS "vendor/%d> .\n",
+            i, bench_rand(gen, vendors));
+    fprintf(gen->fh, "<" EX_NS "product/%d> <" EX_NS "price> \"%d.%02d\"^^<" XSD_NS "decimal> .\n",
+            i, price / 100, price % 100);
+    gen->triples += 5;
+
+    reviews = bench_rand(gen, BENCH_MAX_REVIEWS + 1);
+    for(r = 0; r < reviews; r++, review++) {
+      fprintf(gen->fh, "<" EX_NS "review/%d> " RDF_TYPE " <" EX_NS "Review> .\n",
+              review);
+      fprintf(gen->fh, "<" EX_NS "review/%d> <" EX_NS "reviewOf> <" EX_NS "product/%d> .\n",
+              review, i);
+      fprintf(gen->fh, "<" EX_NS "review/%d> <" EX_NS "reviewer> <" EX_NS "person/%d> .\n",
+              review, bench_rand(gen, people));
+      fprintf(gen->fh, "<" EX_NS "review/%d> <" EX_NS "rating> \"%d\"^^<" XSD_NS "integer> .\n",
+              review, 1 + bench_rand(gen, 5));
+      gen->triples += 4;
+    }
+  }
+}
+
+
+/*
+ * bench_generate:
+ * @world: world
+ * @fh: output file handle
+ * @scale: number of people and of products
+ * @seed: random seed
+ *
+ * Write the synthetic graph as N-Triples to @fh.  The same @scale
+ * and @seed always produce the same graph.
+ *
+ * Return value: number of triples written or -1 on failure
+ */
+static long
+bench_generate(rasqal_world* world, FILE* fh, int scale, unsigned int seed)
+{
+  bench_generator gen;
+
+  gen.fh = fh;
+  gen.triples = 0;
+  gen.random = rasqal_new_random(world);
+  if(!gen.random)
+    return -1;
+  rasqal_random_seed(gen.random, seed);
+
+  bench_generate_social(&gen, scale);
+  bench_generate_catalogue(&gen, scale, scale);
+
+  rasqal_free_random(gen.random);
+
+  return ferror(fh) ? -1 : (long)gen.triples;
+}
+
+
+static double
+bench_elapsed_usecs(struct timeval* start, struct timeval* end)
+{
+  return (double)(end->tv_sec - start->tv_sec) * 1000000.0 +
+    (double)(end->tv_usec - start->tv_usec);
+}
+
+
+/* the query has no data graphs so it runs over the world dataset */
+static rasqal_query*
+bench_new_query(rasqal_world* world, raptor_uri* base_uri,
+                const char* query_string)
+{
+  rasqal_query* rq;
+
+  rq = rasqal_new_query(world, QUERY_LANGUAGE, NULL);
+  if(!rq)
+    return NULL;
+
+  if(rasqal_query_prepare(rq, (const unsigned char*)query_string, base_uri)) {
+    rasqal_free_query(rq);
+    return NULL;
+  }
+
+  return rq;
+}
+
+
+/* Return number of rows or -1 on failure; sets *usecs_p to wall time */
+static long
+bench_run_query(rasqal_world* world, raptor_uri* base_uri,
+                const char* query_string, double* usecs_p)
+{
+  struct timeval tv_start;
+  struct timeval tv_end;
+  rasqal_query* rq;
+  rasqal_query_results* results;
+  long rows = 0;
+
+  gettimeofday(&tv_start, NULL);
+
+  rq = bench_new_query(world, base_uri, query_string);
+  if(!rq)
+    return -1;
+
+  results = rasqal_query_execute(rq);
+  if(!results) {
+    rasqal_free_query(rq);
+    return -1;
+  }
+
+  while(!rasqal_query_results_finished(results)) {
+    rows++;
+    if(rasqal_query_results_next(results))
+      break;
+  }
+
+  rasqal_free_query_results(results);
+  rasqal_free_query(rq);
+
+  gettimeofday(&tv_end, NULL);
+  *usecs_p = bench_elapsed_usecs(&tv_start, &tv_end);
+
+  return rows;
+}
+
+
+/* Return 0 on success; sets *usecs_p to the time to load the world dataset */
+static int
+bench_load(rasqal_world* world, raptor_uri* data_uri, double* usecs_p)
+{
+  struct timeval tv_start;
+  struct timeval tv_end;
+  rasqal_data_graph* dg;
+  int rc;
+
+  dg = rasqal_new_data_graph_from_uri(world, data_uri, NULL,
+                                      RASQAL_DATA_GRAPH_BACKGROUND,
+                                      NULL, "ntriples", NULL);
+  if(!dg)
+    return 1;
+
+  gettimeofday(&tv_start, NULL);
+  rc = rasqal_world_add_data_graph(world, dg);
+  gettimeofday(&tv_end, NULL);
+
+  rasqal_free_data_graph(dg);
+
+  *usecs_p = bench_elapsed_usecs(&tv_start, &tv_end);
+  return rc;
+}
+
+
+static int
+bench_compare_double(const void* a, const void* b)
+{
+  double da = *(const double*)a;
+  double db = *(const double*)b;
+
+  return (da > db) - (da < db);
+}
+
+
+/* nearest-rank percentile of sorted @values */
+static double
+bench_percentile(double* values, int count, int percent)
+{
+  int rank = (percent * count + 99) / 100;
+
+  if(rank < 1)
+    rank = 1;
+  return values[rank - 1];
+}
+
+
+static void
+bench_summarise(double* values, int count, bench_stats* stats)
+{
+  int i;
+
+  qsort(values, count, sizeof(double), bench_compare_double);
+
+  stats->total = 0.0;
+  for(i = 0; i < count; i++)
+    stats->total += values[i];
+
+  stats->min = values[0];
+  stats->max = values[count - 1];
+  stats->p50 = bench_percentile(values, count, 50);
+  stats->p90 = bench_percentile(values, count, 90);
+  stats->p99 = bench_percentile(values, count, 99);
+  stats->mean = stats->total / count;
+}
+
+
+static void
+bench_write_stats(FILE* fh, const char* name, bench_stats* stats)
+{
+  fprintf(fh,
+          "\"%s\": { \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+          "\"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f }",
+          name, stats->min / 1000.0, stats->p50 / 1000.0,
+          stats->p90 / 1000.0, stats->p99 / 1000.0, stats->max / 1000.0,
+          stats->mean / 1000.0);
+}
+
+
+/* peak resident set size in kilobytes or -1 if unknown */
+static long
+bench_peak_rss_kb(void)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+  struct rusage usage;
+
+  if(!getrusage(RUSAGE_SELF, &usage)) {
+#ifdef __APPLE__
+    /* bytes on Mac OS X */
+    return (long)(usage.ru_maxrss / 1024);
+#else
+    return (long)usage.ru_maxrss;
+#endif
+  }
+#endif
+  return -1;
+}
+
+
+static void
+bench_usage(const char* program)
+{
+  fprintf(stderr,
+          "Usage: %s [-s SCALE] [-i ITERATIONS] [-r SEED] [-d DATA-FILE] [-g]\n"
+          "  -s SCALE       number of people and of products (default %d)\n"
+          "  -i ITERATIONS  timed runs of each query (default %d)\n"
+          "  -r SEED        random seed (default %d)\n"
+          "  -d DATA-FILE   file to write the generated data to (default %s)\n"
+          "  -g             write the generated N-Triples to stdout and exit\n",
+          program, BENCH_DEFAULT_SCALE, BENCH_DEFAULT_ITERATIONS,
+          BENCH_DEFAULT_SEED, BENCH_DEFAULT_DATA_FILE);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  int scale = BENCH_DEFAULT_SCALE;
+  int iterations = BENCH_DEFAULT_ITERATIONS;
+  unsigned int seed = BENCH_DEFAULT_SEED;
+  const char* data_file = BENCH_DEFAULT_DATA_FILE;
+  int generate_only = 0;
+  rasqal_world* world = NULL;
+  raptor_world* raptor_world_ptr;
+  unsigned char* uri_string = NULL;
+  raptor_uri* data_uri = NULL;
+  double* latencies = NULL;
+  bench_stats stats;
+  struct timeval tv_start;
+  struct timeval tv_end;
+  double generate_usecs;
+  double load_usecs;
+  long triples;
+  FILE* fh;
+  int failures = 0;
+  int printed = 0;
+  int i;
+
+  for(i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+
+    if(!strcmp(arg, "-g")) {
+      generate_only = 1;
+      continue;
+    }
+
+    if(arg[0] != '-' || !arg[1] || arg[2] || i + 1 == argc) {
+      bench_usage(program);
+      return 1;
+    }
+
+    switch(arg[1]) {
+      case 's':
+        scale = atoi(argv[++i]);
+        break;
+      case 'i':
+        iterations = atoi(argv[++i]);
+        break;
+      case 'r':
+        seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        break;
+      case 'd':
+        data_file = argv[++i];
+        break;
+      default:
+        bench_usage(program);
+        return 1;
+    }
+  }
+
+  if(scale < 1 || iterations < 1) {
+    bench_usage(program);
+    return 1;
+  }
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+  raptor_world_ptr = rasqal_world_get_raptor(world);
+
+  if(generate_only) {
+    triples = bench_generate(world, stdout, scale, seed);
+    rasqal_free_world(world);
+    return (triples < 0);
+  }
+
+  fh = fopen(data_file, "w");
+  if(!fh) {
+    fprintf(stderr, "%s: Cannot write data file %s\n", program, data_file);
+    failures++;
+    goto tidy;
+  }
+  gettimeofday(&tv_start, NULL);
+  triples = bench_generate(world, fh, scale, seed);
+  gettimeofday(&tv_end, NULL);
+  if(fclose(fh) || triples < 0) {
+    fprintf(stderr, "%s: Writing data file %s failed\n", program, data_file);
+    failures++;
+    goto tidy;
+  }
+  generate_usecs = bench_elapsed_usecs(&tv_start, &tv_end);
+
+  uri_string = raptor_uri_filename_to_uri_string(data_file);
+  if(uri_string)
+    data_uri = raptor_new_uri(raptor_world_ptr, uri_string);
+  latencies = RASQAL_CALLOC(double*, iterations, sizeof(double));
+  if(!data_uri || !latencies) {
+    fprintf(stderr, "%s: Out of memory\n", program);
+    failures++;
+    goto tidy;
+  }
+
+  if(bench_load(world, data_uri, &load_usecs)) {
+    fprintf(stderr, "%s: Loading data file %s failed\n", program, data_file);
+    failures++;
+    goto tidy;
+  }
+
+  fprintf(stdout, "{\n");
+  fprintf(stdout, "  \"rasqal_version\": \"%s\",\n", rasqal_version_string);
+  fprintf(stdout, "  \"scale\": %d,\n", scale);
+  fprintf(stdout, "  \"seed\": %u,\n", seed);
+  fprintf(stdout, "  \"iterations\": %d,\n", iterations);
+  fprintf(stdout, "  \"triples\": %ld,\n", triples);
+  fprintf(stdout, "  \"generate_ms\": %.3f,\n", generate_usecs / 1000.0);
+  fprintf(stdout, "  \"load_ms\": %.3f,\n", load_usecs / 1000.0);
+  fprintf(stdout, "  \"queries\": [\n");
+
+  for(i = 0; bench_queries[i].name; i++) {
+    const bench_query* bq = &bench_queries[i];
+    long rows;
+    double usecs;
+    int j;
+
+    /* untimed warm up run, also gives the row count */
+    rows = bench_run_query(world, data_uri, bq->query_string, &usecs);
+    if(rows < 0) {
+      fprintf(stderr, "%s: Query %s failed\n", program, bq->name);
+      failures++;
+      continue;
+    }
+
+    for(j = 0; j < iterations; j++) {
+      if(bench_run_query(world, data_uri, bq->query_string,
+                         &latencies[j]) != rows) {
+        fprintf(stderr, "%s: Query %s returned a different row count\n",
+                program, bq->name);
+        failures++;
+        break;
+      }
+    }
+    if(j < iterations)
+      continue;
+
+    bench_summarise(latencies, iterations, &stats);
+
+    fprintf(stdout, "%s    { \"name\": \"%s\", \"rows\": %ld, ",
+            (printed++ ? ",\n" : ""), bq->name, rows);
+    bench_write_stats(stdout, "latency_ms", &stats);
+    fprintf(stdout, ", \"rows_per_sec\": %.1f }",
+            stats.total > 0.0 ?
+              (double)rows * iterations * 1000000.0 / stats.total : 0.0);
+  }
+
+  fprintf(stdout, "\n  ],\n");
+  fprintf(stdout, "  \"peak_rss_kb\": %ld\n", bench_peak_rss_kb());
+  fprintf(stdout, "}\n");
+
+  tidy:
+  if(latencies)
+    RASQAL_FREE(double*, latencies);
+  if(data_uri)
+    raptor_free_uri(data_uri);
+  if(uri_string)
+    raptor_free_memory(uri_string);
+  rasqal_free_world(world);
+
+  return failures;
+}
+
+#else
+
+int main(int argc, char *argv[]);
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  fprintf(stderr, "%s: No supported query language available, skipping benchmark\n", program);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,1729 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * rasqal_microbench.c - Rasqal component micro benchmarks
+ *
+ * Copyright (C) 2014, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ *
+ * Times individual library components - value parsing, escaping,
+ * result formats, single operators - on fixed synthetic workloads
+ * and writes the timings as JSON to stdout.  Each benchmark does its
+ * own untimed setup and brackets the measured work with
+ * microbench_start() and microbench_stop().
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <rasqal_config.h>
+#endif
+
+#ifdef WIN32
+#include <win32_rasqal_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#include <stdarg.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include "rasqal.h"
+#include "rasqal_internal.h"
+
+#ifndef HAVE_GETTIMEOFDAY
+#define gettimeofday(x,y) rasqal_gettimeofday(x,y)
+#endif
+
+
+#define MICROBENCH_DEFAULT_SCALE 1
+#define MICROBENCH_SEED 2121
+
+#define EX_NS "http://example.org/ns#"
+#define XSD_NS "http://www.w3.org/2001/XMLSchema#"
+
+
+typedef struct {
+  struct timeval start;
+  double usecs;
+} microbench_timer;
+
+/*
+ * Run one benchmark of @scale times its base workload.
+ * Return the number of operations timed or <0 on failure.
+ */
+typedef long (*microbench_fn)(rasqal_world* world, int scale,
+                              microbench_timer* timer);
+
+typedef struct {
+  const char* name;
+  microbench_fn fn;
+} microbench;
+
+
+int main(int argc, char *argv[]);
+
+
+static void
+microbench_start(microbench_timer* timer)
+{
+  gettimeofday(&timer->start, NULL);
+}
+
+
+static void
+microbench_stop(microbench_timer* timer)
+{
+  struct timeval end;
+
+  gettimeofday(&end, NULL);
+  timer->usecs += (double)(end.tv_sec - timer->start.tv_sec) * 1000000.0 +
+    (double)(end.tv_usec - timer->start.tv_usec);
+}
+
+
+#ifdef RASQAL_QUERY_SPARQL
+
+/* Return number of result rows or triples or -1 on failure */
+static long
+microbench_query_rows(rasqal_world* world, raptor_stringbuffer* data,
+                      const char* query_string, microbench_timer* timer)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  rasqal_query* query = NULL;
+  rasqal_query_results* results = NULL;
+  raptor_uri* base_uri;
+  raptor_iostream* iostr = NULL;
+  rasqal_data_graph* dg = NULL;
+  long rows = -1;
+
+  base_uri = raptor_new_uri(raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, EX_NS));
+  if(!base_uri)
+    return -1;
+
+  iostr = raptor_new_iostream_from_string(raptor_world_ptr,
+                                          raptor_stringbuffer_as_string(data),
+                                          raptor_stringbuffer_length(data));
+  if(iostr)
+    dg = rasqal_new_data_graph_from_iostream(world, iostr, base_uri, NULL,
+                                             RASQAL_DATA_GRAPH_BACKGROUND,
+                                             NULL, "ntriples", NULL);
+
+  query = rasqal_new_query(world, "sparql11", NULL);
+  if(!query || !dg)
+    goto tidy;
+
+  /* query owns the data graph */
+  if(rasqal_query_add_data_graph(query, dg)) {
+    rasqal_free_data_graph(dg);
+    goto tidy;
+  }
+
+  if(rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          base_uri))
+    goto tidy;
+
+  microbench_start(timer);
+
+  results = rasqal_query_execute(query);
+  if(results && rasqal_query_results_is_graph(results)) {
+    rows = 0;
+    while(rasqal_query_results_get_triple(results)) {
+      rows++;
+      if(rasqal_query_results_next_triple(results))
+        break;
+    }
+  } else if(results) {
+    rows = 0;
+    while(!rasqal_query_results_finished(results)) {
+      rows++;
+      if(rasqal_query_results_next(results))
+        break;
+    }
+  }
+
+  microbench_stop(timer);
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+  if(iostr)
+    raptor_free_iostream(iostr);
+  raptor_free_uri(base_uri);
+
+  return rows;
+}
+
+
+#define MINUS_PEOPLE 2000
+
+/* people with a name, a quarter of them also blocked */
+static raptor_stringbuffer*
+microbench_minus_data(rasqal_world* world, int people)
+{
+  raptor_stringbuffer* sb;
+  rasqal_random* r;
+  int i;
+
+  sb = raptor_new_stringbuffer();
+  r = rasqal_new_random(world);
+  if(!sb || !r) {
+    if(sb)
+      raptor_free_stringbuffer(sb);
+    if(r)
+      rasqal_free_random(r);
+    return NULL;
+  }
+  rasqal_random_seed(r, MICROBENCH_SEED);
+
+  for(i = 0; i < people; i++) {
+    char line[128];
+
+    sprintf(line, "<" EX_NS "p%d> <" EX_NS "name> \"p%d\" .\n", i, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, line), 1);
+    if(!(rasqal_random_irand(r) % 4)) {
+      sprintf(line, "<" EX_NS "p%d> <" EX_NS "blocked> \"true\" .\n", i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, line), 1);
+    }
+  }
+  rasqal_free_random(r);
+
+  return sb;
+}
+
+
+static long
+microbench_minus_query(rasqal_world* world, int scale,
+                       microbench_timer* timer, const char* query_string)
+{
+  raptor_stringbuffer* sb;
+  long rows;
+
+  sb = microbench_minus_data(world, MINUS_PEOPLE * scale);
+  if(!sb)
+    return -1;
+
+  rows = microbench_query_rows(world, sb, query_string, timer);
+
+  raptor_free_stringbuffer(sb);
+
+  return rows;
+}
+
+
+static long
+microbench_minus(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_minus_query(world, scale, timer,
+    "PREFIX : <" EX_NS ">\n"
+    "SELECT ?p WHERE { ?p :name ?n MINUS { ?p :blocked ?b } }");
+}
+
+
+/* the same result as microbench_minus() the pre-MINUS way */
+static long
+microbench_minus_optional(rasqal_world* world, int scale,
+                          microbench_timer* timer)
+{
+  return microbench_minus_query(world, scale, timer,
+    "PREFIX : <" EX_NS ">\n"
+    "SELECT ?p WHERE { ?p :name ?n OPTIONAL { ?p :blocked ?b } "
+    "FILTER(!BOUND(?b)) }");
+}
+
+
+#define DESCRIBE_RESOURCES 2000
+
+/*
+ * Each resource ex:rN has a name, a link to the next resource, a two
+ * level chain of blank nodes and a tag pointing to one blank node
+ * shared by all resources that also points to itself.
+ */
+static raptor_stringbuffer*
+microbench_describe_data(int resources)
+{
+  raptor_stringbuffer* sb;
+  int i;
+
+  sb = raptor_new_stringbuffer();
+  if(!sb)
+    return NULL;
+
+  for(i = 0; i < resources; i++) {
+    char lines[640];
+
+    sprintf(lines,
+            "<http://example.org/r%d> <http://example.org/name> \"r%d\" .\n"
+            "<http://example.org/r%d> <http://example.org/next> <http://example.org/r%d> .\n"
+            "<http://example.org/r%d> <http://example.org/addr> _:a%d .\n"
+            "<http://example.org/r%d> <http://example.org/tag> _:shared .\n"
+            "_:a%d <http://example.org/city> \"c%d\" .\n"
+            "_:a%d <http://example.org/geo> _:g%d .\n"
+            "_:g%d <http://example.org/lat> \"%d\" .\n",
+            i, i, i, (i + 1) % resources, i, i, i, i, i, i, i, i, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*, lines), 1);
+  }
+
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(unsigned char*,
+    "_:shared <http://example.org/label> \"shared\" .\n"
+    "_:shared <http://example.org/self> _:shared .\n"), 1);
+
+  return sb;
+}
+
+
+/* concise bounded descriptions of every resource */
+static long
+microbench_describe(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  raptor_stringbuffer* sb;
+  long triples;
+
+  sb = microbench_describe_data(DESCRIBE_RESOURCES * scale);
+  if(!sb)
+    return -1;
+
+  triples = microbench_query_rows(world, sb,
+    "PREFIX ex: <http://example.org/>\n"
+    "DESCRIBE ?r WHERE { ?r ex:next ?n }", timer);
+
+  raptor_free_stringbuffer(sb);
+
+  return triples;
+}
+
+
+#define CONSTRUCT_ROWS 20000
+#define CONSTRUCT_SUBJECTS 100
+
+/*
+ * CONSTRUCT over @rows VALUES rows where subject ex:sN repeats every
+ * CONSTRUCT_SUBJECTS rows so the ex:type triple is a duplicate in all
+ * but the first row for each subject.
+ */
+static char*
+microbench_construct_query(int rows)
+{
+  static const char* const head =
+    "PREFIX ex: <http://example.org/>\n"
+    "CONSTRUCT { ?s ex:p ?o . ?s ex:type ex:T . _:b ex:of ?s }\n"
+    "WHERE { VALUES (?s ?o) {\n";
+  static const char* const tail = "} }\n";
+  char* query_string;
+  char* p;
+  int i;
+
+  query_string = RASQAL_MALLOC(char*, strlen(head) + strlen(tail) + 1 +
+                               RASQAL_GOOD_CAST(size_t, rows) * 40);
+  if(!query_string)
+    return NULL;
+
+  p = query_string;
+  memcpy(p, head, strlen(head));
+  p += strlen(head);
+  for(i = 0; i < rows; i++)
+    p += sprintf(p, "(ex:s%d %d)\n", i % CONSTRUCT_SUBJECTS, i);
+  memcpy(p, tail, strlen(tail) + 1);
+
+  return query_string;
+}
+
+
+/* Return number of triples or -1 on failure */
+static long
+microbench_construct_triples(rasqal_world* world, int scale,
+                             microbench_timer* timer, int dedup_size)
+{
+  char* query_string;
+  rasqal_query* query = NULL;
+  rasqal_query_results* results = NULL;
+  long count = -1;
+
+  query_string = microbench_construct_query(CONSTRUCT_ROWS * scale);
+  if(!query_string)
+    return -1;
+
+  query = rasqal_new_query(world, "sparql11", NULL);
+  if(!query)
+    goto tidy;
+
+  rasqal_query_set_feature(query, RASQAL_FEATURE_CONSTRUCT_DEDUP_SIZE,
+                           dedup_size);
+  if(rasqal_query_prepare(query,
+                          RASQAL_GOOD_CAST(const unsigned char*, query_string),
+                          NULL))
+    goto tidy;
+
+  microbench_start(timer);
+
+  results = rasqal_query_execute(query);
+  if(results) {
+    count = 0;
+    while(rasqal_query_results_get_triple(results)) {
+      count++;
+      if(rasqal_query_results_next_triple(results))
+        break;
+    }
+  }
+
+  microbench_stop(timer);
+
+  tidy:
+  if(results)
+    rasqal_free_query_results(results);
+  if(query)
+    rasqal_free_query(query);
+  RASQAL_FREE(char*, query_string);
+
+  return count;
+}
+
+
+static long
+microbench_construct(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_construct_triples(world, scale, timer, 0);
+}
+
+
+static long
+microbench_construct_dedup(rasqal_world* world, int scale,
+                           microbench_timer* timer)
+{
+  return microbench_construct_triples(world, scale, timer, 1024);
+}
+
+#endif /* RASQAL_QUERY_SPARQL */
+
+
+#define ESCAPE_VALUES_COUNT 20000
+#define ESCAPE_VALUE_MAX_LEN 200
+
+/* mostly plain words with some bytes every format has to escape */
+static const char* const escape_pieces[] = {
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+  "http://example.org/resource/", "1234567890", " ", " ", " ",
+  "\"", ",", "\n", "\r", "\t", "<", ">", "&", "\\",
+  "\xc3\xa9", "\xe2\x82\xac", "\x7f"
+};
+#define ESCAPE_PIECES_COUNT \
+  (sizeof(escape_pieces) / sizeof(escape_pieces[0]))
+/* pieces from this index need escaping in some format */
+#define ESCAPE_FIRST_SPECIAL 13
+
+typedef enum {
+  ESCAPE_CSV,
+  ESCAPE_NTRIPLES,
+  ESCAPE_XML
+} microbench_escape_format;
+
+
+/*
+ * Return a buffer of @count NUL-terminated values; every 4th one is
+ * plain text and the rest have a few special bytes at random places.
+ */
+static unsigned char*
+microbench_escape_values(rasqal_world* world, int count)
+{
+  unsigned char* buffer;
+  rasqal_random* r;
+  int i;
+
+  buffer = RASQAL_MALLOC(unsigned char*,
+                         RASQAL_GOOD_CAST(size_t, count) * (ESCAPE_VALUE_MAX_LEN + 1));
+  r = rasqal_new_random(world);
+  if(!buffer || !r) {
+    if(buffer)
+      RASQAL_FREE(unsigned char*, buffer);
+    if(r)
+      rasqal_free_random(r);
+    return NULL;
+  }
+  rasqal_random_seed(r, MICROBENCH_SEED);
+
+  for(i = 0; i < count; i++) {
+    unsigned char* value = buffer + i * (ESCAPE_VALUE_MAX_LEN + 1);
+    size_t len = 0;
+    int plain = !(i % 4);
+
+    while(1) {
+      const char* piece;
+      size_t piece_len;
+      unsigned int n;
+
+      n = RASQAL_GOOD_CAST(unsigned int, rasqal_random_irand(r));
+      if(plain || (n % 16))
+        n %= ESCAPE_FIRST_SPECIAL;
+      else
+        n %= ESCAPE_PIECES_COUNT;
+      piece = escape_pieces[n];
+      piece_len = strlen(piece);
+      if(len + piece_len > ESCAPE_VALUE_MAX_LEN)
+        break;
+      memcpy(value + len, piece, piece_len);
+      len += piece_len;
+    }
+    value[len] = '\0';
+  }
+  rasqal_free_random(r);
+
+  return buffer;
+}
+
+
+/* Write escaped values to a sink with the rasqal or, if @raptor is set,
+ * the raptor writer */
+static long
+microbench_escape(rasqal_world* world, int scale, microbench_timer* timer,
+                  microbench_escape_format format, int raptor)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  int count = ESCAPE_VALUES_COUNT * scale;
+  unsigned char* values;
+  raptor_iostream* iostr = NULL;
+  raptor_namespace_stack* nstack = NULL;
+  raptor_xml_writer* xml_writer = NULL;
+  raptor_namespace* ns = NULL;
+  raptor_xml_element* element = NULL;
+  long rc = -1;
+  int i;
+
+  values = microbench_escape_values(world, count);
+  if(!values)
+    return -1;
+
+  iostr = raptor_new_iostream_to_sink(raptor_world_ptr);
+  if(!iostr)
+    goto tidy;
+
+  if(format == ESCAPE_XML) {
+    nstack = raptor_new_namespaces(raptor_world_ptr, 1);
+    if(nstack)
+      xml_writer = raptor_new_xml_writer(raptor_world_ptr, nstack, iostr);
+    if(xml_writer)
+      ns = raptor_new_namespace(nstack, NULL,
+                                RASQAL_GOOD_CAST(const unsigned char*, EX_NS),
+                                0);
+    if(ns)
+      element = raptor_new_xml_element_from_namespace_local_name(ns,
+                                                                 RASQAL_GOOD_CAST(const unsigned char*, "v"),
+                                                                 NULL, NULL);
+    if(!element)
+      goto tidy;
+  }
+
+  microbench_start(timer);
+
+  for(i = 0; i < count; i++) {
+    unsigned char* value = values + i * (ESCAPE_VALUE_MAX_LEN + 1);
+    size_t len = strlen(RASQAL_GOOD_CAST(const char*, value));
+
+    switch(format) {
+      case ESCAPE_CSV:
+        rasqal_iostream_write_csv_string(value, len, iostr);
+        break;
+
+      case ESCAPE_NTRIPLES:
+        if(raptor)
+          raptor_string_ntriples_write(value, len, '"', iostr);
+        else
+          rasqal_iostream_write_ntriples_string(value, len, '"', iostr);
+        break;
+
+      case ESCAPE_XML:
+        raptor_xml_writer_start_element(xml_writer, element);
+        if(raptor)
+          raptor_xml_writer_cdata_counted(xml_writer, value,
+                                          RASQAL_GOOD_CAST(unsigned int, len));
+        else
+          rasqal_xml_writer_write_cdata(xml_writer, value, len);
+        raptor_xml_writer_end_element(xml_writer, element);
+        break;
+    }
+    raptor_iostream_write_byte('\n', iostr);
+  }
+
+  microbench_stop(timer);
+
+  rc = count;
+
+  tidy:
+  if(element)
+    raptor_free_xml_element(element);
+  if(ns)
+    raptor_free_namespace(ns);
+  if(xml_writer)
+    raptor_free_xml_writer(xml_writer);
+  if(nstack)
+    raptor_free_namespaces(nstack);
+  if(iostr)
+    raptor_free_iostream(iostr);
+  RASQAL_FREE(unsigned char*, values);
+
+  return rc;
+}
+
+
+static long
+microbench_escape_csv(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_escape(world, scale, timer, ESCAPE_CSV, 0);
+}
+
+
+static long
+microbench_escape_ntriples(rasqal_world* world, int scale,
+                           microbench_timer* timer)
+{
+  return microbench_escape(world, scale, timer, ESCAPE_NTRIPLES, 0);
+}
+
+
+static long
+microbench_escape_ntriples_raptor(rasqal_world* world, int scale,
+                                  microbench_timer* timer)
+{
+  return microbench_escape(world, scale, timer, ESCAPE_NTRIPLES, 1);
+}
+
+
+static long
+microbench_escape_xml(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_escape(world, scale, timer, ESCAPE_XML, 0);
+}
+
+
+static long
+microbench_escape_xml_raptor(rasqal_world* world, int scale,
+                             microbench_timer* timer)
+{
+  return microbench_escape(world, scale, timer, ESCAPE_XML, 1);
+}
+
+
+/* Return number of rows read from @string in @format_name or -1 on failure */
+static long
+microbench_read_results(rasqal_world* world, const char* format_name,
+                        const void* string, size_t len,
+                        microbench_timer* timer)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  rasqal_query_results_formatter* formatter;
+  rasqal_variables_table* vt;
+  raptor_iostream* iostr;
+  rasqal_rowsource* rowsource = NULL;
+  raptor_uri* base_uri;
+  long count = -1;
+
+  base_uri = raptor_new_uri(raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, EX_NS));
+  vt = rasqal_new_variables_table(world);
+  formatter = rasqal_new_query_results_formatter(world, format_name, NULL,
+                                                 NULL);
+  if(!base_uri || !vt || !formatter)
+    goto tidy;
+
+  microbench_start(timer);
+
+  iostr = raptor_new_iostream_from_string(raptor_world_ptr,
+                                          RASQAL_GOOD_CAST(void*, string),
+                                          len);
+  if(iostr)
+    /* takes ownership of iostr with flags 1 */
+    rowsource = rasqal_query_results_formatter_get_read_rowsource(world, iostr,
+                                                                  formatter,
+                                                                  vt, base_uri,
+                                                                  1);
+  if(rowsource) {
+    rasqal_row* row;
+
+    count = 0;
+    while((row = rasqal_rowsource_read_row(rowsource))) {
+      count++;
+      rasqal_free_row(row);
+    }
+    rasqal_free_rowsource(rowsource);
+  }
+
+  microbench_stop(timer);
+
+  tidy:
+  if(formatter)
+    rasqal_free_query_results_formatter(formatter);
+  if(vt)
+    rasqal_free_variables_table(vt);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+
+  return count;
+}
+
+
+#define READ_ROWS 50000
+
+/* SPARQL JSON or, if @xml is set, SPARQL XML results of two columns */
+static raptor_stringbuffer*
+microbench_sparql_results(int rows, int xml)
+{
+  raptor_stringbuffer* sb;
+  int i;
+
+  sb = raptor_new_stringbuffer();
+  if(!sb)
+    return NULL;
+
+  if(xml)
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "<?xml version=\"1.0\"?>\n<sparql xmlns=\"http://www.w3.org/2005/sparql-results#\">\n  <head>\n    <variable name=\"s\"/>\n    <variable name=\"o\"/>\n  </head>\n  <results>\n"), 1);
+  else
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "{ \"head\": { \"vars\": [ \"s\", \"o\" ] },\n  \"results\": { \"bindings\": [\n"), 1);
+
+  for(i = 0; i < rows; i++) {
+    if(xml) {
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "    <result>\n      <binding name=\"s\"><uri>http://example.org/resource/"), 1);
+      raptor_stringbuffer_append_decimal(sb, i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "</uri></binding>\n      <binding name=\"o\"><literal xml:lang=\"en\">label number "), 1);
+      raptor_stringbuffer_append_decimal(sb, i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "</literal></binding>\n    </result>\n"), 1);
+    } else {
+      if(i)
+        raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, ",\n"), 1);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "      { \"s\": { \"type\": \"uri\", \"value\": \"http://example.org/resource/"), 1);
+      raptor_stringbuffer_append_decimal(sb, i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "\" }, \"o\": { \"type\": \"literal\", \"value\": \"label number "), 1);
+      raptor_stringbuffer_append_decimal(sb, i);
+      raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "\", \"xml:lang\": \"en\" } }"), 1);
+    }
+  }
+
+  if(xml)
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "  </results>\n</sparql>\n"), 1);
+  else
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "\n  ] }\n}\n"), 1);
+
+  return sb;
+}
+
+
+static long
+microbench_read_sparql_results(rasqal_world* world, int scale,
+                               microbench_timer* timer, int xml)
+{
+  raptor_stringbuffer* sb;
+  long rows;
+
+  sb = microbench_sparql_results(READ_ROWS * scale, xml);
+  if(!sb)
+    return -1;
+
+  rows = microbench_read_results(world, xml ? "xml" : "json",
+                                 raptor_stringbuffer_as_string(sb),
+                                 raptor_stringbuffer_length(sb), timer);
+
+  raptor_free_stringbuffer(sb);
+
+  return rows;
+}
+
+
+static long
+microbench_read_json(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_read_sparql_results(world, scale, timer, 0);
+}
+
+
+static long
+microbench_read_xml(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_read_sparql_results(world, scale, timer, 1);
+}
+
+
+/* TSV results of three columns with repeated subjects and predicates */
+static raptor_stringbuffer*
+microbench_tsv_results(int rows)
+{
+  raptor_stringbuffer* sb;
+  int i;
+
+  sb = raptor_new_stringbuffer();
+  if(!sb)
+    return NULL;
+
+  raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "?s\t?p\t?o\n"), 1);
+  for(i = 0; i < rows; i++) {
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "<http://example.org/resource/"), 1);
+    raptor_stringbuffer_append_decimal(sb, i / 10);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, ">\t<http://example.org/property/"), 1);
+    raptor_stringbuffer_append_decimal(sb, i % 10);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, ">\t"), 1);
+    raptor_stringbuffer_append_decimal(sb, i);
+    raptor_stringbuffer_append_string(sb, RASQAL_GOOD_CAST(const unsigned char*, "\n"), 1);
+  }
+
+  return sb;
+}
+
+
+/*
+ * Return @sb in @format_name rewritten as @out_format_name in a
+ * malloc()ed string of *@len_p bytes or NULL on failure
+ */
+static void*
+microbench_convert_results(rasqal_world* world, raptor_stringbuffer* sb,
+                           const char* format_name,
+                           const char* out_format_name, size_t* len_p)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  rasqal_query_results* results;
+  rasqal_query_results_formatter* formatter = NULL;
+  raptor_iostream* iostr = NULL;
+  raptor_uri* base_uri;
+  void* string = NULL;
+
+  base_uri = raptor_new_uri(raptor_world_ptr,
+                            RASQAL_GOOD_CAST(const unsigned char*, EX_NS));
+  results = rasqal_new_query_results2(world, NULL,
+                                      RASQAL_QUERY_RESULTS_BINDINGS);
+  if(!base_uri || !results)
+    goto tidy;
+
+  formatter = rasqal_new_query_results_formatter(world, format_name, NULL,
+                                                 NULL);
+  iostr = raptor_new_iostream_from_string(raptor_world_ptr,
+                                          raptor_stringbuffer_as_string(sb),
+                                          raptor_stringbuffer_length(sb));
+  if(!formatter || !iostr ||
+     rasqal_query_results_formatter_read(world, iostr, formatter, results,
+                                         base_uri))
+    goto tidy;
+  raptor_free_iostream(iostr);
+  rasqal_free_query_results_formatter(formatter);
+
+  formatter = rasqal_new_query_results_formatter(world, out_format_name,
+                                                 NULL, NULL);
+  iostr = raptor_new_iostream_to_string(raptor_world_ptr, &string, len_p,
+                                        malloc);
+  if(!formatter || !iostr)
+    goto tidy;
+  if(rasqal_query_results_formatter_write(iostr, formatter, results,
+                                          base_uri)) {
+    raptor_free_iostream(iostr);
+    iostr = NULL;
+    if(string)
+      free(string);
+    string = NULL;
+  }
+
+  tidy:
+  /* freeing the string iostream sets the string */
+  if(iostr)
+    raptor_free_iostream(iostr);
+  if(formatter)
+    rasqal_free_query_results_formatter(formatter);
+  if(results)
+    rasqal_free_query_results(results);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+
+  return string;
+}
+
+
+static long
+microbench_read_tsv_results(rasqal_world* world, int scale,
+                            microbench_timer* timer, int binary)
+{
+  raptor_stringbuffer* sb;
+  long rows = -1;
+
+  sb = microbench_tsv_results(READ_ROWS * scale);
+  if(!sb)
+    return -1;
+
+  if(binary) {
+    void* string;
+    size_t len = 0;
+
+    string = microbench_convert_results(world, sb, "tsv", "binary", &len);
+    if(string) {
+      rows = microbench_read_results(world, "binary", string, len, timer);
+      free(string);
+    }
+  } else
+    rows = microbench_read_results(world, "tsv",
+                                   raptor_stringbuffer_as_string(sb),
+                                   raptor_stringbuffer_length(sb), timer);
+
+  raptor_free_stringbuffer(sb);
+
+  return rows;
+}
+
+
+static long
+microbench_read_tsv(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_read_tsv_results(world, scale, timer, 0);
+}
+
+
+/* the same rows as microbench_read_tsv() in the binary format */
+static long
+microbench_read_binary(rasqal_world* world, int scale,
+                       microbench_timer* timer)
+{
+  return microbench_read_tsv_results(world, scale, timer, 1);
+}
+
+
+#define XSD_LOOKUPS 200000
+
+/* XSD datatype local names, most of them recognised */
+static const char* const xsd_lookup_names[] = {
+  "string", "boolean", "integer", "float", "double", "decimal", "dateTime",
+  "nonPositiveInteger", "negativeInteger", "long", "int", "short", "byte",
+  "nonNegativeInteger", "unsignedLong", "unsignedInt", "unsignedShort",
+  "date", "unsignedByte", "gYear"
+};
+#define XSD_LOOKUP_NAMES_COUNT \
+  RASQAL_GOOD_CAST(int, sizeof(xsd_lookup_names) / sizeof(xsd_lookup_names[0]))
+
+
+/*
+ * Resolve datatype URIs to literal types with the rasqal lookup or, if
+ * @linear is set, by comparing with each URI in turn.
+ */
+static long
+microbench_xsd_lookup(rasqal_world* world, int scale, microbench_timer* timer,
+                      int linear)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  raptor_uri* uris[XSD_LOOKUP_NAMES_COUNT];
+  int count = XSD_LOOKUPS * scale;
+  long rc = -1;
+  long sum = 0;
+  int i;
+
+  memset(uris, '\0', sizeof(uris));
+  for(i = 0; i < XSD_LOOKUP_NAMES_COUNT; i++) {
+    char uri_string[64];
+
+    sprintf(uri_string, XSD_NS "%s", xsd_lookup_names[i]);
+    uris[i] = raptor_new_uri(raptor_world_ptr,
+                             RASQAL_GOOD_CAST(const unsigned char*, uri_string));
+    if(!uris[i])
+      goto tidy;
+  }
+
+  microbench_start(timer);
+
+  for(i = 0; i < count; i++) {
+    raptor_uri* uri = uris[i % XSD_LOOKUP_NAMES_COUNT];
+
+    if(linear) {
+      int j;
+
+      for(j = 0; j < XSD_LOOKUP_NAMES_COUNT; j++) {
+        if(raptor_uri_equals(uri, uris[j]))
+          break;
+      }
+      sum += j;
+    } else
+      sum += rasqal_xsd_datatype_uri_to_type(world, uri);
+  }
+
+  microbench_stop(timer);
+
+  /* keep the lookups */
+  rc = sum >= 0 ? count : -1;
+
+  tidy:
+  for(i = 0; i < XSD_LOOKUP_NAMES_COUNT; i++) {
+    if(uris[i])
+      raptor_free_uri(uris[i]);
+  }
+
+  return rc;
+}
+
+
+static long
+microbench_xsd_lookup_hash(rasqal_world* world, int scale,
+                           microbench_timer* timer)
+{
+  return microbench_xsd_lookup(world, scale, timer, 0);
+}
+
+
+static long
+microbench_xsd_lookup_linear(rasqal_world* world, int scale,
+                             microbench_timer* timer)
+{
+  return microbench_xsd_lookup(world, scale, timer, 1);
+}
+
+
+#define TYPED_LITERALS 60000
+
+/* typed lexical forms as a data load would see them */
+static const struct {
+  rasqal_literal_type type;
+  const char* lexical;
+} typed_literals[] = {
+  { RASQAL_LITERAL_INTEGER, "42" },
+  { RASQAL_LITERAL_DOUBLE, "1.5E2" },
+  { RASQAL_LITERAL_DECIMAL, "3.25" },
+  { RASQAL_LITERAL_BOOLEAN, "true" },
+  { RASQAL_LITERAL_DATETIME, "2004-12-31T19:01:00Z" },
+  { RASQAL_LITERAL_DATE, "2004-12-31" }
+};
+#define TYPED_LITERALS_COUNT \
+  RASQAL_GOOD_CAST(int, sizeof(typed_literals) / sizeof(typed_literals[0]))
+
+
+/*
+ * Construct typed literals from lexical forms and datatype URIs with
+ * their native values or, if @lazy is set, leaving the native value
+ * to be made on first use.
+ */
+static long
+microbench_new_typed_literals(rasqal_world* world, int scale,
+                              microbench_timer* timer, int lazy)
+{
+  int count = TYPED_LITERALS * scale;
+  long rc = count;
+  int i;
+
+  microbench_start(timer);
+
+  for(i = 0; i < count; i++) {
+    int t = i % TYPED_LITERALS_COUNT;
+    size_t len = strlen(typed_literals[t].lexical);
+    unsigned char* str;
+    raptor_uri* dt_uri;
+    rasqal_literal* l;
+
+    str = RASQAL_MALLOC(unsigned char*, len + 1);
+    if(!str) {
+      rc = -1;
+      break;
+    }
+    memcpy(str, typed_literals[t].lexical, len + 1);
+    dt_uri = raptor_uri_copy(rasqal_xsd_datatype_type_to_uri(world,
+                                                             typed_literals[t].type));
+
+    if(lazy)
+      l = rasqal_new_string_literal(world, str, NULL, dt_uri, NULL);
+    else
+      l = rasqal_new_string_literal_node(world, str, NULL, dt_uri);
+    if(!l) {
+      rc = -1;
+      break;
+    }
+    rasqal_free_literal(l);
+  }
+
+  microbench_stop(timer);
+
+  return rc;
+}
+
+
+static long
+microbench_typed_literals(rasqal_world* world, int scale,
+                          microbench_timer* timer)
+{
+  return microbench_new_typed_literals(world, scale, timer, 0);
+}
+
+
+static long
+microbench_typed_literals_lazy(rasqal_world* world, int scale,
+                               microbench_timer* timer)
+{
+  return microbench_new_typed_literals(world, scale, timer, 1);
+}
+
+
+#define DATETIMES 200000
+
+static int
+microbench_datetime_compare(const void *a, const void *b)
+{
+  rasqal_xsd_datetime* dt1 = *(rasqal_xsd_datetime* const*)a;
+  rasqal_xsd_datetime* dt2 = *(rasqal_xsd_datetime* const*)b;
+
+  return rasqal_xsd_datetime_compare2(dt1, dt2, NULL);
+}
+
+
+/*
+ * Parse timestamps as a load of event data would and, if @sort is set,
+ * time sorting them as ORDER BY would instead.
+ */
+static long
+microbench_datetimes(rasqal_world* world, int scale, microbench_timer* timer,
+                     int sort)
+{
+  int count = DATETIMES * scale;
+  rasqal_xsd_datetime** dts;
+  unsigned long seed = 1;
+  long rc = -1;
+  int i;
+
+  dts = RASQAL_CALLOC(rasqal_xsd_datetime**, RASQAL_GOOD_CAST(size_t, count),
+                      sizeof(rasqal_xsd_datetime*));
+  if(!dts)
+    return -1;
+
+  if(!sort)
+    microbench_start(timer);
+
+  for(i = 0; i < count; i++) {
+    char buffer[40];
+
+    seed = seed * 1103515245UL + 12345UL;
+    sprintf(buffer, "%04lu-%02lu-%02luT%02lu:%02lu:%02lu.%03luZ",
+            1970 + (seed >> 8) % 60, 1 + (seed >> 4) % 12,
+            1 + (seed >> 12) % 28, (seed >> 16) % 24, (seed >> 20) % 60,
+            (seed >> 3) % 60, (seed >> 6) % 1000);
+    dts[i] = rasqal_new_xsd_datetime(world, buffer);
+    if(!dts[i])
+      goto tidy;
+  }
+
+  if(sort) {
+    microbench_start(timer);
+    qsort(dts, RASQAL_GOOD_CAST(size_t, count), sizeof(rasqal_xsd_datetime*),
+          microbench_datetime_compare);
+  }
+
+  microbench_stop(timer);
+
+  rc = count;
+
+  tidy:
+  for(i = 0; i < count; i++) {
+    if(dts[i])
+      rasqal_free_xsd_datetime(dts[i]);
+  }
+  RASQAL_FREE(rasqal_xsd_datetime**, dts);
+
+  return rc;
+}
+
+
+static long
+microbench_datetime_parse(rasqal_world* world, int scale,
+                          microbench_timer* timer)
+{
+  return microbench_datetimes(world, scale, timer, 0);
+}
+
+
+static long
+microbench_datetime_sort(rasqal_world* world, int scale,
+                         microbench_timer* timer)
+{
+  return microbench_datetimes(world, scale, timer, 1);
+}
+
+
+#define DECIMAL_SUMS 1000000
+
+/* SUM and AVG of prices 0.00, 1.01, ... 99.99 repeating */
+static long
+microbench_decimal_sum(rasqal_world* world, int scale,
+                       microbench_timer* timer)
+{
+  int count = DECIMAL_SUMS * scale;
+  rasqal_xsd_decimal* sum = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* price = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* n = rasqal_new_xsd_decimal(world);
+  rasqal_xsd_decimal* avg = rasqal_new_xsd_decimal(world);
+  char prices[100][8];
+  long rc = -1;
+  int i;
+
+  if(!sum || !price || !n || !avg)
+    goto tidy;
+
+  for(i = 0; i < 100; i++)
+    sprintf(prices[i], "%d.%02d", i, i);
+
+  microbench_start(timer);
+
+  rasqal_xsd_decimal_set_long(sum, 0);
+  for(i = 0; i < count; i++) {
+    rasqal_xsd_decimal_set_string(price, prices[i % 100]);
+    rasqal_xsd_decimal_add(sum, sum, price);
+  }
+  rasqal_xsd_decimal_set_long(n, count);
+  rasqal_xsd_decimal_divide(avg, sum, n);
+
+  microbench_stop(timer);
+
+  rc = count;
+
+  tidy:
+  if(sum)
+    rasqal_free_xsd_decimal(sum);
+  if(price)
+    rasqal_free_xsd_decimal(price);
+  if(n)
+    rasqal_free_xsd_decimal(n);
+  if(avg)
+    rasqal_free_xsd_decimal(avg);
+
+  return rc;
+}
+
+
+#define UTF8_VALUES_COUNT 20000
+#define UTF8_VALUE_MAX_LEN 120
+#define UTF8_ROUNDS 20
+
+/* label-like words with some multi-byte characters */
+static const char* const utf8_pieces[] = {
+  "Label", "of", "the", "Resource", "name", "Example", "2014", " ", " ",
+  "-", "_", "~", ".", "/", "%", "+", "@", "ZYX", "abc",
+  "\xc3\xa9", "\xc3\x89", "\xe2\x82\xac", "\xf0\x9f\x98\x80"
+};
+#define UTF8_PIECES_COUNT \
+  (sizeof(utf8_pieces) / sizeof(utf8_pieces[0]))
+/* pieces from this index are multi-byte */
+#define UTF8_FIRST_MULTIBYTE 19
+
+typedef enum {
+  UTF8_STRLEN,
+  UTF8_SUBSTR,
+  UTF8_UCASE,
+  UTF8_FIND,
+  UTF8_ENCODE_FOR_URI
+} microbench_utf8_kernel;
+
+
+/*
+ * Return a buffer of @count NUL-terminated values; most are ASCII and
+ * every 4th one has multi-byte characters.
+ */
+static unsigned char*
+microbench_utf8_values(rasqal_world* world, int count)
+{
+  unsigned char* buffer;
+  rasqal_random* r;
+  int i;
+
+  buffer = RASQAL_MALLOC(unsigned char*,
+                         RASQAL_GOOD_CAST(size_t, count) * (UTF8_VALUE_MAX_LEN + 1));
+  r = rasqal_new_random(world);
+  if(!buffer || !r) {
+    if(buffer)
+      RASQAL_FREE(unsigned char*, buffer);
+    if(r)
+      rasqal_free_random(r);
+    return NULL;
+  }
+  rasqal_random_seed(r, MICROBENCH_SEED);
+
+  for(i = 0; i < count; i++) {
+    unsigned char* value = buffer + i * (UTF8_VALUE_MAX_LEN + 1);
+    unsigned int limit = (i % 4) ? UTF8_FIRST_MULTIBYTE : UTF8_PIECES_COUNT;
+    size_t len = 0;
+
+    while(1) {
+      const char* piece;
+      size_t piece_len;
+      unsigned int n;
+
+      n = RASQAL_GOOD_CAST(unsigned int, rasqal_random_irand(r)) % limit;
+      piece = utf8_pieces[n];
+      piece_len = strlen(piece);
+      if(len + piece_len > UTF8_VALUE_MAX_LEN ||
+         (len && !(rasqal_random_irand(r) % 24)))
+        break;
+      memcpy(value + len, piece, piece_len);
+      len += piece_len;
+    }
+    value[len] = '\0';
+  }
+  rasqal_free_random(r);
+
+  return buffer;
+}
+
+
+/* Run the rasqal or, if @raptor is set, the raptor @kernel over values */
+static long
+microbench_utf8(rasqal_world* world, int scale, microbench_timer* timer,
+                microbench_utf8_kernel kernel, int raptor)
+{
+  int count = UTF8_VALUES_COUNT * scale;
+  unsigned char* values;
+  unsigned char* buffer;
+  size_t total = 0;
+  int round;
+  int i;
+
+  values = microbench_utf8_values(world, count);
+  buffer = RASQAL_MALLOC(unsigned char*, 3 * UTF8_VALUE_MAX_LEN + 1);
+  if(!values || !buffer) {
+    if(values)
+      RASQAL_FREE(unsigned char*, values);
+    if(buffer)
+      RASQAL_FREE(unsigned char*, buffer);
+    return -1;
+  }
+
+  microbench_start(timer);
+
+  for(round = 0; round < UTF8_ROUNDS; round++) {
+    for(i = 0; i < count; i++) {
+      const unsigned char* s = values + i * (UTF8_VALUE_MAX_LEN + 1);
+      size_t len = strlen(RASQAL_GOOD_CAST(const char*, s));
+
+      switch(kernel) {
+        case UTF8_STRLEN:
+          if(raptor)
+            total += RASQAL_GOOD_CAST(size_t, raptor_unicode_utf8_strlen(s, len));
+          else
+            total += RASQAL_GOOD_CAST(size_t, rasqal_utf8_strlen(s, len));
+          break;
+
+        case UTF8_SUBSTR:
+          if(raptor)
+            total += raptor_unicode_utf8_substr(buffer, NULL, s, len, 4, 20);
+          else {
+            size_t view_len = 0;
+
+            if(rasqal_utf8_substr(s, len, 4, 20, &view_len))
+              total += view_len;
+          }
+          break;
+
+        case UTF8_UCASE:
+          rasqal_utf8_set_case(buffer, s, len, 1);
+          total += buffer[0];
+          break;
+
+        case UTF8_FIND:
+          total += (rasqal_utf8_find(s, len,
+                                     RASQAL_GOOD_CAST(const unsigned char*, "Example"),
+                                     7) != NULL);
+          break;
+
+        case UTF8_ENCODE_FOR_URI:
+          total += rasqal_utf8_encode_for_uri(buffer, s, len);
+          break;
+      }
+    }
+  }
+
+  microbench_stop(timer);
+
+  RASQAL_FREE(unsigned char*, values);
+  RASQAL_FREE(unsigned char*, buffer);
+
+  /* keep the work */
+  return total ? RASQAL_GOOD_CAST(long, count) * UTF8_ROUNDS : 0;
+}
+
+
+static long
+microbench_utf8_strlen(rasqal_world* world, int scale,
+                       microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_STRLEN, 0);
+}
+
+
+static long
+microbench_utf8_strlen_raptor(rasqal_world* world, int scale,
+                              microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_STRLEN, 1);
+}
+
+
+static long
+microbench_utf8_substr(rasqal_world* world, int scale,
+                       microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_SUBSTR, 0);
+}
+
+
+static long
+microbench_utf8_substr_raptor(rasqal_world* world, int scale,
+                              microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_SUBSTR, 1);
+}
+
+
+static long
+microbench_utf8_ucase(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_UCASE, 0);
+}
+
+
+static long
+microbench_utf8_find(rasqal_world* world, int scale, microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_FIND, 0);
+}
+
+
+static long
+microbench_utf8_encode_for_uri(rasqal_world* world, int scale,
+                               microbench_timer* timer)
+{
+  return microbench_utf8(world, scale, timer, UTF8_ENCODE_FOR_URI, 0);
+}
+
+
+#define COMPARE_ROWS 20000
+#define COMPARE_BNODES 100
+
+/* TSV rows of a value and one of a few blank nodes, optionally
+ * reversed with the blank nodes relabelled */
+static char*
+microbench_compare_string(int rows, int reversed)
+{
+  char* string;
+  char* p;
+  int i;
+
+  string = RASQAL_MALLOC(char*, RASQAL_GOOD_CAST(size_t, rows) * 32 + 8);
+  if(!string)
+    return NULL;
+
+  p = string;
+  p += sprintf(p, "a\tb\n");
+  for(i = 0; i < rows; i++) {
+    int r = reversed ? rows - 1 - i : i;
+
+    p += sprintf(p, "\"%d\"\t_:%c%d\n", r, (reversed ? 'y' : 'x'),
+                 r % COMPARE_BNODES);
+  }
+
+  return string;
+}
+
+
+/* compare results as multisets, matching blank nodes */
+static long
+microbench_compare_unordered(rasqal_world* world, int scale,
+                             microbench_timer* timer)
+{
+  int rows = COMPARE_ROWS * scale;
+  char* first_string;
+  char* second_string;
+  raptor_uri* base_uri;
+  rasqal_query_results* first_qr = NULL;
+  rasqal_query_results* second_qr = NULL;
+  rasqal_results_compare* rrc = NULL;
+  long rc = -1;
+
+  first_string = microbench_compare_string(rows, 0);
+  second_string = microbench_compare_string(rows, 1);
+  base_uri = raptor_new_uri(rasqal_world_get_raptor(world),
+                            RASQAL_GOOD_CAST(const unsigned char*, EX_NS));
+  if(!first_string || !second_string || !base_uri)
+    goto tidy;
+
+  first_qr = rasqal_new_query_results_from_string(world,
+                                                  RASQAL_QUERY_RESULTS_BINDINGS,
+                                                  base_uri, first_string, 0);
+  second_qr = rasqal_new_query_results_from_string(world,
+                                                   RASQAL_QUERY_RESULTS_BINDINGS,
+                                                   base_uri, second_string, 0);
+  if(first_qr && second_qr)
+    rrc = rasqal_new_results_compare(world, first_qr, "first",
+                                     second_qr, "second");
+  if(!rrc)
+    goto tidy;
+
+  rasqal_results_compare_set_unordered(rrc, 1);
+
+  microbench_start(timer);
+  if(rasqal_results_compare_compare(rrc) == 1)
+    rc = rows;
+  microbench_stop(timer);
+
+  tidy:
+  if(rrc)
+    rasqal_free_results_compare(rrc);
+  if(first_qr)
+    rasqal_free_query_results(first_qr);
+  if(second_qr)
+    rasqal_free_query_results(second_qr);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  if(first_string)
+    RASQAL_FREE(char*, first_string);
+  if(second_string)
+    RASQAL_FREE(char*, second_string);
+
+  return rc;
+}
+
+
+#define NTRIPLES_LOAD_FILE "rasqal-microbench.nt"
+#define NTRIPLES_LOAD_TRIPLES 200000
+#define NTRIPLES_LOAD_THREADS 4
+
+static int
+microbench_ntriples_load_handler(void* user_data, int index,
+                                 rasqal_triple* triple)
+{
+  long* count = (long*)user_data;
+
+  (*count)++;
+  rasqal_free_triple(triple);
+  return 0;
+}
+
+
+/* Scan and merge an N-Triples file with the loader using @threads */
+static long
+microbench_ntriples_load(rasqal_world* world, int scale,
+                         microbench_timer* timer, int threads)
+{
+  raptor_world* raptor_world_ptr = rasqal_world_get_raptor(world);
+  int triples = NTRIPLES_LOAD_TRIPLES * scale;
+  raptor_sequence* data_graphs = NULL;
+  rasqal_data_graph* dg = NULL;
+  rasqal_ntriples_load* load;
+  unsigned char* uri_string = NULL;
+  raptor_uri* uri = NULL;
+  FILE* fh;
+  long count = 0;
+  long rc = -1;
+  int i;
+
+  fh = fopen(NTRIPLES_LOAD_FILE, "w");
+  if(!fh)
+    return -1;
+  for(i = 0; i < triples; i++) {
+    if(!(i % 2))
+      fprintf(fh, "_:b%d <" EX_NS "label> \"label %d\"@en .\n", i / 10, i);
+    else
+      fprintf(fh, "<" EX_NS "s%d> <" EX_NS "p%d> <" EX_NS "o%d> .\n",
+              i / 10, i % 10, i);
+  }
+  if(fclose(fh))
+    goto tidy;
+
+  uri_string = raptor_uri_filename_to_uri_string(NTRIPLES_LOAD_FILE);
+  if(uri_string)
+    uri = raptor_new_uri(raptor_world_ptr, uri_string);
+  if(uri)
+    dg = rasqal_new_data_graph_from_uri(world, uri, NULL,
+                                        RASQAL_DATA_GRAPH_BACKGROUND,
+                                        NULL, "ntriples", NULL);
+  data_graphs = raptor_new_sequence((raptor_data_free_handler)rasqal_free_data_graph,
+                                    NULL);
+  if(!dg || !data_graphs) {
+    if(dg)
+      rasqal_free_data_graph(dg);
+    goto tidy;
+  }
+  /* sequence owns the data graph */
+  if(raptor_sequence_push(data_graphs, dg))
+    goto tidy;
+
+  microbench_start(timer);
+
+  load = rasqal_new_ntriples_load(world, data_graphs, threads);
+  if(load && rasqal_ntriples_load_has_data_graph(load, 0) &&
+     !rasqal_ntriples_load_merge_data_graph(load, 0,
+                                            RASQAL_GOOD_CAST(const unsigned char*, "bench"),
+                                            microbench_ntriples_load_handler,
+                                            &count))
+    rc = count;
+  if(load)
+    rasqal_free_ntriples_load(load);
+
+  microbench_stop(timer);
+
+  tidy:
+  remove(NTRIPLES_LOAD_FILE);
+  if(data_graphs)
+    raptor_free_sequence(data_graphs);
+  if(uri)
+    raptor_free_uri(uri);
+  if(uri_string)
+    raptor_free_memory(uri_string);
+
+  return rc;
+}
+
+
+static long
+microbench_ntriples_load_1(rasqal_world* world, int scale,
+                           microbench_timer* timer)
+{
+  return microbench_ntriples_load(world, scale, timer, 1);
+}
+
+
+static long
+microbench_ntriples_load_n(rasqal_world* world, int scale,
+                           microbench_timer* timer)
+{
+  return microbench_ntriples_load(world, scale, timer, NTRIPLES_LOAD_THREADS);
+}
+
+
+static const microbench microbenchmarks[] = {
+#ifdef RASQAL_QUERY_SPARQL
+  { "minus", microbench_minus },
+  { "minus_optional_unbound", microbench_minus_optional },
+  { "construct", microbench_construct },
+  { "construct_dedup", microbench_construct_dedup },
+  { "describe", microbench_describe },
+#endif
+  { "escape_csv", microbench_escape_csv },
+  { "escape_ntriples", microbench_escape_ntriples },
+  { "escape_ntriples_raptor", microbench_escape_ntriples_raptor },
+  { "escape_xml", microbench_escape_xml },
+  { "escape_xml_raptor", microbench_escape_xml_raptor },
+  { "read_json", microbench_read_json },
+  { "read_xml", microbench_read_xml },
+  { "read_tsv", microbench_read_tsv },
+  { "read_binary", microbench_read_binary },
+  { "xsd_lookup", microbench_xsd_lookup_hash },
+  { "xsd_lookup_linear", microbench_xsd_lookup_linear },
+  { "typed_literals", microbench_typed_literals },
+  { "typed_literals_lazy", microbench_typed_literals_lazy },
+  { "datetime_parse", microbench_datetime_parse },
+  { "datetime_sort", microbench_datetime_sort },
+  { "decimal_sum", microbench_decimal_sum },
+  { "utf8_strlen", microbench_utf8_strlen },
+  { "utf8_strlen_raptor", microbench_utf8_strlen_raptor },
+  { "utf8_substr", microbench_utf8_substr },
+  { "utf8_substr_raptor", microbench_utf8_substr_raptor },
+  { "utf8_ucase", microbench_utf8_ucase },
+  { "utf8_find", microbench_utf8_find },
+  { "utf8_encode_for_uri", microbench_utf8_encode_for_uri },
+  { "compare_unordered", microbench_compare_unordered },
+  { "ntriples_load", microbench_ntriples_load_1 },
+  { "ntriples_load_threads", microbench_ntriples_load_n },
+  { NULL, NULL }
+};
+
+
+static void
+microbench_usage(const char* program)
+{
+  fprintf(stderr,
+          "Usage: %s [-s SCALE] [-b NAME]\n"
+          "  -s SCALE  multiply every workload by SCALE (default %d)\n"
+          "  -b NAME   run only benchmark NAME\n",
+          program, MICROBENCH_DEFAULT_SCALE);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = rasqal_basename(argv[0]);
+  int scale = MICROBENCH_DEFAULT_SCALE;
+  const char* only = NULL;
+  rasqal_world* world;
+  int failures = 0;
+  int printed = 0;
+  int i;
+
+  for(i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+
+    if(arg[0] != '-' || !arg[1] || arg[2] || i + 1 == argc) {
+      microbench_usage(program);
+      return 1;
+    }
+
+    switch(arg[1]) {
+      case 's':
+        scale = atoi(argv[++i]);
+        break;
+      case 'b':
+        only = argv[++i];
+        break;
+      default:
+        microbench_usage(program);
+        return 1;
+    }
+  }
+
+  if(scale < 1) {
+    microbench_usage(program);
+    return 1;
+  }
+
+  world = rasqal_new_world();
+  if(!world || rasqal_world_open(world)) {
+    fprintf(stderr, "%s: rasqal_world init failed\n", program);
+    return 1;
+  }
+
+  fprintf(stdout, "{\n");
+  fprintf(stdout, "  \"rasqal_version\": \"%s\",\n", rasqal_version_string);
+  fprintf(stdout, "  \"scale\": %d,\n", scale);
+  fprintf(stdout, "  \"benchmarks\": [\n");
+
+  for(i = 0; microbenchmarks[i].name; i++) {
+    const microbench* mb = &microbenchmarks[i];
+    microbench_timer timer;
+    long ops;
+
+    if(only && strcmp(only, mb->name))
+      continue;
+
+    timer.usecs = 0.0;
+    ops = mb->fn(world, scale, &timer);
+    if(ops < 0) {
+      fprintf(stderr, "%s: Benchmark %s failed\n", program, mb->name);
+      failures++;
+      continue;
+    }
+
+    fprintf(stdout,
+            "%s    { \"name\": \"%s\", \"ops\": %ld, \"ms\": %.3f, "
+            "\"ops_per_sec\": %.1f }",
+            (printed++ ? ",\n" : ""), mb->name, ops, timer.usecs / 1000.0,
+            timer.usecs > 0.0 ? (double)ops * 1000000.0 / timer.usecs : 0.0);
+  }
+
+  fprintf(stdout, "\n  ]\n");
+  fprintf(stdout, "}\n");
+
+  rasqal_free_world(world);
+
+  return failures;
+}
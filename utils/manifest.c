@@ -36,6 +36,10 @@
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
 #include <rasqal.h>
 #include <rasqal_internal.h>
 
@@ -43,6 +47,11 @@
 #include "rasqalcmdline.h"
 
 
+#if defined(HAVE_FORK) && defined(HAVE_WAITPID) && defined(HAVE_SYS_WAIT_H)
+#define MANIFEST_PARALLEL 1
+#endif
+
+
 static const unsigned int indent_step = 2;
 static const unsigned int linewrap = 78;
 static const unsigned int banner_width = 68 /* linewrap - 10 */;
@@ -150,6 +159,7 @@ manifest_new_world(rasqal_world* world)
   mw->qt_namespace_uri = raptor_new_uri(raptor_world_ptr, (const unsigned char*)"http://www.w3.org/2001/sw/DataAccess/tests/test-query#");
   mw->dawgt_namespace_uri = raptor_new_uri(raptor_world_ptr, (const unsigned char*)"http://www.w3.org/2001/sw/DataAccess/tests/test-dawg#");
   mw->sd_namespace_uri = raptor_new_uri(raptor_world_ptr, (const unsigned char*)"http://www.w3.org/ns/sparql-service-description#");
+  mw->ut_namespace_uri = raptor_new_uri(raptor_world_ptr, (const unsigned char*)"http://www.w3.org/2009/sparql/tests/test-update#");
 
   mw->mf_Manifest_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->mf_namespace_uri, (const unsigned char*)"Manifest");
   mw->mf_entries_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->mf_namespace_uri, (const unsigned char*)"entries");
@@ -168,6 +178,11 @@ manifest_new_world(rasqal_world* world)
   mw->qt_query_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->qt_namespace_uri, (const unsigned char*)"query");
   mw->dawgt_approval_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->dawgt_namespace_uri, (const unsigned char*)"approval");
   mw->sd_entailmentRegime_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->sd_namespace_uri, (const unsigned char*)"entailmentRegime");
+  mw->rdfs_label_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->rdfs_namespace_uri, (const unsigned char*)"label");
+  mw->ut_request_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->ut_namespace_uri, (const unsigned char*)"request");
+  mw->ut_data_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->ut_namespace_uri, (const unsigned char*)"data");
+  mw->ut_graphData_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->ut_namespace_uri, (const unsigned char*)"graphData");
+  mw->ut_graph_uri = raptor_new_uri_from_uri_local_name(raptor_world_ptr, mw->ut_namespace_uri, (const unsigned char*)"graph");
 
   mw->mf_Manifest_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->mf_Manifest_uri));
   mw->mf_entries_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->mf_entries_uri));
@@ -185,6 +200,11 @@ manifest_new_world(rasqal_world* world)
   mw->qt_query_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->qt_query_uri));
   mw->dawgt_approval_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->dawgt_approval_uri));
   mw->sd_entailmentRegime_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->sd_entailmentRegime_uri));
+  mw->rdfs_label_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->rdfs_label_uri));
+  mw->ut_request_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->ut_request_uri));
+  mw->ut_data_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->ut_data_uri));
+  mw->ut_graphData_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->ut_graphData_uri));
+  mw->ut_graph_literal = rasqal_new_uri_literal(world, raptor_uri_copy(mw->ut_graph_uri));
 
   return mw;
 }
@@ -208,6 +228,8 @@ manifest_free_world(manifest_world* mw)
     raptor_free_uri(mw->dawgt_namespace_uri);
   if(mw->sd_namespace_uri)
     raptor_free_uri(mw->sd_namespace_uri);
+  if(mw->ut_namespace_uri)
+    raptor_free_uri(mw->ut_namespace_uri);
 
   if(mw->mf_Manifest_uri)
     raptor_free_uri(mw->mf_Manifest_uri);
@@ -243,6 +265,16 @@ manifest_free_world(manifest_world* mw)
     raptor_free_uri(mw->dawgt_approval_uri);
   if(mw->sd_entailmentRegime_uri)
     raptor_free_uri(mw->sd_entailmentRegime_uri);
+  if(mw->rdfs_label_uri)
+    raptor_free_uri(mw->rdfs_label_uri);
+  if(mw->ut_request_uri)
+    raptor_free_uri(mw->ut_request_uri);
+  if(mw->ut_data_uri)
+    raptor_free_uri(mw->ut_data_uri);
+  if(mw->ut_graphData_uri)
+    raptor_free_uri(mw->ut_graphData_uri);
+  if(mw->ut_graph_uri)
+    raptor_free_uri(mw->ut_graph_uri);
 
   if(mw->mf_Manifest_literal)
     rasqal_free_literal(mw->mf_Manifest_literal);
@@ -276,11 +308,136 @@ manifest_free_world(manifest_world* mw)
     rasqal_free_literal(mw->dawgt_approval_literal);
   if(mw->sd_entailmentRegime_literal)
     rasqal_free_literal(mw->sd_entailmentRegime_literal);
+  if(mw->rdfs_label_literal)
+    rasqal_free_literal(mw->rdfs_label_literal);
+  if(mw->ut_request_literal)
+    rasqal_free_literal(mw->ut_request_literal);
+  if(mw->ut_data_literal)
+    rasqal_free_literal(mw->ut_data_literal);
+  if(mw->ut_graphData_literal)
+    rasqal_free_literal(mw->ut_graphData_literal);
+  if(mw->ut_graph_literal)
+    rasqal_free_literal(mw->ut_graph_literal);
+
+  while(mw->data_cache) {
+    manifest_data_cache_entry* entry = mw->data_cache;
+
+    mw->data_cache = entry->next;
+    free(entry->uri_string);
+    if(entry->data)
+      rasqal_free_memory(entry->data);
+    free(entry);
+  }
 
   free(mw);
 }
 
 
+/*
+ * manifest_data_cache_get:
+ * @mw: manifest world
+ * @uri: data file URI
+ *
+ * Get the cached contents of a local data file, reading it on first use.
+ *
+ * Many tests in a suite share the same data files so this saves
+ * re-reading them from disk for every test.  When tests run in
+ * worker processes, each worker builds its own cache.
+ *
+ * Return value: cache entry or NULL if @uri is not a readable file
+ */
+static manifest_data_cache_entry*
+manifest_data_cache_get(manifest_world* mw, raptor_uri* uri)
+{
+  const char* uri_string = (const char*)raptor_uri_as_string(uri);
+  manifest_data_cache_entry* entry;
+  char* filename;
+  size_t len;
+
+  for(entry = mw->data_cache; entry; entry = entry->next) {
+    if(!strcmp(entry->uri_string, uri_string))
+      return entry->data ? entry : NULL;
+  }
+
+  entry = (manifest_data_cache_entry*)calloc(sizeof(*entry), 1);
+  if(!entry)
+    return NULL;
+
+  len = strlen(uri_string);
+  entry->uri_string = (char*)malloc(len + 1);
+  if(!entry->uri_string) {
+    free(entry);
+    return NULL;
+  }
+  memcpy(entry->uri_string, uri_string, len + 1);
+
+  /* a failed read is remembered too, with data NULL */
+  if(raptor_uri_uri_string_is_file_uri((const unsigned char*)uri_string)) {
+    filename = raptor_uri_uri_string_to_filename((const unsigned char*)uri_string);
+    if(filename) {
+      entry->data = rasqal_cmdline_read_file_string(mw->world, filename,
+                                                    "data file",
+                                                    &entry->data_len);
+      raptor_free_memory(filename);
+    }
+  }
+
+  if(entry->data)
+    entry->format_name = raptor_world_guess_parser_name(mw->raptor_world_ptr,
+                                                        NULL, NULL,
+                                                        entry->data,
+                                                        entry->data_len,
+                                                        (const unsigned char*)uri_string);
+
+  entry->next = mw->data_cache;
+  mw->data_cache = entry;
+
+  return entry->data ? entry : NULL;
+}
+
+
+/*
+ * manifest_data_cache_data_graph:
+ * @mw: manifest world
+ * @dg: data graph read from a URI
+ * @iostreams: sequence to own the new iostream
+ *
+ * Make a copy of @dg that reads from the cached file contents.
+ *
+ * Return value: new data graph or NULL if @dg cannot use the cache
+ */
+static rasqal_data_graph*
+manifest_data_cache_data_graph(manifest_world* mw, rasqal_data_graph* dg,
+                               raptor_sequence* iostreams)
+{
+  manifest_data_cache_entry* entry;
+  raptor_iostream* iostr;
+  const char* format_name;
+
+  if(!dg->uri)
+    return NULL;
+
+  entry = manifest_data_cache_get(mw, dg->uri);
+  if(!entry)
+    return NULL;
+
+  iostr = raptor_new_iostream_from_string(mw->raptor_world_ptr,
+                                          entry->data, entry->data_len);
+  if(!iostr)
+    return NULL;
+  raptor_sequence_push(iostreams, iostr);
+
+  format_name = dg->format_name ? dg->format_name : entry->format_name;
+
+  /* same base URI as parsing from the URI would use */
+  return rasqal_new_data_graph_from_iostream(mw->world, iostr,
+                                             dg->name_uri ? dg->name_uri : dg->uri,
+                                             dg->name_uri, dg->flags,
+                                             dg->format_type, format_name,
+                                             dg->format_uri);
+}
+
+
 
 static manifest_test_result*
 manifest_new_test_result(manifest_test_state state)
@@ -466,6 +623,83 @@ manifest_decode_test_type(raptor_uri* test_type)
 }
 
 
+/*
+ * manifest_add_update_data_graphs:
+ * @mw: manifest world
+ * @ds: dataset to read from
+ * @node: update test action or result node
+ * @data_graphs: sequence to add data graphs to
+ *
+ * Add the graphs of an update test action or result: the default
+ * graph from ut:data ?uri and the named graphs from
+ * ut:graphData [ ut:graph ?uri ; rdfs:label ?name ]
+ */
+static void
+manifest_add_update_data_graphs(manifest_world* mw, rasqal_dataset* ds,
+                                rasqal_literal* node,
+                                raptor_sequence* data_graphs)
+{
+  rasqal_literal* data_node;
+  rasqal_dataset_term_iterator* iter;
+  rasqal_data_graph* dg;
+
+  data_node = rasqal_dataset_get_target(ds, node, mw->ut_data_literal);
+  if(data_node && data_node->type == RASQAL_LITERAL_URI) {
+    dg = rasqal_new_data_graph_from_uri(mw->world,
+                                        rasqal_literal_as_uri(data_node),
+                                        NULL /* graph name URI */,
+                                        RASQAL_DATA_GRAPH_BACKGROUND,
+                                        NULL /* format mime type */,
+                                        NULL /* format/parser name */,
+                                        NULL /* format URI */);
+    if(dg)
+      raptor_sequence_push(data_graphs, dg);
+  }
+
+  iter = rasqal_dataset_get_targets_iterator(ds, node,
+                                             mw->ut_graphData_literal);
+  if(!iter)
+    return;
+
+  while(1) {
+    rasqal_literal* graph_node;
+    rasqal_literal* label_node;
+    raptor_uri* name_uri = NULL;
+
+    data_node = rasqal_dataset_term_iterator_get(iter);
+    if(!data_node)
+      break;
+
+    graph_node = rasqal_dataset_get_target(ds, data_node,
+                                           mw->ut_graph_literal);
+    label_node = rasqal_dataset_get_target(ds, data_node,
+                                           mw->rdfs_label_literal);
+    if(graph_node && graph_node->type == RASQAL_LITERAL_URI) {
+      /* the graph is named by its label, else by the file URI */
+      if(label_node)
+        name_uri = raptor_new_uri(mw->raptor_world_ptr,
+                                  rasqal_literal_as_string(label_node));
+
+      dg = rasqal_new_data_graph_from_uri(mw->world,
+                                          rasqal_literal_as_uri(graph_node),
+                                          name_uri ? name_uri : rasqal_literal_as_uri(graph_node),
+                                          RASQAL_DATA_GRAPH_NAMED,
+                                          NULL /* format mime type */,
+                                          NULL /* format/parser name */,
+                                          NULL /* format URI */);
+      if(dg)
+        raptor_sequence_push(data_graphs, dg);
+      if(name_uri)
+        raptor_free_uri(name_uri);
+    }
+
+    if(rasqal_dataset_term_iterator_next(iter))
+      break;
+  }
+  rasqal_free_dataset_term_iterator(iter);
+}
+
+
 /**
  * manifest_new_test:
  * @mw: manifest world
@@ -493,6 +727,7 @@ manifest_new_test(manifest_world* mw,
   raptor_uri* test_query_uri = NULL;
   raptor_sequence* test_data_graphs = NULL;
   raptor_uri* test_result_uri = NULL;
+  raptor_sequence* test_expected_data_graphs = NULL;
   raptor_uri* test_type = NULL;
   unsigned int test_flags;
   rasqal_dataset_term_iterator* iter = NULL;
@@ -543,6 +778,11 @@ manifest_new_test(manifest_world* mw,
       node = rasqal_dataset_get_target(ds,
                                        action_node,
                                        mw->qt_query_literal);
+      if(!node)
+        /* update test */
+        node = rasqal_dataset_get_target(ds,
+                                         action_node,
+                                         mw->ut_request_literal);
     }
     if(node && node->type == RASQAL_LITERAL_URI) {
       uri = rasqal_literal_as_uri(node);
@@ -615,6 +855,8 @@ manifest_new_test(manifest_world* mw,
       rasqal_free_dataset_term_iterator(iter);
     } /* end if graphData iter */
 
+    if(action_node->type != RASQAL_LITERAL_URI)
+      manifest_add_update_data_graphs(mw, ds, action_node, test_data_graphs);
     
   } /* end if action node */
 
@@ -631,6 +873,13 @@ manifest_new_test(manifest_world* mw,
                 raptor_uri_as_string(test_result_uri));
 #endif
     }
+  } else if(node) {
+    /* update test: graphs after the update */
+    test_expected_data_graphs = raptor_new_sequence((raptor_data_free_handler)rasqal_free_data_graph,
+                                                    (raptor_data_print_handler)rasqal_data_graph_print);
+    if(test_expected_data_graphs)
+      manifest_add_update_data_graphs(mw, ds, node,
+                                      test_expected_data_graphs);
   }
 
   node = rasqal_dataset_get_target(ds,
@@ -725,6 +974,7 @@ manifest_new_test(manifest_world* mw,
   t->query = test_query_uri;
   t->data_graphs = test_data_graphs;
   t->expected_result = test_result_uri;
+  t->expected_data_graphs = test_expected_data_graphs;
   t->flags = test_flags;
 
   t->usage = 1;
@@ -763,6 +1013,8 @@ manifest_free_test(manifest_test* t)
     raptor_free_sequence(t->data_graphs);
   if(t->expected_result)
     raptor_free_uri(t->expected_result);
+  if(t->expected_data_graphs)
+    raptor_free_sequence(t->expected_data_graphs);
   if(t->result)
     manifest_free_test_result(t->result);
 
@@ -774,10 +1026,10 @@ const char*
 manifest_test_get_query_language(manifest_test* t)
 {
   const char* language = "sparql";
-  if(t->flags & FLAG_IS_UPDATE)
-    language = "sparql-update";
   if(t->flags & FLAG_LANG_SPARQL_11)
     language = "sparql11";
+  if(t->flags & FLAG_IS_UPDATE)
+    language = "sparql11-update";
   return language;
 }
 
@@ -1052,6 +1304,81 @@ manifest_test_print(FILE* fh, manifest_test* t, int indent)
 #endif
 
 
+/* Load data graphs into a store; non-0 on failure */
+static int
+manifest_store_load_data_graphs(rasqal_world* world, rasqal_store* store,
+                                raptor_sequence* data_graphs)
+{
+  rasqal_data_graph* dg;
+  int i;
+
+  if(!data_graphs)
+    return 0;
+
+  for(i = 0;
+      (dg = (rasqal_data_graph*)raptor_sequence_get_at(data_graphs, i));
+      i++) {
+    if(rasqal_store_load_data_graph(store, dg)) {
+      rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                              "Failed to load data graph %s",
+                              raptor_uri_as_string(dg->uri));
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/**
+ * manifest_test_run_update:
+ * @t: update test
+ * @rq: prepared update query
+ *
+ * Run an update test: execute the update on a store holding the test
+ * data graphs and compare the store to the expected graphs.
+ *
+ * Return value: test state
+ */
+static manifest_test_state
+manifest_test_run_update(manifest_test* t, rasqal_query* rq)
+{
+  rasqal_world* world = t->mw->world;
+  rasqal_store* store;
+  rasqal_store* expected_store;
+  manifest_test_state state = STATE_FAIL;
+
+  store = rasqal_new_store(world);
+  expected_store = rasqal_new_store(world);
+  if(!store || !expected_store)
+    goto tidy;
+
+  if(manifest_store_load_data_graphs(world, store, t->data_graphs) ||
+     manifest_store_load_data_graphs(world, expected_store,
+                                     t->expected_data_graphs))
+    goto tidy;
+
+  if(rasqal_query_execute_update(rq, store))
+    goto tidy;
+
+  if(rasqal_store_equals(store, expected_store))
+    state = STATE_PASS;
+  else
+    rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                            "Update result has %d quads, expected %d matching quads",
+                            rasqal_store_get_size(store),
+                            rasqal_store_get_size(expected_store));
+
+  tidy:
+  if(store)
+    rasqal_free_store(store);
+  if(expected_store)
+    rasqal_free_store(expected_store);
+
+  return state;
+}
+
+
 /**
  * manifest_test_run:
  * @t: test
@@ -1078,15 +1405,16 @@ manifest_test_run(manifest_test* t, const char* path)
   char* result_filename = NULL;
   raptor_iostream* result_iostr = NULL;
   rasqal_query_results *actual_results = NULL;
+  raptor_sequence* data_iostreams = NULL;
 
 #if defined(RASQAL_DEBUG) && RASQAL_DEBUG > 0
   RASQAL_DEBUG1("Running ");
   manifest_test_print(stderr, t, 0);
 #endif
 
-  if(t && t->flags & (FLAG_IS_UPDATE | FLAG_IS_PROTOCOL)) {
+  if(t && t->flags & FLAG_IS_PROTOCOL) {
     rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_WARN, NULL,
-                            "Ignoring test %s type UPDATE / PROTOCOL - not supported\n",
+                            "Ignoring test %s type PROTOCOL - not supported\n",
                             rasqal_literal_as_string(t->test_node));
     return NULL;
   }
@@ -1156,6 +1484,11 @@ manifest_test_run(manifest_test* t, const char* path)
     goto setreturnresult;
   }
 
+  if(t->flags & FLAG_IS_UPDATE) {
+    state = manifest_test_run_update(t, rq);
+    goto returnresult;
+  }
+
   /* Default to failure so we just need to set passes */
   state = STATE_FAIL;
 
@@ -1163,11 +1496,24 @@ manifest_test_run(manifest_test* t, const char* path)
   if(t->data_graphs) {
     rasqal_data_graph* dg;
 
+    /* iostreams over cached data; must outlive the query */
+    data_iostreams = raptor_new_sequence((raptor_data_free_handler)raptor_free_iostream,
+                                         NULL);
+
     while((dg = (rasqal_data_graph*)raptor_sequence_pop(t->data_graphs))) {
+      rasqal_data_graph* cached_dg = NULL;
+
+      if(data_iostreams)
+        cached_dg = manifest_data_cache_data_graph(t->mw, dg, data_iostreams);
+      if(cached_dg) {
+        rasqal_free_data_graph(dg);
+        dg = cached_dg;
+      }
+
       if(rasqal_query_add_data_graph(rq, dg)) {
         rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_ERROR, NULL,
                                 "Failed to add data graph %s to query",
-                                raptor_uri_as_string(dg->uri));
+                                dg->uri ? (const char*)raptor_uri_as_string(dg->uri) : "(cached)");
         manifest_free_test_result(result);
         result = NULL;
         goto tidy;
@@ -1356,10 +1702,11 @@ manifest_test_run(manifest_test* t, const char* path)
           if(1) {
             int rc;
             rasqal_results_compare* rrc;
+            int ordered;
 
-            /* FIXME: should NOT do this if results are expected to be ordered */
-            rasqal_query_results_sort(expected_results);
-            rasqal_query_results_sort(actual_results);
+            /* only queries with ORDER BY have a defined result order;
+             * anything else is compared as a multiset of rows */
+            ordered = (rasqal_query_get_order_condition(rq, 0) != NULL);
             
             rrc = rasqal_new_results_compare(world,
                                              expected_results, "expected",
@@ -1367,6 +1714,7 @@ manifest_test_run(manifest_test* t, const char* path)
             t->error_count = 0;
             rasqal_results_compare_set_log_handler(rrc, t,
                                                    manifest_test_run_log_handler);
+            rasqal_results_compare_set_unordered(rrc, !ordered);
             rc = rasqal_results_compare_compare(rrc);
             RASQAL_DEBUG3("rasqal_results_compare_compare returned %d - %s\n", 
                           rc, (rc ? "equal" : "different"));
@@ -1439,6 +1787,8 @@ manifest_test_run(manifest_test* t, const char* path)
     raptor_free_memory(result_filename);
   if(rq)
     rasqal_free_query(rq);
+  if(data_iostreams)
+    raptor_free_sequence(data_iostreams);
   if(query_string)
     rasqal_free_memory(query_string);
 
@@ -1490,11 +1840,269 @@ manifest_testsuite_select_tests_by_string(manifest_testsuite* ts,
 }
 
 
+static int
+manifest_test_is_runnable(manifest_test* t, int approved)
+{
+  if(t->flags & FLAG_IS_PROTOCOL)
+    return 0;
+
+  return !approved || (t->flags & FLAG_TEST_APPROVED);
+}
+
+
+#ifdef MANIFEST_PARALLEL
+static int
+manifest_write_string_record(FILE* fh, const char* str)
+{
+  int len = str ? RASQAL_GOOD_CAST(int, strlen(str)) : -1;
+
+  if(fwrite(&len, sizeof(len), 1, fh) != 1)
+    return 1;
+  if(len > 0 && fwrite(str, 1, RASQAL_GOOD_CAST(size_t, len), fh) != RASQAL_GOOD_CAST(size_t, len))
+    return 1;
+  return 0;
+}
+
+
+/* Return non-0 on failure; *str_p is set to a new string or NULL */
+static int
+manifest_read_string_record(FILE* fh, char** str_p)
+{
+  int len;
+  char* str;
+
+  *str_p = NULL;
+  if(fread(&len, sizeof(len), 1, fh) != 1)
+    return 1;
+  if(len < 0)
+    return 0;
+
+  str = (char*)malloc(RASQAL_GOOD_CAST(size_t, len) + 1);
+  if(!str)
+    return 1;
+  if(len && fread(str, 1, RASQAL_GOOD_CAST(size_t, len), fh) != RASQAL_GOOD_CAST(size_t, len)) {
+    free(str);
+    return 1;
+  }
+  str[len] = '\0';
+
+  *str_p = str;
+  return 0;
+}
+
+
+/*
+ * manifest_testsuite_run_worker:
+ * @ts: testsuite
+ * @runnable: array of indexes of runnable tests
+ * @count: size of @runnable
+ * @worker: worker number
+ * @jobs: number of workers
+ * @fh: file to write results to
+ *
+ * INTERNAL - run every @jobs'th runnable test starting at @worker
+ *
+ * Called in a forked child.  Writes one record per test: test index,
+ * state (-1 for no result), details and log, flushed after each test
+ * so the results survive a later crash.
+ */
+static void
+manifest_testsuite_run_worker(manifest_testsuite* ts,
+                              int* runnable, int count,
+                              int worker, int jobs, FILE* fh)
+{
+  int i;
+
+  for(i = worker; i < count; i += jobs) {
+    manifest_test* t;
+    manifest_test_result* result;
+    int state;
+
+    t = (manifest_test*)raptor_sequence_get_at(ts->tests, runnable[i]);
+    result = manifest_test_run(t, ts->path);
+    state = result ? RASQAL_GOOD_CAST(int, result->state) : -1;
+
+    if(fwrite(&runnable[i], sizeof(int), 1, fh) != 1 ||
+       fwrite(&state, sizeof(int), 1, fh) != 1 ||
+       manifest_write_string_record(fh, result ? result->details : NULL) ||
+       manifest_write_string_record(fh, result ? result->log : NULL))
+      i = count;
+
+    fflush(fh);
+    manifest_free_test_result(result);
+  }
+}
+
+
+/* Read worker results from @fh into the tests; returns records read */
+static int
+manifest_testsuite_read_worker_results(manifest_testsuite* ts, FILE* fh)
+{
+  int size = raptor_sequence_size(ts->tests);
+  int records = 0;
+
+  while(1) {
+    manifest_test* t;
+    manifest_test_result* result;
+    int index;
+    int state;
+    char* details = NULL;
+    char* log = NULL;
+
+    if(fread(&index, sizeof(index), 1, fh) != 1 ||
+       fread(&state, sizeof(state), 1, fh) != 1)
+      break;
+    if(manifest_read_string_record(fh, &details) ||
+       manifest_read_string_record(fh, &log) ||
+       index < 0 || index >= size || state > STATE_LAST) {
+      if(details)
+        free(details);
+      if(log)
+        free(log);
+      break;
+    }
+
+    result = manifest_new_test_result(state < 0 ? STATE_FAIL :
+                                      RASQAL_GOOD_CAST(manifest_test_state, state));
+    if(!result) {
+      free(details);
+      free(log);
+      break;
+    }
+    if(state < 0 && !details)
+      details = strdup("Test returned no result");
+    result->details = details;
+    result->log = log;
+
+    t = (manifest_test*)raptor_sequence_get_at(ts->tests, index);
+    if(t->result)
+      manifest_free_test_result(t->result);
+    t->result = result;
+    records++;
+  }
+
+  return records;
+}
+
+
+/*
+ * manifest_testsuite_run_tests_parallel:
+ * @ts: testsuite
+ * @approved: only run approved tests
+ * @jobs: number of worker processes
+ *
+ * INTERNAL - run the runnable tests of @ts in @jobs forked workers
+ *
+ * Each worker gets a private copy of the rasqal world and manifest
+ * state and runs a fixed interleaved share of the tests, so the
+ * assignment does not depend on timing.  Results come back through
+ * temporary files and are stored in each test's result field; the
+ * caller then reports them in suite order exactly as for a
+ * sequential run.
+ *
+ * Tests whose worker could not be started are left without a result
+ * for the caller to run in-process.  Tests whose worker exited
+ * without reporting them fail.
+ *
+ * Return value: number of workers started
+ */
+static int
+manifest_testsuite_run_tests_parallel(manifest_testsuite* ts,
+                                      int approved, int jobs)
+{
+  int size = raptor_sequence_size(ts->tests);
+  int* runnable = NULL;
+  FILE** files = NULL;
+  pid_t* pids = NULL;
+  int count = 0;
+  int started = 0;
+  int i;
+  int w;
+
+  runnable = (int*)malloc(sizeof(int) * RASQAL_GOOD_CAST(size_t, size + 1));
+  if(!runnable)
+    goto tidy;
+
+  for(i = 0; i < size; i++) {
+    manifest_test* t = (manifest_test*)raptor_sequence_get_at(ts->tests, i);
+    if(manifest_test_is_runnable(t, approved))
+      runnable[count++] = i;
+  }
+
+  if(jobs > count)
+    jobs = count;
+  if(jobs < 2)
+    goto tidy;
+
+  files = (FILE**)calloc(RASQAL_GOOD_CAST(size_t, jobs), sizeof(FILE*));
+  pids = (pid_t*)calloc(RASQAL_GOOD_CAST(size_t, jobs), sizeof(pid_t));
+  if(!files || !pids)
+    goto tidy;
+
+  /* do not duplicate buffered output into the children */
+  fflush(stdout);
+  fflush(stderr);
+
+  for(w = 0; w < jobs; w++) {
+    files[w] = tmpfile();
+    if(!files[w])
+      break;
+
+    pids[w] = fork();
+    if(pids[w] < 0) {
+      fclose(files[w]);
+      files[w] = NULL;
+      break;
+    }
+
+    if(!pids[w]) {
+      manifest_testsuite_run_worker(ts, runnable, count, w, jobs, files[w]);
+      fflush(NULL);
+      _exit(0);
+    }
+  }
+  started = w;
+
+  for(w = 0; w < started; w++) {
+    int status;
+
+    while(waitpid(pids[w], &status, 0) < 0 && errno == EINTR)
+      ;
+
+    rewind(files[w]);
+    manifest_testsuite_read_worker_results(ts, files[w]);
+    fclose(files[w]);
+
+    for(i = w; i < count; i += jobs) {
+      manifest_test* t;
+
+      t = (manifest_test*)raptor_sequence_get_at(ts->tests, runnable[i]);
+      if(!t->result) {
+        t->result = manifest_new_test_result(STATE_FAIL);
+        if(t->result)
+          t->result->details = strdup("Test worker exited before reporting a result");
+      }
+    }
+  }
+
+  tidy:
+  if(pids)
+    free(pids);
+  if(files)
+    free(files);
+  if(runnable)
+    free(runnable);
+
+  return started;
+}
+#endif
+
+
 manifest_test_result*
 manifest_testsuite_run_suite(manifest_testsuite* ts,
                              unsigned int indent,
                              int dryrun, int verbose,
-                             int approved)
+                             int approved, int jobs)
 {
   rasqal_world* world = ts->mw->world;
   char* name = ts->name;
@@ -1514,11 +2122,17 @@ manifest_testsuite_run_suite(manifest_testsuite* ts,
   manifest_indent(stdout, indent);
   fprintf(stdout, "Running testsuite %s: %s\n", name, desc);
 
+#ifdef MANIFEST_PARALLEL
+  /* Fills in results of the tests that the loop below would run */
+  if(jobs > 1 && !dryrun)
+    manifest_testsuite_run_tests_parallel(ts, approved, jobs);
+#endif
+
   column = indent;
   for(i = 0; (t = (manifest_test*)raptor_sequence_get_at(ts->tests, i)); i++) {
-    if(t->flags & (FLAG_IS_UPDATE | FLAG_IS_PROTOCOL)) {
+    if(t->flags & FLAG_IS_PROTOCOL) {
       rasqal_log_error_simple(world, RAPTOR_LOG_LEVEL_WARN, NULL,
-                              "Ignoring test %s type UPDATE / PROTOCOL - not supported\n",
+                              "Ignoring test %s type PROTOCOL - not supported\n",
                               rasqal_literal_as_string(t->test_node));
       t->result = manifest_new_test_result(STATE_SKIP);
     } else if(approved && !(t->flags & (FLAG_TEST_APPROVED))) {
@@ -1528,7 +2142,8 @@ manifest_testsuite_run_suite(manifest_testsuite* ts,
       t->result = manifest_new_test_result(STATE_SKIP);
     } else if(dryrun) {
       t->result = manifest_new_test_result(STATE_SKIP);
-    } else {
+    } else if(!t->result) {
+      /* not already run by a worker */
       t->result = manifest_test_run(t, ts->path);
     }
 
@@ -1599,6 +2214,7 @@ manifest_testsuite_run_suite(manifest_testsuite* ts,
  * @dryrun: dryrun
  * @verbose: verbose
  * @approved: approved
+ * @jobs: number of tests to run at once
  *
  * Run the given manifest testsuites returning a test result
  *
@@ -1610,7 +2226,7 @@ manifest_manifests_run(manifest_world* mw,
                        raptor_uri* base_uri,
                        const char* test_string,
                        unsigned int indent,
-                       int dryrun, int verbose, int approved)
+                       int dryrun, int verbose, int approved, int jobs)
 {
   manifest_test_state total_state = STATE_PASS;
   manifest_test_result* total_result = NULL;
@@ -1642,7 +2258,7 @@ manifest_manifests_run(manifest_world* mw,
       manifest_testsuite_select_tests_by_string(ts, test_string);
 
     result = manifest_testsuite_run_suite(ts, indent, dryrun, verbose,
-                                          approved);
+                                          approved, jobs);
 
     if(result) {
       manifest_testsuite_result_format(stdout, result, ts->name,
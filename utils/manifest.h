@@ -43,7 +43,7 @@ typedef enum
 typedef enum {
   /* these are alternatives */
   FLAG_IS_QUERY     = 1, /* SPARQL query; lang="sparql10" or "sparql11" */
-  FLAG_IS_UPDATE    = 2, /* SPARQL update; lang="sparql-update" */
+  FLAG_IS_UPDATE    = 2, /* SPARQL update; lang="sparql11-update" */
   FLAG_IS_PROTOCOL  = 4, /* SPARQL protocol */
   FLAG_IS_SYNTAX    = 8, /* syntax test: implies no execution */
 
@@ -58,11 +58,25 @@ typedef enum {
 } manifest_test_type_bitflags;
 
 
+/* data file contents kept in memory for reuse across tests */
+typedef struct manifest_data_cache_entry_s
+{
+  struct manifest_data_cache_entry_s* next;
+  char* uri_string;
+  unsigned char* data;
+  size_t data_len;
+  const char* format_name; /* guessed raptor parser name (static) */
+} manifest_data_cache_entry;
+
+
 typedef struct
 {
   rasqal_world* world;
   raptor_world* raptor_world_ptr;
 
+  /* list of data files read so far */
+  manifest_data_cache_entry* data_cache;
+
   /* Namespace URIs */
   raptor_uri* rdfs_namespace_uri;
   raptor_uri* mf_namespace_uri;
@@ -70,6 +84,7 @@ typedef struct
   raptor_uri* qt_namespace_uri;
   raptor_uri* dawgt_namespace_uri;
   raptor_uri* sd_namespace_uri;
+  raptor_uri* ut_namespace_uri;
 
   /* URIs */
   raptor_uri* mf_Manifest_uri;
@@ -89,6 +104,11 @@ typedef struct
   raptor_uri* qt_query_uri;
   raptor_uri* dawgt_approval_uri;
   raptor_uri* sd_entailmentRegime_uri;
+  raptor_uri* rdfs_label_uri;
+  raptor_uri* ut_request_uri;
+  raptor_uri* ut_data_uri;
+  raptor_uri* ut_graphData_uri;
+  raptor_uri* ut_graph_uri;
 
   /* Literals */
   rasqal_literal* mf_Manifest_literal;
@@ -107,6 +127,11 @@ typedef struct
   rasqal_literal* qt_query_literal;
   rasqal_literal* dawgt_approval_literal;
   rasqal_literal* sd_entailmentRegime_literal;
+  rasqal_literal* rdfs_label_literal;
+  rasqal_literal* ut_request_literal;
+  rasqal_literal* ut_data_literal;
+  rasqal_literal* ut_graphData_literal;
+  rasqal_literal* ut_graph_literal;
 } manifest_world;
 
   
@@ -131,6 +156,7 @@ typedef struct
   raptor_uri* query; /* <test-uri> qt:query ?uri */
   raptor_sequence* data_graphs;  /* sequence of data graphs. background graph <test-uri> qt:data ?uri and named graphs <test-uri> qt:dataGraph ?uri */
   raptor_uri* expected_result; /* <test-uri> mf:result ?uri */
+  raptor_sequence* expected_data_graphs; /* update tests: sequence of data graphs after the update from <test-uri> mf:result [ ut:data ?uri ; ut:graphData ?node ] */
   unsigned int flags; /* bit flags from #manifest_test_type_bitflags */
 
   /* Test output */
@@ -159,9 +185,9 @@ void manifest_free_world(manifest_world* mw);
 /* test */
 const char* manifest_test_get_query_language(manifest_test* t);
 
-manifest_test_result* manifest_manifests_run(manifest_world* mw, raptor_sequence* manifest_uris, raptor_uri* base_uri, const char* test_string, unsigned int indent, int dryrun, int verbose, int approved);
+manifest_test_result* manifest_manifests_run(manifest_world* mw, raptor_sequence* manifest_uris, raptor_uri* base_uri, const char* test_string, unsigned int indent, int dryrun, int verbose, int approved, int jobs);
 
-manifest_test_result* manifest_testsuite_run_suite(manifest_testsuite* ts, unsigned int indent, int dryrun, int verbose, int approved);
+manifest_test_result* manifest_testsuite_run_suite(manifest_testsuite* ts, unsigned int indent, int dryrun, int verbose, int approved, int jobs);
 
 /* test results */
 void manifest_free_test_result(manifest_test_result* result);
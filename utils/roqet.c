@@ -87,9 +87,9 @@ static char *program=NULL;
 
 #ifdef RASQAL_INTERNAL
 /* add 'g:' */
-#define GETOPT_STRING "cd:D:e:Ef:F:g:G:hi:np:qr:R:s:t:vW:"
+#define GETOPT_STRING "cd:D:e:Ef:F:g:G:hi:j:np:qr:R:s:t:vW:"
 #else
-#define GETOPT_STRING "cd:D:e:Ef:F:G:hi:np:qr:R:s:t:vW:"
+#define GETOPT_STRING "cd:D:e:Ef:F:G:hi:j:np:qr:R:s:t:vW:"
 #endif
 
 #ifdef HAVE_GETOPT_LONG
@@ -111,6 +111,7 @@ static struct option long_options[] =
   {"named", 1, 0, 'G'},
   {"help", 0, 0, 'h'},
   {"input", 1, 0, 'i'},
+  {"threads", 1, 0, 'j'},
   {"dryrun", 0, 0, 'n'},
   {"protocol", 0, 0, 'p'},
   {"quiet", 0, 0, 'q'},
@@ -133,6 +134,7 @@ static int warning_count = 0;
 
 static int warning_level = -1;
 static int ignore_errors = 0;
+static int info_messages = 1;
 
 static const char *title_string = "Rasqal RDF query utility ";
 
@@ -164,10 +166,17 @@ roqet_log_handler(void *data, raptor_log_message *message)
       warning_count++;
       break;
 
+    case RAPTOR_LOG_LEVEL_INFO:
+      if(info_messages) {
+        fprintf(stderr, "%s: ", program);
+        raptor_locator_print(message->locator, stderr);
+        fprintf(stderr, " - %s\n", message->text);
+      }
+      break;
+
     case RAPTOR_LOG_LEVEL_NONE:
     case RAPTOR_LOG_LEVEL_TRACE:
     case RAPTOR_LOG_LEVEL_DEBUG:
-    case RAPTOR_LOG_LEVEL_INFO:
 
       fprintf(stderr, "%s: Unexpected %s message - ", program,
               raptor_log_level_get_label(message->level));
@@ -673,7 +682,20 @@ roqet_init_query(rasqal_world *world,
     goto tidy_query;
   }
 
-  if(data_graphs) {
+  if(data_graphs && rasqal_query_get_update_operation(rq, 0)) {
+    rasqal_data_graph* dg;
+    int i;
+
+    /* updates change the world dataset so load the data into it */
+    for(i = 0; (dg = (rasqal_data_graph*)raptor_sequence_get_at(data_graphs, i)); i++) {
+      if(rasqal_world_add_data_graph(world, dg)) {
+        fprintf(stderr, "%s: Failed to add data graph to the dataset\n",
+                program);
+        rasqal_free_query(rq); rq = NULL;
+        goto tidy_query;
+      }
+    }
+  } else if(data_graphs) {
     rasqal_data_graph* dg;
     
     while((dg = (rasqal_data_graph*)raptor_sequence_pop(data_graphs))) {
@@ -835,6 +857,7 @@ print_help(rasqal_world* world, raptor_world* raptor_world_ptr)
   puts(HELP_TEXT("F NAME", "format NAME", "Set data source format name (default: guess)"));
   puts(HELP_TEXT("G URI", "named URI   ", "RDF named graph data source URI"));
   puts(HELP_TEXT("h", "help            ", "Print this help, then exit"));
+  puts(HELP_TEXT("j N", "threads N       ", "Load N-Triples data with up to N threads"));
   puts(HELP_TEXT("n", "dryrun          ", "Prepare but do not run the query"));
   puts(HELP_TEXT("q", "quiet           ", "No extra information messages"));
   puts(HELP_TEXT("s URI", "source URI  ", "Same as `-G URI'"));
@@ -1078,7 +1101,7 @@ main(int argc, char *argv[])
             if(!rasqal_query_results_formats_check2(world, optarg,
                                                     NULL /* uri */,
                                                     NULL /* mime type */,
-                                                    RASQAL_QUERY_RESULTS_FORMAT_FLAG_READER)) {
+                                                    RASQAL_QUERY_RESULTS_FORMAT_FLAG_WRITER)) {
               fprintf(stderr,
                       "%s: invalid output result format `%s' for `" HELP_ARG(r, results)  "'\nTry '%s -h' for a list of valid formats\n",
                       program, optarg, program);
@@ -1104,6 +1127,18 @@ main(int argc, char *argv[])
         }
         break;
 
+      case 'j':
+        if(optarg) {
+          int threads = atoi(optarg);
+
+          if(rasqal_world_set_load_threads(world, threads)) {
+            fprintf(stderr, "%s: Invalid number of threads `%s'\n",
+                    program, optarg);
+            usage = 1;
+          }
+        }
+        break;
+
       case 'i':
         if(rasqal_language_name_check(world, optarg))
           ql_name = optarg;
@@ -1128,6 +1163,7 @@ main(int argc, char *argv[])
 
       case 'q':
         quiet = 1;
+        info_messages = 0;
         break;
 
       case 's':
@@ -82,7 +82,7 @@ static char *program = NULL;
 #endif
 
 
-#define GETOPT_STRING "ahnqt:v"
+#define GETOPT_STRING "ahj:nqt:v"
 
 #ifdef HAVE_GETOPT_LONG
 
@@ -91,6 +91,7 @@ static struct option long_options[] =
   /* name, has_arg, flag, val */
   {"approved", 0, 0, 'a'},
   {"help", 0, 0, 'h'},
+  {"jobs", 1, 0, 'j'},
   {"dryrun", 0, 0, 'n'},
   {"quiet", 0, 0, 'q'},
   {"test", 1, 0, 't'},
@@ -159,6 +160,7 @@ print_help(rasqal_world* world, raptor_world* raptor_world_ptr)
   puts("\nOptions:");
   puts(HELP_TEXT("a", "approved        ", "Run only approved tests"));
   puts(HELP_TEXT("h", "help            ", "Print this help, then exit"));
+  puts(HELP_TEXT("j N", "jobs N        ", "Run tests in N worker processes (default 1)"));
   puts(HELP_TEXT("n", "dryrun          ", "Prepare but do not run the query"));
   puts(HELP_TEXT("q", "quiet           ", "No extra information messages"));
   puts(HELP_TEXT("t TEST", "test TEST  ", "Run just one TEST"));
@@ -183,6 +185,7 @@ main(int argc, char *argv[])
   int quiet = 0;
   int dryrun = 0;
   int approved = 0;
+  int jobs = 1;
   manifest_world* mw;
   raptor_sequence* seq;
   manifest_test_result* result;
@@ -233,6 +236,17 @@ main(int argc, char *argv[])
         help = 1;
         break;
 
+      case 'j':
+        if(optarg) {
+          jobs = atoi(optarg);
+          if(jobs < 1) {
+            fprintf(stderr, "%s: Invalid number of jobs `%s'\n",
+                    program, optarg);
+            usage = 1;
+          }
+        }
+        break;
+
       case 'n':
         dryrun = 1;
         break;
@@ -317,7 +331,7 @@ main(int argc, char *argv[])
   result = manifest_manifests_run(mw, seq, base_uri,
                                   test_string,
                                   /* indent */ 0,
-                                  dryrun, !quiet, approved);
+                                  dryrun, !quiet, approved, jobs);
   raptor_free_sequence(seq);
 
   if(result) {